@@ -38,143 +38,384 @@
 #include "flash_memory.h"
 #include "error.h"
 #include "mem_code.h"
+#include "hw/sh4/sh4_code_cache.h"
 
 #include "MemoryMap.h"
 
 static struct BiosFile *bios;
 static struct Memory *mem;
 
-static inline int read_area0(void *buf, size_t addr, size_t len);
-static inline int write_area0(void const *buf, size_t addr, size_t len);
-static inline int read_area3(void *buf, size_t addr, size_t len);
-static inline int write_area3(void const *buf, size_t addr, size_t len);
-static inline int read_area4(void *buf, size_t addr, size_t len);
-static inline int write_area4(void const *buf, size_t addr, size_t len);
+struct memory_map_page memory_map_pages[MEMORY_MAP_N_PAGES];
+
+static int read_area3(void *buf, size_t addr, size_t len);
+static int write_area3(void const *buf, size_t addr, size_t len);
+static int read_bios(void *buf, size_t addr, size_t len);
+static int write_bios(void const *buf, size_t addr, size_t len);
+static int read_sys_page(void *buf, size_t addr, size_t len);
+static int write_sys_page(void const *buf, size_t addr, size_t len);
+static int read_area0_unmapped(void *buf, size_t addr, size_t len);
+static int write_area0_unmapped(void const *buf, size_t addr, size_t len);
+static int read_area4_unmapped(void *buf, size_t addr, size_t len);
+static int write_area4_unmapped(void const *buf, size_t addr, size_t len);
+static int write_area4_tex64(void const *buf, size_t addr, size_t len);
+static int write_area4_tex32(void const *buf, size_t addr, size_t len);
+static int read_unmapped(void *buf, size_t addr, size_t len);
+static int write_unmapped(void const *buf, size_t addr, size_t len);
+
+static int region_read(struct memory_map_region const *region,
+                       void *buf, size_t addr, size_t len);
+static int region_write(struct memory_map_region const *region,
+                        void const *buf, size_t addr, size_t len);
+
+static void memory_map_build(void);
+
+#define REGION(first, last, mask, read, write) \
+    { (first), (last), (mask), (read), (write) }
+
+#define AREA0_REGION(name, read, write)                         \
+    REGION(ADDR_##name##_FIRST, ADDR_##name##_LAST, ADDR_AREA0_MASK,    \
+           (read), (write))
+
+static struct memory_map_region const region_area3 =
+    REGION(ADDR_AREA3_FIRST, ADDR_AREA3_LAST, MEMORY_MAP_ADDR_MASK,
+           read_area3, write_area3);
+static struct memory_map_region const region_tex32 =
+    REGION(ADDR_TEX32_FIRST, ADDR_TEX32_LAST, MEMORY_MAP_ADDR_MASK,
+           pvr2_tex_mem_area32_read, pvr2_tex_mem_area32_write);
+static struct memory_map_region const region_tex64 =
+    REGION(ADDR_TEX64_FIRST, ADDR_TEX64_LAST, MEMORY_MAP_ADDR_MASK,
+           pvr2_tex_mem_area64_read, pvr2_tex_mem_area64_write);
+static struct memory_map_region const region_ta_fifo_poly =
+    REGION(ADDR_TA_FIFO_POLY_FIRST, ADDR_TA_FIFO_POLY_LAST,
+           MEMORY_MAP_ADDR_MASK,
+           pvr2_ta_fifo_poly_read, pvr2_ta_fifo_poly_write);
+
+/*
+ * the TA's direct texture paths.  These are write-only windows into texture
+ * memory; software usually fills them with store queues or channel-2 DMA.
+ */
+static struct memory_map_region const region_area4_tex64 =
+    REGION(ADDR_AREA4_TEX64_FIRST, ADDR_AREA4_TEX64_LAST, MEMORY_MAP_ADDR_MASK,
+           read_area4_unmapped, write_area4_tex64);
+static struct memory_map_region const region_area4_tex32 =
+    REGION(ADDR_AREA4_TEX32_FIRST, ADDR_AREA4_TEX32_LAST, MEMORY_MAP_ADDR_MASK,
+           read_area4_unmapped, write_area4_tex32);
+
+static struct memory_map_region const region_bios =
+    AREA0_REGION(BIOS, read_bios, write_bios);
+static struct memory_map_region const region_flash =
+    AREA0_REGION(FLASH, flash_mem_read, flash_mem_write);
+static struct memory_map_region const region_modem =
+    AREA0_REGION(MODEM, modem_read, modem_write);
+static struct memory_map_region const region_aica =
+    AREA0_REGION(AICA, aica_reg_read, aica_reg_write);
+static struct memory_map_region const region_aica_rtc =
+    AREA0_REGION(AICA_RTC, aica_rtc_read, aica_rtc_write);
+static struct memory_map_region const region_aica_wave =
+    AREA0_REGION(AICA_WAVE, aica_wave_mem_read, aica_wave_mem_write);
+
+/*
+ * all the system block registers (g1, g2, pvr2, etc) are crammed into a single
+ * 64KB page, so that page gets a region of its own that does a second lookup
+ * in sys_page_regions.
+ */
+#define SYS_PAGE_SHIFT 8
+#define SYS_PAGE_N_ENTRIES (1 << (MEMORY_MAP_PAGE_SHIFT - SYS_PAGE_SHIFT))
+
+static struct memory_map_region const region_sys_page =
+    REGION(0, ADDR_AREA0_MASK, ADDR_AREA0_MASK,
+           read_sys_page, write_sys_page);
+
+static struct memory_map_region const region_sys =
+    AREA0_REGION(SYS, sys_block_read, sys_block_write);
+static struct memory_map_region const region_maple =
+    AREA0_REGION(MAPLE, maple_reg_read, maple_reg_write);
+static struct memory_map_region const region_gdrom =
+    AREA0_REGION(GDROM, gdrom_reg_read, gdrom_reg_write);
+static struct memory_map_region const region_g1 =
+    AREA0_REGION(G1, g1_reg_read, g1_reg_write);
+static struct memory_map_region const region_g2 =
+    AREA0_REGION(G2, g2_reg_read, g2_reg_write);
+static struct memory_map_region const region_pvr2 =
+    AREA0_REGION(PVR2, pvr2_reg_read, pvr2_reg_write);
+static struct memory_map_region const region_pvr2_core =
+    AREA0_REGION(PVR2_CORE, pvr2_core_reg_read, pvr2_core_reg_write);
+
+static struct memory_map_region const *sys_page_regions[SYS_PAGE_N_ENTRIES];
+
+// error handlers for the parts of the address space that aren't mapped
+static struct memory_map_region const region_area0_unmapped =
+    REGION(0, ADDR_AREA0_MASK, ADDR_AREA0_MASK,
+           read_area0_unmapped, write_area0_unmapped);
+static struct memory_map_region const region_area4_unmapped =
+    REGION(0, MEMORY_MAP_ADDR_MASK, MEMORY_MAP_ADDR_MASK,
+           read_area4_unmapped, write_area4_unmapped);
+static struct memory_map_region const region_unmapped =
+    REGION(0, MEMORY_MAP_ADDR_MASK, MEMORY_MAP_ADDR_MASK,
+           read_unmapped, write_unmapped);
 
 void memory_map_init(BiosFile *bios_new, struct Memory *mem_new) {
-    memory_map_set_bios(bios_new);
-    memory_map_set_mem(mem_new);
+    bios = bios_new;
+    mem = mem_new;
+    memory_map_build();
 }
 
 void memory_map_set_bios(BiosFile *bios_new) {
     bios = bios_new;
+    memory_map_build();
 }
 
 void memory_map_set_mem(struct Memory *mem_new) {
     mem = mem_new;
+    memory_map_build();
 }
 
-int memory_map_read(void *buf, size_t addr, size_t len) {
-    size_t first_addr = addr;
-    size_t last_addr = addr + (len - 1);
-
-    // check RAM first because that's the case we want to optimize for
-    if (first_addr >= ADDR_AREA3_FIRST && last_addr <= ADDR_AREA3_LAST) {
-        return read_area3(buf, addr, len);
-    } else if (first_addr >= ADDR_TEX32_FIRST && last_addr <= ADDR_TEX32_LAST) {
-        return pvr2_tex_mem_area32_read(buf, addr, len);
-    } else if (first_addr >= ADDR_TEX64_FIRST && last_addr <= ADDR_TEX64_LAST) {
-        return pvr2_tex_mem_area64_read(buf, addr, len);
-    } else if (addr >= ADDR_AREA0_FIRST && addr <= ADDR_AREA0_LAST) {
-        return read_area0(buf, addr, len);
-    } else if (first_addr >= ADDR_AREA4_FIRST && last_addr <= ADDR_AREA4_LAST) {
-        return read_area4(buf, addr, len);
+static void map_pages(addr32_t first, addr32_t last,
+                      struct memory_map_region const *region,
+                      uint8_t *read_ptr, uint8_t *write_ptr, unsigned flags) {
+    unsigned page_no;
+    for (page_no = first >> MEMORY_MAP_PAGE_SHIFT;
+         page_no <= (last >> MEMORY_MAP_PAGE_SHIFT); page_no++) {
+        struct memory_map_page *page = memory_map_pages + page_no;
+        size_t offs = (page_no << MEMORY_MAP_PAGE_SHIFT) - first;
+
+        page->region = region;
+        page->read_ptr = read_ptr ? read_ptr + offs : NULL;
+        page->write_ptr = write_ptr ? write_ptr + offs : NULL;
+        page->flags = flags;
     }
+}
 
-    error_set_feature("memory mapping");
-    error_set_address(addr);
-    error_set_length(len);
-    PENDING_ERROR(ERROR_UNIMPLEMENTED);
-    return MEM_ACCESS_FAILURE;
+static void map_area0(addr32_t base) {
+    unsigned page_no;
+
+    map_pages(base, base + ADDR_AREA0_MASK, &region_area0_unmapped,
+              NULL, NULL, 0);
 
-boundary_cross:
     /*
-     * this label is where we go to when the requested read is not
-     * contained entirely withing a single mapping.
+     * The BIOS can only be read directly if the file actually covers the whole
+     * page; anything else goes through bios_file_read so that it can complain
+     * about it.
      */
-    error_set_feature("proper response for when the guest reads past a memory "
-                      "map's end");
-    error_set_length(len);
-    error_set_address(addr);
-    PENDING_ERROR(ERROR_UNIMPLEMENTED);
-    return MEM_ACCESS_FAILURE;
+    map_pages(base + ADDR_BIOS_FIRST, base + ADDR_BIOS_LAST, &region_bios,
+              NULL, NULL, 0);
+    if (bios && bios->dat) {
+        for (page_no = 0;
+             (page_no + 1) * MEMORY_MAP_PAGE_SIZE <= bios->dat_len &&
+                 page_no <= (ADDR_BIOS_LAST >> MEMORY_MAP_PAGE_SHIFT);
+             page_no++) {
+            memory_map_pages[(base >> MEMORY_MAP_PAGE_SHIFT) + page_no].read_ptr =
+                bios->dat + page_no * MEMORY_MAP_PAGE_SIZE;
+        }
+    }
+
+    map_pages(base + ADDR_FLASH_FIRST, base + ADDR_FLASH_LAST, &region_flash,
+              NULL, NULL, 0);
+    map_pages(base + ADDR_SYS_FIRST, base + ADDR_PVR2_CORE_LAST,
+              &region_sys_page, NULL, NULL, 0);
+    map_pages(base + ADDR_MODEM_FIRST, base + ADDR_MODEM_LAST, &region_modem,
+              NULL, NULL, 0);
+    map_pages(base + ADDR_AICA_FIRST, base + ADDR_AICA_LAST, &region_aica,
+              NULL, NULL, 0);
+    map_pages(base + ADDR_AICA_RTC_FIRST, base + ADDR_AICA_RTC_LAST,
+              &region_aica_rtc, NULL, NULL, 0);
+    map_pages(base + ADDR_AICA_WAVE_FIRST, base + ADDR_AICA_WAVE_LAST,
+              &region_aica_wave, aica_wave_mem, aica_wave_mem, 0);
 }
 
-int memory_map_write(void const *buf, size_t addr, size_t len) {
-    size_t first_addr = addr;
-    size_t last_addr = addr + (len - 1);
-
-    // check RAM first because that's the case we want to optimize for
-    if (first_addr >= ADDR_AREA3_FIRST && last_addr <= ADDR_AREA3_LAST) {
-        return write_area3(buf, addr, len);
-    } else if (first_addr >= ADDR_TEX32_FIRST && last_addr <= ADDR_TEX32_LAST) {
-        return pvr2_tex_mem_area32_write(buf, addr, len);
-    } else if (first_addr >= ADDR_TEX64_FIRST && last_addr <= ADDR_TEX64_LAST) {
-        return pvr2_tex_mem_area64_write(buf, addr, len);
-    } else if (first_addr >= ADDR_AREA0_FIRST && last_addr <= ADDR_AREA0_LAST) {
-        return write_area0(buf, addr, len);
-    } else if (first_addr >= ADDR_AREA4_FIRST && last_addr <= ADDR_AREA4_LAST) {
-        return write_area4(buf, addr, len);
+static void map_sys_page(addr32_t first, addr32_t last,
+                         struct memory_map_region const *region) {
+    unsigned idx;
+    for (idx = (first & MEMORY_MAP_PAGE_MASK) >> SYS_PAGE_SHIFT;
+         idx <= (last & MEMORY_MAP_PAGE_MASK) >> SYS_PAGE_SHIFT; idx++)
+        sys_page_regions[idx] = region;
+}
+
+static void memory_map_build(void) {
+    unsigned idx;
+    addr32_t addr;
+
+    for (idx = 0; idx < SYS_PAGE_N_ENTRIES; idx++)
+        sys_page_regions[idx] = &region_area0_unmapped;
+    map_sys_page(ADDR_SYS_FIRST, ADDR_SYS_LAST, &region_sys);
+    map_sys_page(ADDR_MAPLE_FIRST, ADDR_MAPLE_LAST, &region_maple);
+    map_sys_page(ADDR_GDROM_FIRST, ADDR_GDROM_LAST, &region_gdrom);
+    map_sys_page(ADDR_G1_FIRST, ADDR_G1_LAST, &region_g1);
+    map_sys_page(ADDR_G2_FIRST, ADDR_G2_LAST, &region_g2);
+    map_sys_page(ADDR_PVR2_FIRST, ADDR_PVR2_LAST, &region_pvr2);
+    map_sys_page(ADDR_PVR2_CORE_FIRST, ADDR_PVR2_CORE_LAST, &region_pvr2_core);
+
+    map_pages(0, MEMORY_MAP_ADDR_MASK, &region_unmapped, NULL, NULL, 0);
+
+    // area 0 shows up twice in a row
+    for (addr = ADDR_AREA0_FIRST; addr <= ADDR_AREA0_LAST;
+         addr += ADDR_AREA0_MASK + 1)
+        map_area0(addr);
+
+    /*
+     * Reads from 64-bit texture memory have no side-effects, but writes need
+     * to go through pvr2_tex_mem_area64_write so it can let the texture cache
+     * know.  The 32-bit area might need to sync the framebuffer first so that
+     * one always goes through the handler.
+     */
+    map_pages(ADDR_TEX64_FIRST, ADDR_TEX64_LAST, &region_tex64,
+              pvr2_tex64_mem, NULL, 0);
+    map_pages(ADDR_TEX32_FIRST, ADDR_TEX32_LAST, &region_tex32,
+              NULL, NULL, 0);
+
+    // RAM gets mirrored across all of area 3
+    for (addr = ADDR_AREA3_FIRST; addr <= ADDR_AREA3_LAST;
+         addr += MEMORY_SIZE) {
+        uint8_t *ram = mem ? mem->mem : NULL;
+        map_pages(addr, addr + (MEMORY_SIZE - 1), &region_area3,
+                  ram, ram, MEMORY_MAP_PAGE_CODE);
     }
 
-    error_set_feature("memory mapping");
-    error_set_address(addr);
-    error_set_length(len);
-    PENDING_ERROR(ERROR_UNIMPLEMENTED);
-    return MEM_ACCESS_FAILURE;
+    map_pages(ADDR_AREA4_FIRST, ADDR_AREA4_LAST, &region_area4_unmapped,
+              NULL, NULL, 0);
+    map_pages(ADDR_TA_FIFO_POLY_FIRST, ADDR_TA_FIFO_POLY_LAST,
+              &region_ta_fifo_poly, NULL, NULL, 0);
+    map_pages(ADDR_AREA4_TEX64_FIRST, ADDR_AREA4_TEX64_LAST,
+              &region_area4_tex64, NULL, NULL, 0);
+    map_pages(ADDR_AREA4_TEX32_FIRST, ADDR_AREA4_TEX32_LAST,
+              &region_area4_tex32, NULL, NULL, 0);
+}
 
-boundary_cross:
-    /* when the write is not contained entirely within one mapping */
-    error_set_feature("proper response for when the guest writes past a memory "
-                      "map's end");
-    error_set_length(len);
-    error_set_address(addr);
-    PENDING_ERROR(ERROR_UNIMPLEMENTED);
-    return MEM_ACCESS_FAILURE;
+int memory_map_read(void *buf, size_t addr, size_t len) {
+    uint8_t *dst = (uint8_t*)buf;
+
+    if (addr > MEMORY_MAP_ADDR_MASK)
+        return read_unmapped(buf, addr, len);
+
+    /*
+     * pages that are backed by host memory get copied one page at a time.
+     * As soon as we hit a page that isn't, the rest of the access goes to
+     * that page's region all at once, so that accesses that span more than one
+     * page in the same region still work and accesses that cross into a
+     * different region still fail the way they always have.
+     */
+    while (len) {
+        struct memory_map_page const *page =
+            memory_map_pages + (addr >> MEMORY_MAP_PAGE_SHIFT);
+        size_t offs = addr & MEMORY_MAP_PAGE_MASK;
+        size_t chunk = MEMORY_MAP_PAGE_SIZE - offs;
+
+        if (!page->read_ptr)
+            return region_read(page->region, dst, addr, len);
+
+        if (chunk > len)
+            chunk = len;
+        memcpy(dst, page->read_ptr + offs, chunk);
+
+        dst += chunk;
+        addr += chunk;
+        len -= chunk;
+
+        if (len && addr > MEMORY_MAP_ADDR_MASK)
+            return read_unmapped(dst, addr, len);
+    }
+
+    return MEM_ACCESS_SUCCESS;
 }
 
-static inline int read_area0(void *buf, size_t addr, size_t len) {
-    addr &= ADDR_AREA0_MASK;
-    size_t first_addr = addr;
-    size_t last_addr = addr + (len - 1);
+int memory_map_write(void const *buf, size_t addr, size_t len) {
+    uint8_t const *src = (uint8_t const*)buf;
+
+    if (addr > MEMORY_MAP_ADDR_MASK)
+        return write_unmapped(buf, addr, len);
+
+    // see memory_map_read
+    while (len) {
+        struct memory_map_page const *page =
+            memory_map_pages + (addr >> MEMORY_MAP_PAGE_SHIFT);
+        size_t offs = addr & MEMORY_MAP_PAGE_MASK;
+        size_t chunk = MEMORY_MAP_PAGE_SIZE - offs;
+
+        if (!page->write_ptr)
+            return region_write(page->region, src, addr, len);
+
+        if (chunk > len)
+            chunk = len;
+        if (page->flags & MEMORY_MAP_PAGE_CODE)
+            sh4_code_cache_notify_write(addr & ADDR_AREA3_MASK, chunk);
+        memcpy(page->write_ptr + offs, src, chunk);
+
+        src += chunk;
+        addr += chunk;
+        len -= chunk;
 
-    if (last_addr <= ADDR_BIOS_LAST) {
+        if (len && addr > MEMORY_MAP_ADDR_MASK)
+            return write_unmapped(src, addr, len);
+    }
+
+    return MEM_ACCESS_SUCCESS;
+}
+
+static int region_read(struct memory_map_region const *region,
+                       void *buf, size_t addr, size_t len) {
+    addr &= region->mask;
+    if (addr < region->first || addr + (len - 1) > region->last) {
         /*
-         * XXX In case you were wondering: we don't check to see if
-         * addr >= ADDR_BIOS_FIRST because ADDR_BIOS_FIRST is 0
+         * this is where we go to when the requested read is not
+         * contained entirely withing a single mapping.
          */
-        return bios_file_read(bios, buf, addr - ADDR_BIOS_FIRST, len);
-    } else if (first_addr >= ADDR_FLASH_FIRST && last_addr <= ADDR_FLASH_LAST) {
-        return flash_mem_read(buf, addr, len);
-    } else if (first_addr >= ADDR_G1_FIRST && last_addr <= ADDR_G1_LAST) {
-        return g1_reg_read(buf, addr, len);
-    } else if (first_addr >= ADDR_SYS_FIRST && last_addr <= ADDR_SYS_LAST) {
-        return sys_block_read(buf, addr, len);
-    } else if (first_addr >= ADDR_MAPLE_FIRST && last_addr <= ADDR_MAPLE_LAST) {
-        return maple_reg_read(buf, addr, len);
-    } else if (first_addr >= ADDR_G2_FIRST && last_addr <= ADDR_G2_LAST) {
-        return g2_reg_read(buf, addr, len);
-    } else if (first_addr >= ADDR_PVR2_FIRST && last_addr <= ADDR_PVR2_LAST) {
-        return pvr2_reg_read(buf, addr, len);
-    } else if (first_addr >= ADDR_MODEM_FIRST && last_addr <= ADDR_MODEM_LAST) {
-        return modem_read(buf, addr, len);
-    } else if (first_addr >= ADDR_PVR2_CORE_FIRST &&
-               last_addr <= ADDR_PVR2_CORE_LAST) {
-        return pvr2_core_reg_read(buf, addr, len);
-    } else if(first_addr >= ADDR_AICA_FIRST && last_addr <= ADDR_AICA_LAST) {
-        return aica_reg_read(buf, addr, len);
-    } else if (first_addr >= ADDR_AICA_WAVE_FIRST &&
-               last_addr <= ADDR_AICA_WAVE_LAST) {
-        return aica_wave_mem_read(buf, addr, len);
-    } else if (first_addr >= ADDR_AICA_RTC_FIRST &&
-               last_addr <= ADDR_AICA_RTC_LAST) {
-        return aica_rtc_read(buf, addr, len);
-    } else if (first_addr >= ADDR_GDROM_FIRST && last_addr <= ADDR_GDROM_LAST) {
-        return gdrom_reg_read(buf, addr, len);
+        error_set_feature("proper response for when the guest reads past a "
+                          "memory map's end");
+        error_set_length(len);
+        error_set_address(addr);
+        PENDING_ERROR(ERROR_UNIMPLEMENTED);
+        return MEM_ACCESS_FAILURE;
     }
+    return region->read(buf, addr, len);
+}
+
+static int region_write(struct memory_map_region const *region,
+                        void const *buf, size_t addr, size_t len) {
+    addr &= region->mask;
+    if (addr < region->first || addr + (len - 1) > region->last) {
+        /* when the write is not contained entirely within one mapping */
+        error_set_feature("proper response for when the guest writes past a "
+                          "memory map's end");
+        error_set_length(len);
+        error_set_address(addr);
+        PENDING_ERROR(ERROR_UNIMPLEMENTED);
+        return MEM_ACCESS_FAILURE;
+    }
+    return region->write(buf, addr, len);
+}
 
-boundary_cross:
-    /* when the write is not contained entirely within one mapping */
+static int read_area3(void *buf, size_t addr, size_t len) {
+    return memory_read(mem, buf, addr & ADDR_AREA3_MASK, len);
+}
+
+static int write_area3(void const *buf, size_t addr, size_t len) {
+    sh4_code_cache_notify_write(addr & ADDR_AREA3_MASK, len);
+    return memory_write(mem, buf, addr & ADDR_AREA3_MASK, len);
+}
+
+static int read_bios(void *buf, size_t addr, size_t len) {
+    return bios_file_read(bios, buf, addr - ADDR_BIOS_FIRST, len);
+}
+
+static int write_bios(void const *buf, size_t addr, size_t len) {
+    return write_area0_unmapped(buf, addr, len);
+}
+
+static int read_sys_page(void *buf, size_t addr, size_t len) {
+    return region_read(sys_page_regions[(addr & MEMORY_MAP_PAGE_MASK) >>
+                                        SYS_PAGE_SHIFT], buf, addr, len);
+}
+
+static int write_sys_page(void const *buf, size_t addr, size_t len) {
+    return region_write(sys_page_regions[(addr & MEMORY_MAP_PAGE_MASK) >>
+                                         SYS_PAGE_SHIFT], buf, addr, len);
+}
+
+static int read_area0_unmapped(void *buf, size_t addr, size_t len) {
+    /*
+     * XXX this is the same error the old chain of if-statements gave for
+     * holes in area 0, even though it's not really accurate
+     */
     error_set_feature("proper response for when the guest writes past a memory "
                       "map's end");
     error_set_length(len);
@@ -183,48 +424,7 @@ boundary_cross:
     return MEM_ACCESS_FAILURE;
 }
 
-static inline int write_area0(void const *buf, size_t addr, size_t len) {
-    addr &= ADDR_AREA0_MASK;
-    size_t first_addr = addr;
-    size_t last_addr = addr + (len - 1);
-
-    if (last_addr <= ADDR_BIOS_LAST) {
-        /*
-         * XXX In case you were wondering: we don't check to see if
-         * addr >= ADDR_BIOS_FIRST because ADDR_BIOS_FIRST is 0
-         */
-        goto boundary_cross;
-    } else if (first_addr >= ADDR_FLASH_FIRST && last_addr <= ADDR_FLASH_LAST) {
-        return flash_mem_write(buf, addr, len);
-    } else if (first_addr >= ADDR_G1_FIRST && last_addr <= ADDR_G1_LAST) {
-        return g1_reg_write(buf, addr, len);
-    } else if (first_addr >= ADDR_SYS_FIRST && last_addr <= ADDR_SYS_LAST) {
-        return sys_block_write(buf, addr, len);
-    } else if (first_addr >= ADDR_MAPLE_FIRST && last_addr <= ADDR_MAPLE_LAST) {
-        return maple_reg_write(buf, addr, len);
-    } else if (first_addr >= ADDR_G2_FIRST && last_addr <= ADDR_G2_LAST) {
-        return g2_reg_write(buf, addr, len);
-    } else if (first_addr >= ADDR_PVR2_FIRST && last_addr <= ADDR_PVR2_LAST) {
-        return pvr2_reg_write(buf, addr, len);
-    } else if (first_addr >= ADDR_MODEM_FIRST && last_addr <= ADDR_MODEM_LAST) {
-        return modem_write(buf, addr, len);
-    } else if (first_addr >= ADDR_PVR2_CORE_FIRST &&
-               last_addr <= ADDR_PVR2_CORE_LAST) {
-        return pvr2_core_reg_write(buf, addr, len);
-    } else if(first_addr >= ADDR_AICA_FIRST && last_addr <= ADDR_AICA_LAST) {
-        return aica_reg_write(buf, addr, len);
-    } else if (first_addr >= ADDR_AICA_WAVE_FIRST &&
-               last_addr <= ADDR_AICA_WAVE_LAST) {
-        return aica_wave_mem_write(buf, addr, len);
-    } else if (first_addr >= ADDR_AICA_RTC_FIRST &&
-               last_addr <= ADDR_AICA_RTC_LAST) {
-        return aica_rtc_write(buf, addr, len);
-    } else if (first_addr >= ADDR_GDROM_FIRST && last_addr <= ADDR_GDROM_LAST) {
-        return gdrom_reg_write(buf, addr, len);
-    }
-
-boundary_cross:
-    /* when the write is not contained entirely within one mapping */
+static int write_area0_unmapped(void const *buf, size_t addr, size_t len) {
     error_set_feature("proper response for when the guest writes past a memory "
                       "map's end");
     error_set_length(len);
@@ -233,32 +433,44 @@ boundary_cross:
     return MEM_ACCESS_FAILURE;
 }
 
-static inline int read_area3(void *buf, size_t addr, size_t len) {
-    return memory_read(mem, buf, addr & ADDR_AREA3_MASK, len);
-}
-
-static inline int write_area3(void const *buf, size_t addr, size_t len) {
-    return memory_write(mem, buf, addr & ADDR_AREA3_MASK, len);
+static int read_area4_unmapped(void *buf, size_t addr, size_t len) {
+    error_set_feature("AREA4 readable memory map");
+    error_set_length(len);
+    error_set_address(addr);
+    PENDING_ERROR(ERROR_UNIMPLEMENTED);
+    return MEM_ACCESS_FAILURE;
 }
 
-static inline int read_area4(void *buf, size_t addr, size_t len) {
-    if (addr >= ADDR_TA_FIFO_POLY_FIRST && addr <= ADDR_TA_FIFO_POLY_LAST)
-        return pvr2_ta_fifo_poly_read(buf, addr, len);
-
-    error_set_feature("AREA4 readable memory map");
+static int write_area4_unmapped(void const *buf, size_t addr, size_t len) {
+    error_set_feature("AREA4 writable memory map");
     error_set_length(len);
     error_set_address(addr);
     PENDING_ERROR(ERROR_UNIMPLEMENTED);
     return MEM_ACCESS_FAILURE;
 }
 
-static inline int write_area4(void const *buf, size_t addr, size_t len) {
-    if (addr >= ADDR_TA_FIFO_POLY_FIRST && addr <= ADDR_TA_FIFO_POLY_LAST)
-        return pvr2_ta_fifo_poly_write(buf, addr, len);
+static int write_area4_tex64(void const *buf, size_t addr, size_t len) {
+    return pvr2_tex_mem_area64_write(buf, addr - ADDR_AREA4_TEX64_FIRST +
+                                     ADDR_TEX64_FIRST, len);
+}
+
+static int write_area4_tex32(void const *buf, size_t addr, size_t len) {
+    return pvr2_tex_mem_area32_write(buf, addr - ADDR_AREA4_TEX32_FIRST +
+                                     ADDR_TEX32_FIRST, len);
+}
 
-    error_set_feature("AREA4 writable memory map");
+static int read_unmapped(void *buf, size_t addr, size_t len) {
+    error_set_feature("memory mapping");
+    error_set_address(addr);
     error_set_length(len);
+    PENDING_ERROR(ERROR_UNIMPLEMENTED);
+    return MEM_ACCESS_FAILURE;
+}
+
+static int write_unmapped(void const *buf, size_t addr, size_t len) {
+    error_set_feature("memory mapping");
     error_set_address(addr);
+    error_set_length(len);
     PENDING_ERROR(ERROR_UNIMPLEMENTED);
     return MEM_ACCESS_FAILURE;
 }
@@ -23,9 +23,15 @@
 #ifndef MEMORYMAP_H_
 #define MEMORYMAP_H_
 
+#include <stdint.h>
+#include <string.h>
+
 #include "BiosFile.h"
 #include "memory.h"
 #include "mem_areas.h"
+#include "mem_code.h"
+#include "host_branch_pred.h"
+#include "hw/sh4/sh4_code_cache.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -42,6 +48,104 @@ void memory_map_set_mem(struct Memory *mem_new);
 int memory_map_read(void *buf, size_t addr, size_t len);
 int memory_map_write(void const *buf, size_t addr, size_t len);
 
+/*
+ * The physical address space is split up into 64KB pages, and each page has
+ * an entry in memory_map_pages that says where accesses to it go.  If the
+ * page is backed by plain memory on the host then read_ptr and/or write_ptr
+ * point at the start of that memory and the access is just a load or a
+ * store.  Otherwise it goes to the page's region, which is basically the
+ * read/write handler that memory_map_read/memory_map_write used to pick with
+ * a big chain of if-statements.
+ *
+ * The table gets built by memory_map_init, memory_map_set_bios and
+ * memory_map_set_mem.
+ */
+
+#define MEMORY_MAP_ADDR_MASK 0x1fffffff
+
+#define MEMORY_MAP_PAGE_SHIFT 16
+#define MEMORY_MAP_PAGE_SIZE (1 << MEMORY_MAP_PAGE_SHIFT)
+#define MEMORY_MAP_PAGE_MASK (MEMORY_MAP_PAGE_SIZE - 1)
+#define MEMORY_MAP_N_PAGES ((MEMORY_MAP_ADDR_MASK + 1) >> MEMORY_MAP_PAGE_SHIFT)
+
+typedef int(*memory_map_read_fn)(void *buf, size_t addr, size_t len);
+typedef int(*memory_map_write_fn)(void const *buf, size_t addr, size_t len);
+
+struct memory_map_region {
+    /*
+     * accesses have to fall entirely within first and last, otherwise it's an
+     * error.  These are compared against the address after it's been anded
+     * with mask.
+     */
+    addr32_t first, last, mask;
+
+    memory_map_read_fn read;
+    memory_map_write_fn write;
+};
+
+// writes to this page need to be reported to sh4_code_cache_notify_write
+#define MEMORY_MAP_PAGE_CODE 1
+
+struct memory_map_page {
+    // host memory that backs this page, or NULL to go through region
+    uint8_t *read_ptr;
+    uint8_t *write_ptr;
+
+    struct memory_map_region const *region;
+
+    unsigned flags;
+};
+
+extern struct memory_map_page memory_map_pages[MEMORY_MAP_N_PAGES];
+
+/*
+ * Typed accessors.  These are what the CPU uses for everything except for
+ * odd-sized transfers like the store queues.  addr has to be a physical
+ * address (ie no more than 29 bits).  Accesses that don't fit in a single page
+ * fall back to memory_map_read/memory_map_write; this can only happen when
+ * the address isn't aligned.
+ */
+#define MEMORY_MAP_DEF_READ(bits)                                       \
+    static inline int                                                   \
+    memory_map_read_##bits(uint##bits##_t *valp, addr32_t addr) {       \
+        struct memory_map_page const *page =                            \
+            memory_map_pages + (addr >> MEMORY_MAP_PAGE_SHIFT);         \
+        addr32_t offs = addr & MEMORY_MAP_PAGE_MASK;                    \
+        if (likely(page->read_ptr &&                                    \
+                   offs <= MEMORY_MAP_PAGE_SIZE - sizeof(*valp))) {     \
+            memcpy(valp, page->read_ptr + offs, sizeof(*valp));         \
+            return MEM_ACCESS_SUCCESS;                                  \
+        }                                                               \
+        return memory_map_read(valp, addr, sizeof(*valp));              \
+    }
+
+#define MEMORY_MAP_DEF_WRITE(bits)                                      \
+    static inline int                                                   \
+    memory_map_write_##bits(uint##bits##_t val, addr32_t addr) {        \
+        struct memory_map_page const *page =                            \
+            memory_map_pages + (addr >> MEMORY_MAP_PAGE_SHIFT);         \
+        addr32_t offs = addr & MEMORY_MAP_PAGE_MASK;                    \
+        if (likely(page->write_ptr &&                                   \
+                   offs <= MEMORY_MAP_PAGE_SIZE - sizeof(val))) {       \
+            if (page->flags & MEMORY_MAP_PAGE_CODE)                     \
+                sh4_code_cache_notify_write(addr & ADDR_AREA3_MASK,     \
+                                            sizeof(val));               \
+            memcpy(page->write_ptr + offs, &val, sizeof(val));          \
+            return MEM_ACCESS_SUCCESS;                                  \
+        }                                                               \
+        return memory_map_write(&val, addr, sizeof(val));               \
+    }
+
+MEMORY_MAP_DEF_READ(8)
+MEMORY_MAP_DEF_READ(16)
+MEMORY_MAP_DEF_READ(32)
+MEMORY_MAP_DEF_READ(64)
+
+MEMORY_MAP_DEF_WRITE(8)
+MEMORY_MAP_DEF_WRITE(16)
+MEMORY_MAP_DEF_WRITE(32)
+MEMORY_MAP_DEF_WRITE(64)
+
 #ifdef __cplusplus
 }
 #endif
@@ -21,53 +21,135 @@
  ******************************************************************************/
 
 #include <stddef.h>
+#include <stdlib.h>
+
+#include "error.h"
 
 #include "dc_sched.h"
 
-static struct SchedEvent *ev_next;
+// the heap's storage doubles every time it fills up, starting here
+#define SCHED_INITIAL_CAPACITY 64
 
-void sched_event(struct SchedEvent *event) {
-    struct SchedEvent *next_ptr = ev_next;
-    struct SchedEvent **pprev_ptr = &ev_next;
-    while (next_ptr && next_ptr->when < event->when) {
-        pprev_ptr = &next_ptr->next_event;
-        next_ptr = next_ptr->next_event;
+static struct SchedEvent **heap;
+static unsigned heap_len, heap_capacity;
+
+static uint64_t next_seq;
+
+dc_cycle_stamp_t dc_sched_target_priv_ = DC_SCHED_NO_TARGET;
+
+/*
+ * returns true if a should come out of the queue before b.  Ties go to
+ * whichever one was scheduled last (see dc_sched.h).
+ */
+static inline int sched_before(struct SchedEvent const *a,
+                               struct SchedEvent const *b) {
+    if (a->when != b->when)
+        return a->when < b->when;
+    return a->seq > b->seq;
+}
+
+static inline void sched_place(struct SchedEvent *event, unsigned idx) {
+    heap[idx] = event;
+    event->heap_idx = (int)idx;
+}
+
+static void sched_sift_up(unsigned idx) {
+    struct SchedEvent *event = heap[idx];
+
+    while (idx) {
+        unsigned parent = (idx - 1) / 2;
+        if (!sched_before(event, heap[parent]))
+            break;
+        sched_place(heap[parent], idx);
+        idx = parent;
     }
-    *pprev_ptr = event;
-    if (next_ptr)
-        next_ptr->pprev_event = &event->next_event;
-    event->next_event = next_ptr;
-    event->pprev_event = pprev_ptr;
+
+    sched_place(event, idx);
 }
 
-void cancel_event(struct SchedEvent *event) {
-    if (event->next_event)
-        event->next_event->pprev_event = event->pprev_event;
-    *event->pprev_event = event->next_event;
+static void sched_sift_down(unsigned idx) {
+    struct SchedEvent *event = heap[idx];
 
-    // XXX this is unnecessary, but I'm trying to be extra-safe here
-    event->next_event = NULL;
-    event->pprev_event = NULL;
+    for (;;) {
+        unsigned child = 2 * idx + 1;
+        if (child >= heap_len)
+            break;
+        if (child + 1 < heap_len && sched_before(heap[child + 1], heap[child]))
+            child++;
+        if (!sched_before(heap[child], event))
+            break;
+        sched_place(heap[child], idx);
+        idx = child;
+    }
+
+    sched_place(event, idx);
 }
 
-struct SchedEvent *pop_event() {
-    struct SchedEvent *ev_ret = ev_next;
+// remove the event at the given position and fix up the heap
+static void sched_remove(unsigned idx) {
+    struct SchedEvent *event = heap[idx];
 
-    if (ev_next) {
-        ev_next = ev_next->next_event;
-        if (ev_next)
-            ev_next->pprev_event = &ev_next;
+    heap_len--;
+    if (idx != heap_len) {
+        /*
+         * move the last event into the hole.  It could belong either above
+         * or below where it ended up, so if it doesn't go up then try down.
+         */
+        struct SchedEvent *last = heap[heap_len];
+        sched_place(last, idx);
+        sched_sift_up(idx);
+        if (last->heap_idx == (int)idx)
+            sched_sift_down(idx);
     }
 
-    // XXX this is unnecessary, but I'm trying to be extra-safe here
-    if (ev_ret) {
-        ev_ret->next_event = NULL;
-        ev_ret->pprev_event = NULL;
+    event->heap_idx = -1;
+}
+
+void sched_event(struct SchedEvent *event) {
+    if (heap_len >= heap_capacity) {
+        unsigned new_capacity = heap_capacity ?
+            2 * heap_capacity : SCHED_INITIAL_CAPACITY;
+        struct SchedEvent **new_heap = (struct SchedEvent**)
+            realloc(heap, new_capacity * sizeof(struct SchedEvent*));
+        if (!new_heap)
+            RAISE_ERROR(ERROR_FAILED_ALLOC);
+        heap = new_heap;
+        heap_capacity = new_capacity;
     }
 
+    event->seq = next_seq++;
+    heap[heap_len] = event;
+    sched_sift_up(heap_len++);
+
+    if (event->when < dc_sched_target_priv_)
+        dc_sched_target_priv_ = event->when;
+}
+
+void cancel_event(struct SchedEvent *event) {
+#ifdef INVARIANTS
+    if (event->heap_idx < 0 || (unsigned)event->heap_idx >= heap_len ||
+        heap[event->heap_idx] != event)
+        RAISE_ERROR(ERROR_INTEGRITY);
+#endif
+
+    sched_remove((unsigned)event->heap_idx);
+}
+
+struct SchedEvent *pop_event() {
+    if (!heap_len)
+        return NULL;
+
+    struct SchedEvent *ev_ret = heap[0];
+    sched_remove(0);
     return ev_ret;
 }
 
 struct SchedEvent *peek_event() {
-    return ev_next;
+    return heap_len ? heap[0] : NULL;
+}
+
+void dc_sched_cleanup(void) {
+    free(heap);
+    heap = NULL;
+    heap_len = heap_capacity = 0;
 }
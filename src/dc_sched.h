@@ -29,7 +29,16 @@
 extern "C" {
 #endif
 
-// simple priority-queue scheduler
+/*
+ * simple priority-queue scheduler
+ *
+ * The queue is a binary min-heap of SchedEvent pointers, so sched_event,
+ * cancel_event and pop_event are O(log n) and peek_event is O(1).  Events that
+ * share the same timestamp come out in a fixed order: the one that was
+ * scheduled most recently goes first.  That's what the sorted linked list
+ * this replaced did, and I didn't want to change the order in which events
+ * fire out from under anything that might (accidentally) depend on it.
+ */
 
 typedef uint64_t dc_cycle_stamp_t;
 
@@ -44,9 +53,14 @@ struct SchedEvent {
 
     void *arg_ptr;
 
-    // linked list, only the scheduler gets to touch these
-    struct SchedEvent **pprev_event;
-    struct SchedEvent *next_event;
+    /*
+     * only the scheduler gets to touch these.  heap_idx is the event's
+     * position in the heap (or -1 when it isn't scheduled) and seq is a
+     * counter that gets bumped every time an event is scheduled; it's used to
+     * break ties between events with the same timestamp.
+     */
+    int heap_idx;
+    uint64_t seq;
 };
 
 typedef struct SchedEvent SchedEvent;
@@ -60,6 +74,31 @@ void cancel_event(struct SchedEvent *event);
 struct SchedEvent *pop_event();
 struct SchedEvent *peek_event();
 
+/*
+ * The deadline for the current CPU timeslice.  dreamcast_run sets this before
+ * it runs the CPU, and sched_event pulls it in whenever something gets
+ * scheduled before it so that the CPU doesn't run past the new event (for
+ * example, a TMU channel that gets restarted from inside of a register write).
+ * The CPU run loops check it through dc_sched_clamp_slice in dreamcast.h.
+ *
+ * Like dc_cycle_stamp_priv_, this is only extern so that it can be read from
+ * an inline function.  When there's no deadline it's DC_SCHED_NO_TARGET.
+ */
+#define DC_SCHED_NO_TARGET UINT64_MAX
+
+extern dc_cycle_stamp_t dc_sched_target_priv_;
+
+static inline dc_cycle_stamp_t dc_sched_target(void) {
+    return dc_sched_target_priv_;
+}
+
+static inline void dc_sched_set_target(dc_cycle_stamp_t target) {
+    dc_sched_target_priv_ = target;
+}
+
+// free the heap's storage.  Anything that was still scheduled gets dropped.
+void dc_sched_cleanup(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -37,6 +37,18 @@
 #include "hw/maple/maple.h"
 #include "hw/maple/maple_device.h"
 #include "hw/maple/maple_controller.h"
+#include "hw/maple/maple_reg.h"
+#include "hw/sys/sys_block.h"
+#include "hw/g1/g1_reg.h"
+#include "hw/g2/g2_reg.h"
+#include "hw/gdrom/gdrom_reg.h"
+#include "hw/pvr2/pvr2_reg.h"
+#include "hw/pvr2/pvr2_core_reg.h"
+#include "hw/pvr2/pvr2_ta.h"
+#include "hw/pvr2/geo_buf.h"
+#include "hw/pvr2/pvr2_tex_cache.h"
+#include "hw/pvr2/pvr2_tex_decode.h"
+#include "hw/aica/aica_reg.h"
 
 #ifdef ENABLE_DEBUGGER
 #include "gdb_stub.h"
@@ -46,6 +58,13 @@
 #include "serial_server.h"
 #endif
 
+#ifdef ENABLE_JIT_X86_64
+#include "hw/sh4/sh4_jit.h"
+#endif
+
+#include "hw/sh4/sh4_ir.h"
+#include "hw/sh4/sh4_cached_interp.h"
+
 #include "dreamcast.h"
 
 static Sh4 cpu;
@@ -65,6 +84,13 @@ static struct serial_server serial_server;
 bool serial_server_in_use;
 #endif
 
+#ifdef ENABLE_JIT_X86_64
+static bool using_jit;
+#endif
+
+static bool using_ir, dump_ir;
+static bool using_cached_interp;
+
 #if defined ENABLE_DEBUGGER || defined ENABLE_SERIAL_SERVER
 // Used by the GdbStub and serial_server (if enabled) to do async network I/O
 struct event_base *dc_event_base;
@@ -89,6 +115,12 @@ static void *load_file(char const *path, long *len);
 
 static void dc_single_step(Sh4 *sh4);
 
+static void dc_run_to_next_event(Sh4 *sh4);
+static inline bool dc_using_block_translator(void);
+
+static void dc_mmio_init(void);
+static void dc_mmio_cleanup(void);
+
 void dreamcast_init(char const *bios_path, char const *flash_path) {
     is_running = true;
 
@@ -104,8 +136,11 @@ void dreamcast_init(char const *bios_path, char const *flash_path) {
         flash_mem_load(flash_path);
     bios_file_init(&bios, bios_path);
     memory_map_init(&bios, &mem);
+    dc_mmio_init();
     sh4_init(&cpu);
     spg_init();
+    pvr2_tex_cache_init();
+    pvr2_ta_init();
 
 #ifdef ENABLE_SERIAL_SERVER
     if (serial_server_in_use) {
@@ -184,9 +219,12 @@ void dreamcast_init_direct(char const *path_ip_bin,
         free(dat_syscalls);
     }
 
+    dc_mmio_init();
     sh4_init(&cpu);
 
     spg_init();
+    pvr2_tex_cache_init();
+    pvr2_ta_init();
 
     /* set the PC to the booststrap code within IP.BIN */
     if (skip_ip_bin)
@@ -211,7 +249,31 @@ void dreamcast_init_direct(char const *path_ip_bin,
 }
 #endif
 
+// build the register lookup tables for the devices on the system bus
+static void dc_mmio_init(void) {
+    sys_block_init();
+    maple_reg_init();
+    g1_reg_init();
+    g2_reg_init();
+    gdrom_reg_init();
+    pvr2_reg_init();
+    pvr2_core_reg_init();
+    aica_reg_init();
+}
+
+static void dc_mmio_cleanup(void) {
+    aica_reg_cleanup();
+    pvr2_core_reg_cleanup();
+    pvr2_reg_cleanup();
+    gdrom_reg_cleanup();
+    g2_reg_cleanup();
+    g1_reg_cleanup();
+    maple_reg_cleanup();
+    sys_block_cleanup();
+}
+
 void dreamcast_cleanup() {
+    pvr2_ta_cleanup();
     spg_cleanup();
 
 #ifdef ENABLE_DEBUGGER
@@ -223,10 +285,24 @@ void dreamcast_cleanup() {
         serial_server_cleanup(&serial_server);
 #endif
 
+#ifdef ENABLE_JIT_X86_64
+    if (using_jit)
+        sh4_jit_cleanup();
+#endif
+
+    if (using_ir)
+        sh4_ir_cleanup();
+
+    if (using_cached_interp)
+        sh4_cached_interp_cleanup();
+
     sh4_cleanup(&cpu);
+    dc_mmio_cleanup();
     bios_file_cleanup(&bios);
     memory_cleanup(&mem);
 
+    dc_sched_cleanup();
+
 #if defined(ENABLE_DEBUGGER) || defined(ENABLE_SERIAL_SERVER)
     event_base_free(dc_event_base);
 #endif
@@ -246,6 +322,27 @@ struct debugger *dreamcast_get_debugger() {
  */
 static struct timespec start_time;
 
+static struct dc_loop_stats loop_stats;
+static unsigned long iterations_this_frame;
+
+// called once per main loop iteration to keep loop_stats up to date
+static void dc_update_loop_stats(void) {
+    unsigned long frames = spg_get_frame_count();
+
+    loop_stats.iterations++;
+    iterations_this_frame++;
+
+    if (frames != loop_stats.frames) {
+        loop_stats.frames = frames;
+        loop_stats.iterations_last_frame = iterations_this_frame;
+        iterations_this_frame = 0;
+    }
+}
+
+void dc_get_loop_stats(struct dc_loop_stats *stats_out) {
+    *stats_out = loop_stats;
+}
+
 void dreamcast_run() {
     signal(SIGINT, dc_sigint_handler);
 
@@ -261,6 +358,8 @@ void dreamcast_run() {
     maple_device_init(cont);
 
     while (is_running) {
+        dc_update_loop_stats();
+
         /*
          * The below logic will run the dc_event_base if the debugger is
          * enabled or if the serial server is enabled.  If only the
@@ -312,36 +411,17 @@ void dreamcast_run() {
          * TODO: don't single-step if there's no
          * chance of us hitting a breakpoint
          */
-        dc_single_step(&cpu);
-#else
-        SchedEvent *next_event = peek_event();
-
         /*
-         * if, during the last big chunk of SH4 instructions, there was an
-         * event pushed that predated what was originally the next event,
-         * then we will have accidentally skipped over it.
-         * In this case, we want to run that event immediately without
-         * running the CPU
+         * the JIT and the IR interpreter can't stop on breakpoints, but main
+         * won't let you turn either of them on with the debugger anyways.
          */
-        if (next_event) {
-            if (dc_cycle_stamp_priv_ < next_event->when) {
-                sh4_run_cycles(&cpu, next_event->when - dc_cycle_stamp_priv_);
-            } else {
-                pop_event();
-                next_event->handler(next_event);
-            }
-        } else {
-            /*
-             * Hard to say what to do here.  Constantly checking to see if
-             * a new event got pushed would be costly.  Instead I just run
-             * the cpu a little, but not so much that I drastically overrun
-             * anything that might get scheduled.  The number of cycles to
-             * run here is arbitrary, but if it's too low then performance
-             * will be negatively impacted and if it's too high then
-             * accuracy will be negatively impacted.
-             */
-            sh4_run_cycles(&cpu, 16);
+        if (!using_debugger && dc_using_block_translator()) {
+            dc_run_to_next_event(&cpu);
+            continue;
         }
+        dc_single_step(&cpu);
+#else
+        dc_run_to_next_event(&cpu);
 #endif
     }
     switch (term_reason) {
@@ -389,6 +469,90 @@ static void dc_single_step(Sh4 *sh4) {
     sh4_do_exec_inst(sh4, inst, op);
 
     dc_cycle_advance(tgt_stamp - dc_cycle_stamp());
+
+    /*
+     * skip ahead to the next event if the CPU is idle.  This doesn't happen
+     * when the debugger is in use because then breakpoints inside of the idle
+     * loop would never get hit.
+     */
+    if (sh4->idle) {
+        bool can_skip = true;
+#ifdef ENABLE_DEBUGGER
+        can_skip = !using_debugger;
+#endif
+        next_event = peek_event();
+        if (can_skip && next_event && next_event->when > dc_cycle_stamp())
+            sh4_idle_skip(sh4, next_event->when - dc_cycle_stamp());
+        else
+            sh4->idle = false;
+    }
+}
+
+/*
+ * returns true if the CPU is being run a basic block at a time (ie by the JIT,
+ * the IR interpreter or the cached interpreter) instead of by sh4_run_cycles.
+ */
+static inline bool dc_using_block_translator(void) {
+#ifdef ENABLE_JIT_X86_64
+    if (using_jit)
+        return true;
+#endif
+    return using_ir || using_cached_interp;
+}
+
+static inline void dc_run_cycles(Sh4 *sh4, unsigned n_cycles) {
+#ifdef ENABLE_JIT_X86_64
+    if (using_jit) {
+        sh4_jit_run_cycles(sh4, n_cycles);
+        return;
+    }
+#endif
+    if (using_ir) {
+        sh4_ir_run_cycles(sh4, n_cycles);
+        return;
+    }
+    if (using_cached_interp) {
+        sh4_cached_interp_run_cycles(sh4, n_cycles);
+        return;
+    }
+    sh4_run_cycles(sh4, n_cycles);
+}
+
+/*
+ * how far ahead of the current cycle stamp the CPU gets to run when there's
+ * nothing scheduled.  This is about one frame; anything that gets scheduled
+ * while the CPU is running will cut it short (see dc_sched_target).
+ */
+#define DC_SLICE_HORIZON (200000000 / 60)
+
+// run the cpu until the next scheduled event, then run that event
+static void dc_run_to_next_event(Sh4 *sh4) {
+    SchedEvent *next_event = peek_event();
+
+    /*
+     * if, during the last big chunk of SH4 instructions, there was an
+     * event pushed that predated what was originally the next event,
+     * then we will have accidentally skipped over it.
+     * In this case, we want to run that event immediately without
+     * running the CPU
+     */
+    if (next_event) {
+        if (dc_cycle_stamp_priv_ < next_event->when) {
+            dc_sched_set_target(next_event->when);
+            dc_run_cycles(sh4, next_event->when - dc_cycle_stamp_priv_);
+        } else {
+            pop_event();
+            next_event->handler(next_event);
+        }
+    } else {
+        /*
+         * Nothing is scheduled, so just run until the horizon.  If
+         * something does get scheduled in the meantime then sched_event
+         * will pull the deadline in so the CPU stops in time for it.
+         */
+        dc_sched_set_target(dc_cycle_stamp_priv_ + DC_SLICE_HORIZON);
+        dc_run_cycles(sh4, DC_SLICE_HORIZON);
+    }
 }
 
 void dc_print_perf_stats(void) {
@@ -415,6 +579,74 @@ void dc_print_perf_stats(void) {
     double hz_ratio = hz / 200000000.0;
 
     printf("Performance is %f MHz (%f%%)\n", hz / 1000000.0, hz_ratio * 100.0);
+
+    printf("%lu main loop iterations over %lu frames (%lu during the last "
+           "frame)\n", loop_stats.iterations, loop_stats.frames,
+           loop_stats.iterations_last_frame);
+
+#ifdef ENABLE_JIT_X86_64
+    if (using_jit) {
+        struct sh4_jit_stats jit_stats;
+        sh4_jit_get_stats(&jit_stats);
+        printf("JIT: %lu blocks compiled, %lu invalidated, %lu cache flushes\n",
+               jit_stats.blocks_compiled, jit_stats.blocks_invalidated,
+               jit_stats.flushes);
+        printf("JIT: %lu instructions translated natively, %lu through "
+               "interpreter handlers\n",
+               jit_stats.native_insts, jit_stats.fallback_insts);
+    }
+#endif
+
+    if (using_ir) {
+        struct sh4_ir_stats ir_stats;
+        sh4_ir_get_stats(&ir_stats);
+        printf("IR: %lu blocks compiled, %lu invalidated, %lu cache flushes\n",
+               ir_stats.blocks_compiled, ir_stats.blocks_invalidated,
+               ir_stats.flushes);
+        printf("IR: %lu ops before optimization, %lu after (%lu fallbacks)\n",
+               ir_stats.ops_before_opt, ir_stats.ops_after_opt,
+               ir_stats.fallback_ops);
+        if (dump_ir)
+            sh4_ir_dump_hot_blocks(stdout, 16);
+    }
+
+    struct geo_buf_stats geo_stats;
+    geo_buf_get_stats(&geo_stats);
+    printf("geo_buf: %lu frames, peak arena usage was %zu bytes in one frame "
+           "(at most %u vertices and %u poly groups)\n",
+           geo_stats.frames, geo_stats.arena_peak_bytes,
+           geo_stats.peak_verts, geo_stats.peak_groups);
+    printf("geo_buf: waited for the renderer %lu times, dropped %lu frames\n",
+           geo_stats.stalls, geo_stats.drops);
+
+    struct pvr2_tex_cache_stats tex_stats;
+    pvr2_tex_cache_get_stats(&tex_stats);
+    printf("texture cache: %lu hits, %lu misses, %lu evictions, "
+           "%lu overflows\n", tex_stats.hits, tex_stats.misses,
+           tex_stats.evictions, tex_stats.overflows);
+    printf("texture cache: %lu dirty textures were unchanged, %lu had to be "
+           "sent again\n", tex_stats.content_hits, tex_stats.content_misses);
+
+    struct pvr2_tex_decode_stats decode_stats;
+    pvr2_tex_decode_get_stats(&decode_stats);
+    printf("texture decode: %lu textures decoded, waited for decoding %lu "
+           "times\n", decode_stats.jobs, decode_stats.waits);
+
+    struct sh4_idle_stats idle_stats;
+    sh4_idle_get_stats(&idle_stats);
+    printf("%llu SH4 CPU cycles skipped while idle (%lu skips, "
+           "%lu idle loops found, %lu loops rejected)\n",
+           idle_stats.cycles_skipped, idle_stats.skips,
+           idle_stats.loops_idle, idle_stats.loops_not_idle);
+
+    if (using_cached_interp) {
+        struct sh4_cached_interp_stats ci_stats;
+        sh4_cached_interp_get_stats(&ci_stats);
+        printf("cached interpreter: %lu blocks decoded (%lu instructions), "
+               "%lu invalidated, %lu cache flushes\n",
+               ci_stats.blocks_compiled, ci_stats.insts_decoded,
+               ci_stats.blocks_invalidated, ci_stats.flushes);
+    }
 }
 
 void dreamcast_kill(void) {
@@ -436,6 +668,25 @@ void dreamcast_enable_debugger(void) {
 }
 #endif
 
+#ifdef ENABLE_JIT_X86_64
+void dreamcast_enable_jit(void) {
+    using_jit = true;
+    sh4_jit_init();
+}
+#endif
+
+void dreamcast_enable_ir(bool dump_hot_blocks) {
+    using_ir = true;
+    dump_ir = dump_hot_blocks;
+    sh4_ir_set_dump_enabled(dump_hot_blocks);
+    sh4_ir_init();
+}
+
+void dreamcast_enable_cached_interp(void) {
+    using_cached_interp = true;
+    sh4_cached_interp_init();
+}
+
 #ifdef ENABLE_SERIAL_SERVER
 void dreamcast_enable_serial_server(void) {
     serial_server_in_use = true;
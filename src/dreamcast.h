@@ -75,6 +75,24 @@ void dreamcast_enable_debugger(void);
 void dreamcast_enable_serial_server(void);
 #endif
 
+#ifdef ENABLE_JIT_X86_64
+// this must be called before run or not at all
+void dreamcast_enable_jit(void);
+#endif
+
+/*
+ * this must be called before run or not at all.  If dump_hot_blocks is true
+ * then the most frequently executed IR blocks get printed when the emulator
+ * exits.
+ */
+void dreamcast_enable_ir(bool dump_hot_blocks);
+
+/*
+ * this must be called before run or not at all.  See sh4_cached_interp.h for
+ * how the cached interpreter works.
+ */
+void dreamcast_enable_cached_interp(void);
+
 void dreamcast_run();
 
 /*
@@ -109,6 +127,36 @@ static inline void dc_cycle_advance(dc_cycle_stamp_t n_cycles) {
     dc_cycle_stamp_priv_ += n_cycles;
 }
 
+/*
+ * returns n_cycles, or the number of cycles left until the scheduler's
+ * deadline (see dc_sched_target) if that's less.  The CPU run loops call this
+ * between instructions (or blocks) so that events which get scheduled in the
+ * middle of a timeslice can cut it short.
+ */
+static inline unsigned dc_sched_clamp_slice(unsigned n_cycles) {
+    dc_cycle_stamp_t target = dc_sched_target();
+    dc_cycle_stamp_t stamp = dc_cycle_stamp();
+
+    if (target <= stamp)
+        return 0;
+    if (target - stamp < n_cycles)
+        return target - stamp;
+    return n_cycles;
+}
+
+struct dc_loop_stats {
+    // number of times dreamcast_run has gone through its main loop
+    unsigned long iterations;
+
+    // number of frames emulated (ie V-BLANK IN interrupts)
+    unsigned long frames;
+
+    // main loop iterations during the most recent complete frame
+    unsigned long iterations_last_frame;
+};
+
+void dc_get_loop_stats(struct dc_loop_stats *stats_out);
+
 void dc_print_perf_stats(void);
 
 bool dc_is_running(void);
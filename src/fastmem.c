@@ -0,0 +1,232 @@
+/*******************************************************************************
+ *
+ *
+ *    WashingtonDC Dreamcast Emulator
+ *    Copyright (C) 2017 snickerbockers
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ******************************************************************************/
+
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include "mem_areas.h"
+
+#include "fastmem.h"
+
+#define FASTMEM_WINDOW_SIZE (((uint64_t)1) << 32)
+
+// each of the SH4's areas (P0 counts as four of these) is 512MB
+#define FASTMEM_AREA_SHIFT 29
+#define FASTMEM_N_AREAS 8
+
+// P4 never has RAM in it
+#define FASTMEM_AREA_P4 7
+
+struct fastmem_fixup {
+    uintptr_t fault_ip;
+    uintptr_t resume_ip;
+};
+
+/*
+ * the linker generates these for the fastmem_fixup section that the inline asm
+ * in fastmem.h puts its table entries in.  They're weak just in case nothing
+ * ever instantiates those functions.
+ */
+extern struct fastmem_fixup const __start_fastmem_fixup[]
+__attribute__((weak));
+extern struct fastmem_fixup const __stop_fastmem_fixup[]
+__attribute__((weak));
+
+uint8_t *fastmem_base;
+
+static int ram_fd = -1;
+static uint8_t *ram;
+static size_t ram_len;
+
+static bool area_mapped[FASTMEM_N_AREAS];
+
+static struct sigaction old_sigsegv_action;
+
+static void fastmem_sigsegv_handler(int sig, siginfo_t *info, void *ctx_ptr);
+static int fastmem_map_area(unsigned area_idx, bool mapped);
+static void fastmem_teardown(void);
+
+void *fastmem_ram_alloc(size_t len) {
+    unsigned area_idx;
+    struct sigaction act;
+
+    if (ram)
+        return NULL; // there can only be one
+
+    ram_len = len;
+
+    if ((ram_fd = memfd_create("washingtondc_ram", 0)) < 0) {
+        perror("memfd_create");
+        goto on_error;
+    }
+
+    if (ftruncate(ram_fd, len) < 0) {
+        perror("ftruncate");
+        goto on_error;
+    }
+
+    ram = (uint8_t*)mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED,
+                         ram_fd, 0);
+    if (ram == MAP_FAILED) {
+        ram = NULL;
+        perror("mmap");
+        goto on_error;
+    }
+
+    /*
+     * this only reserves address space.  MAP_NORESERVE is there so that the
+     * kernel doesn't try to account for 4GB worth of memory we never touch.
+     */
+    fastmem_base = (uint8_t*)mmap(NULL, FASTMEM_WINDOW_SIZE, PROT_NONE,
+                                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                                  -1, 0);
+    if (fastmem_base == MAP_FAILED) {
+        fastmem_base = NULL;
+        perror("mmap");
+        goto on_error;
+    }
+
+    memset(area_mapped, 0, sizeof(area_mapped));
+    for (area_idx = 0; area_idx < FASTMEM_N_AREAS; area_idx++) {
+        if (area_idx != FASTMEM_AREA_P4 && fastmem_map_area(area_idx, true) < 0)
+            goto on_error;
+    }
+
+    memset(&act, 0, sizeof(act));
+    act.sa_sigaction = fastmem_sigsegv_handler;
+    act.sa_flags = SA_SIGINFO;
+    sigemptyset(&act.sa_mask);
+    if (sigaction(SIGSEGV, &act, &old_sigsegv_action) < 0) {
+        perror("sigaction");
+        goto on_error;
+    }
+
+    return ram;
+
+on_error:
+    fprintf(stderr, "WARNING: unable to set up fastmem; falling back to the "
+            "regular memory map\n");
+    fastmem_teardown();
+    return NULL;
+}
+
+bool fastmem_ram_free(void *ram_ptr) {
+    if (!ram || ram_ptr != ram)
+        return false;
+
+    sigaction(SIGSEGV, &old_sigsegv_action, NULL);
+    fastmem_teardown();
+    return true;
+}
+
+void fastmem_set_area_mapped(unsigned area_idx, bool mapped) {
+    if (!fastmem_base || area_idx == FASTMEM_AREA_P4 ||
+        area_mapped[area_idx] == mapped)
+        return;
+
+    if (fastmem_map_area(area_idx, mapped) < 0) {
+        /*
+         * There's no good way to recover from this, since anything that's
+         * still mapped would bypass whatever the caller is trying to do.
+         */
+        fprintf(stderr, "ERROR: unable to change fastmem mappings\n");
+        abort();
+    }
+}
+
+static void fastmem_teardown(void) {
+    if (fastmem_base)
+        munmap(fastmem_base, FASTMEM_WINDOW_SIZE);
+    fastmem_base = NULL;
+
+    if (ram)
+        munmap(ram, ram_len);
+    ram = NULL;
+
+    if (ram_fd >= 0)
+        close(ram_fd);
+    ram_fd = -1;
+}
+
+/*
+ * maps (or unmaps) RAM and all of its mirrors in area 3 for the given 512MB
+ * area of the window.  Unmapping is done by mapping PROT_NONE memory over it
+ * so that nothing else can end up in that part of the window.
+ */
+static int fastmem_map_area(unsigned area_idx, bool mapped) {
+    uint64_t addr;
+    uint64_t area_base = ((uint64_t)area_idx) << FASTMEM_AREA_SHIFT;
+
+    for (addr = ADDR_AREA3_FIRST; addr <= ADDR_AREA3_LAST; addr += ram_len) {
+        void *dst = fastmem_base + area_base + addr;
+        void *res;
+
+        if (mapped) {
+            res = mmap(dst, ram_len, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_FIXED, ram_fd, 0);
+        } else {
+            res = mmap(dst, ram_len, PROT_NONE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED,
+                       -1, 0);
+        }
+
+        if (res == MAP_FAILED) {
+            perror("mmap");
+            return -1;
+        }
+    }
+
+    area_mapped[area_idx] = mapped;
+    return 0;
+}
+
+static void fastmem_sigsegv_handler(int sig, siginfo_t *info, void *ctx_ptr) {
+    ucontext_t *ctx = (ucontext_t*)ctx_ptr;
+    greg_t *regs = ctx->uc_mcontext.gregs;
+    uintptr_t fault_addr = (uintptr_t)info->si_addr;
+    uintptr_t base = (uintptr_t)fastmem_base;
+    struct fastmem_fixup const *fixup;
+
+    if (base && fault_addr >= base && fault_addr - base < FASTMEM_WINDOW_SIZE) {
+        for (fixup = __start_fastmem_fixup; fixup < __stop_fastmem_fixup;
+             fixup++) {
+            if (fixup->fault_ip == (uintptr_t)regs[REG_RIP]) {
+                regs[REG_RCX] = 1;
+                regs[REG_RIP] = fixup->resume_ip;
+                return;
+            }
+        }
+    }
+
+    /*
+     * not one of ours, so put the old handler back and return.  The faulting
+     * instruction will get executed again and this time whatever was there
+     * before (probably the default handler) will get it.
+     */
+    sigaction(SIGSEGV, &old_sigsegv_action, NULL);
+}
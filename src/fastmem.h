@@ -0,0 +1,148 @@
+/*******************************************************************************
+ *
+ *
+ *    WashingtonDC Dreamcast Emulator
+ *    Copyright (C) 2017 snickerbockers
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ******************************************************************************/
+
+
+#ifndef FASTMEM_H_
+#define FASTMEM_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "types.h"
+#include "host_branch_pred.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * fastmem: the SH4's entire 4GB virtual address space gets its own 4GB
+ * window on the host, and guest RAM (along with all of its mirrors in areas
+ * P0-P3) is mapped into that window from a memfd.  That way a guest RAM
+ * access is just a load or a store at fastmem_base + addr.
+ *
+ * Everything that isn't RAM is left unmapped.  Accesses to those parts of the
+ * window fault, and the SIGSEGV handler sends them back to the caller, which
+ * then takes the slow path.  Faults are expensive, so callers should only
+ * try the window for addresses that are supposed to be RAM; the fault handler
+ * is just there to catch RAM areas that fastmem_set_area_mapped turned off
+ * because the MMU is remapping them.  The way this works is basically the same thing
+ * Linux does for copy_from_user: every instruction that's allowed to fault
+ * goes in a table (the fastmem_fixup section) along with the address to
+ * resume at, and the faulting instruction's fault flag (which is always
+ * rcx) gets set to nonzero.  Since the faulting instruction is always one of
+ * the ones in the inline asm below, the signal handler never has to decode
+ * anything.
+ *
+ * If any of this fails (no memfd, can't reserve 4GB of address space, etc)
+ * then fastmem_base stays NULL and every accessor returns false right away.
+ */
+
+extern uint8_t *fastmem_base;
+
+/*
+ * Allocates len bytes of guest RAM from a memfd, and sets up the fastmem
+ * window around it.  Returns NULL if that can't be done, in which case the
+ * caller should allocate RAM some other way.
+ */
+void *fastmem_ram_alloc(size_t len);
+
+/*
+ * returns true if ram was allocated by fastmem_ram_alloc, in which case it
+ * has now been freed along with the window.
+ */
+bool fastmem_ram_free(void *ram);
+
+/*
+ * enable or disable the RAM mappings for one of the SH4's 512MB areas (the
+ * upper three bits of the address).  When address translation is on, P0 and
+ * P3 can't go straight to RAM anymore.
+ */
+void fastmem_set_area_mapped(unsigned area_idx, bool mapped);
+
+#define FASTMEM_FIXUP(fault_label, resume_label)        \
+    ".pushsection fastmem_fixup, \"aw\"\n"              \
+    ".quad " fault_label ", " resume_label "\n"         \
+    ".popsection\n"
+
+/*
+ * these return true if the access went through, or false if the caller needs
+ * to go through the slow path.
+ */
+#define FASTMEM_DEF_READ(bits, inst)                                    \
+    static inline bool                                                  \
+    fastmem_read_##bits(uint##bits##_t *valp, addr32_t addr) {          \
+        uint##bits##_t val;                                             \
+        unsigned long fault = 0;                                        \
+        uint8_t *base = fastmem_base;                                   \
+        if (unlikely(!base))                                            \
+            return false;                                               \
+        __asm__ __volatile__("1: " inst "\n"                            \
+                             "2:\n"                                     \
+                             FASTMEM_FIXUP("1b", "2b")                  \
+                             : [val] "=r"(val), [fault] "+c"(fault)     \
+                             : [base] "r"(base),                        \
+                               [offs] "r"((uint64_t)addr)               \
+                             : "memory");                               \
+        if (unlikely(fault))                                            \
+            return false;                                               \
+        *valp = val;                                                    \
+        return true;                                                    \
+    }
+
+#define FASTMEM_DEF_WRITE(bits, inst)                                   \
+    static inline bool                                                  \
+    fastmem_write_##bits(uint##bits##_t val, addr32_t addr) {           \
+        unsigned long fault = 0;                                        \
+        uint8_t *base = fastmem_base;                                   \
+        if (unlikely(!base))                                            \
+            return false;                                               \
+        __asm__ __volatile__("1: " inst "\n"                            \
+                             "2:\n"                                     \
+                             FASTMEM_FIXUP("1b", "2b")                  \
+                             : [fault] "+c"(fault)                      \
+                             : [val] "r"(val), [base] "r"(base),        \
+                               [offs] "r"((uint64_t)addr)               \
+                             : "memory");                               \
+        return !fault;                                                  \
+    }
+
+/*
+ * the 8-bit and 16-bit reads use movzx into a 32-bit register since that's
+ * what gcc would do anyways.
+ */
+FASTMEM_DEF_READ(8, "movzbl (%[base],%[offs]), %k[val]")
+FASTMEM_DEF_READ(16, "movzwl (%[base],%[offs]), %k[val]")
+FASTMEM_DEF_READ(32, "movl (%[base],%[offs]), %k[val]")
+FASTMEM_DEF_READ(64, "movq (%[base],%[offs]), %q[val]")
+
+FASTMEM_DEF_WRITE(8, "movb %b[val], (%[base],%[offs])")
+FASTMEM_DEF_WRITE(16, "movw %w[val], (%[base],%[offs])")
+FASTMEM_DEF_WRITE(32, "movl %k[val], (%[base],%[offs])")
+FASTMEM_DEF_WRITE(64, "movq %q[val], (%[base],%[offs])")
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
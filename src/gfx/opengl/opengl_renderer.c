@@ -57,6 +57,19 @@ static GLuint vbo, vao;
 
 static GLuint tex_cache[PVR2_TEX_CACHE_SIZE];
 
+/*
+ * The texture cache recycles an entry (and therefore its texture object) when
+ * it has to evict something.  If the new texture has the same dimensions and
+ * format as the old one, the existing storage gets overwritten instead of
+ * being reallocated.
+ */
+static struct tex_storage {
+    bool allocated;
+    unsigned w, h;
+    int pix_fmt;
+} tex_storage[PVR2_TEX_CACHE_SIZE];
+
+// ARGB 4444 textures come out of the texture cache as RGBA 4444
 static const GLenum tex_formats[TEX_CTRL_PIX_FMT_COUNT] = {
     [TEX_CTRL_PIX_FMT_ARGB_1555] = GL_UNSIGNED_SHORT_1_5_5_5_REV,
     [TEX_CTRL_PIX_FMT_RGB_565] = GL_UNSIGNED_SHORT_5_6_5,
@@ -106,8 +119,6 @@ static const GLenum depth_funcs[PVR2_DEPTH_FUNC_COUNT] = {
  */
 static void render_do_draw(struct geo_buf *geo);
 
-// converts pixels from ARGB 4444 to RGBA 4444
-static void render_conv_argb_4444(uint16_t *pixels, size_t n_pixels);
 
 void render_init(void) {
     shader_load_vert_from_file(&pvr_ta_shader, "pvr2_ta_vert.glsl");
@@ -130,6 +141,7 @@ void render_init(void) {
     glGenVertexArrays(1, &vao);
     glGenBuffers(1, &vbo);
     glGenTextures(PVR2_TEX_CACHE_SIZE, tex_cache);
+    memset(tex_storage, 0, sizeof(tex_storage));
 
     unsigned tex_no;
     for (tex_no = 0; tex_no < PVR2_TEX_CACHE_SIZE; tex_no++) {
@@ -288,15 +300,25 @@ void render_next_geo_buf(void) {
                 GLenum format = tex->pix_fmt == TEX_CTRL_PIX_FMT_RGB_565 ?
                     GL_RGB : GL_RGBA;
 
-                if (tex->pix_fmt == TEX_CTRL_PIX_FMT_ARGB_4444)
-                    render_conv_argb_4444((uint16_t*)tex->dat, tex->w * tex->h);
-
                 glBindTexture(GL_TEXTURE_2D, tex_cache[tex_no]);
 
                 // TODO: maybe don't always set this to 1
                 glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-                glTexImage2D(GL_TEXTURE_2D, 0, format, tex->w, tex->h, 0,
-                             format, tex_formats[tex->pix_fmt], tex->dat);
+
+                struct tex_storage *storage = tex_storage + tex_no;
+                if (storage->allocated && storage->w == tex->w &&
+                    storage->h == tex->h && storage->pix_fmt == tex->pix_fmt) {
+                    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, tex->w, tex->h,
+                                    format, tex_formats[tex->pix_fmt],
+                                    tex->dat);
+                } else {
+                    glTexImage2D(GL_TEXTURE_2D, 0, format, tex->w, tex->h, 0,
+                                 format, tex_formats[tex->pix_fmt], tex->dat);
+                    storage->allocated = true;
+                    storage->w = tex->w;
+                    storage->h = tex->h;
+                    storage->pix_fmt = tex->pix_fmt;
+                }
                 glBindTexture(GL_TEXTURE_2D, 0);
                 tex->dirty = false;
                 free(tex->dat);
@@ -322,21 +344,7 @@ void render_next_geo_buf(void) {
 
         printf("frame_stamp %u rendered\n", frame_stamp);
 
-        enum display_list_type disp_list;
-        for (disp_list = DISPLAY_LIST_FIRST; disp_list < DISPLAY_LIST_COUNT;
-             disp_list++) {
-            struct display_list *list = geo->lists + disp_list;
-            if (list->n_groups) {
-                /*
-                 * current protocol is that list->groups is only valid if
-                 * list->n_groups is non-valid; ergo it's safe to leave a
-                 * hangning pointer here.
-                 */
-                free(list->groups);
-                list->n_groups = 0;
-            }
-        }
-
+        // this also throws away all of the geo_buf's poly_groups and vertices
         geo_buf_consume();
         bufs_rendered++;
     }
@@ -361,15 +369,3 @@ void render_wait_for_frame_stamp(unsigned stamp) {
     if (pthread_mutex_unlock(&frame_stamp_mtx) != 0)
         abort(); // TODO: error handling
 }
-
-static void render_conv_argb_4444(uint16_t *pixels, size_t n_pixels) {
-    for (size_t pix_no = 0; pix_no < n_pixels; pix_no++, pixels++) {
-        uint16_t pix_current = *pixels;
-        uint16_t b = (pix_current & 0x000f) >> 0;
-        uint16_t g = (pix_current & 0x00f0) >> 4;
-        uint16_t r = (pix_current & 0x0f00) >> 8;
-        uint16_t a = (pix_current & 0xf000) >> 12;
-
-        *pixels = a | (b << 4) | (g << 8) | (r << 12);
-    }
-}
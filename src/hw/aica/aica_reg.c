@@ -24,6 +24,7 @@
 
 #include "mem_code.h"
 #include "MemoryMap.h"
+#include "mmio.h"
 
 #include "aica_reg.h"
 
@@ -140,8 +141,21 @@ static struct aica_mapped_reg {
     { NULL }
 };
 
+static struct mmio_map aica_reg_map;
+
+void aica_reg_init(void) {
+    MMIO_MAP_INIT_TABLE(&aica_reg_map, ADDR_AICA_FIRST, ADDR_AICA_LAST,
+                        struct aica_mapped_reg, aica_reg_info,
+                        ent->len * ent->n_elem);
+}
+
+void aica_reg_cleanup(void) {
+    mmio_map_cleanup(&aica_reg_map);
+}
+
 int aica_reg_read(void *buf, size_t addr, size_t len) {
-    struct aica_mapped_reg *curs = aica_reg_info;
+    struct aica_mapped_reg *curs =
+        mmio_map_search_start(&aica_reg_map, addr, aica_reg_info);
 
     while (curs->reg_name) {
         if ((addr >= curs->addr) &&
@@ -169,7 +183,8 @@ int aica_reg_read(void *buf, size_t addr, size_t len) {
 }
 
 int aica_reg_write(void const *buf, size_t addr, size_t len) {
-    struct aica_mapped_reg *curs = aica_reg_info;
+    struct aica_mapped_reg *curs =
+        mmio_map_search_start(&aica_reg_map, addr, aica_reg_info);
 
     while (curs->reg_name) {
         if ((addr >= curs->addr) &&
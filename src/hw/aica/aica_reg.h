@@ -27,6 +27,9 @@
 extern "C" {
 #endif
 
+void aica_reg_init(void);
+void aica_reg_cleanup(void);
+
 int aica_reg_read(void *buf, size_t addr, size_t len);
 int aica_reg_write(void const *buf, size_t addr, size_t len);
 
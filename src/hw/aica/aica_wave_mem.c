@@ -24,7 +24,7 @@
 #include "MemoryMap.h"
 #include "error.h"
 
-static uint8_t aica_wave_mem[ADDR_AICA_WAVE_LAST - ADDR_AICA_WAVE_FIRST + 1];
+uint8_t aica_wave_mem[ADDR_AICA_WAVE_LAST - ADDR_AICA_WAVE_FIRST + 1];
 
 int aica_wave_mem_read(void *buf, size_t addr, size_t len) {
     void const *start_addr = aica_wave_mem + (addr - ADDR_AICA_WAVE_FIRST);
@@ -23,10 +23,17 @@
 #ifndef AICA_WAVE_MEM_H_
 #define AICA_WAVE_MEM_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mem_areas.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+extern uint8_t aica_wave_mem[ADDR_AICA_WAVE_LAST - ADDR_AICA_WAVE_FIRST + 1];
+
 int aica_wave_mem_read(void *buf, size_t addr, size_t len);
 int aica_wave_mem_write(void const *buf, size_t addr, size_t len);
 
@@ -24,6 +24,7 @@
 #include <stdio.h>
 
 #include <stdint.h>
+#include "mmio.h"
 
 #include "g1_reg.h"
 #include "hw/gdrom/gdrom_reg.h"
@@ -107,8 +108,20 @@ static struct g1_mem_mapped_reg g1_reg_info[] = {
     { NULL }
 };
 
+static struct mmio_map g1_reg_map;
+
+void g1_reg_init(void) {
+    MMIO_MAP_INIT_TABLE(&g1_reg_map, ADDR_G1_FIRST, ADDR_G1_LAST,
+                        struct g1_mem_mapped_reg, g1_reg_info, ent->len);
+}
+
+void g1_reg_cleanup(void) {
+    mmio_map_cleanup(&g1_reg_map);
+}
+
 int g1_reg_read(void *buf, size_t addr, size_t len) {
-    struct g1_mem_mapped_reg *curs = g1_reg_info;
+    struct g1_mem_mapped_reg *curs =
+        mmio_map_search_start(&g1_reg_map, addr, g1_reg_info);
 
     while (curs->reg_name) {
         if (curs->addr == addr) {
@@ -134,7 +147,8 @@ int g1_reg_read(void *buf, size_t addr, size_t len) {
 }
 
 int g1_reg_write(void const *buf, size_t addr, size_t len) {
-    struct g1_mem_mapped_reg *curs = g1_reg_info;
+    struct g1_mem_mapped_reg *curs =
+        mmio_map_search_start(&g1_reg_map, addr, g1_reg_info);
 
     while (curs->reg_name) {
         if (curs->addr == addr) {
@@ -48,6 +48,9 @@ struct g1_mem_mapped_reg {
     g1_reg_write_handler_t on_write;
 };
 
+void g1_reg_init(void);
+void g1_reg_cleanup(void);
+
 int g1_reg_read(void *buf, size_t addr, size_t len);
 int g1_reg_write(void const *buf, size_t addr, size_t len);
 
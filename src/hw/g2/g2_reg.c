@@ -29,6 +29,7 @@
 #include "mem_code.h"
 #include "mem_areas.h"
 #include "error.h"
+#include "mmio.h"
 
 #include "g2_reg.h"
 
@@ -168,8 +169,20 @@ static struct g2_mem_mapped_reg {
     { NULL }
 };
 
+static struct mmio_map g2_reg_map;
+
+void g2_reg_init(void) {
+    MMIO_MAP_INIT_TABLE(&g2_reg_map, ADDR_G2_FIRST, ADDR_G2_LAST,
+                        struct g2_mem_mapped_reg, g2_reg_info, ent->len);
+}
+
+void g2_reg_cleanup(void) {
+    mmio_map_cleanup(&g2_reg_map);
+}
+
 int g2_reg_read(void *buf, size_t addr, size_t len) {
-    struct g2_mem_mapped_reg *curs = g2_reg_info;
+    struct g2_mem_mapped_reg *curs =
+        mmio_map_search_start(&g2_reg_map, addr, g2_reg_info);
 
     while (curs->reg_name) {
         if (curs->addr == addr) {
@@ -195,7 +208,8 @@ int g2_reg_read(void *buf, size_t addr, size_t len) {
 }
 
 int g2_reg_write(void const *buf, size_t addr, size_t len) {
-    struct g2_mem_mapped_reg *curs = g2_reg_info;
+    struct g2_mem_mapped_reg *curs =
+        mmio_map_search_start(&g2_reg_map, addr, g2_reg_info);
 
     while (curs->reg_name) {
         if (curs->addr == addr) {
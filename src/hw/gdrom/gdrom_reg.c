@@ -37,6 +37,7 @@
 #include "hw/sh4/sh4_dmac.h"
 #include "cdrom.h"
 #include "dreamcast.h"
+#include "mmio.h"
 
 #include "gdrom_reg.h"
 
@@ -549,8 +550,20 @@ static void gdrom_input_read_packet(void);
 
 static void gdrom_input_packet_71(void);
 
+static struct mmio_map gdrom_reg_map;
+
+void gdrom_reg_init(void) {
+    MMIO_MAP_INIT_TABLE(&gdrom_reg_map, ADDR_GDROM_FIRST, ADDR_GDROM_LAST,
+                        struct gdrom_mem_mapped_reg, gdrom_reg_info, ent->len);
+}
+
+void gdrom_reg_cleanup(void) {
+    mmio_map_cleanup(&gdrom_reg_map);
+}
+
 int gdrom_reg_read(void *buf, size_t addr, size_t len) {
-    struct gdrom_mem_mapped_reg *curs = gdrom_reg_info;
+    struct gdrom_mem_mapped_reg *curs =
+        mmio_map_search_start(&gdrom_reg_map, addr, gdrom_reg_info);
 
     while (curs->reg_name) {
         if (curs->addr == addr) {
@@ -575,7 +588,8 @@ int gdrom_reg_read(void *buf, size_t addr, size_t len) {
 }
 
 int gdrom_reg_write(void const *buf, size_t addr, size_t len) {
-    struct gdrom_mem_mapped_reg *curs = gdrom_reg_info;
+    struct gdrom_mem_mapped_reg *curs =
+        mmio_map_search_start(&gdrom_reg_map, addr, gdrom_reg_info);
 
     while (curs->reg_name) {
         if (curs->addr == addr) {
@@ -32,6 +32,7 @@
 #include "types.h"
 #include "MemoryMap.h"
 #include "maple.h"
+#include "mmio.h"
 
 #include "maple_reg.h"
 
@@ -119,8 +120,20 @@ static struct maple_mapped_reg {
     { NULL }
 };
 
+static struct mmio_map maple_reg_map;
+
+void maple_reg_init(void) {
+    MMIO_MAP_INIT_TABLE(&maple_reg_map, ADDR_MAPLE_FIRST, ADDR_MAPLE_LAST,
+                        struct maple_mapped_reg, maple_reg_info, ent->len);
+}
+
+void maple_reg_cleanup(void) {
+    mmio_map_cleanup(&maple_reg_map);
+}
+
 int maple_reg_read(void *buf, size_t addr, size_t len) {
-    struct maple_mapped_reg *curs = maple_reg_info;
+    struct maple_mapped_reg *curs =
+        mmio_map_search_start(&maple_reg_map, addr, maple_reg_info);
 
     while (curs->reg_name) {
         if (curs->addr == addr) {
@@ -147,7 +160,8 @@ int maple_reg_read(void *buf, size_t addr, size_t len) {
 }
 
 int maple_reg_write(void const *buf, size_t addr, size_t len) {
-    struct maple_mapped_reg *curs = maple_reg_info;
+    struct maple_mapped_reg *curs =
+        mmio_map_search_start(&maple_reg_map, addr, maple_reg_info);
 
     while (curs->reg_name) {
         if (curs->addr == addr) {
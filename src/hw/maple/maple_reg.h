@@ -29,6 +29,9 @@
 extern "C" {
 #endif
 
+void maple_reg_init(void);
+void maple_reg_cleanup(void);
+
 int maple_reg_read(void *buf, size_t addr, size_t len);
 int maple_reg_write(void const *buf, size_t addr, size_t len);
 
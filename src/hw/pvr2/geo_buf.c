@@ -22,43 +22,216 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
 
 #include "dreamcast.h"
 
 #include "geo_buf.h"
+#include "pvr2_tex_decode.h"
 
-#define GEO_BUF_COUNT 4
+/*
+ * how long geo_buf_produce sleeps before it checks dc_is_running again when
+ * it's waiting for the gfx_thread.  This only matters when WashingtonDC is
+ * shutting down, since the gfx_thread stops consuming at that point.
+ */
+#define GEO_BUF_WAIT_NS (50 * 1000 * 1000)
 
-// producer and consumer indices
-static volatile unsigned prod_idx, cons_idx;
+static unsigned n_geo_bufs;
+static enum geo_buf_policy policy;
 
-static struct geo_buf ringbuf[GEO_BUF_COUNT];
+/*
+ * producer and consumer indices.  These are protected by geo_buf_lock, except
+ * that the producer can read prod_idx without the lock because it's the only
+ * one who ever writes to it.
+ */
+static unsigned prod_idx, cons_idx;
+
+/*
+ * this is set when the gfx_thread is rendering ringbuf[cons_idx], so that
+ * GEO_BUF_POLICY_DROP_OLDEST knows to leave that one alone.
+ */
+static bool cons_busy;
+
+static pthread_mutex_t geo_buf_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// the gfx_thread signals this whenever it frees up a geo_buf
+static pthread_cond_t geo_buf_consumed_cond = PTHREAD_COND_INITIALIZER;
+
+static struct geo_buf *ringbuf;
 
 static unsigned next_frame_stamp;
 
+static struct geo_buf_stats stats;
+
 DEF_ERROR_INT_ATTR(src_blend_factor);
 DEF_ERROR_INT_ATTR(dst_blend_factor);
 DEF_ERROR_INT_ATTR(display_list_index);
 DEF_ERROR_INT_ATTR(geo_buf_group_index);
 
+static void init_geo_buf(struct geo_buf *buf);
+static void empty_geo_buf(struct geo_buf *buf);
+static void drop_oldest(void);
+
 struct geo_buf *geo_buf_get_cons(void) {
-    if (prod_idx == cons_idx)
-        return NULL;
-    else
-        return ringbuf + cons_idx;
+    struct geo_buf *ret = NULL;
+
+    if (pthread_mutex_lock(&geo_buf_lock) != 0)
+        abort(); // TODO: error handling
+    if (prod_idx != cons_idx) {
+        cons_busy = true;
+        ret = ringbuf + cons_idx;
+    }
+    if (pthread_mutex_unlock(&geo_buf_lock) != 0)
+        abort(); // TODO: error handling
+
+    return ret;
 }
 
 struct geo_buf *geo_buf_get_prod(void) {
     return ringbuf + prod_idx;
 }
 
+void geo_buf_init(unsigned n_bufs, enum geo_buf_policy policy_new) {
+    unsigned idx;
+
+    if (n_bufs < 2) {
+        // the ring always keeps one buffer for the producer
+        error_set_length(n_bufs);
+        RAISE_ERROR(ERROR_TOO_SMALL);
+    }
+
+    memset(&stats, 0, sizeof(stats));
+
+    n_geo_bufs = n_bufs;
+    policy = policy_new;
+    prod_idx = cons_idx = 0;
+    cons_busy = false;
+
+    ringbuf = (struct geo_buf*)calloc(n_geo_bufs, sizeof(struct geo_buf));
+    if (!ringbuf)
+        RAISE_ERROR(ERROR_FAILED_ALLOC);
+
+    for (idx = 0; idx < n_geo_bufs; idx++) {
+        struct geo_buf *buf = ringbuf + idx;
+
+        /*
+         * these are big, but the pages don't get touched until there's
+         * geometry in them.
+         */
+        buf->vert_arena = (float*)malloc(sizeof(float) * GEO_BUF_VERT_LEN *
+                                         GEO_BUF_VERT_COUNT);
+        buf->group_arena = (struct poly_group*)malloc(sizeof(struct poly_group) *
+                                                      GEO_BUF_GROUP_COUNT);
+        if (!buf->vert_arena || !buf->group_arena)
+            RAISE_ERROR(ERROR_FAILED_ALLOC);
+        buf->n_verts = 0;
+        buf->n_groups = 0;
+    }
+}
+
+void geo_buf_cleanup(void) {
+    unsigned idx;
+
+    for (idx = 0; idx < n_geo_bufs; idx++) {
+        struct geo_buf *buf = ringbuf + idx;
+
+        free(buf->group_arena);
+        free(buf->vert_arena);
+    }
+
+    free(ringbuf);
+    ringbuf = NULL;
+}
+
+struct poly_group *geo_buf_new_group(struct geo_buf *geo,
+                                     enum display_list_type disp_list) {
+    struct display_list *list = geo->lists + disp_list;
+
+    if (geo->n_groups >= GEO_BUF_GROUP_COUNT)
+        return NULL;
+
+    struct poly_group *group = geo->group_arena + geo->n_groups;
+
+    if (!list->n_groups) {
+        list->groups = group;
+    } else if (list->groups + list->n_groups != group) {
+        /*
+         * Some other list got in between, which can happen when a TA_RESET
+         * lets this list get opened again.  Move this list's groups up to the
+         * end of the arena so they're still contiguous.  The slots they
+         * leave behind go unused until the arena gets emptied.
+         */
+        if (geo->n_groups + list->n_groups >= GEO_BUF_GROUP_COUNT)
+            return NULL;
+
+        memcpy(group, list->groups, sizeof(*group) * list->n_groups);
+        list->groups = group;
+        geo->n_groups += list->n_groups;
+        group += list->n_groups;
+    }
+
+    geo->n_groups++;
+    list->n_groups++;
+
+    group->n_verts = 0;
+    group->verts = geo->vert_arena + GEO_BUF_VERT_LEN * geo->n_verts;
+
+    return group;
+}
+
+float *geo_buf_add_verts(struct geo_buf *geo, struct poly_group *group,
+                         unsigned n_verts) {
+#ifdef INVARIANTS
+    if (group != geo->group_arena + geo->n_groups - 1)
+        RAISE_ERROR(ERROR_INTEGRITY);
+#endif
+
+    if (geo->n_verts + n_verts > GEO_BUF_VERT_COUNT)
+        return NULL;
+
+    float *verts = group->verts + GEO_BUF_VERT_LEN * group->n_verts;
+    group->n_verts += n_verts;
+    geo->n_verts += n_verts;
+
+    return verts;
+}
+
+void geo_buf_get_stats(struct geo_buf_stats *stats_out) {
+    memcpy(stats_out, &stats, sizeof(*stats_out));
+}
+
 void geo_buf_consume(void) {
+    if (pthread_mutex_lock(&geo_buf_lock) != 0)
+        abort(); // TODO: error handling
+
     if (prod_idx == cons_idx) {
         fprintf(stderr, "WARNING: attempt to consume from empty geo_buf "
                 "ring\n");
     } else {
-        cons_idx = (cons_idx + 1) % GEO_BUF_COUNT;
+        empty_geo_buf(ringbuf + cons_idx);
+        cons_idx = (cons_idx + 1) % n_geo_bufs;
+        cons_busy = false;
+
+        if (pthread_cond_signal(&geo_buf_consumed_cond) != 0)
+            abort(); // TODO: error handling
     }
+
+    if (pthread_mutex_unlock(&geo_buf_lock) != 0)
+        abort(); // TODO: error handling
+}
+
+// throw away all of buf's poly_groups and vertices
+static void empty_geo_buf(struct geo_buf *buf) {
+    enum display_list_type disp_list;
+
+    for (disp_list = DISPLAY_LIST_FIRST; disp_list < DISPLAY_LIST_COUNT;
+         disp_list++) {
+        buf->lists[disp_list].n_groups = 0;
+    }
+    buf->n_verts = 0;
+    buf->n_groups = 0;
 }
 
 static void init_geo_buf(struct geo_buf *buf) {
@@ -77,18 +250,108 @@ static void init_geo_buf(struct geo_buf *buf) {
 #endif
 }
 
+/*
+ * Throw away the oldest frame the gfx_thread hasn't started on yet, and
+ * shift everything after it down by one so that the free buffer ends up at
+ * prod_idx.  The caller must hold geo_buf_lock, and the ring must be full.
+ *
+ * The textures are the tricky part: any texture the dropped frame was going
+ * to upload still needs to get to the gfx_thread, since the texture cache
+ * already considers it sent.  Those get handed down to the next frame unless
+ * it has a newer version of the same texture.
+ */
+static void drop_oldest(void) {
+    unsigned victim_idx = cons_busy ? (cons_idx + 1) % n_geo_bufs : cons_idx;
+    unsigned idx = victim_idx;
+    struct geo_buf *victim = ringbuf + victim_idx;
+    struct geo_buf *next = ringbuf + (victim_idx + 1) % n_geo_bufs;
+    unsigned tex_no;
+
+    for (tex_no = 0; tex_no < PVR2_TEX_CACHE_SIZE; tex_no++) {
+        struct pvr2_tex *tex_old = victim->tex_cache + tex_no;
+        struct pvr2_tex *tex_new = next->tex_cache + tex_no;
+
+        if (!(tex_old->valid && tex_old->dirty))
+            continue;
+
+        if (tex_new->valid && tex_new->dirty)
+            free(tex_old->dat);
+        else
+            memcpy(tex_new, tex_old, sizeof(*tex_new));
+
+        tex_old->dirty = false;
+        tex_old->dat = NULL;
+    }
+
+    empty_geo_buf(victim);
+
+    while (idx != prod_idx) {
+        unsigned next_idx = (idx + 1) % n_geo_bufs;
+        struct geo_buf tmp;
+
+        memcpy(&tmp, ringbuf + idx, sizeof(tmp));
+        memcpy(ringbuf + idx, ringbuf + next_idx, sizeof(tmp));
+        memcpy(ringbuf + next_idx, &tmp, sizeof(tmp));
+
+        idx = next_idx;
+    }
+
+    stats.drops++;
+}
+
 void geo_buf_produce(void) {
-    unsigned next_prod_idx = (prod_idx + 1) % GEO_BUF_COUNT;
-
-    if (next_prod_idx == cons_idx) {
-        fprintf(stderr, "WARNING %s: prod_idx == %u, cons_idx == %u.  "
-                "This thread will spin while the ring drains...\n", __func__, prod_idx, cons_idx);
-        while (next_prod_idx == cons_idx && dc_is_running())
-            ;
-        fprintf(stderr, "the ring has drained\n");
+    /*
+     * the textures this frame uploads might still be getting decoded.  Those
+     * are the only decodes that can be in flight because this waits for all
+     * of them every frame.
+     */
+    pvr2_tex_decode_wait();
+
+    struct geo_buf const *cur = ringbuf + prod_idx;
+    size_t arena_bytes = sizeof(float) * GEO_BUF_VERT_LEN * cur->n_verts +
+        sizeof(struct poly_group) * cur->n_groups;
+
+    stats.frames++;
+    if (arena_bytes > stats.arena_peak_bytes)
+        stats.arena_peak_bytes = arena_bytes;
+    if (cur->n_verts > stats.peak_verts)
+        stats.peak_verts = cur->n_verts;
+    if (cur->n_groups > stats.peak_groups)
+        stats.peak_groups = cur->n_groups;
+
+    if (pthread_mutex_lock(&geo_buf_lock) != 0)
+        abort(); // TODO: error handling
+
+    unsigned next_prod_idx = (prod_idx + 1) % n_geo_bufs;
+
+    /*
+     * dropping can't work if the only frame that's waiting is the one the
+     * gfx_thread is already rendering.  That only happens with two geo_bufs,
+     * and then the only choice is to wait.
+     */
+    if (next_prod_idx == cons_idx && policy == GEO_BUF_POLICY_DROP_OLDEST &&
+        !(cons_busy && (cons_idx + 1) % n_geo_bufs == prod_idx)) {
+        drop_oldest();
+        next_prod_idx = prod_idx;
+    } else if (next_prod_idx == cons_idx) {
+        stats.stalls++;
+        while (next_prod_idx == cons_idx && dc_is_running()) {
+            struct timespec timeout;
+            clock_gettime(CLOCK_REALTIME, &timeout);
+            timeout.tv_nsec += GEO_BUF_WAIT_NS;
+            if (timeout.tv_nsec >= 1000000000) {
+                timeout.tv_sec++;
+                timeout.tv_nsec -= 1000000000;
+            }
+            pthread_cond_timedwait(&geo_buf_consumed_cond, &geo_buf_lock,
+                                   &timeout);
+        }
     }
 
     prod_idx = next_prod_idx;
 
+    if (pthread_mutex_unlock(&geo_buf_lock) != 0)
+        abort(); // TODO: error handling
+
     init_geo_buf(ringbuf + prod_idx);
 }
@@ -24,6 +24,7 @@
 #define GEO_BUF_H_
 
 #include <assert.h>
+#include <stddef.h>
 
 #include "error.h"
 #include "pvr2_tex_cache.h"
@@ -43,6 +44,9 @@
 #define GEO_BUF_TRIANGLE_COUNT 131072
 #define GEO_BUF_VERT_COUNT (GEO_BUF_TRIANGLE_COUNT * 3)
 
+// max number of poly_groups for a single geo_buf (all display lists combined)
+#define GEO_BUF_GROUP_COUNT 16384
+
 /*
  * offsets to vertex components within the geo_buf's vert array
  * these are in terms of sizeof(float)
@@ -112,7 +116,7 @@ enum tex_filter {
  */
 struct poly_group {
     unsigned n_verts;
-    float verts[GEO_BUF_VERT_COUNT * GEO_BUF_VERT_LEN];
+    float *verts; // points into the geo_buf's vert_arena
 
     bool tex_enable;
     unsigned tex_idx; // only valid if tex_enable=true
@@ -175,8 +179,77 @@ struct geo_buf {
 
     // near and far clipping plane Z-coordinates
     float clip_min, clip_max;
+
+    /*
+     * All of the poly_groups and vertices in the geo_buf get carved out of
+     * these two arenas, and geo_buf_consume empties them both in one shot
+     * when the gfx_thread is done with the geo_buf.
+     *
+     * Only the newest poly_group ever gets new vertices, so each group's
+     * vertices are contiguous in vert_arena.  Each list's groups are
+     * contiguous in group_arena too; if a list gets re-opened after another
+     * list has added groups (this happens after a TA_RESET), then
+     * geo_buf_new_group moves the list's groups to the end of the arena.
+     */
+    float *vert_arena;
+    unsigned n_verts; // number of vertices allocated from vert_arena
+    struct poly_group *group_arena;
+    unsigned n_groups; // number of poly_groups allocated from group_arena
 };
 
+struct geo_buf_stats {
+    unsigned long frames;
+
+    // number of times geo_buf_produce had to wait for the gfx_thread
+    unsigned long stalls;
+
+    // number of frames thrown away by GEO_BUF_POLICY_DROP_OLDEST
+    unsigned long drops;
+
+    // the most arena space any one geo_buf has ever needed
+    size_t arena_peak_bytes;
+    unsigned peak_verts, peak_groups;
+};
+
+// what geo_buf_produce does when the gfx_thread falls behind
+enum geo_buf_policy {
+    // wait for the gfx_thread to finish rendering a frame
+    GEO_BUF_POLICY_BLOCK,
+
+    /*
+     * throw away the oldest frame that hasn't been rendered yet, so the
+     * emulation never has to wait for the host's GPU.
+     */
+    GEO_BUF_POLICY_DROP_OLDEST
+};
+
+#define GEO_BUF_COUNT_DEFAULT 4
+
+/*
+ * n_bufs is the number of geo_bufs in the ring between the emulation and the
+ * gfx_thread.  One of them always belongs to the emulation, so this needs to
+ * be at least 2.
+ */
+void geo_buf_init(unsigned n_bufs, enum geo_buf_policy policy);
+void geo_buf_cleanup(void);
+
+/*
+ * start a new poly_group at the end of the given display list.  This returns
+ * NULL if the geo_buf is out of poly_groups.
+ */
+struct poly_group *geo_buf_new_group(struct geo_buf *geo,
+                                     enum display_list_type disp_list);
+
+/*
+ * add n_verts vertices to the end of group, which must be the newest
+ * poly_group in geo.  This returns a pointer to the first new vertex, or NULL
+ * if the geo_buf is out of vertices.
+ */
+float *geo_buf_add_verts(struct geo_buf *geo, struct poly_group *group,
+                         unsigned n_verts);
+
+void geo_buf_get_stats(struct geo_buf_stats *stats_out);
+
 /*
  * return the next geo_buf to be consumed, or NULL if there are none.
  * This function never blocks.
@@ -194,9 +267,9 @@ void geo_buf_consume(void);
 /*
  * mark the current geo_buf as having been consumed.
  *
- * This function can block if the buffer is full; this is not ideal
- * and I would like to find a way to revisit this some time in the future.  For
- * now, stability trumps performance.
+ * If the ring is full, this either waits for the gfx_thread to finish a
+ * geo_buf or drops the oldest frame that hasn't been rendered yet, depending
+ * on the policy passed to geo_buf_init.
  */
 void geo_buf_produce(void);
 
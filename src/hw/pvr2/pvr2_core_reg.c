@@ -31,6 +31,7 @@
 #include "error.h"
 #include "framebuffer.h"
 #include "pvr2_ta.h"
+#include "mmio.h"
 
 #include "pvr2_core_reg.h"
 
@@ -604,8 +605,22 @@ static struct pvr2_core_mem_mapped_reg {
     { NULL }
 };
 
+static struct mmio_map pvr2_core_reg_map;
+
+void pvr2_core_reg_init(void) {
+    MMIO_MAP_INIT_TABLE(&pvr2_core_reg_map,
+                        ADDR_PVR2_CORE_FIRST, ADDR_PVR2_CORE_LAST,
+                        struct pvr2_core_mem_mapped_reg, pvr2_core_reg_info,
+                        ent->len);
+}
+
+void pvr2_core_reg_cleanup(void) {
+    mmio_map_cleanup(&pvr2_core_reg_map);
+}
+
 int pvr2_core_reg_read(void *buf, size_t addr, size_t len) {
-    struct pvr2_core_mem_mapped_reg *curs = pvr2_core_reg_info;
+    struct pvr2_core_mem_mapped_reg *curs =
+        mmio_map_search_start(&pvr2_core_reg_map, addr, pvr2_core_reg_info);
 
     while (curs->reg_name) {
         if ((addr == curs->addr) && (len == curs->len))
@@ -621,7 +636,8 @@ int pvr2_core_reg_read(void *buf, size_t addr, size_t len) {
 }
 
 int pvr2_core_reg_write(void const *buf, size_t addr, size_t len) {
-    struct pvr2_core_mem_mapped_reg *curs = pvr2_core_reg_info;
+    struct pvr2_core_mem_mapped_reg *curs =
+        mmio_map_search_start(&pvr2_core_reg_map, addr, pvr2_core_reg_info);
 
     while (curs->reg_name) {
         if ((addr == curs->addr) && (len == curs->len))
@@ -995,6 +1011,8 @@ ta_vertbuf_start_reg_write_handler(struct pvr2_core_mem_mapped_reg const *reg_in
 static int
 ta_vertbuf_pos_reg_read_handler(struct pvr2_core_mem_mapped_reg const *reg_info,
                                 void *buf, addr32_t addr, unsigned len) {
+    // this is supposed to show how far along the TA is
+    pvr2_ta_sync();
     memcpy(buf, &ta_vertbuf_pos, len);
     return 0;
 }
@@ -1137,6 +1155,7 @@ ta_next_opb_reg_read_handler(struct pvr2_core_mem_mapped_reg const *reg_info,
                              void *buf, addr32_t addr, unsigned len) {
     // TODO: actually track the positions of where the OPB blocks should go
 
+    pvr2_ta_sync();
 
     fprintf(stderr, "You should *really* come up with a real implementation of "
             "%s at line %d of %s\n", __func__, __LINE__, __FILE__);
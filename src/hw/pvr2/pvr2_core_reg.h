@@ -41,6 +41,9 @@ extern "C" {
 #define PVR2_PIXEL_DOUBLE_SHIFT 8
 #define PVR2_PIXEL_DOUBLE_MASK (1 << PVR2_PIXEL_DOUBLE_SHIFT)
 
+void pvr2_core_reg_init(void);
+void pvr2_core_reg_cleanup(void);
+
 int pvr2_core_reg_read(void *buf, size_t addr, size_t len);
 int pvr2_core_reg_write(void const *buf, size_t addr, size_t len);
 
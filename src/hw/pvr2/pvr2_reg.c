@@ -27,6 +27,7 @@
 #include "mem_code.h"
 #include "types.h"
 #include "MemoryMap.h"
+#include "mmio.h"
 
 #include "pvr2_reg.h"
 
@@ -85,8 +86,20 @@ static struct pvr2_mem_mapped_reg {
     { NULL }
 };
 
+static struct mmio_map pvr2_reg_map;
+
+void pvr2_reg_init(void) {
+    MMIO_MAP_INIT_TABLE(&pvr2_reg_map, ADDR_PVR2_FIRST, ADDR_PVR2_LAST,
+                        struct pvr2_mem_mapped_reg, pvr2_reg_info, ent->len);
+}
+
+void pvr2_reg_cleanup(void) {
+    mmio_map_cleanup(&pvr2_reg_map);
+}
+
 int pvr2_reg_read(void *buf, size_t addr, size_t len) {
-    struct pvr2_mem_mapped_reg *curs = pvr2_reg_info;
+    struct pvr2_mem_mapped_reg *curs =
+        mmio_map_search_start(&pvr2_reg_map, addr, pvr2_reg_info);
 
     while (curs->reg_name) {
         if (curs->addr == addr) {
@@ -112,7 +125,8 @@ int pvr2_reg_read(void *buf, size_t addr, size_t len) {
 }
 
 int pvr2_reg_write(void const *buf, size_t addr, size_t len) {
-    struct pvr2_mem_mapped_reg *curs = pvr2_reg_info;
+    struct pvr2_mem_mapped_reg *curs =
+        mmio_map_search_start(&pvr2_reg_map, addr, pvr2_reg_info);
 
     while (curs->reg_name) {
         if (curs->addr == addr) {
@@ -27,6 +27,9 @@
 extern "C" {
 #endif
 
+void pvr2_reg_init(void);
+void pvr2_reg_cleanup(void);
+
 int pvr2_reg_read(void *buf, size_t addr, size_t len);
 int pvr2_reg_write(void const *buf, size_t addr, size_t len);
 
@@ -26,6 +26,17 @@
 #include <stdlib.h>
 #include <stdbool.h>
 
+#ifdef ENABLE_PVR2_TA_THREAD
+#include <pthread.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <err.h>
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "error.h"
 #include "geo_buf.h"
 #include "gfx/gfx_thread.h"
@@ -143,6 +154,7 @@ struct poly_hdr {
     uint32_t tex_addr;
     unsigned tex_width_shift, tex_height_shift;
     bool tex_twiddle;
+    bool tex_vq, tex_mipmap;
     int tex_fmt;
     enum tex_inst tex_inst;
     enum tex_filter tex_filter;
@@ -163,6 +175,14 @@ struct poly_hdr {
     float poly_color_rgba[4];
 };
 
+/*
+ * A vertex decoder converts one vertex from the TA's format (which depends on
+ * the polygon header) to the geo_buf's format.  src points to the vertex
+ * packet (including the command word) and vert points to GEO_BUF_VERT_LEN
+ * floats.
+ */
+typedef void (*ta_vert_decoder)(float *vert, uint32_t const *src);
+
 static struct poly_state {
     // used to store the previous two verts when we're rendering a triangle strip
     float strip_vert1[GEO_BUF_VERT_LEN];
@@ -176,9 +196,6 @@ static struct poly_state {
     // index into the texture cache
     unsigned tex_idx;
 
-    // which display list is currently open
-    enum display_list_type current_list;
-
     enum Pvr2BlendFactor src_blend_factor, dst_blend_factor;
 
     bool enable_depth_writes;
@@ -194,16 +211,25 @@ static struct poly_state {
     enum tex_inst tex_inst;
     enum tex_filter tex_filter;
 
-    // number of 4-byte quads per vertex
-    unsigned vert_len;
-
     float poly_color_rgba[4];
 
     enum vert_type vert_type;
-} poly_state = {
-    .current_list = DISPLAY_LIST_NONE,
-    .vert_len = 8
-};
+
+    // picked by process_poly_hdr based on vert_type
+    ta_vert_decoder decode_vert;
+} poly_state;
+
+/*
+ * The emulation thread keeps track of which display list is open and how
+ * long the vertices are so that it can tell where each command in the TA FIFO
+ * ends and raise the end-of-list interrupts on time.  Everything in
+ * poly_state belongs to whoever is building the geo_buf (see
+ * ENABLE_PVR2_TA_THREAD below).
+ */
+static enum display_list_type current_list = DISPLAY_LIST_NONE;
+
+// number of 4-byte quads per vertex
+static unsigned vert_len = 8;
 
 char const *display_list_names[DISPLAY_LIST_COUNT] = {
     "Opaque",
@@ -234,7 +260,49 @@ static const unsigned vert_lengths[N_VERT_TYPES] = {
 
 bool list_submitted[DISPLAY_LIST_COUNT];
 
+// a whole TA command (one packet, or two for the long vertices)
+struct ta_cmd {
+    uint32_t words[PVR2_CMD_MAX_LEN / 4];
+
+    // the display list that was open when the command came in
+    enum display_list_type list;
+};
+
+#ifdef ENABLE_PVR2_TA_THREAD
+/*
+ * Commands go from the emulation thread to the TA worker through this ring.
+ * There's only ever one producer (the emulation thread) and one consumer (the
+ * worker), so the two indices are all the ring needs.  The lock and the
+ * condition variables are only there to give each thread something to sleep
+ * on when it has to wait for the other one.
+ *
+ * ta_ring_head and ta_ring_tail are never wrapped; the slot is the index
+ * modulo TA_RING_LEN.
+ */
+#define TA_RING_LEN 1024
+
+static struct ta_cmd ta_ring[TA_RING_LEN];
+static atomic_uint ta_ring_head, ta_ring_tail;
+
+// set while the worker is asleep waiting for the emulation thread
+static atomic_bool ta_worker_idle;
+
+// set while the emulation thread is asleep waiting for the worker
+static atomic_bool ta_emu_waiting;
+
+static bool ta_worker_running, ta_worker_stop;
+static pthread_t ta_worker;
+
+static pthread_mutex_t ta_ring_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ta_ring_work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t ta_ring_drain_cond = PTHREAD_COND_INITIALIZER;
+
+static void *ta_worker_main(void *arg);
+static void ta_ring_wait(unsigned max_pending);
+#endif
+
 static void input_poly_fifo(uint8_t byte);
+static void input_poly_packet(uint8_t const *pkt);
 
 // this function gets called every time a full packet is received by the TA
 static void on_packet_received(void);
@@ -242,17 +310,30 @@ static void on_polyhdr_received(void);
 static void on_vertex_received(void);
 static void on_end_of_list_received(void);
 
+// hands the command in ta_fifo off to whoever is building the geo_buf
+static void ta_submit(enum display_list_type list);
+
+// these turn the commands from ta_submit into geo_buf data
+static void ta_process_cmd(struct ta_cmd const *cmd);
+static void process_poly_hdr(uint32_t const *src,
+                             enum display_list_type list);
+static void process_vertex(uint32_t const *src, enum display_list_type list);
+
 static void finish_poly_group(struct geo_buf *geo,
                               enum display_list_type disp_list);
 static void next_poly_group(struct geo_buf *geo,
                             enum display_list_type disp_list);
 
-static void decode_poly_hdr(struct poly_hdr *hdr);
+static void decode_vert_fmt(struct poly_hdr *hdr, uint32_t cmd);
+static void decode_poly_hdr(struct poly_hdr *hdr, uint32_t const *src);
 
 // call this whenever a packet has been processed
 static void ta_fifo_finish_packet(void);
 
-static enum vert_type classify_vert(void);
+static enum vert_type classify_vert(struct poly_hdr const *hdr);
+
+static ta_vert_decoder const vert_decoders[N_VERT_TYPES];
+static void decode_intensity_mode_2(float *vert, uint32_t const *src);
 
 int pvr2_ta_fifo_poly_read(void *buf, size_t addr, size_t len) {
 #ifdef PVR2_LOG_VERBOSE
@@ -284,7 +365,24 @@ int pvr2_ta_fifo_poly_write(void const *buf, size_t addr, size_t len) {
     }
 #endif
 
-    uint8_t *ptr = (uint8_t*)buf;
+    /*
+     * Almost everything that gets written here is made of whole 32-byte
+     * packets (store queue flushes, channel-2 DMA), so those go in a packet
+     * at a time.  The byte-at-a-time path is only for whatever doesn't line
+     * up with a packet boundary.
+     */
+    uint8_t const *ptr = (uint8_t const*)buf;
+    while (len && (ta_fifo_byte_count % 32)) {
+        input_poly_fifo(*ptr++);
+        len--;
+    }
+
+    while (len >= 32) {
+        input_poly_packet(ptr);
+        ptr += 32;
+        len -= 32;
+    }
+
     while (len--)
         input_poly_fifo(*ptr++);
 
@@ -299,6 +397,13 @@ static void input_poly_fifo(uint8_t byte) {
     }
 }
 
+// ta_fifo_byte_count has to be a multiple of 32 when this gets called
+static void input_poly_packet(uint8_t const *pkt) {
+    memcpy(ta_fifo + ta_fifo_byte_count, pkt, 32);
+    ta_fifo_byte_count += 32;
+    on_packet_received();
+}
+
 static void on_packet_received(void) {
     uint32_t const *ta_fifo32 = (uint32_t const*)ta_fifo;
     unsigned cmd_tp = (ta_fifo32[0] & TA_CMD_TYPE_MASK) >> TA_CMD_TYPE_SHIFT;
@@ -321,59 +426,64 @@ static void on_packet_received(void) {
     }
 }
 
-static void decode_poly_hdr(struct poly_hdr *hdr) {
-    uint32_t const *ta_fifo32 = (uint32_t const*)ta_fifo;
+// the parts of a polygon header's command word that decide the vertex layout
+static void decode_vert_fmt(struct poly_hdr *hdr, uint32_t cmd) {
+    hdr->tex_enable = (bool)(cmd & TA_CMD_TEX_ENABLE_MASK);
+    hdr->two_volumes_mode = (bool)(cmd & TA_CMD_TWO_VOLUMES_MASK);
+    hdr->color_type =
+        (enum ta_color_type)((cmd & TA_CMD_COLOR_TYPE_MASK) >>
+                             TA_CMD_COLOR_TYPE_SHIFT);
+    hdr->tex_coord_16_bit_enable = (bool)(cmd & TA_CMD_16_BIT_TEX_COORD_MASK);
+}
+
+static void decode_poly_hdr(struct poly_hdr *hdr, uint32_t const *src) {
+    decode_vert_fmt(hdr, src[0]);
 
     hdr->list =
-        (enum display_list_type)((ta_fifo32[0] & TA_CMD_DISP_LIST_MASK) >>
+        (enum display_list_type)((src[0] & TA_CMD_DISP_LIST_MASK) >>
                                  TA_CMD_DISP_LIST_SHIFT);
-    hdr->tex_enable = (bool)(ta_fifo32[0] & TA_CMD_TEX_ENABLE_MASK);
-    hdr->ta_color_fmt = (ta_fifo32[0] & TA_COLOR_FMT_MASK) >>
+    hdr->ta_color_fmt = (src[0] & TA_COLOR_FMT_MASK) >>
         TA_COLOR_FMT_SHIFT;
     if (hdr->tex_enable) {
-        hdr->tex_fmt = (ta_fifo32[3] & TEX_CTRL_PIX_FMT_MASK) >>
+        hdr->tex_fmt = (src[3] & TEX_CTRL_PIX_FMT_MASK) >>
             TEX_CTRL_PIX_FMT_SHIFT;
         hdr->tex_width_shift = 3 +
-            ((ta_fifo32[2] & TSP_TEX_WIDTH_MASK) >> TSP_TEX_WIDTH_SHIFT);
+            ((src[2] & TSP_TEX_WIDTH_MASK) >> TSP_TEX_WIDTH_SHIFT);
         hdr->tex_height_shift = 3 +
-            ((ta_fifo32[2] & TSP_TEX_HEIGHT_MASK) >> TSP_TEX_HEIGHT_SHIFT);
-        hdr->tex_inst = (ta_fifo32[2] & TSP_TEX_INST_MASK) >>
+            ((src[2] & TSP_TEX_HEIGHT_MASK) >> TSP_TEX_HEIGHT_SHIFT);
+        hdr->tex_inst = (src[2] & TSP_TEX_INST_MASK) >>
             TSP_TEX_INST_SHIFT;
-        hdr->tex_twiddle = !(bool)(TEX_CTRL_NOT_TWIDDLED_MASK & ta_fifo32[3]);
-        hdr->tex_addr = ((ta_fifo32[3] & TEX_CTRL_TEX_ADDR_MASK) >>
+        hdr->tex_twiddle = !(bool)(TEX_CTRL_NOT_TWIDDLED_MASK & src[3]);
+        hdr->tex_vq = (bool)(TEX_CTRL_VQ_MASK & src[3]);
+        hdr->tex_mipmap = (bool)(TEX_CTRL_MIP_MAPPED_MASK & src[3]);
+        hdr->tex_addr = ((src[3] & TEX_CTRL_TEX_ADDR_MASK) >>
                          TEX_CTRL_TEX_ADDR_SHIFT) << 3;
-        hdr->tex_filter = (ta_fifo32[2] & TSP_TEX_INST_FILTER_MASK) >>
+        hdr->tex_filter = (src[2] & TSP_TEX_INST_FILTER_MASK) >>
             TSP_TEX_INST_FILTER_SHIFT;
     }
 
     hdr->src_blend_factor =
-        (ta_fifo32[2] & TSP_WORD_SRC_ALPHA_FACTOR_MASK) >>
+        (src[2] & TSP_WORD_SRC_ALPHA_FACTOR_MASK) >>
         TSP_WORD_SRC_ALPHA_FACTOR_SHIFT;
     hdr->dst_blend_factor =
-        (ta_fifo32[2] & TSP_WORD_DST_ALPHA_FACTOR_MASK) >>
+        (src[2] & TSP_WORD_DST_ALPHA_FACTOR_MASK) >>
         TSP_WORD_DST_ALPHA_FACTOR_SHIFT;
 
     hdr->enable_depth_writes =
-        !((ta_fifo32[0] & DEPTH_WRITE_DISABLE_MASK) >>
+        !((src[0] & DEPTH_WRITE_DISABLE_MASK) >>
           DEPTH_WRITE_DISABLE_SHIFT);
     hdr->depth_func =
-        (ta_fifo32[0] & DEPTH_FUNC_MASK) >> DEPTH_FUNC_SHIFT;
+        (src[0] & DEPTH_FUNC_MASK) >> DEPTH_FUNC_SHIFT;
 
-    hdr->shadow = (bool)(ta_fifo32[0] & TA_CMD_SHADOW_MASK);
-    hdr->two_volumes_mode = (bool)(ta_fifo32[0] & TA_CMD_TWO_VOLUMES_MASK);
-    hdr->color_type =
-        (enum ta_color_type)((ta_fifo32[0] & TA_CMD_COLOR_TYPE_MASK) >>
-                             TA_CMD_COLOR_TYPE_SHIFT);
-    hdr->offset_color_enable = (bool)(ta_fifo32[0] & TA_CMD_OFFSET_COLOR_MASK);
+    hdr->shadow = (bool)(src[0] & TA_CMD_SHADOW_MASK);
+    hdr->offset_color_enable = (bool)(src[0] & TA_CMD_OFFSET_COLOR_MASK);
     hdr->gourad_shading_enable =
-        (bool)(ta_fifo32[0] & TA_CMD_GOURAD_SHADING_MASK);
-    hdr->tex_coord_16_bit_enable =
-        (bool)(ta_fifo32[0] & TA_CMD_16_BIT_TEX_COORD_MASK);
+        (bool)(src[0] & TA_CMD_GOURAD_SHADING_MASK);
 
     if (hdr->color_type == TA_COLOR_TYPE_INTENSITY_MODE_1 ||
         hdr->color_type == TA_COLOR_TYPE_INTENSITY_MODE_2) {
-        memcpy(hdr->poly_color_rgba, ta_fifo32 + 5, 3 * sizeof(float));
-        memcpy(hdr->poly_color_rgba + 3, ta_fifo32 + 4, sizeof(float));
+        memcpy(hdr->poly_color_rgba, src + 5, 3 * sizeof(float));
+        memcpy(hdr->poly_color_rgba + 3, src + 4, sizeof(float));
     }
 }
 
@@ -382,25 +492,61 @@ static void on_polyhdr_received(void) {
     enum display_list_type list =
         (enum display_list_type)((ta_fifo32[0] & TA_CMD_DISP_LIST_MASK) >>
                                  TA_CMD_DISP_LIST_SHIFT);
-    struct poly_hdr hdr;
-
-    decode_poly_hdr(&hdr);
+    struct poly_hdr fmt;
 
-    if ((poly_state.current_list == DISPLAY_LIST_NONE) &&
-        list_submitted[list]) {
+    if ((current_list == DISPLAY_LIST_NONE) && list_submitted[list]) {
         printf("WARNING: unable to open list %s because it is already "
                "closed\n", display_list_names[list]);
         goto the_end;
     }
 
-    if ((poly_state.current_list != DISPLAY_LIST_NONE) &&
-        (poly_state.current_list != list)) {
+    if ((current_list != DISPLAY_LIST_NONE) && (current_list != list)) {
         printf("WARNING: attempting to input poly header for list %s without "
                "first closing %s\n", display_list_names[list],
-               display_list_names[poly_state.current_list]);
+               display_list_names[current_list]);
         goto the_end;
     }
 
+    if (current_list == DISPLAY_LIST_NONE) {
+        printf("Opening display list %s\n", display_list_names[list]);
+        current_list = list;
+        list_submitted[list] = true;
+    }
+
+    decode_vert_fmt(&fmt, ta_fifo32[0]);
+    vert_len = vert_lengths[classify_vert(&fmt)];
+
+    ta_submit(current_list);
+
+the_end:
+    ta_fifo_finish_packet();
+}
+
+static void on_vertex_received(void) {
+    /*
+     * if the vertex is not long enough, return and make input_poly_fifo call
+     * us again later when there is more data.  Practically, this means that we
+     * are expecting 64 bytes, but we only have 32 bytes so far.
+     */
+    if (ta_fifo_byte_count != (vert_len * 4))
+        return;
+
+    if (current_list < 0) {
+        printf("ERROR: unable to render vertex because no display lists are "
+               "open\n");
+    } else {
+        ta_submit(current_list);
+    }
+
+    ta_fifo_finish_packet();
+}
+
+static void process_poly_hdr(uint32_t const *src,
+                             enum display_list_type list) {
+    struct poly_hdr hdr;
+
+    decode_poly_hdr(&hdr, src);
+
     /*
      * next_poly_group will finish the current poly_group (if there is one),
      * and that will reference the poly_state.  Ergo, next_poly_group must be
@@ -408,19 +554,7 @@ static void on_polyhdr_received(void) {
      */
     struct geo_buf *geo = geo_buf_get_prod();
 
-    if ((poly_state.current_list == DISPLAY_LIST_NONE) &&
-        !list_submitted[list]) {
-
-        // finish the last poly group of the current list
-        if (geo->lists[poly_state.current_list].n_groups >= 1)
-            finish_poly_group(geo, poly_state.current_list);
-
-        printf("Opening display list %s\n", display_list_names[list]);
-        poly_state.current_list = list;
-        list_submitted[list] = true;
-    }
-
-    next_poly_group(geo, poly_state.current_list);
+    next_poly_group(geo, list);
 
     // reset triangle strips
     poly_state.strip_len = 0;
@@ -443,7 +577,8 @@ static void on_polyhdr_received(void) {
             pvr2_tex_cache_find(hdr.tex_addr,
                                 1 << hdr.tex_width_shift,
                                 1 << hdr.tex_height_shift,
-                                hdr.tex_fmt, hdr.tex_twiddle);
+                                hdr.tex_fmt, hdr.tex_twiddle,
+                                hdr.tex_vq, hdr.tex_mipmap);
 
         printf("texture dimensions are (%u, %u)\n",
                1 << hdr.tex_width_shift,
@@ -458,7 +593,8 @@ static void on_polyhdr_received(void) {
                                      1 << hdr.tex_width_shift,
                                      1 << hdr.tex_height_shift,
                                      hdr.tex_fmt,
-                                     hdr.tex_twiddle);
+                                     hdr.tex_twiddle,
+                                     hdr.tex_vq, hdr.tex_mipmap);
         }
 
         if (!ent) {
@@ -485,8 +621,16 @@ static void on_polyhdr_received(void) {
     poly_state.gourad_shading_enable = hdr.gourad_shading_enable;
     poly_state.tex_coord_16_bit_enable = hdr.tex_coord_16_bit_enable;
 
-    poly_state.vert_type = classify_vert();
-    poly_state.vert_len = vert_lengths[poly_state.vert_type];
+    /*
+     * this goes by hdr.tex_enable instead of poly_state.tex_enable because the
+     * vertex layout doesn't change just because the texture couldn't be
+     * added to the cache.
+     */
+    poly_state.vert_type = classify_vert(&hdr);
+    if (hdr.color_type == TA_COLOR_TYPE_INTENSITY_MODE_2)
+        poly_state.decode_vert = decode_intensity_mode_2;
+    else
+        poly_state.decode_vert = vert_decoders[poly_state.vert_type];
 
     poly_state.tex_inst = hdr.tex_inst;
     poly_state.tex_filter = hdr.tex_filter;
@@ -495,48 +639,27 @@ static void on_polyhdr_received(void) {
            sizeof(poly_state.poly_color_rgba));
 
     printf("POLY HEADER PACKET!\n");
-
-the_end:
-    ta_fifo_finish_packet();
 }
 
-static void on_vertex_received(void) {
-    uint32_t const *ta_fifo32 = (uint32_t const*)ta_fifo;
-    float const *ta_fifo_float = (float const*)ta_fifo;
-
-    /*
-     * if the vertex is not long enough, return and make input_poly_fifo call
-     * us again later when there is more data.  Practically, this means that we
-     * are expecting 64 bytes, but we only have 32 bytes so far.
-     */
-    if (ta_fifo_byte_count != (poly_state.vert_len * 4))
-        return;
-
+static void process_vertex(uint32_t const *src, enum display_list_type list) {
 #ifdef PVR2_LOG_VERBOSE
     printf("vertex received!\n");
 #endif
     struct geo_buf *geo = geo_buf_get_prod();
+    struct display_list *disp_list = geo->lists + list;
 
-    if (poly_state.current_list < 0) {
-        printf("ERROR: unable to render vertex because no display lists are "
-               "open\n");
-        ta_fifo_finish_packet();
-        return;
-    }
-
-    struct display_list *list = geo->lists + poly_state.current_list;
-
-    if (list->n_groups <= 0) {
+    if (disp_list->n_groups <= 0) {
         printf("ERROR: unable to render vertex because I'm still waiting to "
                "see a polygon header\n");
-        ta_fifo_finish_packet();
         return;
     }
 
-    struct poly_group *group = list->groups + (list->n_groups - 1);
+    struct poly_group *group = disp_list->groups + (disp_list->n_groups - 1);
 
     /*
      * un-strip triangle strips by duplicating the previous two vertices.
+     * The duplicates and the new vertex get staged here so that they can all
+     * go into the poly_group at once.
      *
      * TODO: obviously it would be best to preserve the triangle strips and
      * send them to OpenGL via GL_TRIANGLE_STRIP in the rendering backend, but
@@ -544,127 +667,77 @@ static void on_vertex_received(void) {
      * re-start strips.  It might also be possible to stitch separate strips
      * together with degenerate triangles...
      */
-    if (poly_state.strip_len >= 3) {
-        if (group->n_verts < GEO_BUF_VERT_COUNT) {
-            memcpy(group->verts + GEO_BUF_VERT_LEN * group->n_verts,
-                   poly_state.strip_vert1, sizeof(poly_state.strip_vert1));
-            group->n_verts++;
-        }
+    float staged[3 * GEO_BUF_VERT_LEN];
+    unsigned n_staged = 0;
 
-        if (group->n_verts < GEO_BUF_VERT_COUNT) {
-            memcpy(group->verts + GEO_BUF_VERT_LEN * group->n_verts,
-                   poly_state.strip_vert2, sizeof(poly_state.strip_vert2));
-            group->n_verts++;
-        }
+    if (poly_state.strip_len >= 3) {
+        memcpy(staged, poly_state.strip_vert1, sizeof(poly_state.strip_vert1));
+        memcpy(staged + GEO_BUF_VERT_LEN, poly_state.strip_vert2,
+               sizeof(poly_state.strip_vert2));
+        n_staged = 2;
     }
 
-    if (group->n_verts < GEO_BUF_VERT_COUNT) {
-        // first update the clipping planes in the geo_buf
-        /*
-         * TODO: there are FPU instructions on x86 that can do this without
-         * branching
-         */
-        if (ta_fifo_float[3] < geo->clip_min)
-            geo->clip_min = ta_fifo_float[3];
-        if (ta_fifo_float[3] > geo->clip_max)
-            geo->clip_max = ta_fifo_float[3];
-
-        group->verts[GEO_BUF_VERT_LEN * group->n_verts + GEO_BUF_POS_OFFSET + 0] =
-            ta_fifo_float[1];
-        group->verts[GEO_BUF_VERT_LEN * group->n_verts + GEO_BUF_POS_OFFSET + 1] =
-            ta_fifo_float[2];
-        group->verts[GEO_BUF_VERT_LEN * group->n_verts + GEO_BUF_POS_OFFSET + 2] =
-            ta_fifo_float[3];
-
-        if (poly_state.tex_enable) {
-            unsigned dst_uv_offset =
-                GEO_BUF_VERT_LEN * group->n_verts + GEO_BUF_TEX_COORD_OFFSET;
-            group->verts[dst_uv_offset + 0] = ta_fifo_float[4];
-            group->verts[dst_uv_offset + 1] = ta_fifo_float[5];
-        }
-
-        float color_r, color_g, color_b, color_a;
-        float intensity;
-
-        switch (poly_state.ta_color_fmt) {
-        case TA_COLOR_TYPE_PACKED:
-            color_a = (float)((ta_fifo32[6] & 0xff000000) >> 24) / 255.0f;
-            color_r = (float)((ta_fifo32[6] & 0x00ff0000) >> 16) / 255.0f;
-            color_g = (float)((ta_fifo32[6] & 0x0000ff00) >> 8) / 255.0f;
-            color_b = (float)((ta_fifo32[6] & 0x000000ff) >> 0) / 255.0f;
-            break;
-        case TA_COLOR_TYPE_FLOAT:
-            memcpy(&color_a, ta_fifo32 + 4, sizeof(color_a));
-            memcpy(&color_r, ta_fifo32 + 5, sizeof(color_r));
-            memcpy(&color_g, ta_fifo32 + 6, sizeof(color_g));
-            memcpy(&color_b, ta_fifo32 + 7, sizeof(color_b));
-            break;
-        case TA_COLOR_TYPE_INTENSITY_MODE_1:
-            color_a = poly_state.poly_color_rgba[3];
-
-            memcpy(&intensity, ta_fifo32 + 6, sizeof(float));
-            color_r = intensity * poly_state.poly_color_rgba[0];
-            color_g = intensity * poly_state.poly_color_rgba[1];
-            color_b = intensity * poly_state.poly_color_rgba[2];
-
-            break;
-        case TA_COLOR_TYPE_INTENSITY_MODE_2:
-            error_set_feature("intensity color mode 2");
-            RAISE_ERROR(ERROR_UNIMPLEMENTED);
-            break;
-        default:
-            color_r = color_g = color_b = color_a = 1.0f;
-            fprintf(stderr, "WARNING: unknown TA color format %u\n", poly_state.ta_color_fmt);
-        }
+    float *vert = staged + GEO_BUF_VERT_LEN * n_staged++;
+    float *dst = geo_buf_add_verts(geo, group, n_staged);
 
-        group->verts[GEO_BUF_VERT_LEN * group->n_verts + GEO_BUF_COLOR_OFFSET + 0] =
-            color_r;
-        group->verts[GEO_BUF_VERT_LEN * group->n_verts + GEO_BUF_COLOR_OFFSET + 1] =
-            color_g;
-        group->verts[GEO_BUF_VERT_LEN * group->n_verts + GEO_BUF_COLOR_OFFSET + 2] =
-            color_b;
-        group->verts[GEO_BUF_VERT_LEN * group->n_verts + GEO_BUF_COLOR_OFFSET + 3] =
-            color_a;
-
-        if (ta_fifo32[0] & TA_CMD_END_OF_STRIP_MASK) {
-            /*
-             * TODO: handle degenerate cases where the user sends an
-             * end-of-strip on the first or second vertex
-             */
-            poly_state.strip_len = 0;
-        } else {
-            /*
-             * shift the new vert into strip_vert2 and
-             * shift strip_vert2 into strip_vert1
-             */
-            memcpy(poly_state.strip_vert1, poly_state.strip_vert2,
-                   sizeof(poly_state.strip_vert1));
-            memcpy(poly_state.strip_vert2,
-                   group->verts + GEO_BUF_VERT_LEN * group->n_verts,
-                   sizeof(poly_state.strip_vert2));
-            poly_state.strip_len++;
-        }
-
-        group->n_verts++;
-    } else {
+    if (!dst) {
         fprintf(stderr, "WARNING: dropped vertices: geo_buf contains %u "
-                "verts\n", group->n_verts);
+                "verts\n", geo->n_verts);
 #ifdef INVARIANTS
         abort();
 #endif
+        return;
     }
 
-    ta_fifo_finish_packet();
+    poly_state.decode_vert(vert, src);
+
+    // update the clipping planes in the geo_buf
+    /*
+     * TODO: there are FPU instructions on x86 that can do this without
+     * branching
+     */
+    float z = vert[GEO_BUF_POS_OFFSET + 2];
+    if (z < geo->clip_min)
+        geo->clip_min = z;
+    if (z > geo->clip_max)
+        geo->clip_max = z;
+
+    memcpy(dst, staged, n_staged * GEO_BUF_VERT_LEN * sizeof(float));
+
+    if (src[0] & TA_CMD_END_OF_STRIP_MASK) {
+        /*
+         * TODO: handle degenerate cases where the user sends an
+         * end-of-strip on the first or second vertex
+         */
+        poly_state.strip_len = 0;
+    } else {
+        /*
+         * shift the new vert into strip_vert2 and
+         * shift strip_vert2 into strip_vert1
+         */
+        memcpy(poly_state.strip_vert1, poly_state.strip_vert2,
+               sizeof(poly_state.strip_vert1));
+        memcpy(poly_state.strip_vert2, vert, sizeof(poly_state.strip_vert2));
+        poly_state.strip_len++;
+    }
 }
 
 static void on_end_of_list_received(void) {
     printf("END-OF-LIST PACKET!\n");
 
-    finish_poly_group(geo_buf_get_prod(), poly_state.current_list);
+    /*
+     * Closing the list means finishing its last poly_group, so the worker has
+     * to catch up first.  Waiting for it here (instead of letting the worker
+     * close the list) is what lets the interrupt below go out at the same
+     * time it always has.
+     */
+    pvr2_ta_sync();
+
+    finish_poly_group(geo_buf_get_prod(), current_list);
 
-    if (poly_state.current_list != DISPLAY_LIST_NONE) {
+    if (current_list != DISPLAY_LIST_NONE) {
         printf("Display list \"%s\" closed\n",
-               display_list_names[poly_state.current_list]);
+               display_list_names[current_list]);
     } else {
         printf("Unable to close the current display list because no display "
                "list has been opened\n");
@@ -672,7 +745,7 @@ static void on_end_of_list_received(void) {
     }
 
     // TODO: In a real dreamcast this probably would not happen instantly
-    switch (poly_state.current_list) {
+    switch (current_list) {
     case DISPLAY_LIST_OPAQUE:
         holly_raise_nrm_int(HOLLY_REG_ISTNRM_PVR_OPAQUE_COMPLETE);
         break;
@@ -696,7 +769,7 @@ static void on_end_of_list_received(void) {
         RAISE_ERROR(ERROR_INTEGRITY);
     }
 
-    poly_state.current_list = DISPLAY_LIST_NONE;
+    current_list = DISPLAY_LIST_NONE;
 
 the_end:
     ta_fifo_finish_packet();
@@ -705,6 +778,8 @@ the_end:
 void pvr2_ta_startrender(void) {
     printf("STARTRENDER requested!\n");
 
+    pvr2_ta_sync();
+
     struct geo_buf *geo = geo_buf_get_prod();
 
     unsigned tile_w = get_glob_tile_clip_x() << 5;
@@ -775,14 +850,14 @@ void pvr2_ta_startrender(void) {
 
     pvr2_tex_cache_xmit(geo);
 
-    finish_poly_group(geo, poly_state.current_list);
+    finish_poly_group(geo, current_list);
 
     framebuffer_set_current_host(geo->frame_stamp);
     geo_buf_produce();
     gfx_thread_render_geo_buf();
 
     memset(list_submitted, 0, sizeof(list_submitted));
-    poly_state.current_list = DISPLAY_LIST_NONE;
+    current_list = DISPLAY_LIST_NONE;
 
     // TODO: This irq definitely should not be triggered immediately
     holly_raise_nrm_int(HOLLY_REG_ISTNRM_PVR_RENDER_COMPLETE);
@@ -792,6 +867,139 @@ void pvr2_ta_reinit(void) {
     memset(list_submitted, 0, sizeof(list_submitted));
 }
 
+void pvr2_ta_init(void) {
+#ifdef ENABLE_PVR2_TA_THREAD
+    int err_code;
+
+    atomic_store(&ta_ring_head, 0);
+    atomic_store(&ta_ring_tail, 0);
+    atomic_store(&ta_worker_idle, false);
+    atomic_store(&ta_emu_waiting, false);
+    ta_worker_stop = false;
+
+    if ((err_code = pthread_create(&ta_worker, NULL, ta_worker_main, NULL)) != 0)
+        err(errno, "Unable to launch TA worker thread");
+    ta_worker_running = true;
+#endif
+}
+
+void pvr2_ta_cleanup(void) {
+#ifdef ENABLE_PVR2_TA_THREAD
+    if (!ta_worker_running)
+        return;
+
+    pthread_mutex_lock(&ta_ring_lock);
+    ta_worker_stop = true;
+    pthread_cond_signal(&ta_ring_work_cond);
+    pthread_mutex_unlock(&ta_ring_lock);
+
+    pthread_join(ta_worker, NULL);
+    ta_worker_running = false;
+#endif
+}
+
+void pvr2_ta_sync(void) {
+#ifdef ENABLE_PVR2_TA_THREAD
+    if (ta_worker_running)
+        ta_ring_wait(0);
+#endif
+}
+
+static void ta_submit(enum display_list_type list) {
+#ifdef ENABLE_PVR2_TA_THREAD
+    if (ta_worker_running) {
+        unsigned head = atomic_load_explicit(&ta_ring_head,
+                                             memory_order_relaxed);
+
+        if (head - atomic_load(&ta_ring_tail) >= TA_RING_LEN)
+            ta_ring_wait(TA_RING_LEN - 1);
+
+        struct ta_cmd *cmd = ta_ring + head % TA_RING_LEN;
+        memcpy(cmd->words, ta_fifo, ta_fifo_byte_count);
+        cmd->list = list;
+
+        /*
+         * the worker sets ta_worker_idle before it checks ta_ring_head one last
+         * time, and we check ta_worker_idle after we update ta_ring_head, so
+         * at least one of us is guaranteed to notice the other.
+         */
+        atomic_store(&ta_ring_head, head + 1);
+        if (atomic_load(&ta_worker_idle)) {
+            pthread_mutex_lock(&ta_ring_lock);
+            pthread_cond_signal(&ta_ring_work_cond);
+            pthread_mutex_unlock(&ta_ring_lock);
+        }
+        return;
+    }
+#endif
+
+    struct ta_cmd cmd;
+    memcpy(cmd.words, ta_fifo, ta_fifo_byte_count);
+    cmd.list = list;
+    ta_process_cmd(&cmd);
+}
+
+static void ta_process_cmd(struct ta_cmd const *cmd) {
+    unsigned cmd_tp = (cmd->words[0] & TA_CMD_TYPE_MASK) >> TA_CMD_TYPE_SHIFT;
+
+    // on_packet_received already filtered out everything else
+    if (cmd_tp == TA_CMD_TYPE_POLY_HDR)
+        process_poly_hdr(cmd->words, cmd->list);
+    else
+        process_vertex(cmd->words, cmd->list);
+}
+
+#ifdef ENABLE_PVR2_TA_THREAD
+// wait until the worker has no more than max_pending commands left to process
+static void ta_ring_wait(unsigned max_pending) {
+    atomic_store(&ta_emu_waiting, true);
+
+    pthread_mutex_lock(&ta_ring_lock);
+    while (atomic_load(&ta_ring_head) - atomic_load(&ta_ring_tail) >
+           max_pending) {
+        pthread_cond_wait(&ta_ring_drain_cond, &ta_ring_lock);
+    }
+    pthread_mutex_unlock(&ta_ring_lock);
+
+    atomic_store(&ta_emu_waiting, false);
+}
+
+static void *ta_worker_main(void *arg) {
+    for (;;) {
+        unsigned tail = atomic_load_explicit(&ta_ring_tail,
+                                             memory_order_relaxed);
+
+        if (atomic_load(&ta_ring_head) == tail) {
+            bool stop;
+
+            pthread_mutex_lock(&ta_ring_lock);
+            atomic_store(&ta_worker_idle, true);
+            while (atomic_load(&ta_ring_head) == tail && !ta_worker_stop)
+                pthread_cond_wait(&ta_ring_work_cond, &ta_ring_lock);
+            atomic_store(&ta_worker_idle, false);
+            stop = ta_worker_stop && atomic_load(&ta_ring_head) == tail;
+            pthread_mutex_unlock(&ta_ring_lock);
+
+            if (stop)
+                break;
+            continue;
+        }
+
+        ta_process_cmd(ta_ring + tail % TA_RING_LEN);
+
+        // same deal as ta_submit, just with the roles reversed
+        atomic_store(&ta_ring_tail, tail + 1);
+        if (atomic_load(&ta_emu_waiting)) {
+            pthread_mutex_lock(&ta_ring_lock);
+            pthread_cond_signal(&ta_ring_drain_cond);
+            pthread_mutex_unlock(&ta_ring_lock);
+        }
+    }
+
+    return NULL;
+}
+#endif
+
 static void finish_poly_group(struct geo_buf *geo,
                               enum display_list_type disp_list) {
     if (disp_list < 0) {
@@ -851,77 +1059,80 @@ static void finish_poly_group(struct geo_buf *geo,
 
 static void next_poly_group(struct geo_buf *geo,
                             enum display_list_type disp_list) {
-    struct display_list *list = geo->lists + disp_list;
-
     if (disp_list < 0) {
         printf("%s - no lists are open\n", __func__);
         return;
     }
 
-    if (list->n_groups >= 1) {
+    if (geo->lists[disp_list].n_groups >= 1)
         finish_poly_group(geo, disp_list);
-        list->groups = (struct poly_group*)realloc(list->groups,
-                                                  sizeof(struct poly_group) *
-                                                  ++list->n_groups);
-    } else {
-        list->n_groups = 1;
-        list->groups = (struct poly_group*)malloc(sizeof(struct poly_group));
+
+    struct poly_group *new_group = geo_buf_new_group(geo, disp_list);
+
+    if (!new_group) {
+        /*
+         * the new header's vertices will end up in the previous group, which
+         * is wrong but better than nothing.
+         */
+        fprintf(stderr, "WARNING: geo_buf is out of poly_groups\n");
+#ifdef INVARIANTS
+        abort();
+#endif
+        return;
     }
 
-    struct poly_group *new_group = list->groups + (list->n_groups - 1);
-    new_group->n_verts = 0;
     new_group->tex_enable = false;
 }
 
-static enum vert_type classify_vert(void) {
-    if (poly_state.tex_enable) {
-        if (poly_state.two_volumes_mode) {
-            if (poly_state.tex_coord_16_bit_enable) {
-                if (poly_state.color_type == TA_COLOR_TYPE_PACKED)
+static enum vert_type classify_vert(struct poly_hdr const *hdr) {
+    if (hdr->tex_enable) {
+        if (hdr->two_volumes_mode) {
+            if (hdr->tex_coord_16_bit_enable) {
+                if (hdr->color_type == TA_COLOR_TYPE_PACKED)
                     return VERT_TEX_PACKED_COLOR_TWO_VOLUMES_16_BIT_TEX_COORD;
-                if ((poly_state.color_type == TA_COLOR_TYPE_INTENSITY_MODE_1) ||
-                    (poly_state.color_type == TA_COLOR_TYPE_INTENSITY_MODE_2))
+                if ((hdr->color_type == TA_COLOR_TYPE_INTENSITY_MODE_1) ||
+                    (hdr->color_type == TA_COLOR_TYPE_INTENSITY_MODE_2))
                     return VERT_TEX_INTENSITY_TWO_VOLUMES_16_BIT_TEX_COORD;
             } else {
-                if (poly_state.color_type == TA_COLOR_TYPE_PACKED)
+                if (hdr->color_type == TA_COLOR_TYPE_PACKED)
                     return VERT_TEX_PACKED_COLOR_TWO_VOLUMES;
-                if ((poly_state.color_type == TA_COLOR_TYPE_INTENSITY_MODE_1) ||
-                    (poly_state.color_type == TA_COLOR_TYPE_INTENSITY_MODE_2))
+                if ((hdr->color_type == TA_COLOR_TYPE_INTENSITY_MODE_1) ||
+                    (hdr->color_type == TA_COLOR_TYPE_INTENSITY_MODE_2))
                     return VERT_TEX_INTENSITY_TWO_VOLUMES;
             }
         } else {
-            if (poly_state.tex_coord_16_bit_enable) {
-                if (poly_state.color_type == TA_COLOR_TYPE_PACKED)
+            if (hdr->tex_coord_16_bit_enable) {
+                if (hdr->color_type == TA_COLOR_TYPE_PACKED)
                     return VERT_TEX_PACKED_COLOR_16_BIT_TEX_COORD;
-                if (poly_state.color_type == TA_COLOR_TYPE_FLOAT)
+                if (hdr->color_type == TA_COLOR_TYPE_FLOAT)
                     return VERT_TEX_FLOATING_COLOR_16_BIT_TEX_COORD;
-                if ((poly_state.color_type == TA_COLOR_TYPE_INTENSITY_MODE_1) ||
-                    (poly_state.color_type == TA_COLOR_TYPE_INTENSITY_MODE_2))
+                if ((hdr->color_type == TA_COLOR_TYPE_INTENSITY_MODE_1) ||
+                    (hdr->color_type == TA_COLOR_TYPE_INTENSITY_MODE_2))
                     return VERT_TEX_INTENSITY_16_BIT_TEX_COORD;
             } else {
-                if (poly_state.color_type == TA_COLOR_TYPE_PACKED)
+                if (hdr->color_type == TA_COLOR_TYPE_PACKED)
                     return VERT_TEX_PACKED_COLOR;
-                if (poly_state.color_type == TA_COLOR_TYPE_FLOAT)
+                if (hdr->color_type == TA_COLOR_TYPE_FLOAT)
                     return VERT_TEX_FLOATING_COLOR;
-                if ((poly_state.color_type == TA_COLOR_TYPE_INTENSITY_MODE_1) ||
-                    (poly_state.color_type == TA_COLOR_TYPE_INTENSITY_MODE_2))
+                if ((hdr->color_type == TA_COLOR_TYPE_INTENSITY_MODE_1) ||
+                    (hdr->color_type == TA_COLOR_TYPE_INTENSITY_MODE_2))
                     return VERT_TEX_INTENSITY;
             }
         }
     } else {
-        if (poly_state.two_volumes_mode) {
-            if (poly_state.color_type == TA_COLOR_TYPE_PACKED)
+        if (hdr->two_volumes_mode) {
+            if (hdr->color_type == TA_COLOR_TYPE_PACKED)
                 return VERT_NO_TEX_PACKED_COLOR_TWO_VOLUMES;
-            if ((poly_state.color_type == TA_COLOR_TYPE_INTENSITY_MODE_1) ||
-                (poly_state.color_type == TA_COLOR_TYPE_INTENSITY_MODE_2))
+            if ((hdr->color_type == TA_COLOR_TYPE_INTENSITY_MODE_1) ||
+                (hdr->color_type == TA_COLOR_TYPE_INTENSITY_MODE_2))
                 return VERT_NO_TEX_INTENSITY_TWO_VOLUMES;
         } else {
-            if (poly_state.color_type == TA_COLOR_TYPE_PACKED)
+            if (hdr->color_type == TA_COLOR_TYPE_PACKED)
                 return VERT_NO_TEX_PACKED_COLOR;
-            if (poly_state.color_type == TA_COLOR_TYPE_FLOAT)
+            if (hdr->color_type == TA_COLOR_TYPE_FLOAT)
                 return VERT_NO_TEX_FLOAT_COLOR;
-            if ((poly_state.color_type == TA_COLOR_TYPE_INTENSITY_MODE_1) ||
-                (poly_state.color_type == TA_COLOR_TYPE_INTENSITY_MODE_2))
+            if ((hdr->color_type == TA_COLOR_TYPE_INTENSITY_MODE_1) ||
+                (hdr->color_type == TA_COLOR_TYPE_INTENSITY_MODE_2))
                 return VERT_NO_TEX_INTENSITY;
         }
     }
@@ -929,6 +1140,141 @@ static enum vert_type classify_vert(void) {
     RAISE_ERROR(ERROR_UNIMPLEMENTED);
 }
 
+/*
+ * Vertex decoders.  Every vertex starts with the command word followed by
+ * x, y and z; after that it's some combination of texture coordinates and
+ * color data, and the location of each depends on the vertex type.  For the
+ * two-volume types, only the first volume gets used.
+ */
+static inline float ta_float(uint32_t const *src, unsigned idx) {
+    float val;
+    memcpy(&val, src + idx, sizeof(val));
+    return val;
+}
+
+static inline void decode_pos(float *vert, uint32_t const *src) {
+    memcpy(vert + GEO_BUF_POS_OFFSET, src + 1, 3 * sizeof(float));
+}
+
+static inline void decode_uv_none(float *vert) {
+    vert[GEO_BUF_TEX_COORD_OFFSET + 0] = 0.0f;
+    vert[GEO_BUF_TEX_COORD_OFFSET + 1] = 0.0f;
+}
+
+static inline void decode_uv_32(float *vert, uint32_t const *src,
+                                unsigned idx) {
+    memcpy(vert + GEO_BUF_TEX_COORD_OFFSET, src + idx, 2 * sizeof(float));
+}
+
+// 16-bit texture coordinates are the upper halves of two 32-bit floats
+static inline void decode_uv_16(float *vert, uint32_t const *src,
+                                unsigned idx) {
+    uint32_t u_bits = src[idx] & 0xffff0000;
+    uint32_t v_bits = src[idx] << 16;
+
+    memcpy(vert + GEO_BUF_TEX_COORD_OFFSET + 0, &u_bits, sizeof(float));
+    memcpy(vert + GEO_BUF_TEX_COORD_OFFSET + 1, &v_bits, sizeof(float));
+}
+
+// convert a packed ARGB8888 color to RGBA floats
+static inline void unpack_argb(float *rgba, uint32_t argb) {
+#ifdef __SSE2__
+    __m128i zero = _mm_setzero_si128();
+    __m128i bgra = _mm_unpacklo_epi16(
+        _mm_unpacklo_epi8(_mm_cvtsi32_si128(argb), zero), zero);
+    __m128 bgra_f = _mm_div_ps(_mm_cvtepi32_ps(bgra), _mm_set1_ps(255.0f));
+    _mm_storeu_ps(rgba, _mm_shuffle_ps(bgra_f, bgra_f,
+                                       _MM_SHUFFLE(3, 0, 1, 2)));
+#else
+    rgba[0] = (float)((argb & 0x00ff0000) >> 16) / 255.0f;
+    rgba[1] = (float)((argb & 0x0000ff00) >> 8) / 255.0f;
+    rgba[2] = (float)((argb & 0x000000ff) >> 0) / 255.0f;
+    rgba[3] = (float)((argb & 0xff000000) >> 24) / 255.0f;
+#endif
+}
+
+static inline void decode_color_packed(float *vert, uint32_t const *src,
+                                       unsigned idx) {
+    unpack_argb(vert + GEO_BUF_COLOR_OFFSET, src[idx]);
+}
+
+// floating-point colors are in ARGB order
+static inline void decode_color_float(float *vert, uint32_t const *src,
+                                      unsigned idx) {
+    memcpy(vert + GEO_BUF_COLOR_OFFSET, src + idx + 1, 3 * sizeof(float));
+    memcpy(vert + GEO_BUF_COLOR_OFFSET + 3, src + idx, sizeof(float));
+}
+
+// intensity scales the face color from the polygon header
+static inline void decode_color_intensity(float *vert, uint32_t const *src,
+                                          unsigned idx) {
+    float intensity = ta_float(src, idx);
+
+    vert[GEO_BUF_COLOR_OFFSET + 0] = intensity * poly_state.poly_color_rgba[0];
+    vert[GEO_BUF_COLOR_OFFSET + 1] = intensity * poly_state.poly_color_rgba[1];
+    vert[GEO_BUF_COLOR_OFFSET + 2] = intensity * poly_state.poly_color_rgba[2];
+    vert[GEO_BUF_COLOR_OFFSET + 3] = poly_state.poly_color_rgba[3];
+}
+
+#define DEF_VERT_DECODER(name, uv, color)                       \
+    static void name(float *vert, uint32_t const *src) {        \
+        decode_pos(vert, src);                                  \
+        uv;                                                     \
+        color;                                                  \
+    }
+
+DEF_VERT_DECODER(decode_no_tex_packed,
+                 decode_uv_none(vert), decode_color_packed(vert, src, 6))
+DEF_VERT_DECODER(decode_no_tex_float,
+                 decode_uv_none(vert), decode_color_float(vert, src, 4))
+DEF_VERT_DECODER(decode_no_tex_intensity,
+                 decode_uv_none(vert), decode_color_intensity(vert, src, 6))
+DEF_VERT_DECODER(decode_tex_packed,
+                 decode_uv_32(vert, src, 4), decode_color_packed(vert, src, 6))
+DEF_VERT_DECODER(decode_tex_packed_uv16,
+                 decode_uv_16(vert, src, 4), decode_color_packed(vert, src, 6))
+DEF_VERT_DECODER(decode_tex_float,
+                 decode_uv_32(vert, src, 4), decode_color_float(vert, src, 8))
+DEF_VERT_DECODER(decode_tex_float_uv16,
+                 decode_uv_16(vert, src, 4), decode_color_float(vert, src, 8))
+DEF_VERT_DECODER(decode_tex_intensity,
+                 decode_uv_32(vert, src, 4),
+                 decode_color_intensity(vert, src, 6))
+DEF_VERT_DECODER(decode_tex_intensity_uv16,
+                 decode_uv_16(vert, src, 4),
+                 decode_color_intensity(vert, src, 6))
+DEF_VERT_DECODER(decode_no_tex_packed_two_vol,
+                 decode_uv_none(vert), decode_color_packed(vert, src, 4))
+DEF_VERT_DECODER(decode_no_tex_intensity_two_vol,
+                 decode_uv_none(vert), decode_color_intensity(vert, src, 4))
+
+static ta_vert_decoder const vert_decoders[N_VERT_TYPES] = {
+    [VERT_NO_TEX_PACKED_COLOR] = decode_no_tex_packed,
+    [VERT_NO_TEX_FLOAT_COLOR] = decode_no_tex_float,
+    [VERT_NO_TEX_INTENSITY] = decode_no_tex_intensity,
+    [VERT_TEX_PACKED_COLOR] = decode_tex_packed,
+    [VERT_TEX_PACKED_COLOR_16_BIT_TEX_COORD] = decode_tex_packed_uv16,
+    [VERT_TEX_FLOATING_COLOR] = decode_tex_float,
+    [VERT_TEX_FLOATING_COLOR_16_BIT_TEX_COORD] = decode_tex_float_uv16,
+    [VERT_TEX_INTENSITY] = decode_tex_intensity,
+    [VERT_TEX_INTENSITY_16_BIT_TEX_COORD] = decode_tex_intensity_uv16,
+    [VERT_NO_TEX_PACKED_COLOR_TWO_VOLUMES] = decode_no_tex_packed_two_vol,
+    [VERT_NO_TEX_INTENSITY_TWO_VOLUMES] = decode_no_tex_intensity_two_vol,
+
+    // the first volume of a textured two-volume vertex looks just like these
+    [VERT_TEX_PACKED_COLOR_TWO_VOLUMES] = decode_tex_packed,
+    [VERT_TEX_PACKED_COLOR_TWO_VOLUMES_16_BIT_TEX_COORD] =
+    decode_tex_packed_uv16,
+    [VERT_TEX_INTENSITY_TWO_VOLUMES] = decode_tex_intensity,
+    [VERT_TEX_INTENSITY_TWO_VOLUMES_16_BIT_TEX_COORD] =
+    decode_tex_intensity_uv16
+};
+
+static void decode_intensity_mode_2(float *vert, uint32_t const *src) {
+    error_set_feature("intensity color mode 2");
+    RAISE_ERROR(ERROR_UNIMPLEMENTED);
+}
+
 static void ta_fifo_finish_packet(void) {
     ta_fifo_byte_count = 0;
 }
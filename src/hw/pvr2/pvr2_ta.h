@@ -87,4 +87,15 @@ void pvr2_ta_startrender(void);
 
 void pvr2_ta_reinit(void);
 
+void pvr2_ta_init(void);
+void pvr2_ta_cleanup(void);
+
+/*
+ * With ENABLE_PVR2_TA_THREAD, the geo_buf gets built on a separate thread.
+ * This waits for that thread to finish everything that has been written to
+ * the TA FIFO so far; call it before looking at anything the TA is
+ * responsible for.  Without ENABLE_PVR2_TA_THREAD, this does nothing.
+ */
+void pvr2_ta_sync(void);
+
 #endif
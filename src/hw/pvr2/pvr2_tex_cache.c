@@ -26,10 +26,15 @@
 #include <string.h>
 #include <stdint.h>
 
+#ifdef ENABLE_PVR2_TA_THREAD
+#include <pthread.h>
+#endif
+
 #include "pvr2_tex_mem.h"
 #include "mem_areas.h"
 
 #include "geo_buf.h"
+#include "pvr2_tex_decode.h"
 
 #include "pvr2_tex_cache.h"
 
@@ -46,77 +51,170 @@ unsigned static const pixel_sizes[TEX_CTRL_PIX_FMT_COUNT] = {
 
 static struct pvr2_tex tex_cache[PVR2_TEX_CACHE_SIZE];
 
-static unsigned tex_twiddle(unsigned x, unsigned y,
-                            unsigned w_shift, unsigned h_shift);
+/*
+ * Lookups go through an open-addressing (linear probing) hash table of
+ * indices into tex_cache.  It's kept at most half-full so that the probe
+ * sequences stay short no matter how many textures are live.
+ */
+#define TEX_HASH_BITS 8
+#define TEX_HASH_SIZE (1 << TEX_HASH_BITS)
+#define TEX_HASH_MASK (TEX_HASH_SIZE - 1)
+#define TEX_HASH_EMPTY -1
+
+static_assert(TEX_HASH_SIZE >= 2 * PVR2_TEX_CACHE_SIZE,
+              "the texture hash table is too small");
+
+static int tex_hash[TEX_HASH_SIZE];
 
 /*
- * maps from a normal row-major configuration to the
- * pvr2's own "twiddled" format
+ * bookkeeping for each entry in tex_cache.  The entries are kept in a
+ * doubly-linked list from most-recently-used (lru_head) to
+ * least-recently-used (lru_tail).  Empty entries always sit at the tail end,
+ * so they get used before anything gets evicted.
  */
-static unsigned tex_twiddle(unsigned x, unsigned y,
-                            unsigned w_shift, unsigned h_shift) {
-    assert(x < (1 << w_shift));
-    assert(y < (1 << h_shift));
+static struct tex_meta {
+    uint64_t key;
+    int lru_prev, lru_next;
 
-    if (w_shift == 0 && h_shift == 0)
-        return 0;
+    // the value of tex_frame when this texture was last referenced
+    unsigned last_frame;
 
-    unsigned w_shift_next = w_shift;
-    unsigned h_shift_next = h_shift;
-    if (w_shift)
-        w_shift_next--;
-    if (h_shift)
-        h_shift_next--;
-
-    if (x < (1 << w_shift_next) && y < (1 << h_shift_next)) {
-        return tex_twiddle(x, y, w_shift_next, h_shift_next);
-    } else if (x < (1 << w_shift_next) && y >= (1 << h_shift_next)) {
-        return (1 << w_shift_next) * (1 << h_shift_next) +
-            tex_twiddle(x, y - (1 << h_shift_next), w_shift_next, h_shift_next);
-    } else if (x >= (1 << w_shift_next) && y < (1 << h_shift_next)) {
-        return 2 * (1 << w_shift_next) * (1 << h_shift_next) +
-            tex_twiddle(x - (1 << w_shift_next), y, w_shift_next, h_shift_next);
-    } else {
-        return 3 * (1 << w_shift_next) * (1 << h_shift_next) +
-            tex_twiddle(x - (1 << w_shift_next), y - (1 << h_shift_next),
-                        w_shift_next, h_shift_next);
+    /*
+     * hash of the raw texture data the last time it was sent to the
+     * renderer.  If a dirty texture still hashes to this, the renderer
+     * already has it and it doesn't need to go out again.  This is only
+     * valid if has_content_hash is set.
+     */
+    uint64_t content_hash;
+    bool has_content_hash;
+} tex_meta[PVR2_TEX_CACHE_SIZE];
+
+static int lru_head, lru_tail;
+
+// this gets incremented every time the texture cache gets sent to the renderer
+static unsigned tex_frame;
+
+static struct pvr2_tex_cache_stats stats;
+
+/*
+ * Writes to texture memory don't touch the cache directly.  They just mark
+ * the pages they hit in this bitmap, and pvr2_tex_cache_xmit checks every
+ * texture's pages against it once per frame.  This can make a texture look
+ * dirty when it was really a neighbor sharing the same page that got written,
+ * but the worst that does is cause an extra upload.
+ */
+#define TEX_PAGE_SHIFT 10
+#define TEX_PAGE_COUNT \
+    ((ADDR_TEX64_LAST - ADDR_TEX64_FIRST + 1) >> TEX_PAGE_SHIFT)
+#define TEX_DIRTY_WORDS (TEX_PAGE_COUNT / 64)
+
+static_assert(TEX_PAGE_COUNT % 64 == 0,
+              "texture memory isn't a whole number of bitmap words");
+
+static uint64_t tex_dirty_pages[TEX_DIRTY_WORDS];
+
+#ifdef ENABLE_PVR2_TA_THREAD
+/*
+ * The TA worker thread looks textures up and adds them while the emulation
+ * thread is running, so find and add take this lock.  notify_write doesn't
+ * because it only touches tex_dirty_pages, which belongs to the emulation
+ * thread.  pvr2_tex_cache_xmit doesn't need it either because it only gets
+ * called after pvr2_ta_sync.
+ */
+static pthread_mutex_t tex_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+#define TEX_CACHE_LOCK() pthread_mutex_lock(&tex_cache_lock)
+#define TEX_CACHE_UNLOCK() pthread_mutex_unlock(&tex_cache_lock)
+#else
+#define TEX_CACHE_LOCK() do { } while (0)
+#define TEX_CACHE_UNLOCK() do { } while (0)
+#endif
+
+static uint64_t tex_key(uint32_t addr, unsigned w, unsigned h, int pix_fmt,
+                        bool twiddled, bool vq, bool mipmap);
+static unsigned tex_key_hash(uint64_t key);
+static uint64_t tex_content_hash(uint8_t const *dat, size_t n_bytes);
+static int tex_hash_find(uint64_t key);
+static void tex_hash_remove(int tex_idx);
+static void lru_unlink(int tex_idx);
+static void lru_push_head(int tex_idx);
+static void tex_pages_mark(unsigned page_first, unsigned page_last);
+static bool tex_pages_test(unsigned page_first, unsigned page_last);
+
+void pvr2_tex_cache_init(void) {
+    int idx;
+
+    memset(tex_cache, 0, sizeof(tex_cache));
+    memset(&stats, 0, sizeof(stats));
+    memset(tex_dirty_pages, 0, sizeof(tex_dirty_pages));
+    tex_frame = 0;
+
+    for (idx = 0; idx < TEX_HASH_SIZE; idx++)
+        tex_hash[idx] = TEX_HASH_EMPTY;
+
+    for (idx = 0; idx < PVR2_TEX_CACHE_SIZE; idx++) {
+        tex_meta[idx].lru_prev = idx - 1;
+        tex_meta[idx].lru_next =
+            (idx + 1 < PVR2_TEX_CACHE_SIZE) ? idx + 1 : -1;
+        tex_meta[idx].last_frame = 0;
     }
+    lru_head = 0;
+    lru_tail = PVR2_TEX_CACHE_SIZE - 1;
 }
 
 struct pvr2_tex *pvr2_tex_cache_find(uint32_t addr, unsigned w,
-                                     unsigned h, int pix_fmt, bool twiddled) {
-    unsigned idx;
-    struct pvr2_tex *tex;
-    for (idx = 0; idx < PVR2_TEX_CACHE_SIZE; idx++) {
+                                     unsigned h, int pix_fmt, bool twiddled,
+                                     bool vq, bool mipmap) {
+    struct pvr2_tex *tex = NULL;
+
+    TEX_CACHE_LOCK();
+    int idx = tex_hash_find(tex_key(addr, w, h, pix_fmt,
+                                    twiddled, vq, mipmap));
+    if (idx >= 0) {
         tex = tex_cache + idx;
-        if (tex->valid && (tex->addr_first == addr) &&
-            (tex->w == w) && (tex->h == h) && (tex->pix_fmt == pix_fmt) &&
-            tex->twiddled == twiddled) {
-            return tex;
-        }
+        tex_meta[idx].last_frame = tex_frame;
+        lru_unlink(idx);
+        lru_push_head(idx);
+        stats.hits++;
+    } else {
+        stats.misses++;
     }
+    TEX_CACHE_UNLOCK();
 
-    return NULL;
+    return tex;
 }
 
 struct pvr2_tex *pvr2_tex_cache_add(uint32_t addr,
                                     unsigned w, unsigned h,
-                                    int pix_fmt, bool twiddled) {
+                                    int pix_fmt, bool twiddled,
+                                    bool vq, bool mipmap) {
     assert(pix_fmt < TEX_CTRL_PIX_FMT_INVALID);
 
-    unsigned idx;// = addr & PVR2_TEX_CACHE_MASK;
-    /* struct pvr2_tex *tex = tex_cache + idx; */
-    struct pvr2_tex *tex;
-    for (idx = 0; idx < PVR2_TEX_CACHE_SIZE; idx++) {
-        tex = tex_cache + idx;
-        if (!tex->valid)
-            break;
-    }
+    TEX_CACHE_LOCK();
+
+    int idx = lru_tail;
+    struct pvr2_tex *tex = tex_cache + idx;
+    struct tex_meta *meta = tex_meta + idx;
+
+    if (tex->valid) {
+        /*
+         * Anything that's been referenced since the last time the cache was
+         * sent to the renderer can't be evicted because there are
+         * poly_groups in the current geo_buf that point to it.  If the
+         * least-recently-used texture is one of those, then all of them are.
+         */
+        if (meta->last_frame == tex_frame) {
+            stats.overflows++;
+            TEX_CACHE_UNLOCK();
+            fprintf(stderr, "ERROR: TEXTURE CACHE OVERFLOW\n");
+            return NULL;
+        }
 
-    if (idx >= PVR2_TEX_CACHE_SIZE) {
-        // TODO: This is where we should evict an old texture
-        fprintf(stderr, "ERROR: TEXTURE CACHE OVERFLOW\n");
-        return NULL;
+        /*
+         * The renderer will reuse this entry's texture object for the new
+         * texture when it sees the entry come through dirty.
+         */
+        tex_hash_remove(idx);
+        stats.evictions++;
     }
 
     tex->addr_first = addr;
@@ -130,6 +228,20 @@ struct pvr2_tex *pvr2_tex_cache_add(uint32_t addr,
     tex->dirty = true;
     tex->twiddled = twiddled;
 
+    meta->key = tex_key(addr, w, h, pix_fmt, twiddled, vq, mipmap);
+    meta->last_frame = tex_frame;
+    meta->has_content_hash = false;
+
+    unsigned slot = tex_key_hash(meta->key);
+    while (tex_hash[slot] != TEX_HASH_EMPTY)
+        slot = (slot + 1) & TEX_HASH_MASK;
+    tex_hash[slot] = idx;
+
+    lru_unlink(idx);
+    lru_push_head(idx);
+
+    TEX_CACHE_UNLOCK();
+
     /*
      * We defer reading the actual data from texture memory until we're ready
      * to transmit this to the rendering thread.
@@ -138,32 +250,195 @@ struct pvr2_tex *pvr2_tex_cache_add(uint32_t addr,
     return tex;
 }
 
-static inline bool check_overlap(uint32_t range1_start, uint32_t range1_end,
-                                 uint32_t range2_start, uint32_t range2_end) {
-    if ((range1_start >= range2_start) && (range1_start <= range2_end))
-        return true;
-    if ((range1_end >= range2_start) && (range1_end <= range2_end))
-        return true;
-    if ((range2_start >= range1_start) && (range2_start <= range1_end))
-        return true;
-    if ((range2_end >= range1_start) && (range2_end <= range1_end))
-        return true;
-    return false;
+void pvr2_tex_cache_get_stats(struct pvr2_tex_cache_stats *stats_out) {
+    TEX_CACHE_LOCK();
+    memcpy(stats_out, &stats, sizeof(*stats_out));
+    TEX_CACHE_UNLOCK();
 }
 
-void pvr2_tex_cache_notify_write(uint32_t addr_first, uint32_t len) {
-    unsigned idx;
-    uint32_t addr_last = addr_first + (len - 1);
+/*
+ * Everything that identifies a texture packed into one integer.  Texture
+ * memory is 8MB so the address fits in 24 bits, and the dimensions are
+ * between 8 and 1024 so they fit in 11 bits each.
+ */
+static uint64_t tex_key(uint32_t addr, unsigned w, unsigned h, int pix_fmt,
+                        bool twiddled, bool vq, bool mipmap) {
+    return (uint64_t)(addr & 0xffffff) |
+        ((uint64_t)w << 24) |
+        ((uint64_t)h << 35) |
+        ((uint64_t)pix_fmt << 46) |
+        ((uint64_t)twiddled << 49) |
+        ((uint64_t)vq << 50) |
+        ((uint64_t)mipmap << 51);
+}
 
-    for (idx = 0; idx < PVR2_TEX_CACHE_SIZE; idx++) {
-        struct pvr2_tex *tex = tex_cache + idx;
-        if (tex->valid &&
-            check_overlap(addr_first, addr_last,
-                          tex->addr_first + ADDR_TEX64_FIRST,
-                          tex->addr_last + ADDR_TEX64_FIRST)) {
-            tex->dirty = true;
+// fibonacci hashing
+static unsigned tex_key_hash(uint64_t key) {
+    return (unsigned)((key * 0x9e3779b97f4a7c15ull) >> (64 - TEX_HASH_BITS));
+}
+
+/*
+ * Hashes texture data 32 bytes at a time with four independent
+ * multiply-rotate lanes so the multiplies can overlap.  This only needs to
+ * notice when a texture changes, so it doesn't have to be any good against
+ * somebody trying to make it collide.
+ */
+#define CONTENT_HASH_PRIME1 0x9e3779b185ebca87ull
+#define CONTENT_HASH_PRIME2 0xc2b2ae3d27d4eb4full
+
+static inline uint64_t content_hash_round(uint64_t acc, uint64_t word) {
+    acc += word * CONTENT_HASH_PRIME2;
+    acc = (acc << 31) | (acc >> 33);
+    return acc * CONTENT_HASH_PRIME1;
+}
+
+static uint64_t tex_content_hash(uint8_t const *dat, size_t n_bytes) {
+    uint64_t lanes[4] = {
+        CONTENT_HASH_PRIME1, CONTENT_HASH_PRIME2, 0, ~CONTENT_HASH_PRIME1
+    };
+    uint64_t hash, word;
+    size_t offs = 0;
+    unsigned lane;
+
+    for (; offs + 32 <= n_bytes; offs += 32) {
+        for (lane = 0; lane < 4; lane++) {
+            memcpy(&word, dat + offs + 8 * lane, sizeof(word));
+            lanes[lane] = content_hash_round(lanes[lane], word);
+        }
+    }
+
+    hash = n_bytes;
+    for (lane = 0; lane < 4; lane++)
+        hash = content_hash_round(hash, lanes[lane]);
+
+    for (; offs < n_bytes; offs++)
+        hash = content_hash_round(hash, dat[offs]);
+
+    // murmur3's finalizer, so every input bit affects every output bit
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+
+    return hash;
+}
+
+static int tex_hash_find(uint64_t key) {
+    unsigned slot = tex_key_hash(key);
+    int idx;
+
+    while ((idx = tex_hash[slot]) != TEX_HASH_EMPTY) {
+        if (tex_meta[idx].key == key)
+            return idx;
+        slot = (slot + 1) & TEX_HASH_MASK;
+    }
+
+    return -1;
+}
+
+/*
+ * Removing an entry from a linear-probing table leaves a hole that would cut
+ * off the probe sequences of anything that collided with it, so every entry
+ * after the hole (up to the next empty slot) that could live in the hole gets
+ * moved back into it.
+ */
+static void tex_hash_remove(int tex_idx) {
+    unsigned hole = tex_key_hash(tex_meta[tex_idx].key);
+
+    while (tex_hash[hole] != tex_idx)
+        hole = (hole + 1) & TEX_HASH_MASK;
+
+    unsigned slot = hole;
+    for (;;) {
+        slot = (slot + 1) & TEX_HASH_MASK;
+
+        int idx = tex_hash[slot];
+        if (idx == TEX_HASH_EMPTY)
+            break;
+
+        // can idx's home slot reach the hole without passing slot?
+        unsigned home = tex_key_hash(tex_meta[idx].key);
+        if (((slot - home) & TEX_HASH_MASK) >= ((slot - hole) & TEX_HASH_MASK)) {
+            tex_hash[hole] = idx;
+            hole = slot;
         }
     }
+
+    tex_hash[hole] = TEX_HASH_EMPTY;
+}
+
+static void lru_unlink(int tex_idx) {
+    struct tex_meta *meta = tex_meta + tex_idx;
+
+    if (meta->lru_prev >= 0)
+        tex_meta[meta->lru_prev].lru_next = meta->lru_next;
+    else
+        lru_head = meta->lru_next;
+
+    if (meta->lru_next >= 0)
+        tex_meta[meta->lru_next].lru_prev = meta->lru_prev;
+    else
+        lru_tail = meta->lru_prev;
+}
+
+static void lru_push_head(int tex_idx) {
+    struct tex_meta *meta = tex_meta + tex_idx;
+
+    meta->lru_prev = -1;
+    meta->lru_next = lru_head;
+    if (lru_head >= 0)
+        tex_meta[lru_head].lru_prev = tex_idx;
+    else
+        lru_tail = tex_idx;
+    lru_head = tex_idx;
+}
+
+void pvr2_tex_cache_notify_write(uint32_t addr_first, uint32_t len) {
+    if (!len)
+        return;
+
+    uint32_t offs = addr_first - ADDR_TEX64_FIRST;
+    tex_pages_mark(offs >> TEX_PAGE_SHIFT, (offs + (len - 1)) >> TEX_PAGE_SHIFT);
+}
+
+// bits first_bit through last_bit (inclusive) of a word
+static inline uint64_t tex_page_mask(unsigned first_bit, unsigned last_bit) {
+    return (~(uint64_t)0 << first_bit) & (~(uint64_t)0 >> (63 - last_bit));
+}
+
+static void tex_pages_mark(unsigned page_first, unsigned page_last) {
+    unsigned word_first = page_first / 64, word_last = page_last / 64;
+
+    if (word_first == word_last) {
+        tex_dirty_pages[word_first] |=
+            tex_page_mask(page_first % 64, page_last % 64);
+        return;
+    }
+
+    // DMA transfers can cover a lot of pages, so fill whole words at a time
+    tex_dirty_pages[word_first] |= tex_page_mask(page_first % 64, 63);
+    unsigned word;
+    for (word = word_first + 1; word < word_last; word++)
+        tex_dirty_pages[word] = ~(uint64_t)0;
+    tex_dirty_pages[word_last] |= tex_page_mask(0, page_last % 64);
+}
+
+static bool tex_pages_test(unsigned page_first, unsigned page_last) {
+    unsigned word_first = page_first / 64, word_last = page_last / 64;
+
+    if (word_first == word_last) {
+        return tex_dirty_pages[word_first] &
+            tex_page_mask(page_first % 64, page_last % 64);
+    }
+
+    if (tex_dirty_pages[word_first] & tex_page_mask(page_first % 64, 63))
+        return true;
+    unsigned word;
+    for (word = word_first + 1; word < word_last; word++)
+        if (tex_dirty_pages[word])
+            return true;
+    return tex_dirty_pages[word_last] & tex_page_mask(0, page_last % 64);
 }
 
 /*
@@ -201,66 +476,103 @@ static unsigned pvr2_log2(unsigned in) {
 
 void pvr2_tex_cache_xmit(struct geo_buf *out) {
     unsigned idx;
+
     for (idx = 0; idx < PVR2_TEX_CACHE_SIZE; idx++) {
         struct pvr2_tex *tex_in = tex_cache + idx;
         struct pvr2_tex *tex_out = out->tex_cache + idx;
 
-        if (tex_in->valid && tex_in->dirty) {
-            tex_out->addr_first = tex_in->addr_first;
-            tex_out->addr_last = tex_in->addr_last;
-            tex_out->w = tex_in->w;
-            tex_out->h = tex_in->h;
-            tex_out->pix_fmt = tex_in->pix_fmt;
-            tex_out->twiddled = tex_in->twiddled;
+        /*
+         * The texture's address comes straight from the guest, so it can
+         * run off the end of texture memory.  The pages past the end can't be
+         * written to, so they're never dirty.
+         */
+        if (tex_in->valid && !tex_in->dirty &&
+            (tex_in->addr_first >> TEX_PAGE_SHIFT) < TEX_PAGE_COUNT) {
+            unsigned page_last = tex_in->addr_last >> TEX_PAGE_SHIFT;
+            if (page_last >= TEX_PAGE_COUNT)
+                page_last = TEX_PAGE_COUNT - 1;
+            if (tex_pages_test(tex_in->addr_first >> TEX_PAGE_SHIFT,
+                               page_last))
+                tex_in->dirty = true;
+        }
 
+        /*
+         * Textures that this frame doesn't use stay dirty until a frame that
+         * does use them comes along, so nobody waits on decoding them.
+         */
+        if (tex_in->valid && tex_in->dirty &&
+            tex_meta[idx].last_frame == tex_frame) {
             // TODO: better error-handling
             if ((ADDR_TEX64_LAST - ADDR_TEX64_FIRST + 1) <=
                 (tex_in->addr_last - tex_in->addr_first + 1)) {
                 abort();
             }
 
-            printf("tex_in->addr_first is 0x%08x\n", tex_in->addr_first);
-
-            size_t n_bytes = sizeof(uint8_t) *
-                tex_in->w * tex_in->h * pixel_sizes[tex_in->pix_fmt];
-            tex_out->dat = (uint8_t*)malloc(n_bytes);
+            unsigned pix_size = pixel_sizes[tex_in->pix_fmt];
+            size_t n_bytes = sizeof(uint8_t) * tex_in->w * tex_in->h * pix_size;
+            uint8_t const *beg = pvr2_tex64_mem + tex_in->addr_first;
 
-            // de-twiddle
             /*
-             * TODO: don't do this unconditionally
-             * not all textures are twiddled
+             * lots of games rewrite textures with exactly what was already
+             * there (fonts and UI get DMA'd in every frame), so don't bother
+             * decoding and uploading it again if nothing actually changed.
              */
-            uint8_t const *beg = pvr2_tex64_mem + tex_in->addr_first;
-            if (tex_in->twiddled) {
-                unsigned row, col;
-                for (row = 0; row < tex_in->h; row++) {
-                    for (col = 0; col < tex_in->w; col++) {
-                        unsigned twid_idx = tex_twiddle(col, row,
-                                                        pvr2_log2(tex_in->w),
-                                                        pvr2_log2(tex_in->h));
-
-                        void *dst_ptr = tex_out->dat +
-                            (row * tex_in->w + col) *
-                            pixel_sizes[tex_in->pix_fmt];
-                        memcpy(dst_ptr,
-                               beg + twid_idx * pixel_sizes[tex_in->pix_fmt],
-                               pixel_sizes[tex_in->pix_fmt]);
-                    }
-                }
-            } else {
-                memcpy(tex_out->dat, beg,
-                       pixel_sizes[tex_in->pix_fmt] * tex_in->w * tex_in->h);
+            struct tex_meta *meta = tex_meta + idx;
+            uint64_t content_hash = tex_content_hash(beg, n_bytes);
+            if (meta->has_content_hash && meta->content_hash == content_hash) {
+                stats.content_hits++;
+                tex_in->dirty = false;
+                continue;
             }
+            stats.content_misses++;
+            meta->content_hash = content_hash;
+            meta->has_content_hash = true;
 
-            // this is what you'd have to do for a non-twiddled texture, I think
-            /* memcpy(tex_out->dat, pvr2_tex64_mem + tex_in->addr_first, */
-            /*        tex_in->addr_last - tex_in->addr_first + 1); */
+            tex_out->addr_first = tex_in->addr_first;
+            tex_out->addr_last = tex_in->addr_last;
+            tex_out->w = tex_in->w;
+            tex_out->h = tex_in->h;
+            tex_out->pix_fmt = tex_in->pix_fmt;
+            tex_out->twiddled = tex_in->twiddled;
+
+            printf("tex_in->addr_first is 0x%08x\n", tex_in->addr_first);
+
+            tex_out->dat = (uint8_t*)malloc(n_bytes);
+            if (!tex_in->twiddled &&
+                tex_in->pix_fmt != TEX_CTRL_PIX_FMT_ARGB_4444) {
+                // nothing to decode
+                memcpy(tex_out->dat, beg, n_bytes);
+            } else {
+                /*
+                 * The decoder reads straight out of texture memory.  That's
+                 * safe because geo_buf_produce waits for it to finish before
+                 * the CPU gets to run again.
+                 */
+                struct pvr2_tex_decode_job job = {
+                    .dst = tex_out->dat,
+                    .src = beg,
+                    .w_shift = pvr2_log2(tex_in->w),
+                    .h_shift = pvr2_log2(tex_in->h),
+                    .pix_fmt = tex_in->pix_fmt,
+                    .pix_size = pix_size,
+                    .twiddled = tex_in->twiddled
+                };
+                pvr2_tex_decode_submit(&job);
+            }
 
             tex_in->dirty = false;
             tex_out->dirty = true;
             tex_out->valid = true;
         }
     }
+
+    /*
+     * every texture that's in the cache has been checked, and anything that
+     * gets added later will be read in full anyways.
+     */
+    memset(tex_dirty_pages, 0, sizeof(tex_dirty_pages));
+
+    tex_frame++;
 }
 
 int pvr2_tex_cache_get_idx(struct pvr2_tex const *tex) {
@@ -63,21 +63,54 @@ struct pvr2_tex {
     uint8_t *dat;
 };
 
-// insert the given texture into the cache
+void pvr2_tex_cache_init(void);
+
+/*
+ * insert the given texture into the cache.  If the cache is full, this evicts
+ * the least-recently-used texture that isn't referenced by the current frame.
+ * Returns NULL if every texture is referenced by the current frame.
+ */
 struct pvr2_tex *pvr2_tex_cache_add(uint32_t addr,
                                     unsigned w, unsigned h,
-                                    int pix_fmt, bool twiddled);
+                                    int pix_fmt, bool twiddled,
+                                    bool vq, bool mipmap);
 
 struct pvr2_tex *pvr2_tex_cache_find(uint32_t addr, unsigned w,
-                                     unsigned h, int pix_fmt, bool twiddled);
+                                     unsigned h, int pix_fmt, bool twiddled,
+                                     bool vq, bool mipmap);
 
+/*
+ * addr_first is an address in the 64-bit texture area.  This only marks the
+ * pages that got written; the textures on them don't get marked dirty until
+ * the next call to pvr2_tex_cache_xmit.
+ */
 void pvr2_tex_cache_notify_write(uint32_t addr_first, uint32_t len);
 
 int pvr2_tex_cache_get_idx(struct pvr2_tex const *tex);
 
+struct pvr2_tex_cache_stats {
+    unsigned long hits, misses;
+
+    // textures that got kicked out to make room for a new one
+    unsigned long evictions;
+
+    // times the cache was full of textures from the current frame
+    unsigned long overflows;
+
+    /*
+     * dirty textures that turned out to be the same as what the renderer
+     * already had (content_hits) or not (content_misses)
+     */
+    unsigned long content_hits, content_misses;
+};
+
+void pvr2_tex_cache_get_stats(struct pvr2_tex_cache_stats *stats_out);
+
 /*
  * this function sends the texture cache over to the rendering thread
- * by copying it to the given geo_buf
+ * by copying it to the given geo_buf.  Only dirty textures that the current
+ * frame uses get sent.  Their data may still be getting decoded when this
+ * returns; see pvr2_tex_decode.h
  */
 void pvr2_tex_cache_xmit(struct geo_buf *out);
 
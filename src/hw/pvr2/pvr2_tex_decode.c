@@ -0,0 +1,235 @@
+/*******************************************************************************
+ *
+ *
+ *    WashingtonDC Dreamcast Emulator
+ *    Copyright (C) 2017 snickerbockers
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ******************************************************************************/
+
+#include <err.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "error.h"
+#include "pvr2_ta.h"
+#include "pvr2_tex_cache.h"
+#include "pvr2_twiddle.h"
+
+#include "pvr2_tex_decode.h"
+
+/*
+ * pvr2_tex_cache_xmit submits at most one job per texture, and everything
+ * gets waited on before the next call, so the job list never needs to hold
+ * more than this.
+ */
+#define MAX_JOBS PVR2_TEX_CACHE_SIZE
+
+static pthread_t *decode_threads;
+static unsigned n_decode_threads;
+
+/*
+ * jobs[next_job] through jobs[n_jobs - 1] haven't been started yet.  n_pending
+ * counts the ones that haven't been finished yet.  All of this is protected by
+ * decode_lock.
+ */
+static struct pvr2_tex_decode_job jobs[MAX_JOBS];
+static unsigned n_jobs, next_job, n_pending;
+static bool decode_stop;
+
+static pthread_mutex_t decode_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// signaled when there are new jobs (or when it's time to stop)
+static pthread_cond_t decode_work_cond = PTHREAD_COND_INITIALIZER;
+
+// signaled when n_pending reaches zero
+static pthread_cond_t decode_done_cond = PTHREAD_COND_INITIALIZER;
+
+static struct pvr2_tex_decode_stats stats;
+
+static void *decode_thread_main(void *arg);
+static void tex_decode(struct pvr2_tex_decode_job const *job);
+
+void pvr2_tex_decode_init(unsigned n_threads) {
+    unsigned idx;
+    int err_code;
+
+    pvr2_twiddle_init();
+
+    memset(&stats, 0, sizeof(stats));
+    n_jobs = next_job = n_pending = 0;
+    decode_stop = false;
+
+    n_decode_threads = n_threads;
+    if (!n_threads)
+        return;
+
+    decode_threads = (pthread_t*)calloc(n_threads, sizeof(pthread_t));
+    if (!decode_threads)
+        RAISE_ERROR(ERROR_FAILED_ALLOC);
+
+    for (idx = 0; idx < n_threads; idx++) {
+        err_code = pthread_create(decode_threads + idx, NULL,
+                                  decode_thread_main, NULL);
+        if (err_code != 0)
+            err(errno, "Unable to launch texture decode thread");
+    }
+}
+
+void pvr2_tex_decode_cleanup(void) {
+    unsigned idx;
+
+    if (!n_decode_threads)
+        return;
+
+    if (pthread_mutex_lock(&decode_lock) != 0)
+        abort(); // TODO: error handling
+    decode_stop = true;
+    pthread_cond_broadcast(&decode_work_cond);
+    if (pthread_mutex_unlock(&decode_lock) != 0)
+        abort(); // TODO: error handling
+
+    for (idx = 0; idx < n_decode_threads; idx++)
+        pthread_join(decode_threads[idx], NULL);
+
+    free(decode_threads);
+    decode_threads = NULL;
+    n_decode_threads = 0;
+}
+
+void pvr2_tex_decode_submit(struct pvr2_tex_decode_job const *job) {
+    if (!n_decode_threads) {
+        stats.jobs++;
+        tex_decode(job);
+        return;
+    }
+
+    if (pthread_mutex_lock(&decode_lock) != 0)
+        abort(); // TODO: error handling
+
+    if (n_jobs >= MAX_JOBS)
+        RAISE_ERROR(ERROR_INTEGRITY);
+
+    jobs[n_jobs++] = *job;
+    n_pending++;
+    stats.jobs++;
+    pthread_cond_signal(&decode_work_cond);
+
+    if (pthread_mutex_unlock(&decode_lock) != 0)
+        abort(); // TODO: error handling
+}
+
+void pvr2_tex_decode_wait(void) {
+    if (!n_decode_threads)
+        return;
+
+    if (pthread_mutex_lock(&decode_lock) != 0)
+        abort(); // TODO: error handling
+
+    /*
+     * The CPU thread can't do anything else until the decodes are finished,
+     * so it might as well help out instead of going to sleep.  Once there's
+     * nothing left to start, it only has to wait on the jobs that the decode
+     * threads are already working on.
+     */
+    while (next_job < n_jobs) {
+        struct pvr2_tex_decode_job job = jobs[next_job++];
+
+        if (pthread_mutex_unlock(&decode_lock) != 0)
+            abort(); // TODO: error handling
+
+        tex_decode(&job);
+
+        if (pthread_mutex_lock(&decode_lock) != 0)
+            abort(); // TODO: error handling
+
+        n_pending--;
+    }
+
+    if (n_pending)
+        stats.waits++;
+    while (n_pending)
+        pthread_cond_wait(&decode_done_cond, &decode_lock);
+
+    // nobody is looking at the job list now, so start over from the top
+    n_jobs = next_job = 0;
+
+    if (pthread_mutex_unlock(&decode_lock) != 0)
+        abort(); // TODO: error handling
+}
+
+void pvr2_tex_decode_get_stats(struct pvr2_tex_decode_stats *stats_out) {
+    if (pthread_mutex_lock(&decode_lock) != 0)
+        abort(); // TODO: error handling
+    memcpy(stats_out, &stats, sizeof(*stats_out));
+    if (pthread_mutex_unlock(&decode_lock) != 0)
+        abort(); // TODO: error handling
+}
+
+static void *decode_thread_main(void *arg) {
+    if (pthread_mutex_lock(&decode_lock) != 0)
+        abort(); // TODO: error handling
+
+    for (;;) {
+        while (next_job == n_jobs && !decode_stop)
+            pthread_cond_wait(&decode_work_cond, &decode_lock);
+
+        if (next_job == n_jobs)
+            break; // decode_stop is set and there's nothing left to do
+
+        struct pvr2_tex_decode_job job = jobs[next_job++];
+
+        if (pthread_mutex_unlock(&decode_lock) != 0)
+            abort(); // TODO: error handling
+
+        tex_decode(&job);
+
+        if (pthread_mutex_lock(&decode_lock) != 0)
+            abort(); // TODO: error handling
+
+        if (!--n_pending)
+            pthread_cond_signal(&decode_done_cond);
+    }
+
+    if (pthread_mutex_unlock(&decode_lock) != 0)
+        abort(); // TODO: error handling
+
+    return NULL;
+}
+
+static void tex_decode(struct pvr2_tex_decode_job const *job) {
+    size_t n_pixels = (size_t)1 << (job->w_shift + job->h_shift);
+
+    if (job->twiddled) {
+        if (job->pix_fmt == TEX_CTRL_PIX_FMT_ARGB_4444) {
+            pvr2_detwiddle_argb_4444((uint16_t*)job->dst,
+                                     (uint16_t const*)job->src,
+                                     job->w_shift, job->h_shift);
+        } else if (job->pix_size == 2) {
+            pvr2_detwiddle_16((uint16_t*)job->dst, (uint16_t const*)job->src,
+                              job->w_shift, job->h_shift);
+        } else if (job->pix_size == 1) {
+            pvr2_detwiddle_8(job->dst, job->src, job->w_shift, job->h_shift);
+        }
+    } else if (job->pix_fmt == TEX_CTRL_PIX_FMT_ARGB_4444) {
+        pvr2_conv_argb_4444((uint16_t*)job->dst, (uint16_t const*)job->src,
+                            n_pixels);
+    } else {
+        memcpy(job->dst, job->src, job->pix_size * n_pixels);
+    }
+}
@@ -0,0 +1,89 @@
+/*******************************************************************************
+ *
+ *
+ *    WashingtonDC Dreamcast Emulator
+ *    Copyright (C) 2017 snickerbockers
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ******************************************************************************/
+
+#ifndef PVR2_TEX_DECODE_H_
+#define PVR2_TEX_DECODE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A small pool of threads that turns textures from the PVR2's formats into
+ * something OpenGL can use.  pvr2_tex_cache_xmit hands out the work, and
+ * geo_buf_produce waits for it to finish before the geo_buf goes to the
+ * gfx_thread.  The thread that waits decodes textures too, so the pool just
+ * adds more threads to the decoding.
+ *
+ * With zero threads, every texture gets decoded on the spot by
+ * pvr2_tex_decode_submit.
+ */
+
+#define PVR2_TEX_DECODE_THREADS_DEFAULT 2
+
+struct pvr2_tex_decode_job {
+    uint8_t *dst;
+
+    /*
+     * This points into texture memory, so the guest can't be allowed to run
+     * until pvr2_tex_decode_wait returns.
+     */
+    uint8_t const *src;
+
+    unsigned w_shift, h_shift;
+    int pix_fmt;
+    unsigned pix_size; // bytes per texel
+    bool twiddled;
+};
+
+void pvr2_tex_decode_init(unsigned n_threads);
+void pvr2_tex_decode_cleanup(void);
+
+// job gets copied, so it doesn't need to stick around
+void pvr2_tex_decode_submit(struct pvr2_tex_decode_job const *job);
+
+/*
+ * wait for every job that's been submitted to finish, decoding whatever
+ * hasn't been started yet on the calling thread
+ */
+void pvr2_tex_decode_wait(void);
+
+struct pvr2_tex_decode_stats {
+    unsigned long jobs;
+
+    /*
+     * times pvr2_tex_decode_wait had to block on a decode thread after
+     * running out of jobs to do itself
+     */
+    unsigned long waits;
+};
+
+void pvr2_tex_decode_get_stats(struct pvr2_tex_decode_stats *stats_out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
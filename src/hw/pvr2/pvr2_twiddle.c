@@ -0,0 +1,239 @@
+/*******************************************************************************
+ *
+ *
+ *    WashingtonDC Dreamcast Emulator
+ *    Copyright (C) 2017 snickerbockers
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ******************************************************************************/
+
+#include <stdbool.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "pvr2_twiddle.h"
+
+/*
+ * Textures are between 8 and 1024 texels on a side, so the kernels below
+ * work on 8x8 tiles.  Every tile is 64 consecutive texels in the twiddled
+ * texture, so the source side is just a few unaligned loads.
+ */
+#define TWIDDLE_MAX_SHIFT 10
+#define TILE_SHIFT 3
+#define TILE_LEN (1 << TILE_SHIFT)
+
+// twiddle_lut[n] is n with its bits spread out into the even bits
+static uint32_t twiddle_lut[1 << TWIDDLE_MAX_SHIFT];
+
+void pvr2_twiddle_init(void) {
+    unsigned idx, bit;
+
+    for (idx = 0; idx < (1 << TWIDDLE_MAX_SHIFT); idx++) {
+        uint32_t spread = 0;
+        for (bit = 0; bit < TWIDDLE_MAX_SHIFT; bit++)
+            if (idx & (1 << bit))
+                spread |= 1 << (2 * bit);
+        twiddle_lut[idx] = spread;
+    }
+}
+
+/*
+ * min_shift is the log2 of the texture's shorter side.  Whichever of x and y
+ * goes past that gets its extra bits stacked on top of the interleaved ones.
+ */
+static inline unsigned twiddle_offset(unsigned x, unsigned y,
+                                      unsigned min_shift) {
+    unsigned mask = (1 << min_shift) - 1;
+
+    return ((twiddle_lut[x & mask] << 1) | twiddle_lut[y & mask]) |
+        (((x | y) >> min_shift) << (2 * min_shift));
+}
+
+static inline unsigned min_shift_of(unsigned w_shift, unsigned h_shift) {
+    return w_shift < h_shift ? w_shift : h_shift;
+}
+
+static inline uint16_t argb_4444_to_rgba(uint16_t pix) {
+    return (uint16_t)((pix << 4) | (pix >> 12));
+}
+
+#ifdef __SSE2__
+
+static inline __m128i argb_4444_to_rgba_x8(__m128i pix) {
+    return _mm_or_si128(_mm_slli_epi16(pix, 4), _mm_srli_epi16(pix, 12));
+}
+
+/*
+ * splits a 4x4 block of 16-bit texels (16 consecutive texels in Morton order)
+ * into its rows.  rows01 ends up with row 0 in its low half and row 1 in its
+ * high half, and rows23 has rows 2 and 3.
+ */
+static inline void detwiddle_blk_4x4(uint16_t const *blk, bool swizzle,
+                                     __m128i *rows01, __m128i *rows23) {
+    __m128i lo = _mm_loadu_si128((__m128i const*)blk);
+    __m128i hi = _mm_loadu_si128((__m128i const*)(blk + 8));
+
+    if (swizzle) {
+        lo = argb_4444_to_rgba_x8(lo);
+        hi = argb_4444_to_rgba_x8(hi);
+    }
+
+    /*
+     * the low bit of the offset is y and the next bit is x, so swapping the
+     * middle two texels of every group of four leaves each 32-bit lane
+     * holding two horizontally adjacent texels from the same row.
+     */
+    lo = _mm_shufflelo_epi16(lo, _MM_SHUFFLE(3, 1, 2, 0));
+    lo = _mm_shufflehi_epi16(lo, _MM_SHUFFLE(3, 1, 2, 0));
+    hi = _mm_shufflelo_epi16(hi, _MM_SHUFFLE(3, 1, 2, 0));
+    hi = _mm_shufflehi_epi16(hi, _MM_SHUFFLE(3, 1, 2, 0));
+
+    *rows01 = _mm_unpacklo_epi32(lo, hi);
+    *rows23 = _mm_unpackhi_epi32(lo, hi);
+}
+
+/*
+ * An 8x8 tile is four 4x4 blocks.  The right half of each row comes from the
+ * block 32 texels after the one the left half comes from.
+ */
+static inline void detwiddle_tile_16(uint16_t *dst, unsigned stride,
+                                     uint16_t const *tile, bool swizzle) {
+    unsigned half;
+
+    for (half = 0; half < 2; half++) {
+        __m128i l01, l23, r01, r23;
+        uint16_t const *left = tile + 16 * half;
+        uint16_t *row = dst + 4 * half * stride;
+
+        detwiddle_blk_4x4(left, swizzle, &l01, &l23);
+        detwiddle_blk_4x4(left + 32, swizzle, &r01, &r23);
+
+        _mm_storeu_si128((__m128i*)row, _mm_unpacklo_epi64(l01, r01));
+        _mm_storeu_si128((__m128i*)(row + stride),
+                         _mm_unpackhi_epi64(l01, r01));
+        _mm_storeu_si128((__m128i*)(row + 2 * stride),
+                         _mm_unpacklo_epi64(l23, r23));
+        _mm_storeu_si128((__m128i*)(row + 3 * stride),
+                         _mm_unpackhi_epi64(l23, r23));
+    }
+}
+
+#else
+
+static inline void detwiddle_tile_16(uint16_t *dst, unsigned stride,
+                                     uint16_t const *tile, bool swizzle) {
+    unsigned x, y;
+
+    for (y = 0; y < TILE_LEN; y++) {
+        uint16_t *row = dst + y * stride;
+        uint32_t y_bits = twiddle_lut[y];
+        for (x = 0; x < TILE_LEN; x++) {
+            uint16_t pix = tile[(twiddle_lut[x] << 1) | y_bits];
+            row[x] = swizzle ? argb_4444_to_rgba(pix) : pix;
+        }
+    }
+}
+
+#endif
+
+static inline void detwiddle_tile_8(uint8_t *dst, unsigned stride,
+                                    uint8_t const *tile) {
+    unsigned x, y;
+
+    for (y = 0; y < TILE_LEN; y++) {
+        uint8_t *row = dst + y * stride;
+        uint32_t y_bits = twiddle_lut[y];
+        for (x = 0; x < TILE_LEN; x++)
+            row[x] = tile[(twiddle_lut[x] << 1) | y_bits];
+    }
+}
+
+/*
+ * swizzle is always a constant, so the two callers each get their own copy of
+ * this with the branch on it folded away.
+ */
+static inline void detwiddle_16(uint16_t *dst, uint16_t const *src,
+                                unsigned w_shift, unsigned h_shift,
+                                bool swizzle) {
+    unsigned w = 1 << w_shift, h = 1 << h_shift;
+    unsigned min_shift = min_shift_of(w_shift, h_shift);
+    unsigned x, y;
+
+    if (min_shift < TILE_SHIFT) {
+        // too small to be a real texture, but handle it anyways
+        for (y = 0; y < h; y++) {
+            for (x = 0; x < w; x++) {
+                uint16_t pix = src[twiddle_offset(x, y, min_shift)];
+                dst[y * w + x] = swizzle ? argb_4444_to_rgba(pix) : pix;
+            }
+        }
+        return;
+    }
+
+    for (y = 0; y < h; y += TILE_LEN) {
+        for (x = 0; x < w; x += TILE_LEN) {
+            detwiddle_tile_16(dst + y * w + x, w,
+                              src + twiddle_offset(x, y, min_shift), swizzle);
+        }
+    }
+}
+
+void pvr2_detwiddle_16(uint16_t *dst, uint16_t const *src,
+                       unsigned w_shift, unsigned h_shift) {
+    detwiddle_16(dst, src, w_shift, h_shift, false);
+}
+
+void pvr2_detwiddle_argb_4444(uint16_t *dst, uint16_t const *src,
+                              unsigned w_shift, unsigned h_shift) {
+    detwiddle_16(dst, src, w_shift, h_shift, true);
+}
+
+void pvr2_detwiddle_8(uint8_t *dst, uint8_t const *src,
+                      unsigned w_shift, unsigned h_shift) {
+    unsigned w = 1 << w_shift, h = 1 << h_shift;
+    unsigned min_shift = min_shift_of(w_shift, h_shift);
+    unsigned x, y;
+
+    if (min_shift < TILE_SHIFT) {
+        for (y = 0; y < h; y++)
+            for (x = 0; x < w; x++)
+                dst[y * w + x] = src[twiddle_offset(x, y, min_shift)];
+        return;
+    }
+
+    for (y = 0; y < h; y += TILE_LEN) {
+        for (x = 0; x < w; x += TILE_LEN) {
+            detwiddle_tile_8(dst + y * w + x, w,
+                             src + twiddle_offset(x, y, min_shift));
+        }
+    }
+}
+
+void pvr2_conv_argb_4444(uint16_t *dst, uint16_t const *src, size_t n_pixels) {
+    size_t pix_no = 0;
+
+#ifdef __SSE2__
+    for (; pix_no + 8 <= n_pixels; pix_no += 8) {
+        __m128i pix = _mm_loadu_si128((__m128i const*)(src + pix_no));
+        _mm_storeu_si128((__m128i*)(dst + pix_no), argb_4444_to_rgba_x8(pix));
+    }
+#endif
+
+    for (; pix_no < n_pixels; pix_no++)
+        dst[pix_no] = argb_4444_to_rgba(src[pix_no]);
+}
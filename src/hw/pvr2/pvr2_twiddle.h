@@ -0,0 +1,67 @@
+/*******************************************************************************
+ *
+ *
+ *    WashingtonDC Dreamcast Emulator
+ *    Copyright (C) 2017 snickerbockers
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ******************************************************************************/
+
+#ifndef PVR2_TWIDDLE_H_
+#define PVR2_TWIDDLE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * The PVR2's "twiddled" textures are stored in Morton order: the bits of a
+ * texel's x and y coordinates get interleaved (y in the even bits, x in the
+ * odd bits) to form its offset.  Non-square textures are stored as a row (or
+ * column) of square textures whose sides are the shorter of the two
+ * dimensions, so the extra bits of the longer dimension just go on top.
+ *
+ * These functions copy a twiddled texture at src into dst in the normal
+ * row-major order.  The width and height are (1 << w_shift) and
+ * (1 << h_shift).
+ */
+
+// call this once before any of the others
+void pvr2_twiddle_init(void);
+
+void pvr2_detwiddle_16(uint16_t *dst, uint16_t const *src,
+                       unsigned w_shift, unsigned h_shift);
+
+void pvr2_detwiddle_8(uint8_t *dst, uint8_t const *src,
+                      unsigned w_shift, unsigned h_shift);
+
+/*
+ * OpenGL doesn't have ARGB 4444, so these turn it into RGBA 4444 on the way.
+ * pvr2_conv_argb_4444 is for textures that aren't twiddled.
+ */
+void pvr2_detwiddle_argb_4444(uint16_t *dst, uint16_t const *src,
+                              unsigned w_shift, unsigned h_shift);
+
+void pvr2_conv_argb_4444(uint16_t *dst, uint16_t const *src, size_t n_pixels);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
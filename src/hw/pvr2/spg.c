@@ -121,6 +121,9 @@ static reg32_t spg_reg[SPG_REG_COUNT] = {
 
 static unsigned raster_x, raster_y;
 
+// incremented every V-BLANK IN; see spg_get_frame_count
+static unsigned long frame_count;
+
 static SchedEvent hblank_event, vblank_in_event, vblank_out_event;
 
 static bool hblank_event_scheduled, vblank_in_event_scheduled,
@@ -163,6 +166,10 @@ void spg_init() {
 void spg_cleanup() {
 }
 
+unsigned long spg_get_frame_count(void) {
+    return frame_count;
+}
+
 static void spg_unsched_all() {
     if (hblank_event_scheduled) {
         cancel_event(&hblank_event);
@@ -248,6 +255,8 @@ static void spg_handle_hblank(SchedEvent *event) {
 }
 
 static void spg_handle_vblank_in(SchedEvent *event) {
+    frame_count++;
+
     spg_sync();
     holly_raise_nrm_int(HOLLY_NRM_INT_VBLANK_IN);
     sched_next_vblank_in_event();
@@ -38,6 +38,9 @@ struct pvr2_core_mem_mapped_reg;
 void spg_init();
 void spg_cleanup();
 
+// returns the number of V-BLANK IN interrupts (ie frames) so far
+unsigned long spg_get_frame_count(void);
+
 // val should be either 1 or 2
 void spg_set_pclk_div(unsigned val);
 
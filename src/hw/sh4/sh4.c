@@ -52,8 +52,14 @@ void sh4_init(Sh4 *sh4) {
 
     sh4_tmu_init(sh4);
 
+    sh4_dmac_init(sh4);
+
     sh4_scif_init(&sh4->scif);
 
+    sh4_idle_init();
+
+    sh4_init_reg_map();
+
     sh4_init_regs(sh4);
 
     sh4_compile_instructions(sh4);
@@ -74,6 +80,12 @@ void sh4_init(Sh4 *sh4) {
 void sh4_cleanup(Sh4 *sh4) {
     error_rm_callback(&sh4_error_callback);
 
+    sh4_idle_cleanup();
+
+    sh4_cleanup_reg_map();
+
+    sh4_dmac_cleanup(sh4);
+
     sh4_tmu_cleanup(sh4);
 
     sh4_ocache_cleanup(&sh4->ocache);
@@ -108,7 +120,12 @@ void sh4_on_hard_reset(Sh4 *sh4) {
 
     sh4_ocache_clear(&sh4->ocache);
 
+    sh4_mem_refresh_pages(sh4);
+
+    sh4_refresh_intc_prio(sh4);
+
     sh4->exec_state = SH4_EXEC_STATE_NORM;
+    sh4->idle = false;
 }
 
 reg32_t sh4_get_pc(Sh4 *sh4) {
@@ -144,6 +161,11 @@ void sh4_set_individual_reg(Sh4 *sh4, unsigned reg_no, reg32_t reg_val) {
         sh4_on_sr_change(sh4, old_sr_val);
     } else {
         sh4->reg[reg_no] = reg_val;
+        if (reg_no == SH4_REG_CCR || reg_no == SH4_REG_MMUCR)
+            sh4_mem_refresh_pages(sh4);
+        else if (reg_no == SH4_REG_ICR || (reg_no >= SH4_REG_IPRA &&
+                                           reg_no <= SH4_REG_IPRD))
+            sh4_refresh_intc_prio(sh4);
     }
 }
 
@@ -182,12 +204,19 @@ void sh4_set_fpscr(Sh4 *sh4, reg32_t new_val) {
     sh4_fpu_bank_switch_maybe(sh4, sh4->reg[SH4_REG_FPSCR], new_val);
 
     sh4->reg[SH4_REG_FPSCR] = new_val;
+    sh4->inst_lut = sh4_inst_fpu_mode_lut[sh4_inst_fpu_mode(new_val)];
+
     if (sh4->reg[SH4_REG_FPSCR] & SH4_FPSCR_RM_MASK)
         fesetround(FE_TOWARDZERO);
     else
         fesetround(FE_TONEAREST);
 }
 
+/*
+ * if ENABLE_SH4_THREADED_DISPATCH is defined, sh4_run_cycles lives in
+ * sh4_inst.c instead so that it can get at the opcode handlers directly.
+ */
+#ifndef ENABLE_SH4_THREADED_DISPATCH
 void sh4_run_cycles(Sh4 *sh4, unsigned n_cycles) {
     inst_t inst;
     int exc_pending;
@@ -204,7 +233,7 @@ mulligan:
             }
         }
 
-        InstOpcode const *op = sh4_inst_lut[inst];
+        InstOpcode const *op = sh4->inst_lut[inst];
 
         if (op->issue > (n_cycles + sh4->cycles_accum)) {
             dc_cycle_advance(n_cycles);
@@ -242,7 +271,7 @@ mulligan:
                     RAISE_ERROR(get_error_pending());
             }
 
-            InstOpcode const *second_op = sh4_inst_lut[inst];
+            InstOpcode const *second_op = sh4->inst_lut[inst];
 
             if (second_op->group == SH4_GROUP_CO)
                 continue;
@@ -252,8 +281,12 @@ mulligan:
                 sh4_do_exec_inst(sh4, inst, second_op);
             }
         }
-    } while (n_cycles);
+    } while ((n_cycles = dc_sched_clamp_slice(n_cycles)) && !sh4->idle);
+
+    if (sh4->idle)
+        sh4_idle_skip(sh4, n_cycles);
 }
+#endif
 
 void sh4_fetch_inst(Sh4 *sh4, inst_t *inst_out, InstOpcode const **op_out,
                     unsigned *n_cycles_out) {
@@ -272,7 +305,7 @@ mulligan:
             RAISE_ERROR(get_error_pending());
     }
 
-    InstOpcode const *op = sh4_inst_lut[inst];
+    InstOpcode const *op = sh4->inst_lut[inst];
 
     if ((sh4->last_inst_type == SH4_GROUP_NONE) ||
         ((op->group == SH4_GROUP_CO) ||
@@ -37,6 +37,7 @@
 #include "sh4_excp.h"
 #include "sh4_scif.h"
 #include "sh4_dmac.h"
+#include "sh4_idle.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -113,6 +114,26 @@ struct Sh4 {
      */
      sh4_inst_group_t last_inst_type;
 
+    /*
+     * the entry in sh4_inst_fpu_mode_lut that matches the current
+     * FPSCR.PR/FPSCR.SZ bits.  sh4_set_fpscr keeps this up to date, so
+     * anything that changes either of those bits needs to go through there.
+     */
+    InstOpcode const * const *inst_lut;
+
+    /*
+     * one enum sh4_mem_page_type for every 16MB of the address space.  This
+     * depends on CCR and MMUCR; see sh4_mem_refresh_pages.
+     */
+    uint8_t mem_pages[SH4_MEM_N_PAGES];
+
+    /*
+     * set when the CPU is sleeping or stuck in an idle loop, which means it
+     * can't do anything different until the next scheduled event.  The run
+     * loops clear this by calling sh4_idle_skip.  See sh4_idle.h.
+     */
+    bool idle;
+
 #ifdef ENABLE_DEBUGGER
     /*
      * this member is used to implement watchpoints.  When a watchpoint
@@ -294,6 +315,27 @@ static inline double *sh4_fpu_xd(Sh4 *sh4, unsigned reg_no) {
     return (double*)(sh4->reg + SH4_REG_XD0 + (reg_no << 1));
 }
 
+/*
+ * check IRQ lines and enter interrupt state if necessary.  All of the work is
+ * done ahead of time by the interrupt controller, so this is just a check of
+ * sh4->intc.is_irq_pending.
+ *
+ * for the purposes of interrupt handling, I treat delayed-branch slots
+ * as atomic units because if I allowed an interrupt to happen between the
+ * two instructions then I would need a way to track the delayed branch slot
+ * until the interrupt handler returns, and I would need to account for
+ * situations such as interrupt handlers that never return and interrupt
+ * handlers that enable interrupts.
+ *
+ * And the hardware would have to do that too if that was the way it was
+ * implemented, so I'm *assuming* that it doesn't allow interrupts in the
+ * middle of delay slots either.
+ */
+static inline void sh4_check_interrupts(Sh4 *sh4) {
+    if (sh4->intc.is_irq_pending && !sh4->delayed_branch)
+        sh4_enter_pending_irq(sh4);
+}
+
 /*
  * this function should be called every time sr has just been written to and
  * bits other than T/Q/M/S may have changed
@@ -0,0 +1,187 @@
+/*******************************************************************************
+ *
+ *
+ *    WashingtonDC Dreamcast Emulator
+ *    Copyright (C) 2017 snickerbockers
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sh4.h"
+#include "sh4_mem.h"
+#include "error.h"
+#include "dreamcast.h"
+
+#include "sh4_cached_interp.h"
+
+/*
+ * Blocks get carved out of one big arena instead of being malloc'd
+ * individually.  Invalidated blocks aren't reclaimed until the arena fills
+ * up, at which point everything gets thrown away and we start over.  That
+ * means nothing ever has to be freed while a block is executing, which
+ * matters because a block can invalidate itself.
+ */
+#define CI_ARENA_SIZE (8 * 1024 * 1024)
+
+// every block's size gets rounded up to a multiple of this
+#define CI_BLOCK_ALIGN 16
+
+static struct sh4_code_cache ci_cache;
+
+static uint8_t *arena;
+static size_t arena_used;
+
+static struct sh4_cached_interp_stats stats;
+
+static struct sh4_code_block *ci_find(addr32_t pc);
+static struct sh4_code_block *ci_compile(addr32_t pc);
+static unsigned ci_exec(Sh4 *sh4, struct sh4_code_block *hdr);
+static void ci_flush(void);
+
+static struct sh4_code_runner const ci_runner = {
+    .find = ci_find,
+    .compile = ci_compile,
+    .exec = ci_exec
+};
+
+void sh4_cached_interp_init(void) {
+    memset(&stats, 0, sizeof(stats));
+
+    arena = (uint8_t*)malloc(CI_ARENA_SIZE);
+    if (!arena)
+        RAISE_ERROR(ERROR_FAILED_ALLOC);
+    arena_used = 0;
+
+    /*
+     * on_invalidate is NULL because there's nothing to do; the memory gets
+     * reclaimed when the arena is flushed.
+     */
+    sh4_code_cache_init(&ci_cache, NULL);
+}
+
+void sh4_cached_interp_cleanup(void) {
+    sh4_code_cache_cleanup(&ci_cache);
+    free(arena);
+    arena = NULL;
+}
+
+void sh4_cached_interp_get_stats(struct sh4_cached_interp_stats *stats_out) {
+    memcpy(stats_out, &stats, sizeof(*stats_out));
+    stats_out->blocks_invalidated = ci_cache.n_invalidated;
+}
+
+void sh4_cached_interp_run_cycles(Sh4 *sh4, unsigned n_cycles) {
+    sh4_code_cache_run_cycles(sh4, n_cycles, &ci_runner);
+}
+
+/*
+ * the P4 check is there because masking off the top three bits would make P4
+ * addresses alias with the boot ROM.
+ */
+static struct sh4_code_block *ci_find(addr32_t pc) {
+    if (pc >= SH4_AREA_P4_FIRST)
+        return NULL;
+    return sh4_code_cache_find(&ci_cache, pc & 0x1fffffff);
+}
+
+/*
+ * Every handler leaves the PC pointing at the next instruction unless it
+ * branched or raised an exception, so as long as the PC is where we expect
+ * it to be the block can keep going.  Delayed branches also move the PC
+ * forward by one instruction (they only set sh4->delayed_branch), which is
+ * how the block makes it to its delay slot.
+ */
+static unsigned ci_exec(Sh4 *sh4, struct sh4_code_block *hdr) {
+    struct sh4_cached_interp_block const *blk =
+        (struct sh4_cached_interp_block const*)hdr;
+    struct sh4_cached_interp_entry const *ent = blk->entries;
+    struct sh4_cached_interp_entry const *end = ent + blk->n_entries;
+    addr32_t next_pc = sh4->reg[SH4_REG_PC];
+
+    for (; ent < end; ent++) {
+        next_pc += 2;
+        ent->func(sh4, ent->oa);
+        if (sh4->reg[SH4_REG_PC] != next_pc)
+            return ent->cycles;
+    }
+
+    if (blk->has_slot && sh4->delayed_branch) {
+        /*
+         * sh4_do_exec_inst takes care of the branch itself, as well as
+         * illegal slot instructions.
+         */
+        sh4_do_exec_inst(sh4, blk->slot_oa.inst, blk->slot_op);
+        return blk->hdr.cycle_count;
+    }
+
+    return blk->cycle_count_no_slot;
+}
+
+static struct sh4_code_block *ci_compile(addr32_t pc) {
+    struct sh4_code_walk walk;
+    unsigned inst_no;
+
+    // see ci_find
+    if (pc >= SH4_AREA_P4_FIRST)
+        return NULL;
+
+    addr32_t paddr = pc & 0x1fffffff;
+
+    if (!sh4_code_walk_block(&walk, paddr))
+        return NULL;
+
+    size_t n_bytes = sizeof(struct sh4_cached_interp_block) +
+        walk.n_insts * sizeof(struct sh4_cached_interp_entry);
+    n_bytes = (n_bytes + CI_BLOCK_ALIGN - 1) & ~(size_t)(CI_BLOCK_ALIGN - 1);
+
+    if (arena_used + n_bytes > CI_ARENA_SIZE)
+        ci_flush();
+
+    struct sh4_cached_interp_block *blk =
+        (struct sh4_cached_interp_block*)(arena + arena_used);
+    arena_used += n_bytes;
+
+    for (inst_no = 0; inst_no < walk.n_insts; inst_no++) {
+        struct sh4_code_inst const *ent = walk.insts + inst_no;
+        blk->entries[inst_no].func = ent->op->func;
+        blk->entries[inst_no].oa.inst = ent->inst;
+        blk->entries[inst_no].cycles = ent->cycles;
+    }
+
+    blk->hdr.cycle_count = sh4_code_walk_cycles(&walk);
+    blk->cycle_count_no_slot = walk.insts[walk.n_insts - 1].cycles;
+    blk->has_slot = walk.has_slot;
+    blk->slot_oa.inst = walk.has_slot ? walk.slot.inst : 0;
+    blk->slot_op = walk.has_slot ? walk.slot.op : NULL;
+    blk->n_entries = walk.n_insts;
+
+    sh4_code_cache_insert(&ci_cache, &blk->hdr, paddr,
+                          sh4_code_walk_pc_last(&walk, paddr));
+
+    stats.blocks_compiled++;
+    stats.insts_decoded += walk.n_insts + (walk.has_slot ? 1 : 0);
+
+    return &blk->hdr;
+}
+
+static void ci_flush(void) {
+    sh4_code_cache_clear(&ci_cache);
+    arena_used = 0;
+    stats.flushes++;
+}
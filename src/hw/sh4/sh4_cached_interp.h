@@ -0,0 +1,106 @@
+/*******************************************************************************
+ *
+ *
+ *    WashingtonDC Dreamcast Emulator
+ *    Copyright (C) 2017 snickerbockers
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ******************************************************************************/
+
+#ifndef SH4_CACHED_INTERP_H_
+#define SH4_CACHED_INTERP_H_
+
+#include <stdint.h>
+
+#include "types.h"
+#include "sh4_inst.h"
+#include "sh4_code_cache.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Cached interpreter.
+ *
+ * This is the regular interpreter, except that each basic block only gets
+ * fetched and decoded once.  The block is turned into an array of entries
+ * that hold everything sh4_run_cycles would otherwise have to work out every
+ * time it runs an instruction (the handler from sh4_inst_lut, the
+ * instruction's operands and how many cycles it costs after dual-issue), and
+ * after that the block gets replayed straight out of the array until a write
+ * to system RAM invalidates it.
+ *
+ * Blocks are split up by sh4_code_walk_block and run by
+ * sh4_code_cache_run_cycles, the same as the JIT and the IR, but they're
+ * keyed by physical address, so the P1 and P2 mirrors of the same code share
+ * a block.  That works because none of the entries have the guest PC baked
+ * into them; the handlers all work relative to whatever's in SH4_REG_PC.
+ */
+
+struct sh4_cached_interp_entry {
+    opcode_func_t func;
+    Sh4OpArgs oa;
+
+    /*
+     * cycles charged to the block up to and including this instruction.
+     * This is what the block returns if it exits early here.
+     */
+    uint16_t cycles;
+};
+
+struct sh4_cached_interp_block {
+    // this must be the first member
+    struct sh4_code_block hdr;
+
+    // same as hdr.cycle_count, except for when the delayed branch isn't taken
+    unsigned cycle_count_no_slot;
+
+    /*
+     * the delay slot for the branch at the end of the block.  This is kept
+     * separately from the other entries because it has to go through
+     * sh4_do_exec_inst.
+     */
+    bool has_slot;
+    Sh4OpArgs slot_oa;
+    InstOpcode const *slot_op;
+
+    unsigned n_entries;
+    struct sh4_cached_interp_entry entries[];
+};
+
+struct Sh4;
+
+void sh4_cached_interp_init(void);
+void sh4_cached_interp_cleanup(void);
+
+// drop-in replacement for sh4_run_cycles; see sh4_code_cache_run_cycles
+void sh4_cached_interp_run_cycles(struct Sh4 *sh4, unsigned n_cycles);
+
+struct sh4_cached_interp_stats {
+    unsigned long blocks_compiled;
+    unsigned long blocks_invalidated;
+    unsigned long flushes;
+    unsigned long insts_decoded;
+};
+
+void sh4_cached_interp_get_stats(struct sh4_cached_interp_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,288 @@
+/*******************************************************************************
+ *
+ *
+ *    WashingtonDC Dreamcast Emulator
+ *    Copyright (C) 2017 snickerbockers
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "sh4.h"
+#include "sh4_mem.h"
+#include "mem_code.h"
+#include "mem_areas.h"
+#include "MemoryMap.h"
+#include "dreamcast.h"
+
+#include "sh4_code_cache.h"
+
+uint8_t sh4_code_pages[SH4_CODE_PAGE_COUNT];
+
+// every cache that's currently in use, so writes can be sent to all of them
+static struct sh4_code_cache *cache_list;
+
+static void link_page(struct sh4_code_cache *cache,
+                      struct sh4_code_block *blk, unsigned which);
+static void unlink_page(struct sh4_code_cache *cache,
+                        struct sh4_code_block *blk, unsigned which);
+static void invalidate_page(struct sh4_code_cache *cache, unsigned page_no);
+
+void sh4_code_cache_init(struct sh4_code_cache *cache,
+                         sh4_code_cache_invalidate_fn on_invalidate) {
+    memset(cache, 0, sizeof(*cache));
+    cache->on_invalidate = on_invalidate;
+
+    cache->next = cache_list;
+    cache_list = cache;
+}
+
+void sh4_code_cache_cleanup(struct sh4_code_cache *cache) {
+    struct sh4_code_cache **pprev = &cache_list;
+
+    while (*pprev) {
+        if (*pprev == cache) {
+            *pprev = cache->next;
+            break;
+        }
+        pprev = &(*pprev)->next;
+    }
+
+    cache->next = NULL;
+
+    /*
+     * sh4_code_pages might still have flags set for pages that only this
+     * cache was using.  That's harmless since it just means the next write to
+     * that page is a little slower than it needs to be.
+     */
+}
+
+void sh4_code_cache_clear(struct sh4_code_cache *cache) {
+    memset(cache->hash, 0, sizeof(cache->hash));
+    memset(cache->page_heads, 0, sizeof(cache->page_heads));
+}
+
+void sh4_code_cache_insert(struct sh4_code_cache *cache,
+                           struct sh4_code_block *blk,
+                           addr32_t pc_first, addr32_t pc_last) {
+    addr32_t paddr_first = pc_first & 0x1fffffff;
+    addr32_t paddr_last = (pc_last + 1) & 0x1fffffff;
+
+    blk->pc = pc_first;
+    blk->valid = true;
+
+    if (paddr_first >= ADDR_AREA3_FIRST && paddr_first <= ADDR_AREA3_LAST) {
+        blk->page[0] = (paddr_first & ADDR_AREA3_MASK) >> SH4_CODE_PAGE_SHIFT;
+        blk->page[1] = (paddr_last & ADDR_AREA3_MASK) >> SH4_CODE_PAGE_SHIFT;
+        link_page(cache, blk, 0);
+        if (blk->page[1] != blk->page[0])
+            link_page(cache, blk, 1);
+    } else {
+        blk->page[0] = blk->page[1] = -1;
+    }
+
+    unsigned hash_idx = (pc_first >> 1) & SH4_CODE_CACHE_HASH_MASK;
+    blk->next_hash = cache->hash[hash_idx];
+    cache->hash[hash_idx] = blk;
+}
+
+bool sh4_code_cache_fetch(addr32_t pc, inst_t *inst_out) {
+    addr32_t paddr = pc & 0x1fffffff;
+
+    if (pc >= SH4_AREA_P4_FIRST)
+        return false;
+
+    if ((paddr >= ADDR_AREA3_FIRST && paddr <= ADDR_AREA3_LAST - 1) ||
+        (paddr >= ADDR_BIOS_FIRST && paddr <= ADDR_BIOS_LAST - 1)) {
+        return memory_map_read(inst_out, paddr, sizeof(*inst_out)) ==
+            MEM_ACCESS_SUCCESS;
+    }
+
+    return false;
+}
+
+bool sh4_code_walk_block(struct sh4_code_walk *walk, addr32_t pc) {
+    sh4_inst_group_t prev_group = SH4_GROUP_NONE;
+    unsigned cycles = 0;
+    inst_t inst;
+
+    walk->n_insts = 0;
+    walk->ends_on_branch = false;
+    walk->has_slot = false;
+
+    if (!sh4_code_cache_fetch(pc, &inst))
+        return false;
+
+    for (;;) {
+        InstOpcode const *op = sh4_inst_lut[inst];
+        struct sh4_code_inst *ent = walk->insts + walk->n_insts++;
+
+        cycles += sh4_inst_dual_issue_cycles(op, &prev_group);
+        ent->inst = inst;
+        ent->op = op;
+        ent->cycles = cycles;
+
+        if (op->is_branch || op->group == SH4_GROUP_CO) {
+            walk->ends_on_branch = true;
+            if (sh4_code_cache_fetch(pc + 2, &inst)) {
+                op = sh4_inst_lut[inst];
+                walk->has_slot = true;
+                walk->slot.inst = inst;
+                walk->slot.op = op;
+                walk->slot.cycles = cycles +
+                    sh4_inst_dual_issue_cycles(op, &prev_group);
+            }
+            return true;
+        }
+
+        pc += 2;
+
+        if (walk->n_insts >= SH4_CODE_MAX_BLOCK_LEN ||
+            !sh4_code_cache_fetch(pc, &inst))
+            return true;
+    }
+}
+
+void sh4_code_cache_run_cycles(Sh4 *sh4, unsigned n_cycles,
+                               struct sh4_code_runner const *runner) {
+    do {
+        sh4_check_interrupts(sh4);
+
+        /*
+         * blocks always resolve their own delay slots before they return, so
+         * the only way to get here with a delayed branch pending is if the
+         * delay slot couldn't be fetched at compile-time.  The interpreter
+         * knows how to deal with that.
+         */
+        if (sh4->delayed_branch) {
+            sh4_run_cycles(sh4, n_cycles);
+            return;
+        }
+
+        addr32_t pc = sh4->reg[SH4_REG_PC];
+        struct sh4_code_block *blk = runner->find(pc);
+        if (!blk && !(blk = runner->compile(pc))) {
+            /*
+             * the block is somewhere the translator doesn't want to read
+             * from (or its first instruction can't be fetched at all), so let
+             * the interpreter have the rest of this timeslice.
+             */
+            sh4_run_cycles(sh4, n_cycles);
+            return;
+        }
+
+        if (blk->cycle_count > (n_cycles + sh4->cycles_accum)) {
+            dc_cycle_advance(n_cycles);
+            sh4->cycles_accum += n_cycles;
+            return;
+        }
+
+        unsigned cycles = runner->exec(sh4, blk);
+
+        if (cycles > sh4->cycles_accum) {
+            unsigned adv_cycles = cycles - sh4->cycles_accum;
+            dc_cycle_advance(adv_cycles);
+            n_cycles -= adv_cycles;
+            sh4->cycles_accum = 0;
+        } else {
+            sh4->cycles_accum -= cycles;
+        }
+
+        n_cycles = dc_sched_clamp_slice(n_cycles);
+
+        // branch handlers and SLEEP set this; see sh4_idle.h
+        if (sh4->idle) {
+            sh4_idle_skip(sh4, n_cycles);
+            return;
+        }
+    } while (n_cycles);
+}
+
+void sh4_code_cache_invalidate_page(unsigned page_no) {
+    struct sh4_code_cache *cache;
+
+    for (cache = cache_list; cache; cache = cache->next)
+        invalidate_page(cache, page_no);
+
+    sh4_code_pages[page_no] = 0;
+}
+
+static void link_page(struct sh4_code_cache *cache,
+                      struct sh4_code_block *blk, unsigned which) {
+    int page_no = blk->page[which];
+
+    blk->next_in_page[which] = cache->page_heads[page_no];
+    cache->page_heads[page_no] = blk;
+    sh4_code_pages[page_no] = 1;
+}
+
+static void unlink_page(struct sh4_code_cache *cache,
+                        struct sh4_code_block *blk, unsigned which) {
+    int page_no = blk->page[which];
+    struct sh4_code_block **pprev = cache->page_heads + page_no;
+
+    while (*pprev) {
+        struct sh4_code_block *cur = *pprev;
+        unsigned cur_which = (cur->page[0] == page_no) ? 0 : 1;
+
+        if (cur == blk) {
+            *pprev = cur->next_in_page[cur_which];
+            return;
+        }
+        pprev = cur->next_in_page + cur_which;
+    }
+}
+
+static void invalidate_page(struct sh4_code_cache *cache, unsigned page_no) {
+    struct sh4_code_block *blk = cache->page_heads[page_no];
+
+    /*
+     * unlink the whole list before calling on_invalidate in case the callback
+     * wants to recycle the blocks.
+     */
+    cache->page_heads[page_no] = NULL;
+
+    while (blk) {
+        struct sh4_code_block *next = (blk->page[0] == (int)page_no) ?
+            blk->next_in_page[0] : blk->next_in_page[1];
+
+        if (blk->valid) {
+            struct sh4_code_block **pprev =
+                cache->hash + ((blk->pc >> 1) & SH4_CODE_CACHE_HASH_MASK);
+            while (*pprev != blk)
+                pprev = &(*pprev)->next_hash;
+            *pprev = blk->next_hash;
+
+            /*
+             * if the block also spans another page then it needs to come off
+             * that page's list too, since on_invalidate is allowed to free it.
+             */
+            if (blk->page[0] != blk->page[1]) {
+                unsigned other = (blk->page[0] == (int)page_no) ? 1 : 0;
+                unlink_page(cache, blk, other);
+            }
+
+            blk->valid = false;
+            cache->n_invalidated++;
+
+            if (cache->on_invalidate)
+                cache->on_invalidate(cache, blk);
+        }
+
+        blk = next;
+    }
+}
@@ -0,0 +1,292 @@
+/*******************************************************************************
+ *
+ *
+ *    WashingtonDC Dreamcast Emulator
+ *    Copyright (C) 2017 snickerbockers
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ******************************************************************************/
+
+#ifndef SH4_CODE_CACHE_H_
+#define SH4_CODE_CACHE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "types.h"
+#include "memory.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Generic cache of translated SH4 code blocks, shared by everything that
+ * turns guest code into something else ahead of time (the JIT, the IR
+ * interpreter, etc).
+ *
+ * Blocks are looked up by the guest PC of their first instruction.  Each
+ * cache also keeps track of which pages of system RAM its blocks were read
+ * from so that writes to those pages can throw the stale blocks away.  The
+ * boot ROM can't be written to, so blocks that live there are never
+ * invalidated.
+ *
+ * The cache doesn't own the blocks; the user embeds a struct sh4_code_block
+ * at the start of its own block structure and gets notified through
+ * on_invalidate when a block gets kicked out.
+ *
+ * This is also where the parts that every translator has in common live:
+ * sh4_code_walk_block decides where blocks start and end and what they cost,
+ * and sh4_code_cache_run_cycles is the run loop that executes them.
+ */
+
+#define SH4_CODE_PAGE_SHIFT 12
+#define SH4_CODE_PAGE_COUNT (MEMORY_SIZE >> SH4_CODE_PAGE_SHIFT)
+
+#define SH4_CODE_CACHE_HASH_SIZE (1 << 14)
+#define SH4_CODE_CACHE_HASH_MASK (SH4_CODE_CACHE_HASH_SIZE - 1)
+
+struct sh4_code_block {
+    // guest address of the first instruction in the block
+    addr32_t pc;
+
+    /*
+     * system RAM pages this block was read from.  A block can span at most
+     * two pages; page[1] == page[0] if it doesn't.  These are -1 if the block
+     * is not in system RAM.
+     */
+    int page[2];
+
+    bool valid;
+
+    /*
+     * number of cycles the block takes if it runs all the way through to the
+     * end.  If the block ends in a delay slot, this assumes the branch was
+     * taken.  Only sh4_code_cache_run_cycles looks at this.
+     */
+    unsigned cycle_count;
+
+    struct sh4_code_block *next_hash;
+    struct sh4_code_block *next_in_page[2];
+};
+
+struct sh4_code_cache;
+
+typedef void(*sh4_code_cache_invalidate_fn)(struct sh4_code_cache*,
+                                             struct sh4_code_block*);
+
+struct sh4_code_cache {
+    struct sh4_code_block *hash[SH4_CODE_CACHE_HASH_SIZE];
+    struct sh4_code_block *page_heads[SH4_CODE_PAGE_COUNT];
+
+    /*
+     * this gets called for every block that gets invalidated by a write to
+     * system RAM.  It can be called in the middle of a block's execution
+     * (if the block writes to itself) so it must not free anything that the
+     * block is still using.
+     */
+    sh4_code_cache_invalidate_fn on_invalidate;
+
+    unsigned long n_invalidated;
+
+    struct sh4_code_cache *next;
+};
+
+void sh4_code_cache_init(struct sh4_code_cache *cache,
+                         sh4_code_cache_invalidate_fn on_invalidate);
+void sh4_code_cache_cleanup(struct sh4_code_cache *cache);
+
+/*
+ * forget about every block in the cache.  on_invalidate does not get called;
+ * the caller is expected to already know what it's throwing away.
+ */
+void sh4_code_cache_clear(struct sh4_code_cache *cache);
+
+static inline struct sh4_code_block *
+sh4_code_cache_find(struct sh4_code_cache const *cache, addr32_t pc) {
+    struct sh4_code_block *blk = cache->hash[(pc >> 1) & SH4_CODE_CACHE_HASH_MASK];
+
+    while (blk) {
+        if (blk->pc == pc)
+            return blk;
+        blk = blk->next_hash;
+    }
+
+    return NULL;
+}
+
+/*
+ * add a block to the cache.  pc_last is the guest address of the last
+ * instruction the block was translated from.
+ */
+void sh4_code_cache_insert(struct sh4_code_cache *cache,
+                           struct sh4_code_block *blk,
+                           addr32_t pc_first, addr32_t pc_last);
+
+/*
+ * read an instruction for translation purposes.  This only succeeds for
+ * system RAM and the boot ROM, which are the only places that can be read
+ * from without side-effects.  That's important because translators read
+ * ahead of the guest's PC, so they can't be allowed to trigger exceptions or
+ * errors the guest would never have seen.
+ */
+bool sh4_code_cache_fetch(addr32_t pc, inst_t *inst_out);
+
+/*
+ * one flag for each page of system RAM; nonzero means some cache might have
+ * a block on that page.
+ */
+extern uint8_t sh4_code_pages[SH4_CODE_PAGE_COUNT];
+
+void sh4_code_cache_invalidate_page(unsigned page_no);
+
+/*
+ * this gets called every time system RAM is written to.  addr is an offset
+ * into system RAM (ie it has already been masked with ADDR_AREA3_MASK).
+ */
+static inline void sh4_code_cache_notify_write(addr32_t addr, size_t len) {
+    unsigned page_first = addr >> SH4_CODE_PAGE_SHIFT;
+    unsigned page_last = (addr + len - 1) >> SH4_CODE_PAGE_SHIFT;
+    unsigned page_no;
+
+    for (page_no = page_first;
+         page_no <= page_last && page_no < SH4_CODE_PAGE_COUNT; page_no++) {
+        if (sh4_code_pages[page_no])
+            sh4_code_cache_invalidate_page(page_no);
+    }
+}
+
+/*******************************************************************************
+ *
+ * block walking
+ *
+ ******************************************************************************/
+
+/*
+ * A block ends at the first branch (plus its delay slot), the first CO-group
+ * instruction, the first instruction that sh4_code_cache_fetch can't read, or
+ * after SH4_CODE_MAX_BLOCK_LEN instructions, whichever comes first.
+ */
+#define SH4_CODE_MAX_BLOCK_LEN 64
+
+struct InstOpcode;
+
+struct sh4_code_inst {
+    inst_t inst;
+    struct InstOpcode const *op;
+
+    /*
+     * cycles charged to the block up to and including this instruction,
+     * after dual-issue.  This is what a block that exits early here costs.
+     */
+    unsigned cycles;
+};
+
+struct sh4_code_walk {
+    // the delay slot isn't in here
+    struct sh4_code_inst insts[SH4_CODE_MAX_BLOCK_LEN];
+    unsigned n_insts;
+
+    /*
+     * true if the last instruction is a branch or a CO-group instruction.
+     * Either way it sets the PC on its own, so the block doesn't fall through.
+     */
+    bool ends_on_branch;
+
+    /*
+     * the delay slot after the last instruction, which only gets fetched if
+     * ends_on_branch is set.  has_slot is false if it couldn't be fetched, in
+     * which case sh4_code_cache_run_cycles hands it to the interpreter.
+     * slot.cycles is what the block costs if the delayed branch is taken.
+     */
+    bool has_slot;
+    struct sh4_code_inst slot;
+};
+
+/*
+ * decode the block that starts at pc.  Returns false if not even the first
+ * instruction could be fetched.
+ */
+bool sh4_code_walk_block(struct sh4_code_walk *walk, addr32_t pc);
+
+// guest address of the last instruction in the block, delay slot included
+static inline addr32_t
+sh4_code_walk_pc_last(struct sh4_code_walk const *walk, addr32_t pc) {
+    return pc + 2 * (walk->n_insts - 1 + (walk->has_slot ? 1 : 0));
+}
+
+// the most a block can cost: the delay slot if there is one, else the end
+static inline unsigned
+sh4_code_walk_cycles(struct sh4_code_walk const *walk) {
+    return walk->has_slot ? walk->slot.cycles :
+        walk->insts[walk->n_insts - 1].cycles;
+}
+
+/*
+ * SHLL2/SHLL8/SHLL16 and SHLR2/SHLR8/SHLR16.  Unlike SHLL and SHLR these
+ * don't touch the T flag, so translators can treat them as plain shifts.
+ * Returns false if inst isn't one of them.
+ */
+static inline bool sh4_code_decode_shift(inst_t inst, unsigned *rn_out,
+                                         unsigned *amount_out,
+                                         bool *right_out) {
+    static unsigned const shift_amounts[3] = { 2, 8, 16 };
+    unsigned shift_sel = (inst >> 4) & 0xf;
+
+    if ((inst & 0xf0ce) != 0x4008 || shift_sel >= 3)
+        return false;
+
+    *rn_out = (inst >> 8) & 0xf;
+    *amount_out = shift_amounts[shift_sel];
+    *right_out = inst & 1;
+    return true;
+}
+
+/*******************************************************************************
+ *
+ * running blocks
+ *
+ ******************************************************************************/
+
+struct Sh4;
+
+/*
+ * find returns the cached block for pc, or NULL if there isn't one yet.
+ * compile builds it, or returns NULL if the block is somewhere the translator
+ * doesn't want to read from.  exec runs a block and returns the number of
+ * cycles it used; that's only less than cycle_count if the block exited early.
+ */
+struct sh4_code_runner {
+    struct sh4_code_block *(*find)(addr32_t pc);
+    struct sh4_code_block *(*compile)(addr32_t pc);
+    unsigned (*exec)(struct Sh4 *sh4, struct sh4_code_block *blk);
+};
+
+/*
+ * this is a drop-in replacement for sh4_run_cycles.  The cycle accounting is
+ * the same (including cycles_accum and dual-issue), but it is done when a
+ * block is compiled rather than every time it is executed.  Anything the
+ * runner can't turn into a block goes to the interpreter.
+ */
+void sh4_code_cache_run_cycles(struct Sh4 *sh4, unsigned n_cycles,
+                               struct sh4_code_runner const *runner);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
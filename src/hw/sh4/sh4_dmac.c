@@ -20,10 +20,12 @@
  *
  ******************************************************************************/
 
-#include <stdio.h>
+#include <stdbool.h>
 #include <string.h>
 
 #include "error.h"
+#include "dreamcast.h"
+#include "dc_sched.h"
 
 #include "sh4.h"
 #include "sh4_reg.h"
@@ -31,242 +33,167 @@
 #include "MemoryMap.h"
 #include "sh4_dmac.h"
 #include "mem_areas.h"
-#include "hw/pvr2/pvr2_ta.h"
-#include "hw/pvr2/pvr2_tex_mem.h"
 #include "hw/sys/holly_intc.h"
 
-int sh4_dmac_sar_reg_read_handler(Sh4 *sh4, void *buf,
-                                  struct Sh4MemMappedReg const *reg_info) {
-    int chan;
-    switch (reg_info->reg_idx) {
-    /* case SH4_REG_SAR0: */
-    /*     chan = 0; */
-    /*     break; */
-    case SH4_REG_SAR1:
-        chan = 1;
-        break;
-    case SH4_REG_SAR2:
-        chan = 2;
-        break;
-    case SH4_REG_SAR3:
-        chan = 3;
-        break;
-    default:
-        RAISE_ERROR(ERROR_INVALID_PARAM);
+/*
+ * Every transfer moves all of its data as soon as it starts; the only part
+ * of it that takes any time is the transfer-end (setting TE and raising the
+ * interrupt), which gets scheduled for however long the transfer would have
+ * tied up the bus.  The bus is 64 bits wide and it runs at half of the CPU's
+ * clock, so that comes out to 4 bytes per CPU cycle.
+ */
+#define DMAC_BYTES_PER_CYCLE 4
+
+// the channel registers are 16 bytes apart, starting with SAR0
+#define DMAC_REG_FIRST 0xffa00000
+#define DMAC_REG_STRIDE 0x10
+
+// the biggest transfer unit is a 32-byte block
+#define DMAC_MAX_UNIT 32
+
+// address modes (SM and DM in CHCR)
+enum dmac_addr_mode {
+    DMAC_ADDR_FIXED,
+    DMAC_ADDR_INCREMENT,
+    DMAC_ADDR_DECREMENT
+};
+
+static struct SchedEvent dmac_end_event[SH4_DMAC_N_CHANNELS];
+static bool dmac_busy[SH4_DMAC_N_CHANNELS];
+
+/*
+ * set when channel 2's transfer was started by the system block (as opposed
+ * to an auto-request), in which case it also gets an interrupt from holly
+ * when it's done.
+ */
+static bool chan2_from_sys_block;
+
+static Sh4ExceptionCode const dmac_dmte[SH4_DMAC_N_CHANNELS] = {
+    SH4_EXCP_DMAC_DMTE0,
+    SH4_EXCP_DMAC_DMTE1,
+    SH4_EXCP_DMAC_DMTE2,
+    SH4_EXCP_DMAC_DMTE3
+};
+
+static void dmac_end_event_handler(SchedEvent *ev);
+static void dmac_finish_now(unsigned chan);
+static void dmac_sched_end(Sh4 *sh4, unsigned chan, unsigned n_bytes);
+static void dmac_try_auto_request(Sh4 *sh4, unsigned chan);
+static void dmac_xfer(addr32_t *dst, enum dmac_addr_mode dst_mode,
+                      addr32_t *src, enum dmac_addr_mode src_mode,
+                      unsigned unit_sz, unsigned n_units);
+static void dmac_copy(addr32_t dst, addr32_t src, unsigned n_bytes);
+
+void sh4_dmac_init(Sh4 *sh4) {
+    unsigned chan;
+
+    memset(&sh4->dmac, 0, sizeof(sh4->dmac));
+
+    for (chan = 0; chan < SH4_DMAC_N_CHANNELS; chan++) {
+        dmac_end_event[chan].handler = dmac_end_event_handler;
+        dmac_end_event[chan].arg_ptr = sh4;
+        dmac_busy[chan] = false;
+    }
+    chan2_from_sys_block = false;
+}
+
+void sh4_dmac_cleanup(Sh4 *sh4) {
+    unsigned chan;
+
+    for (chan = 0; chan < SH4_DMAC_N_CHANNELS; chan++) {
+        if (dmac_busy[chan]) {
+            cancel_event(dmac_end_event + chan);
+            dmac_busy[chan] = false;
+        }
     }
+}
+
+static unsigned dmac_reg_chan(struct Sh4MemMappedReg const *reg_info) {
+    unsigned chan = (reg_info->addr - DMAC_REG_FIRST) / DMAC_REG_STRIDE;
+
+    if (chan >= SH4_DMAC_N_CHANNELS)
+        RAISE_ERROR(ERROR_INVALID_PARAM);
 
-    printf("WARNING: reading %08x from SH4 DMAC SAR%d register\n",
-           (unsigned)sh4->dmac.sar[chan], chan);
+    return chan;
+}
 
+int sh4_dmac_sar_reg_read_handler(Sh4 *sh4, void *buf,
+                                  struct Sh4MemMappedReg const *reg_info) {
+    unsigned chan = dmac_reg_chan(reg_info);
     memcpy(buf, &sh4->dmac.sar[chan], sizeof(sh4->dmac.sar[chan]));
     return 0;
 }
 
 int sh4_dmac_sar_reg_write_handler(Sh4 *sh4, void const *buf,
                                    struct Sh4MemMappedReg const *reg_info) {
-    int chan;
-    switch (reg_info->reg_idx) {
-    /* case SH4_REG_SAR0: */
-    /*     chan = 0; */
-    /*     break; */
-    case SH4_REG_SAR1:
-        chan = 1;
-        break;
-    case SH4_REG_SAR2:
-        chan = 2;
-        break;
-    case SH4_REG_SAR3:
-        chan = 3;
-        break;
-    default:
-        RAISE_ERROR(ERROR_INVALID_PARAM);
-    }
-
+    unsigned chan = dmac_reg_chan(reg_info);
     memcpy(&sh4->dmac.sar[chan], buf, sizeof(sh4->dmac.sar[chan]));
-
-    printf("WARNING: writing %08x to SH4 DMAC SAR%d register\n",
-           (unsigned)sh4->dmac.sar[chan], chan);
-
     return 0;
 }
 
 int sh4_dmac_dar_reg_read_handler(Sh4 *sh4, void *buf,
                                   struct Sh4MemMappedReg const *reg_info) {
-    int chan;
-    switch (reg_info->reg_idx) {
-    /* case SH4_REG_DAR0: */
-    /*     chan = 0; */
-    /*     break; */
-    case SH4_REG_DAR1:
-        chan = 1;
-        break;
-    case SH4_REG_DAR2:
-        chan = 2;
-        break;
-    case SH4_REG_DAR3:
-        chan = 3;
-        break;
-    default:
-        RAISE_ERROR(ERROR_INVALID_PARAM);
-    }
-
+    unsigned chan = dmac_reg_chan(reg_info);
     memcpy(buf, &sh4->dmac.dar[chan], sizeof(sh4->dmac.dar[chan]));
-
-    printf("WARNING: reading %08x from SH4 DMAC DAR%d register\n",
-           (unsigned)sh4->dmac.dar[chan], chan);
-
     return 0;
 }
 
 int sh4_dmac_dar_reg_write_handler(Sh4 *sh4, void const *buf,
                                    struct Sh4MemMappedReg const *reg_info) {
-    int chan;
-    switch (reg_info->reg_idx) {
-    /* case SH4_REG_DAR0: */
-    /*     chan = 0; */
-    /*     break; */
-    case SH4_REG_DAR1:
-        chan = 1;
-        break;
-    case SH4_REG_DAR2:
-        chan = 2;
-        break;
-    case SH4_REG_DAR3:
-        chan = 3;
-        break;
-    default:
-        RAISE_ERROR(ERROR_INVALID_PARAM);
-    }
-
+    unsigned chan = dmac_reg_chan(reg_info);
     memcpy(&sh4->dmac.dar[chan], buf, sizeof(sh4->dmac.dar[chan]));
-
-    printf("WARNING: writing to SH4 DMAC DAR%d register\n", chan);
-
     return 0;
 }
 
 int sh4_dmac_dmatcr_reg_read_handler(Sh4 *sh4, void *buf,
                                      struct Sh4MemMappedReg const *reg_info) {
-    int chan;
-    switch (reg_info->reg_idx) {
-    /* case SH4_REG_DMATCR0: */
-    /*     chan = 0; */
-    /*     break; */
-    case SH4_REG_DMATCR1:
-        chan = 1;
-        break;
-    case SH4_REG_DMATCR2:
-        chan = 2;
-        break;
-    case SH4_REG_DMATCR3:
-        chan = 3;
-        break;
-    default:
-        RAISE_ERROR(ERROR_INVALID_PARAM);
-    }
-
-    memcpy(buf, &sh4->dmac.dmatcr[chan], sizeof(&sh4->dmac.dmatcr[chan]));
-
-    printf("WARNING: reading %08x from SH4 DMAC DMATCR%d register\n",
-           (unsigned)sh4->dmac.dmatcr[chan], chan);
-
+    unsigned chan = dmac_reg_chan(reg_info);
+    memcpy(buf, &sh4->dmac.dmatcr[chan], sizeof(sh4->dmac.dmatcr[chan]));
     return 0;
 }
 
 int sh4_dmac_dmatcr_reg_write_handler(Sh4 *sh4, void const *buf,
                                       struct Sh4MemMappedReg const *reg_info) {
-    int chan;
-    switch (reg_info->reg_idx) {
-    /* case SH4_REG_DMATCR0: */
-    /*     chan = 0; */
-    /*     break; */
-    case SH4_REG_DMATCR1:
-        chan = 1;
-        break;
-    case SH4_REG_DMATCR2:
-        chan = 2;
-        break;
-    case SH4_REG_DMATCR3:
-        chan = 3;
-        break;
-    default:
-        RAISE_ERROR(ERROR_INVALID_PARAM);
-    }
-
-    memcpy(&sh4->dmac.dmatcr[chan], buf, sizeof(&sh4->dmac.dmatcr[chan]));
+    unsigned chan = dmac_reg_chan(reg_info);
+    memcpy(&sh4->dmac.dmatcr[chan], buf, sizeof(sh4->dmac.dmatcr[chan]));
 
-    printf("WARNING: writing %08x to SH4 DMAC DMATCR%d register\n",
-           (unsigned)sh4->dmac.dmatcr[chan], chan);
+    // only the bottom 24 bits are there
+    sh4->dmac.dmatcr[chan] &= 0x00ffffff;
 
     return 0;
 }
 
+/*
+ * There used to be printf statements in the CHCR handlers, but KallistiOS
+ * programs seem to be constantly accessing CHCR3 and the printfs ended up
+ * causing a huge performance drop.  None of the DMAC's register handlers
+ * print anything now.
+ */
 int sh4_dmac_chcr_reg_read_handler(Sh4 *sh4, void *buf,
                                    struct Sh4MemMappedReg const *reg_info) {
-    int chan;
-    switch (reg_info->reg_idx) {
-    /* case SH4_REG_CHCR0: */
-    /*     chan = 0; */
-    /*     break; */
-    case SH4_REG_CHCR1:
-        chan = 1;
-        break;
-    case SH4_REG_CHCR2:
-        chan = 2;
-        break;
-    case SH4_REG_CHCR3:
-        chan = 3;
-        break;
-    default:
-        RAISE_ERROR(ERROR_INVALID_PARAM);
-    }
-
+    unsigned chan = dmac_reg_chan(reg_info);
     memcpy(buf, &sh4->dmac.chcr[chan], sizeof(sh4->dmac.chcr[chan]));
-
-    /*
-     * TODO: I can't print here because KallistiOS programs seem to be
-     * constantly accessing CHCR3, and the printf statememnts end up causing a
-     * huge performance drop.  I need to investigate further to determine if
-     * this is a result of a bug in WashingtonDC, or if KallistiOS is actually
-     * supposed to be doing this.
-     */
-    /* printf("WARNING: reading %08x from SH4 DMAC CHCR%d register\n", */
-    /*        (unsigned)sh4->dmac.chcr[chan], chan); */
-
     return 0;
 }
 
 int sh4_dmac_chcr_reg_write_handler(Sh4 *sh4, void const *buf,
                                     struct Sh4MemMappedReg const *reg_info) {
-    int chan;
-    switch (reg_info->reg_idx) {
-    /* case SH4_REG_CHCR0: */
-    /*     chan = 0; */
-    /*     break; */
-    case SH4_REG_CHCR1:
-        chan = 1;
-        break;
-    case SH4_REG_CHCR2:
-        chan = 2;
-        break;
-    case SH4_REG_CHCR3:
-        chan = 3;
-        break;
-    default:
-        RAISE_ERROR(ERROR_INVALID_PARAM);
-    }
+    unsigned chan = dmac_reg_chan(reg_info);
+    reg32_t old_val = sh4->dmac.chcr[chan];
+    reg32_t new_val;
 
-    memcpy(&sh4->dmac.chcr[chan], buf, sizeof(sh4->dmac.chcr[chan]));
+    memcpy(&new_val, buf, sizeof(new_val));
 
     /*
-     * TODO: I can't print here because KallistiOS programs seem to be
-     * constantly accessing CHCR3, and the printf statememnts end up causing a
-     * huge performance drop.  I need to investigate further to determine if
-     * this is a result of a bug in WashingtonDC, or if KallistiOS is actually
-     * supposed to be doing this.
+     * software can clear TE, but it can't set it.  Technically it's only
+     * supposed to be able to clear it after reading it as 1, but I don't
+     * bother keeping track of that.
      */
-    /* printf("WARNING: writing %08x to SH4 DMAC CHCR%d register\n", */
-    /*        (unsigned)sh4->dmac.chcr[chan], chan); */
+    new_val = (new_val & ~SH4_DMAC_CHCR_TE_MASK) |
+        (new_val & old_val & SH4_DMAC_CHCR_TE_MASK);
+    sh4->dmac.chcr[chan] = new_val;
+
+    dmac_try_auto_request(sh4, chan);
 
     return 0;
 }
@@ -274,19 +201,24 @@ int sh4_dmac_chcr_reg_write_handler(Sh4 *sh4, void const *buf,
 int sh4_dmac_dmaor_reg_read_handler(Sh4 *sh4, void *buf,
                                     struct Sh4MemMappedReg const *reg_info) {
     memcpy(buf, &sh4->dmac.dmaor, sizeof(sh4->dmac.dmaor));
-
-    printf("WARNING: reading %08x from SH4 DMAC DMAOR register\n",
-           (unsigned)sh4->dmac.dmaor);
-
     return 0;
 }
 
 int sh4_dmac_dmaor_reg_write_handler(Sh4 *sh4, void const *buf,
                                      struct Sh4MemMappedReg const *reg_info) {
-    memcpy(&sh4->dmac.dmaor, buf, sizeof(sh4->dmac.dmaor));
+    reg32_t const flags = SH4_DMAC_DMAOR_NMIF_MASK | SH4_DMAC_DMAOR_AE_MASK;
+    reg32_t old_val = sh4->dmac.dmaor;
+    reg32_t new_val;
+    unsigned chan;
+
+    memcpy(&new_val, buf, sizeof(new_val));
+
+    // like CHCR's TE bit, the error flags can only be cleared
+    sh4->dmac.dmaor = (new_val & ~flags) | (new_val & old_val & flags);
 
-    printf("WARNING: writing %08x to SH4 DMAC DMAOR register\n",
-           (unsigned)sh4->dmac.dmaor);
+    // this might have been what was holding an auto-request back
+    for (chan = 0; chan < SH4_DMAC_N_CHANNELS; chan++)
+        dmac_try_auto_request(sh4, chan);
 
     return 0;
 }
@@ -307,80 +239,116 @@ void sh4_dmac_transfer_from_mem(addr32_t transfer_src, size_t unit_sz,
     }
 }
 
+// returns the size of one transfer unit, in bytes
+static unsigned dmac_unit_size(reg32_t chcr) {
+    switch ((chcr & SH4_DMAC_CHCR_TS_MASK) >> SH4_DMAC_CHCR_TS_SHIFT) {
+    case 0:
+        return 8;
+    case 1:
+        return 1;
+    case 2:
+        return 2;
+    case 3:
+        return 4;
+    case 4:
+        return 32;
+    default:
+        error_set_feature("SH4 DMAC transfers with an invalid CHCR.TS value");
+        RAISE_ERROR(ERROR_UNIMPLEMENTED);
+    }
+}
+
+static enum dmac_addr_mode dmac_src_mode(reg32_t chcr) {
+    unsigned mode = (chcr & SH4_DMAC_CHCR_SM_MASK) >> SH4_DMAC_CHCR_SM_SHIFT;
+    if (mode > DMAC_ADDR_DECREMENT) {
+        error_set_feature("SH4 DMAC transfers with an invalid CHCR.SM value");
+        RAISE_ERROR(ERROR_UNIMPLEMENTED);
+    }
+    return (enum dmac_addr_mode)mode;
+}
+
+static enum dmac_addr_mode dmac_dst_mode(reg32_t chcr) {
+    unsigned mode = (chcr & SH4_DMAC_CHCR_DM_MASK) >> SH4_DMAC_CHCR_DM_SHIFT;
+    if (mode > DMAC_ADDR_DECREMENT) {
+        error_set_feature("SH4 DMAC transfers with an invalid CHCR.DM value");
+        RAISE_ERROR(ERROR_UNIMPLEMENTED);
+    }
+    return (enum dmac_addr_mode)mode;
+}
+
+/*
+ * start a transfer on any channel whose CHCR asks for an auto-request.
+ * Transfers that wait on DREQ or on one of the on-chip peripherals don't get
+ * started here; nothing on the Dreamcast uses those except for channel 2's
+ * DDT transfers, and those come in through sh4_dmac_channel2.
+ */
+static void dmac_try_auto_request(Sh4 *sh4, unsigned chan) {
+    struct sh4_dmac *dmac = &sh4->dmac;
+    reg32_t chcr = dmac->chcr[chan];
+    unsigned rs = (chcr & SH4_DMAC_CHCR_RS_MASK) >> SH4_DMAC_CHCR_RS_SHIFT;
+    reg32_t const dmaor_bits = SH4_DMAC_DMAOR_DME_MASK |
+        SH4_DMAC_DMAOR_NMIF_MASK | SH4_DMAC_DMAOR_AE_MASK;
+
+    if (dmac_busy[chan] ||
+        (dmac->dmaor & dmaor_bits) != SH4_DMAC_DMAOR_DME_MASK ||
+        (chcr & (SH4_DMAC_CHCR_DE_MASK | SH4_DMAC_CHCR_TE_MASK)) !=
+        SH4_DMAC_CHCR_DE_MASK)
+        return;
+
+    // 4, 5 and 6 are the auto-request settings
+    if (rs < 4 || rs > 6)
+        return;
+
+    if (!dmac->dmatcr[chan]) {
+        error_set_feature("SH4 DMAC transfers with DMATCR set to 0");
+        RAISE_ERROR(ERROR_UNIMPLEMENTED);
+    }
+
+    unsigned unit_sz = dmac_unit_size(chcr);
+    unsigned n_units = dmac->dmatcr[chan];
+
+    dmac_xfer(&dmac->dar[chan], dmac_dst_mode(chcr),
+              &dmac->sar[chan], dmac_src_mode(chcr), unit_sz, n_units);
+    dmac->dmatcr[chan] = 0;
+
+    if (chan == 2)
+        chan2_from_sys_block = false;
+    dmac_sched_end(sh4, chan, unit_sz * n_units);
+}
+
 void sh4_dmac_channel2(Sh4 *sh4, addr32_t transfer_dst, unsigned n_bytes) {
+    struct sh4_dmac *dmac = &sh4->dmac;
+    reg32_t chcr = dmac->chcr[2];
+
     /*
      * TODO: check DMAOR to make sure DMA is enabled.  Maybe check a few other
      * registers as well (I think CHCR2 has a per-channel enable bit for this?)
      */
 
-    if (n_bytes != (32 * sh4->dmac.dmatcr[2])) {
+    unsigned unit_sz = dmac_unit_size(chcr);
+    if (n_bytes != (unit_sz * dmac->dmatcr[2])) {
         error_set_feature("whatever happens when there's a channel-2 DMA "
                           "length mismatch");
         RAISE_ERROR(ERROR_UNIMPLEMENTED);
     }
 
+    // a transfer can't start until the last one is done
+    if (dmac_busy[2])
+        dmac_finish_now(2);
+
     /*
-     * n_bytes has already been established to be divisible by 32,
-     * so it must also be divisible by 4
+     * the AREA4 texture memory addresses don't show up in the memory map, so
+     * those get translated to the regular texture memory addresses.
      */
-    unsigned n_words = n_bytes / 4;
-
-    addr32_t transfer_src = sh4->dmac.sar[2];
-
-    fprintf(stderr, "SH4 - initiating %u-byte DMA transfer from 0x%08x to "
-            "0x%08x\n", n_bytes, transfer_src, transfer_dst);
-
     if ((transfer_dst >= ADDR_TA_FIFO_POLY_FIRST) &&
         (transfer_dst <= ADDR_TA_FIFO_POLY_LAST)) {
-        while (n_words--) {
-            uint32_t buf;
-            if (sh4_do_read_mem(sh4, &buf, transfer_src, sizeof(buf))
-                != MEM_ACCESS_SUCCESS) {
-                RAISE_ERROR(get_error_pending());
-            }
-
-            pvr2_ta_fifo_poly_write(&buf, transfer_dst, sizeof(buf));
-            transfer_dst += sizeof(buf);
-            transfer_src += sizeof(buf);
-        }
+        // nothing to do here
     } else if ((transfer_dst >= ADDR_AREA4_TEX64_FIRST) &&
                (transfer_dst <= ADDR_AREA4_TEX64_LAST)) {
-        // TODO: do tex DMA transfers in large chuks instead of 4-byte increments
         transfer_dst = transfer_dst - ADDR_AREA4_TEX64_FIRST + ADDR_TEX64_FIRST;
-
-        while (n_words--) {
-            uint32_t buf;
-            if (sh4_do_read_mem(sh4, &buf, transfer_src, sizeof(buf))
-                != MEM_ACCESS_SUCCESS) {
-                RAISE_ERROR(get_error_pending());
-            }
-
-            if (pvr2_tex_mem_area64_write(&buf, transfer_dst, sizeof(buf)) !=
-                MEM_ACCESS_SUCCESS) {
-                RAISE_ERROR(get_error_pending());
-            }
-            transfer_dst += sizeof(buf);
-            transfer_src += sizeof(buf);
-        }
     } else if ((transfer_dst >= ADDR_AREA4_TEX32_FIRST) &&
                (transfer_dst <= ADDR_AREA4_TEX32_LAST)) {
-        // TODO: do tex DMA transfers in large chuks instead of 4-byte increments
         transfer_dst = transfer_dst - ADDR_AREA4_TEX32_FIRST + ADDR_TEX32_FIRST;
-
-        while (n_words--) {
-            uint32_t buf;
-            if (sh4_do_read_mem(sh4, &buf, transfer_src, sizeof(buf))
-                != MEM_ACCESS_SUCCESS) {
-                RAISE_ERROR(get_error_pending());
-            }
-
-            if (pvr2_tex_mem_area32_write(&buf, transfer_dst, sizeof(buf)) !=
-                MEM_ACCESS_SUCCESS) {
-                RAISE_ERROR(get_error_pending());
-            }
-            transfer_dst += sizeof(buf);
-            transfer_src += sizeof(buf);
-        }
     } else {
         error_set_address(transfer_dst);
         error_set_length(n_bytes);
@@ -388,9 +356,131 @@ void sh4_dmac_channel2(Sh4 *sh4, addr32_t transfer_dst, unsigned n_bytes) {
         RAISE_ERROR(ERROR_UNIMPLEMENTED);
     }
 
-    // raise the interrupt
-    sh4->dmac.chcr[2] |= SH4_DMAC_CHCR_TE_MASK;
-    sh4_set_interrupt(sh4, SH4_IRQ_DMAC, SH4_EXCP_DMAC_DMTE2);
+    /*
+     * the system block supplies the destination address itself (that's the
+     * point of DDT mode), so DAR2 and CHCR2.DM don't come into it.
+     */
+    dmac_xfer(&transfer_dst, DMAC_ADDR_INCREMENT,
+              &dmac->sar[2], dmac_src_mode(chcr), unit_sz, dmac->dmatcr[2]);
+    dmac->dmatcr[2] = 0;
+
+    chan2_from_sys_block = true;
+    dmac_sched_end(sh4, 2, n_bytes);
+}
+
+static void dmac_sched_end(Sh4 *sh4, unsigned chan, unsigned n_bytes) {
+    SchedEvent *ev = dmac_end_event + chan;
+    unsigned n_cycles =
+        (n_bytes + DMAC_BYTES_PER_CYCLE - 1) / DMAC_BYTES_PER_CYCLE;
 
-    holly_raise_nrm_int(HOLLY_REG_ISTNRM_CHANNEL2_DMA_COMPLETE);
+    ev->when = dc_cycle_stamp() + (n_cycles ? n_cycles : 1);
+    dmac_busy[chan] = true;
+    sched_event(ev);
+}
+
+static void dmac_end_event_handler(SchedEvent *ev) {
+    unsigned chan = ev - dmac_end_event;
+    Sh4 *sh4 = (Sh4*)ev->arg_ptr;
+
+    dmac_busy[chan] = false;
+
+    sh4->dmac.chcr[chan] |= SH4_DMAC_CHCR_TE_MASK;
+    if (sh4->dmac.chcr[chan] & SH4_DMAC_CHCR_IE_MASK)
+        sh4_set_interrupt(sh4, SH4_IRQ_DMAC, dmac_dmte[chan]);
+
+    if (chan == 2 && chan2_from_sys_block)
+        holly_raise_nrm_int(HOLLY_REG_ISTNRM_CHANNEL2_DMA_COMPLETE);
+}
+
+// end the given channel's transfer right now instead of when it's scheduled
+static void dmac_finish_now(unsigned chan) {
+    cancel_event(dmac_end_event + chan);
+    dmac_end_event_handler(dmac_end_event + chan);
+}
+
+static void dmac_step(addr32_t *addr, enum dmac_addr_mode mode,
+                      unsigned n_bytes) {
+    if (mode == DMAC_ADDR_INCREMENT)
+        *addr += n_bytes;
+    else if (mode == DMAC_ADDR_DECREMENT)
+        *addr -= n_bytes;
+}
+
+/*
+ * move n_units units of unit_sz bytes each from *src to *dst.  *src and *dst
+ * are left pointing wherever the DMAC would have left them.
+ */
+static void dmac_xfer(addr32_t *dst, enum dmac_addr_mode dst_mode,
+                      addr32_t *src, enum dmac_addr_mode src_mode,
+                      unsigned unit_sz, unsigned n_units) {
+    unsigned n_bytes = unit_sz * n_units;
+
+    if (src_mode == DMAC_ADDR_INCREMENT && dst_mode == DMAC_ADDR_INCREMENT) {
+        // the common case: two contiguous ranges
+        dmac_copy(*dst, *src, n_bytes);
+        *src += n_bytes;
+        *dst += n_bytes;
+        return;
+    }
+
+    /*
+     * anything else has to go one unit at a time.  This is mostly FIFOs
+     * (fixed addresses), which should be rare enough not to matter.
+     */
+    while (n_units--) {
+        uint8_t unit[DMAC_MAX_UNIT];
+
+        if (memory_map_read(unit, *src & MEMORY_MAP_ADDR_MASK, unit_sz) !=
+            MEM_ACCESS_SUCCESS)
+            RAISE_ERROR(get_error_pending());
+        if (memory_map_write(unit, *dst & MEMORY_MAP_ADDR_MASK, unit_sz) !=
+            MEM_ACCESS_SUCCESS)
+            RAISE_ERROR(get_error_pending());
+
+        dmac_step(src, src_mode, unit_sz);
+        dmac_step(dst, dst_mode, unit_sz);
+    }
+}
+
+/*
+ * copy n_bytes from src to dst.  This goes one page at a time; whenever the
+ * source page is backed by host memory the destination gets a pointer
+ * straight into it, so a transfer out of system RAM (which is almost all of
+ * them) is one memcpy or one call to the destination's handler per 64KB.
+ */
+static void dmac_copy(addr32_t dst, addr32_t src, unsigned n_bytes) {
+    while (n_bytes) {
+        addr32_t src_phys = src & MEMORY_MAP_ADDR_MASK;
+        addr32_t dst_phys = dst & MEMORY_MAP_ADDR_MASK;
+        struct memory_map_page const *page =
+            memory_map_pages + (src_phys >> MEMORY_MAP_PAGE_SHIFT);
+        unsigned src_offs = src_phys & MEMORY_MAP_PAGE_MASK;
+        unsigned chunk = MEMORY_MAP_PAGE_SIZE - src_offs;
+        unsigned dst_room =
+            MEMORY_MAP_PAGE_SIZE - (dst_phys & MEMORY_MAP_PAGE_MASK);
+        uint8_t bounce[256];
+        void const *span;
+
+        if (chunk > dst_room)
+            chunk = dst_room;
+        if (chunk > n_bytes)
+            chunk = n_bytes;
+
+        if (page->read_ptr) {
+            span = page->read_ptr + src_offs;
+        } else {
+            if (chunk > sizeof(bounce))
+                chunk = sizeof(bounce);
+            if (memory_map_read(bounce, src_phys, chunk) != MEM_ACCESS_SUCCESS)
+                RAISE_ERROR(get_error_pending());
+            span = bounce;
+        }
+
+        if (memory_map_write(span, dst_phys, chunk) != MEM_ACCESS_SUCCESS)
+            RAISE_ERROR(get_error_pending());
+
+        src += chunk;
+        dst += chunk;
+        n_bytes -= chunk;
+    }
 }
@@ -26,21 +26,25 @@
 struct Sh4;
 #include "types.h"
 
+#define SH4_DMAC_N_CHANNELS 4
+
 struct sh4_dmac {
     /*
-     * 1 register per channel.  Channel 0 is inaccessible to guest programs and
-     * therefore practically non-existant, but I still include it here for
-     * posterity's sake.  Plus, by including it the indices of the registers
-     * match the channel numbers.
+     * 1 register per channel.  On the Dreamcast, channel 0 is hooked up to
+     * something that guest programs aren't supposed to touch, but its
+     * registers are still there and it can still do auto-request transfers.
      */
-    reg32_t sar[4];
-    reg32_t dar[4];
-    reg32_t dmatcr[4];
-    reg32_t chcr[4];
+    reg32_t sar[SH4_DMAC_N_CHANNELS];
+    reg32_t dar[SH4_DMAC_N_CHANNELS];
+    reg32_t dmatcr[SH4_DMAC_N_CHANNELS];
+    reg32_t chcr[SH4_DMAC_N_CHANNELS];
 
     reg32_t dmaor;
 };
 
+void sh4_dmac_init(Sh4 *sh4);
+void sh4_dmac_cleanup(Sh4 *sh4);
+
 int sh4_dmac_sar_reg_read_handler(Sh4 *sh4, void *buf,
                                   struct Sh4MemMappedReg const *reg_info);
 int sh4_dmac_sar_reg_write_handler(Sh4 *sh4, void const *buf,
@@ -82,7 +86,14 @@ void sh4_dmac_transfer_to_mem(addr32_t transfer_dst, size_t unit_sz,
 void sh4_dmac_transfer_from_mem(addr32_t transfer_src, size_t unit_sz,
                                 size_t n_units, void *dat);
 
-// perform a DMA transfer using channel 2's settings
+/*
+ * perform a DMA transfer using channel 2's settings.  This is what the system
+ * block calls when software starts a channel-2 DMA through SB_C2DST.
+ *
+ * The data gets moved right away, but TE, the DMTE2 interrupt (if CHCR2.IE is
+ * set) and holly's channel-2 DMA interrupt all wait until the transfer would
+ * have finished on real hardware.
+ */
 void sh4_dmac_channel2(Sh4 *sh4, addr32_t transfer_dst, unsigned n_bytes);
 
 #endif
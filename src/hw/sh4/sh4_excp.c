@@ -159,34 +159,96 @@ void sh4_set_exception(Sh4 *sh4, unsigned excp_code) {
     sh4_enter_exception(sh4, (Sh4ExceptionCode)excp_code);
 }
 
+/* return the priority level IPRA-IPRD assign to the given IRQ line */
+static unsigned sh4_intc_line_prio(Sh4 const *sh4, unsigned line) {
+    unsigned ipr_reg_idx = SH4_REG_IPRA + line / 4;
+    unsigned prio_shift_amt = 4 * (line % 4);
+
+    return (sh4->reg[ipr_reg_idx] >> prio_shift_amt) & 0xf;
+}
+
+// set or clear the given bit in prio_mask depending on what's in line_mask
+static void sh4_intc_update_prio_bit(struct sh4_intc *intc, unsigned prio) {
+    if (intc->line_mask & intc->prio_lines[prio])
+        intc->prio_mask |= 1 << prio;
+    else
+        intc->prio_mask &= ~(1 << prio);
+}
+
+/*
+ * recompute irl_prio from the IRL lines.  When ICR.IRLM is clear, the four IRL
+ * pins are a single active-low 4-bit value instead of four independent lines;
+ * 0xf means no interrupt and everything else is priority level 15 - value.
+ */
+static void sh4_intc_update_irl(Sh4 *sh4) {
+    struct sh4_intc *intc = &sh4->intc;
+    unsigned irl_val = 0;
+
+    if (sh4->reg[SH4_REG_ICR] & SH4_ICR_IRLM_MASK) {
+        intc->irl_prio = 0;
+        return;
+    }
+
+    if (intc->line_mask & (1 << SH4_IRQ_IRL0))
+        irl_val |= 1;
+    if (intc->line_mask & (1 << SH4_IRQ_IRL1))
+        irl_val |= 2;
+    if (intc->line_mask & (1 << SH4_IRQ_IRL2))
+        irl_val |= 4;
+    if (intc->line_mask & (1 << SH4_IRQ_IRL3))
+        irl_val |= 8;
+
+    // now make it active-low as it should be
+    irl_val = (~irl_val) & 0xf;
+
+    intc->irl_prio = 15 - irl_val;
+}
+
 void sh4_set_interrupt(Sh4 *sh4, unsigned irq_line,
                        Sh4ExceptionCode intp_code) {
-    sh4->intc.irq_lines[irq_line] = intp_code;
+    struct sh4_intc *intc = &sh4->intc;
+
+    intc->irq_lines[irq_line] = intp_code;
+    if (intp_code)
+        intc->line_mask |= 1 << irq_line;
+    else
+        intc->line_mask &= ~(1 << irq_line);
+
+    sh4_intc_update_prio_bit(intc, sh4_intc_line_prio(sh4, irq_line));
     sh4_refresh_intc(sh4);
 }
 
 void sh4_set_irl_interrupt(Sh4 *sh4, unsigned irl_val) {
-    irl_val = ~irl_val;
+    static unsigned const irl_lines[4] = {
+        SH4_IRQ_IRL0, SH4_IRQ_IRL1, SH4_IRQ_IRL2, SH4_IRQ_IRL3
+    };
+    static Sh4ExceptionCode const irl_codes[4] = {
+        SH4_EXCP_IRL0, SH4_EXCP_IRL1, SH4_EXCP_IRL2, SH4_EXCP_IRL3
+    };
+    struct sh4_intc *intc = &sh4->intc;
+    uint32_t old_line_mask = intc->line_mask;
+    unsigned bit;
 
-    if (irl_val & 0x1)
-        sh4->intc.irq_lines[SH4_IRQ_IRL0] = SH4_EXCP_IRL0;
-    else
-        sh4->intc.irq_lines[SH4_IRQ_IRL0] = (Sh4ExceptionCode)0;
+    irl_val = ~irl_val;
 
-    if (irl_val & 0x2)
-        sh4->intc.irq_lines[SH4_IRQ_IRL1] = SH4_EXCP_IRL1;
-    else
-        sh4->intc.irq_lines[SH4_IRQ_IRL1] = (Sh4ExceptionCode)0;
+    for (bit = 0; bit < 4; bit++) {
+        unsigned line = irl_lines[bit];
+        if (irl_val & (1 << bit)) {
+            intc->irq_lines[line] = irl_codes[bit];
+            intc->line_mask |= 1 << line;
+        } else {
+            intc->irq_lines[line] = (Sh4ExceptionCode)0;
+            intc->line_mask &= ~(1 << line);
+        }
+    }
 
-    if (irl_val & 0x4)
-        sh4->intc.irq_lines[SH4_IRQ_IRL2] = SH4_EXCP_IRL2;
-    else
-        sh4->intc.irq_lines[SH4_IRQ_IRL2] = (Sh4ExceptionCode)0;
+    // Holly raises the same level over and over again, so this is common
+    if (intc->line_mask == old_line_mask)
+        return;
 
-    if (irl_val & 0x8)
-        sh4->intc.irq_lines[SH4_IRQ_IRL3] = SH4_EXCP_IRL3;
-    else
-        sh4->intc.irq_lines[SH4_IRQ_IRL3] = (Sh4ExceptionCode)0;
+    for (bit = 0; bit < 4; bit++)
+        sh4_intc_update_prio_bit(intc, sh4_intc_line_prio(sh4, irl_lines[bit]));
+    sh4_intc_update_irl(sh4);
 
     sh4_refresh_intc(sh4);
 }
@@ -211,31 +273,16 @@ static void sh4_enter_irq_from_meta(Sh4 *sh4, struct sh4_irq_meta *irq_meta) {
         //       this after an IRQ has been served?
         sh4_set_irl_interrupt(sh4, 0xf);
     } else {
-        sh4->intc.irq_lines[irq_meta->line] = (Sh4ExceptionCode)0;
-        sh4_refresh_intc(sh4);
+        sh4_set_interrupt(sh4, irq_meta->line, (Sh4ExceptionCode)0);
     }
 
     // exit sleep/standby mode
     sh4->exec_state = SH4_EXEC_STATE_NORM;
 }
 
-void sh4_check_interrupts(Sh4 *sh4) {
-    /*
-     * for the purposes of interrupt handling, I treat delayed-branch slots
-     * as atomic units because if I allowed an interrupt to happen between the
-     * two instructions then I would need a way to track the delayed branch slot
-     * until the interrupt handler returns, and I would need to account for
-     * situations such as interrupt handlers that never return and interrupt
-     * handlers that enable interrupts.
-     *
-     * And the hardware would have to do that too if that was the way it was
-     * implemented, so I'm *assuming* that it doesn't allow interrupts in the
-     * middle of delay slots either.
-     */
-    if (!sh4->delayed_branch && sh4->intc.is_irq_pending) {
-        sh4_enter_irq_from_meta(sh4, &sh4->intc.pending_irq);
-        sh4->intc.is_irq_pending = false;
-    }
+void sh4_enter_pending_irq(Sh4 *sh4) {
+    sh4_enter_irq_from_meta(sh4, &sh4->intc.pending_irq);
+    sh4->intc.is_irq_pending = false;
 }
 
 void sh4_refresh_intc(Sh4 *sh4) {
@@ -243,20 +290,10 @@ void sh4_refresh_intc(Sh4 *sh4) {
         (sh4_get_next_irq_line(sh4, &sh4->intc.pending_irq) >= 0);
 }
 
-/*
- * return the highest-priority pending IRQ, or -1 if there are none.
- *
- * the exception code will be placed into *code_ptr.  A valid pointer must be
- * provided even if you don't need it.
- */
-static int sh4_get_next_irq_line(Sh4 const *sh4, struct sh4_irq_meta *irq_meta) {
-    if (sh4->reg[SH4_REG_SR] & SH4_SR_BL_MASK)
-        return -1;
-
-    /* TODO - NMIs */
+void sh4_refresh_intc_prio(Sh4 *sh4) {
+    struct sh4_intc *intc = &sh4->intc;
 
-    int max_prio = -1;
-    unsigned max_prio_line = -1;
+    memset(intc->prio_lines, 0, sizeof(intc->prio_lines));
 
     /*
      * Skip over SH4_IRQ_IRL3 through SH4_IRQ_IRL0 if those four bits are
@@ -267,131 +304,61 @@ static int sh4_get_next_irq_line(Sh4 const *sh4, struct sh4_irq_meta *irq_meta)
         last_line = SH4_IRQ_GPIO;
 
     unsigned line;
-    for (line = 0; line <= last_line; line++) {
-        unsigned ipr_reg_idx = SH4_REG_IPRA + line / 4;
-        unsigned prio_shift_amt = 4 * (line % 4);
-        unsigned mask = 0xf << prio_shift_amt;
-        int prio = (mask & sh4->reg[ipr_reg_idx]) >> prio_shift_amt;
-
-        /* check the sh4's interrupt mask */
-        if (prio > (int)((sh4->reg[SH4_REG_SR] & SH4_SR_IMASK_MASK) >>
-                         SH4_SR_IMASK_SHIFT)) {
-            // only take the highest priority irq
-            // TODO: priority order
-            if (sh4->intc.irq_lines[line] && (prio > max_prio)) {
-                max_prio = prio;
-                max_prio_line = line;
-            }
-        }
-    }
+    for (line = 0; line <= last_line; line++)
+        intc->prio_lines[sh4_intc_line_prio(sh4, line)] |= 1 << line;
 
-    // Now handle the four-bit IRL interrupt as a special case if it's enabled
-    if (!(sh4->reg[SH4_REG_ICR] & SH4_ICR_IRLM_MASK)) {
-        unsigned irl_val = 0;
-
-        if (sh4->intc.irq_lines[SH4_IRQ_IRL0])
-            irl_val |= 1;
-        if (sh4->intc.irq_lines[SH4_IRQ_IRL1])
-            irl_val |= 2;
-        if (sh4->intc.irq_lines[SH4_IRQ_IRL2])
-            irl_val |= 4;
-        if (sh4->intc.irq_lines[SH4_IRQ_IRL3])
-            irl_val |= 8;
-
-        // now make it active-low as it should be
-        irl_val = (~irl_val) & 0xf;
-
-        // since it's active-low, 0xf == no interrupt
-        if (irl_val != 0xf) {
-            int prio;
-            Sh4ExceptionCode code;
-
-            /*
-             * Yeah, yeah I know that a switch statement
-             * isn't the best way to do this...
-             */
-            switch (irl_val) {
-            case 0x0:
-                prio = 15;
-                code = SH4_EXCP_EXT_0;
-                break;
-            case 0x1:
-                prio = 14;
-                code = SH4_EXCP_EXT_1;
-                break;
-            case 0x2:
-                prio = 13;
-                code = SH4_EXCP_EXT_2;
-                break;
-            case 0x3:
-                prio = 12;
-                code = SH4_EXCP_EXT_3;
-                break;
-            case 0x4:
-                prio = 11;
-                code = SH4_EXCP_EXT_4;
-                break;
-            case 0x5:
-                prio = 10;
-                code = SH4_EXCP_EXT_5;
-                break;
-            case 0x6:
-                prio = 9;
-                code = SH4_EXCP_EXT_6;
-                break;
-            case 0x7:
-                prio = 8;
-                code = SH4_EXCP_EXT_7;
-                break;
-            case 0x8:
-                prio = 7;
-                code = SH4_EXCP_EXT_8;
-                break;
-            case 0x9:
-                prio = 6;
-                code = SH4_EXCP_EXT_9;
-                break;
-            case 0xa:
-                prio = 5;
-                code = SH4_EXCP_EXT_A;
-                break;
-            case 0xb:
-                prio = 4;
-                code = SH4_EXCP_EXT_B;
-                break;
-            case 0xc:
-                prio = 3;
-                code = SH4_EXCP_EXT_C;
-                break;
-            case 0xd:
-                prio = 2;
-                code = SH4_EXCP_EXT_D;
-                break;
-            case 0xe:
-                prio = 1;
-                code = SH4_EXCP_EXT_E;
-                break;
-            default:
-                RAISE_ERROR(ERROR_INTEGRITY);
-            }
-
-            // TODO: priority order
-            if (prio > max_prio &&
-                (prio > (int)((sh4->reg[SH4_REG_SR] & SH4_SR_IMASK_MASK) >>
-                              SH4_SR_IMASK_SHIFT))) {
-                irq_meta->is_irl = true;
-                irq_meta->code = code;
-
-                return prio;
-            }
-        }
+    unsigned prio;
+    for (prio = 0; prio < 16; prio++)
+        sh4_intc_update_prio_bit(intc, prio);
+
+    sh4_intc_update_irl(sh4);
+
+    sh4_refresh_intc(sh4);
+}
+
+/*
+ * return the priority of the highest-priority pending IRQ, or -1 if there are
+ * none.
+ *
+ * the IRQ will be placed into *irq_meta.  A valid pointer must be provided
+ * even if you don't need it.
+ */
+static int sh4_get_next_irq_line(Sh4 const *sh4, struct sh4_irq_meta *irq_meta) {
+    struct sh4_intc const *intc = &sh4->intc;
+
+    if (sh4->reg[SH4_REG_SR] & SH4_SR_BL_MASK)
+        return -1;
+
+    /* TODO - NMIs */
+
+    int imask = (sh4->reg[SH4_REG_SR] & SH4_SR_IMASK_MASK) >>
+        SH4_SR_IMASK_SHIFT;
+
+    // only levels above IMASK are allowed through
+    uint32_t prios = intc->prio_mask & ~((2u << imask) - 1);
+    int line_prio = prios ? (31 - __builtin_clz(prios)) : -1;
+
+    /*
+     * the IRL bus loses ties against the independent lines.
+     * TODO: priority order
+     */
+    if (intc->irl_prio > imask && intc->irl_prio > line_prio) {
+        irq_meta->is_irl = true;
+        irq_meta->code = SH4_EXCP_EXT_0 + 0x20 * (15 - intc->irl_prio);
+        return intc->irl_prio;
     }
 
-    if (max_prio >= 0) {
+    if (line_prio >= 0) {
+        /*
+         * only take the highest priority irq; within a level the
+         * lowest-numbered line wins.
+         */
+        unsigned line =
+            __builtin_ctz(intc->line_mask & intc->prio_lines[line_prio]);
         irq_meta->is_irl = false;
-        irq_meta->code = sh4->intc.irq_lines[max_prio_line];
-        irq_meta->line = max_prio_line;
-        return max_prio;
+        irq_meta->code = intc->irq_lines[line];
+        irq_meta->line = line;
+        return line_prio;
     }
 
     return -1;
@@ -401,7 +368,7 @@ int sh4_excp_icr_reg_write_handler(Sh4 *sh4, void const *buf,
                                    struct Sh4MemMappedReg const *reg_info) {
     memcpy(sh4->reg + SH4_REG_ICR, buf, sizeof(sh4->reg[SH4_REG_ICR]));
 
-    sh4_refresh_intc(sh4);
+    sh4_refresh_intc_prio(sh4);
 
     return MEM_ACCESS_SUCCESS;
 }
@@ -410,7 +377,7 @@ int sh4_excp_ipra_reg_write_handler(Sh4 *sh4, void const *buf,
                                     struct Sh4MemMappedReg const *reg_info) {
     memcpy(sh4->reg + SH4_REG_IPRA, buf, sizeof(sh4->reg[SH4_REG_IPRA]));
 
-    sh4_refresh_intc(sh4);
+    sh4_refresh_intc_prio(sh4);
 
     return MEM_ACCESS_SUCCESS;
 }
@@ -419,7 +386,7 @@ int sh4_excp_iprb_reg_write_handler(Sh4 *sh4, void const *buf,
                                     struct Sh4MemMappedReg const *reg_info) {
     memcpy(sh4->reg + SH4_REG_IPRB, buf, sizeof(sh4->reg[SH4_REG_IPRB]));
 
-    sh4_refresh_intc(sh4);
+    sh4_refresh_intc_prio(sh4);
 
     return MEM_ACCESS_SUCCESS;
 }
@@ -428,7 +395,7 @@ int sh4_excp_iprc_reg_write_handler(Sh4 *sh4, void const *buf,
                                     struct Sh4MemMappedReg const *reg_info) {
     memcpy(sh4->reg + SH4_REG_IPRC, buf, sizeof(sh4->reg[SH4_REG_IPRC]));
 
-    sh4_refresh_intc(sh4);
+    sh4_refresh_intc_prio(sh4);
 
     return MEM_ACCESS_SUCCESS;
 }
@@ -437,7 +404,7 @@ int sh4_excp_iprd_reg_write_handler(Sh4 *sh4, void const *buf,
                                     struct Sh4MemMappedReg const *reg_info) {
     memcpy(sh4->reg + SH4_REG_IPRD, buf, sizeof(sh4->reg[SH4_REG_IPRD]));
 
-    sh4_refresh_intc(sh4);
+    sh4_refresh_intc_prio(sh4);
 
     return MEM_ACCESS_SUCCESS;
 }
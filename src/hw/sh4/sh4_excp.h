@@ -24,6 +24,7 @@
 #define SH4_EXCP_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "sh4_reg.h"
 
@@ -164,9 +165,32 @@ struct sh4_irq_meta {
     unsigned line;
 };
 
+/*
+ * The interrupt controller's state is kept as a handful of bitmasks so that
+ * figuring out which interrupt to take never has to look at every IRQ line.
+ *
+ * line_mask has one bit for every IRQ line that's currently asserted.
+ * prio_lines[n] has one bit for every IRQ line that IPRA-IPRD (and ICR)
+ * assign to priority level n; that only changes when one of those registers
+ * gets written.  prio_mask has bit n set whenever line_mask and prio_lines[n]
+ * have any bits in common; sh4_set_interrupt and sh4_set_irl_interrupt keep it
+ * up to date one line at a time.  Resolving the next interrupt is then just a
+ * matter of masking off the levels at or below SR.IMASK and finding the
+ * highest bit that's left.
+ */
 struct sh4_intc {
     Sh4ExceptionCode irq_lines[SH4_IRQ_COUNT];
 
+    uint32_t line_mask;
+    uint32_t prio_lines[16];
+    uint32_t prio_mask;
+
+    /*
+     * priority of the 4-bit IRL bus, or 0 if there's nothing on it (or if
+     * ICR.IRLM has the IRL pins configured as independent lines).
+     */
+    int irl_prio;
+
     // if true, then there is an interrupt or exception pending
     bool is_irq_pending;
 
@@ -196,8 +220,11 @@ void sh4_set_irl_interrupt(Sh4 *sh4, unsigned irl_val);
 
 void sh4_set_interrupt(Sh4 *sh4, unsigned irq_line, Sh4ExceptionCode intp_code);
 
-/* check IRQ lines and enter interrupt state if necessary */
-void sh4_check_interrupts(Sh4 *sh4);
+/*
+ * enter the interrupt in sh4->intc.pending_irq.  Don't call this directly,
+ * use sh4_check_interrupts (in sh4.h) instead.
+ */
+void sh4_enter_pending_irq(Sh4 *sh4);
 
 /*
  * The following registers (in addition to the IMASK and BL bits in SR) all
@@ -220,11 +247,19 @@ int sh4_excp_iprd_reg_write_handler(Sh4 *sh4, void const *buf,
 #define SH4_INTC_SR_BITS (SH4_SR_IMASK_MASK | SH4_SR_BL_MASK)
 
 /*
- * call this every time the interrupt controller's state may have changed to
- * check if there are any interrupts that should be pending
+ * call this every time SR.BL or SR.IMASK may have changed to check if there
+ * are any interrupts that should be pending.  Changes to the IRQ lines don't
+ * need this because sh4_set_interrupt and sh4_set_irl_interrupt take care of
+ * it themselves.
  */
 void sh4_refresh_intc(Sh4 *sh4);
 
+/*
+ * call this every time ICR or IPRA-IPRD may have changed to recompute the
+ * priority level of every IRQ line.  This also calls sh4_refresh_intc.
+ */
+void sh4_refresh_intc_prio(Sh4 *sh4);
+
 #ifdef __cplusplus
 }
 #endif
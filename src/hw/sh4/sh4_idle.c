@@ -0,0 +1,341 @@
+/*******************************************************************************
+ *
+ *
+ *    WashingtonDC Dreamcast Emulator
+ *    Copyright (C) 2017 snickerbockers
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ******************************************************************************/
+
+
+#include <string.h>
+
+#include "sh4.h"
+#include "sh4_code_cache.h"
+#include "dreamcast.h"
+
+#include "sh4_idle.h"
+
+/*
+ * verdicts are kept in a sh4_code_cache so that they get thrown away when the
+ * loop is overwritten.  Like the cached interpreter, they're never freed
+ * individually; when the pool fills up the whole cache gets cleared.
+ */
+#define SH4_IDLE_N_LOOPS 1024
+
+/*
+ * loops are keyed by (head, branch), since more than one branch can jump back
+ * to the same head and each of those is a different loop.  The cache only
+ * knows about the head, so loops that share a head share a hash chain.
+ */
+struct idle_loop {
+    // this must be the first member
+    struct sh4_code_block hdr;
+
+    // physical address of the branch that jumps back to hdr.pc
+    addr32_t branch_paddr;
+
+    bool idle;
+};
+
+static struct idle_loop loops[SH4_IDLE_N_LOOPS];
+static unsigned n_loops;
+
+static struct sh4_code_cache idle_cache;
+
+static struct sh4_idle_stats stats;
+
+// set by sh4_idle_clock_read, see sh4_idle.h
+static bool clock_read;
+
+// masks of the registers an instruction reads and writes
+#define IDLE_REG(reg_no) (((uint32_t)1) << (reg_no))
+#define IDLE_REG_T IDLE_REG(16)
+#define IDLE_REG_GBR IDLE_REG(17)
+
+static bool idle_decode(inst_t inst, uint32_t *src_out, uint32_t *dst_out);
+static bool idle_analyze(addr32_t loop_pc, addr32_t branch_pc,
+                         addr32_t *pc_last_out);
+
+void sh4_idle_init(void) {
+    memset(&stats, 0, sizeof(stats));
+    n_loops = 0;
+    clock_read = false;
+    sh4_code_cache_init(&idle_cache, NULL);
+}
+
+void sh4_idle_cleanup(void) {
+    sh4_code_cache_cleanup(&idle_cache);
+}
+
+void sh4_idle_get_stats(struct sh4_idle_stats *stats_out) {
+    memcpy(stats_out, &stats, sizeof(*stats_out));
+}
+
+bool sh4_idle_loop_check(addr32_t loop_pc, addr32_t branch_pc) {
+    addr32_t paddr = loop_pc & 0x1fffffff;
+    addr32_t branch_paddr = branch_pc & 0x1fffffff;
+    struct sh4_code_block *hdr;
+    struct idle_loop *loop;
+
+    /*
+     * the loop read a register that counts up on its own since the last
+     * time we were here, so this iteration doesn't count regardless of
+     * what the cached verdict is.
+     */
+    if (clock_read) {
+        clock_read = false;
+        return false;
+    }
+
+    for (hdr = sh4_code_cache_find(&idle_cache, paddr); hdr;
+         hdr = hdr->next_hash) {
+        loop = (struct idle_loop*)hdr;
+        if (hdr->pc == paddr && loop->branch_paddr == branch_paddr)
+            return loop->idle;
+    }
+
+    addr32_t pc_last;
+    bool idle = idle_analyze(loop_pc, branch_pc, &pc_last);
+
+    if (idle)
+        stats.loops_idle++;
+    else
+        stats.loops_not_idle++;
+
+    if (n_loops >= SH4_IDLE_N_LOOPS) {
+        sh4_code_cache_clear(&idle_cache);
+        n_loops = 0;
+    }
+
+    loop = loops + n_loops++;
+    loop->branch_paddr = branch_paddr;
+    loop->idle = idle;
+    sh4_code_cache_insert(&idle_cache, &loop->hdr,
+                          paddr, pc_last & 0x1fffffff);
+
+    return idle;
+}
+
+void sh4_idle_clock_read(void) {
+    clock_read = true;
+}
+
+void sh4_idle_skip(Sh4 *sh4, unsigned n_cycles) {
+    sh4->idle = false;
+
+    dc_cycle_advance(n_cycles);
+
+    stats.skips++;
+    stats.cycles_skipped += n_cycles;
+}
+
+/*
+ * Walk forward from loop_pc until the first branch.  That branch has to be
+ * the one at branch_pc, it has to jump back to loop_pc, and everything in
+ * between has to be on the list of instructions idle_decode knows about.  pc_last_out gets the
+ * address of the last instruction that was looked at, even on failure, so the
+ * verdict can be cached either way.
+ */
+static bool idle_analyze(addr32_t loop_pc, addr32_t branch_pc,
+                         addr32_t *pc_last_out) {
+    uint32_t src[SH4_IDLE_MAX_LOOP_LEN + 1], dst[SH4_IDLE_MAX_LOOP_LEN + 1];
+    unsigned n_insts = 0, idx;
+    addr32_t pc = loop_pc;
+    uint32_t written = 0, written_so_far = 0;
+    inst_t inst;
+
+    *pc_last_out = loop_pc;
+
+    for (;;) {
+        if (n_insts >= SH4_IDLE_MAX_LOOP_LEN || !sh4_code_cache_fetch(pc, &inst))
+            return false;
+        *pc_last_out = pc;
+
+        int32_t disp;
+        bool delayed;
+        uint32_t branch_src = IDLE_REG_T;
+
+        switch (inst & 0xff00) {
+        case 0x8900: // BT
+        case 0x8b00: // BF
+            delayed = false;
+            disp = (int8_t)(inst & 0xff);
+            break;
+        case 0x8d00: // BT/S
+        case 0x8f00: // BF/S
+            delayed = true;
+            disp = (int8_t)(inst & 0xff);
+            break;
+        default:
+            if ((inst & 0xf000) == 0xa000) { // BRA
+                delayed = true;
+                disp = inst & 0xfff;
+                if (disp & 0x800)
+                    disp -= 0x1000;
+                branch_src = 0;
+                break;
+            }
+
+            if (!idle_decode(inst, src + n_insts, dst + n_insts))
+                return false;
+            n_insts++;
+            pc += 2;
+            continue;
+        }
+
+        if (pc != branch_pc || pc + 4 + disp * 2 != loop_pc)
+            return false;
+
+        src[n_insts] = branch_src;
+        dst[n_insts] = 0;
+        n_insts++;
+
+        if (delayed) {
+            // the delay slot gets executed after the branch reads T
+            if (!sh4_code_cache_fetch(pc + 2, &inst) ||
+                !idle_decode(inst, src + n_insts, dst + n_insts))
+                return false;
+            *pc_last_out = pc + 2;
+            n_insts++;
+        }
+        break;
+    }
+
+    for (idx = 0; idx < n_insts; idx++)
+        written |= dst[idx];
+
+    /*
+     * anything that gets read before it's written in the same iteration has
+     * to be something the loop never writes, otherwise the loop has state
+     * that carries over from one iteration to the next.
+     */
+    for (idx = 0; idx < n_insts; idx++) {
+        if (src[idx] & written & ~written_so_far)
+            return false;
+        written_so_far |= dst[idx];
+    }
+
+    return true;
+}
+
+/*
+ * the instructions that can appear in an idle loop.  These are loads,
+ * register-to-register moves, logic ops and comparisons; nothing that writes
+ * to memory or changes any state other than general-purpose registers and T.
+ */
+static bool idle_decode(inst_t inst, uint32_t *src_out, uint32_t *dst_out) {
+    uint32_t rn = IDLE_REG((inst >> 8) & 0xf);
+    uint32_t rm = IDLE_REG((inst >> 4) & 0xf);
+    uint32_t r0 = IDLE_REG(0);
+
+    if (inst == 0x0009) { // NOP
+        *src_out = *dst_out = 0;
+        return true;
+    }
+
+    switch (inst & 0xf000) {
+    case 0x5000: // MOV.L @(disp, Rm), Rn
+        *src_out = rm;
+        *dst_out = rn;
+        return true;
+    case 0x9000: // MOV.W @(disp, PC), Rn
+    case 0xd000: // MOV.L @(disp, PC), Rn
+    case 0xe000: // MOV #imm, Rn
+        *src_out = 0;
+        *dst_out = rn;
+        return true;
+    }
+
+    switch (inst & 0xff00) {
+    case 0x8400: // MOV.B @(disp, Rm), R0
+    case 0x8500: // MOV.W @(disp, Rm), R0
+        *src_out = rm;
+        *dst_out = r0;
+        return true;
+    case 0xc400: // MOV.B @(disp, GBR), R0
+    case 0xc500: // MOV.W @(disp, GBR), R0
+    case 0xc600: // MOV.L @(disp, GBR), R0
+        *src_out = IDLE_REG_GBR;
+        *dst_out = r0;
+        return true;
+    case 0xc900: // AND #imm, R0
+    case 0xca00: // XOR #imm, R0
+    case 0xcb00: // OR #imm, R0
+        *src_out = r0;
+        *dst_out = r0;
+        return true;
+    case 0xc800: // TST #imm, R0
+    case 0x8800: // CMP/EQ #imm, R0
+        *src_out = r0;
+        *dst_out = IDLE_REG_T;
+        return true;
+    }
+
+    switch (inst & 0xf00f) {
+    case 0x6000: // MOV.B @Rm, Rn
+    case 0x6001: // MOV.W @Rm, Rn
+    case 0x6002: // MOV.L @Rm, Rn
+    case 0x6003: // MOV Rm, Rn
+    case 0x600c: // EXTU.B Rm, Rn
+    case 0x600d: // EXTU.W Rm, Rn
+    case 0x600e: // EXTS.B Rm, Rn
+    case 0x600f: // EXTS.W Rm, Rn
+        *src_out = rm;
+        *dst_out = rn;
+        return true;
+    case 0x000c: // MOV.B @(R0, Rm), Rn
+    case 0x000d: // MOV.W @(R0, Rm), Rn
+    case 0x000e: // MOV.L @(R0, Rm), Rn
+        *src_out = r0 | rm;
+        *dst_out = rn;
+        return true;
+    case 0x2009: // AND Rm, Rn
+    case 0x200a: // XOR Rm, Rn
+    case 0x200b: // OR Rm, Rn
+        *src_out = rm | rn;
+        *dst_out = rn;
+        return true;
+    case 0x2008: // TST Rm, Rn
+    case 0x3000: // CMP/EQ Rm, Rn
+    case 0x3002: // CMP/HS Rm, Rn
+    case 0x3003: // CMP/GE Rm, Rn
+    case 0x3006: // CMP/HI Rm, Rn
+    case 0x3007: // CMP/GT Rm, Rn
+        *src_out = rm | rn;
+        *dst_out = IDLE_REG_T;
+        return true;
+    }
+
+    switch (inst & 0xf0ff) {
+    case 0x4011: // CMP/PZ Rn
+    case 0x4015: // CMP/PL Rn
+        *src_out = rn;
+        *dst_out = IDLE_REG_T;
+        return true;
+    case 0x4008: // SHLL2 Rn
+    case 0x4009: // SHLR2 Rn
+    case 0x4018: // SHLL8 Rn
+    case 0x4019: // SHLR8 Rn
+    case 0x4028: // SHLL16 Rn
+    case 0x4029: // SHLR16 Rn
+        *src_out = rn;
+        *dst_out = rn;
+        return true;
+    }
+
+    return false;
+}
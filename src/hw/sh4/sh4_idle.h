@@ -0,0 +1,115 @@
+/*******************************************************************************
+ *
+ *
+ *    WashingtonDC Dreamcast Emulator
+ *    Copyright (C) 2017 snickerbockers
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ******************************************************************************/
+
+
+#ifndef SH4_IDLE_H_
+#define SH4_IDLE_H_
+
+#include <stdbool.h>
+
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Idle-loop detection.
+ *
+ * A lot of software spends most of its time in loops like this:
+ *
+ * wait_vblank:
+ *     mov.l @r4, r0
+ *     tst r1, r0
+ *     bt wait_vblank
+ *
+ * Nothing that loop does can change anything until some piece of hardware
+ * changes the register it's polling, and for the most part hardware only
+ * changes state when a SchedEvent runs.  So once the CPU is in one of these
+ * there's no point in emulating it all the way up to the next event; the run
+ * loops can just advance the clock instead.  The same goes for the SLEEP
+ * instruction.
+ *
+ * The exception is registers that work out their value from the current
+ * cycle count whenever they're read, like the TMU's TCNT registers.  A loop
+ * that polls one of those is waiting for time to pass rather than for an
+ * event, and skipping to the next event would take it past whatever it was
+ * waiting for.  The read handlers for those registers call
+ * sh4_idle_clock_read, which keeps the next sh4_idle_loop_check from calling
+ * the loop idle.
+ *
+ * A loop counts as idle if it's short, it doesn't contain any branches other
+ * than the one at the end, it doesn't write to memory, and every register it
+ * reads was either set earlier in the same iteration or never gets written to
+ * by the loop at all.  That last part is what rules out delay loops that count
+ * down a register.
+ *
+ * Branch instructions call sh4_idle_loop_check whenever they jump backwards.
+ * The JIT, the IR interpreter and the cached interpreter all run branches
+ * through the same handlers, so they get this for free.  If the loop is idle
+ * the handler sets sh4->idle, and the run loop then calls sh4_idle_skip with
+ * whatever's left of its timeslice.
+ */
+
+#define SH4_IDLE_MAX_LOOP_LEN 16
+
+struct Sh4;
+
+struct sh4_idle_stats {
+    unsigned long loops_idle;
+    unsigned long loops_not_idle;
+
+    // number of times sh4_idle_skip was called, and the total cycles skipped
+    unsigned long skips;
+    unsigned long long cycles_skipped;
+};
+
+void sh4_idle_init(void);
+void sh4_idle_cleanup(void);
+
+void sh4_idle_get_stats(struct sh4_idle_stats *stats_out);
+
+/*
+ * returns true if the branch at branch_pc jumping back to loop_pc closes an
+ * idle loop.  The branch has to be the first one after loop_pc; any other
+ * branch back to loop_pc goes around a different loop, which gets its own
+ * verdict.  Verdicts are cached until the loop gets overwritten.
+ */
+bool sh4_idle_loop_check(addr32_t loop_pc, addr32_t branch_pc);
+
+/*
+ * read handlers call this when the value they return depends on the current
+ * cycle count.  It keeps the next loop check from saying the loop is idle.
+ */
+void sh4_idle_clock_read(void);
+
+/*
+ * skip n_cycles worth of time and clear sh4->idle.  The run loops call this
+ * instead of running out their timeslice when sh4->idle is set.
+ */
+void sh4_idle_skip(struct Sh4 *sh4, unsigned n_cycles);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -42,6 +42,20 @@
 
 #include "sh4_inst.h"
 
+/*
+ * SSE versions of FIPR and FTRV.  These only need SSE1, which every x86-64
+ * CPU has, but they still get picked at runtime so that a 32-bit x86 build
+ * can run on a CPU without it.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SH4_INST_SSE
+#include <xmmintrin.h>
+#endif
+
+#ifdef SH4_INST_SSE
+static bool sh4_inst_have_sse;
+#endif
+
 static DEF_ERROR_STRING_ATTR(opcode_format)
 static DEF_ERROR_STRING_ATTR(opcode_name)
 static DEF_ERROR_INT_ATTR(instruction)
@@ -63,6 +77,23 @@ static void sh4_fr_invalid(Sh4 *sh4, unsigned dst_reg);
 
 static InstOpcode const* sh4_decode_inst_slow(inst_t inst);
 
+static void sh4_inst_init_fpu_mode_luts(void);
+
+#ifdef ENABLE_SH4_SPECIALIZED_HANDLERS
+static void sh4_inst_install_specializations(void);
+
+/*
+ * SH4_INST_HOT marks the handlers that tool/sh4_inst_gen makes
+ * operand-specialized copies of (it finds them by looking for this macro).
+ * They need to be inlined into those copies, otherwise there's no point.
+ * Keep in mind that every two-register opcode marked this way turns into 256
+ * more functions.
+ */
+#define SH4_INST_HOT __attribute__((always_inline)) inline
+#else
+#define SH4_INST_HOT
+#endif
+
 #ifdef INVARIANTS
 #define CHECK_INST(inst, mask, val) \
     do_check_inst(inst, mask, val, __LINE__, __FILE__, __func__)
@@ -107,896 +138,10 @@ static void do_check_fpscr(reg32_t fpscr, reg32_t mask, reg32_t expect,
 #endif
 
 static struct InstOpcode opcode_list[] = {
-    // RTS
-    { "0000000000001011", &sh4_inst_rts, true, SH4_GROUP_CO, 2 },
-
-    // CLRMAC
-    { "0000000000101000", &sh4_inst_clrmac, false, SH4_GROUP_CO, 1 },
-
-    // CLRS
-    { "0000000001001000", &sh4_inst_clrs, false, SH4_GROUP_CO, 1 },
-
-    // CLRT
-    { "0000000000001000", &sh4_inst_clrt, false, SH4_GROUP_MT, 1 },
-
-    // LDTLB
-    { "0000000000111000", &sh4_inst_ldtlb, false, SH4_GROUP_CO, 1 },
-
-    // NOP
-    { "0000000000001001", &sh4_inst_nop, false, SH4_GROUP_MT, 1 },
-
-    // RTE
-    { "0000000000101011", &sh4_inst_rte, false, SH4_GROUP_CO, 5 },
-
-    // SETS
-    { "0000000001011000", &sh4_inst_sets, false, SH4_GROUP_CO, 1 },
-
-    // SETT
-    { "0000000000011000", &sh4_inst_sett, false, SH4_GROUP_MT, 1 },
-
-    // SLEEP
-    { "0000000000011011", &sh4_inst_sleep, false, SH4_GROUP_CO, 4 },
-
-    // FRCHG
-    { "1111101111111101", &sh4_inst_frchg, false, SH4_GROUP_FE, 1 },
-
-    // FSCHG
-    { "1111001111111101", &sh4_inst_fschg, false, SH4_GROUP_FE, 1 },
-
-    // MOVT Rn
-    { "0000nnnn00101001", &sh4_inst_unary_movt_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // CMP/PZ
-    { "0100nnnn00010001", &sh4_inst_unary_cmppz_gen, false,
-      SH4_GROUP_MT, 1 },
-
-    // CMP/PL
-    { "0100nnnn00010101", &sh4_inst_unary_cmppl_gen, false,
-      SH4_GROUP_MT, 1 },
-
-    // DT
-    { "0100nnnn00010000", &sh4_inst_unary_dt_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // ROTL Rn
-    { "0100nnnn00000100", &sh4_inst_unary_rotl_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // ROTR Rn
-    { "0100nnnn00000101", &sh4_inst_unary_rotr_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // ROTCL Rn
-    { "0100nnnn00100100", &sh4_inst_unary_rotcl_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // ROTCR Rn
-    { "0100nnnn00100101", &sh4_inst_unary_rotcr_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // SHAL Rn
-    { "0100nnnn00100000", &sh4_inst_unary_shal_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // SHAR Rn
-    { "0100nnnn00100001", &sh4_inst_unary_shar_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // SHLL Rn
-    { "0100nnnn00000000", &sh4_inst_unary_shll_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // SHLR Rn
-    { "0100nnnn00000001", &sh4_inst_unary_shlr_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // SHLL2 Rn
-    { "0100nnnn00001000", &sh4_inst_unary_shll2_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // SHLR2 Rn
-    { "0100nnnn00001001", &sh4_inst_unary_shlr2_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // SHLL8 Rn
-    { "0100nnnn00011000", &sh4_inst_unary_shll8_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // SHLR8 Rn
-    { "0100nnnn00011001", &sh4_inst_unary_shlr8_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // SHLL16 Rn
-    { "0100nnnn00101000", &sh4_inst_unary_shll16_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // SHLR16 Rn
-    { "0100nnnn00101001", &sh4_inst_unary_shlr16_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // BRAF Rn
-    { "0000nnnn00100011", &sh4_inst_unary_braf_gen, true,
-      SH4_GROUP_CO, 2 },
-
-    // BSRF Rn
-    { "0000nnnn00000011", &sh4_inst_unary_bsrf_gen, true,
-      SH4_GROUP_CO, 2 },
-
-    // CMP/EQ #imm, R0
-    { "10001000iiiiiiii", &sh4_inst_binary_cmpeq_imm_r0, false,
-      SH4_GROUP_MT, 1 },
-
-    // AND.B #imm, @(R0, GBR)
-    { "11001101iiiiiiii", &sh4_inst_binary_andb_imm_r0_gbr, false,
-      SH4_GROUP_CO, 4 },
-
-    // AND #imm, R0
-    { "11001001iiiiiiii", &sh4_inst_binary_and_imm_r0, false,
-      SH4_GROUP_EX, 1 },
-
-    // OR.B #imm, @(R0, GBR)
-    { "11001111iiiiiiii", &sh4_inst_binary_orb_imm_r0_gbr, false,
-      SH4_GROUP_CO, 4 },
-
-    // OR #imm, R0
-    { "11001011iiiiiiii", &sh4_inst_binary_or_imm_r0, false,
-      SH4_GROUP_EX, 1 },
-
-    // TST #imm, R0
-    { "11001000iiiiiiii", &sh4_inst_binary_tst_imm_r0, false,
-      SH4_GROUP_MT, 1 },
-
-    // TST.B #imm, @(R0, GBR)
-    { "11001100iiiiiiii", &sh4_inst_binary_tstb_imm_r0_gbr, false,
-      SH4_GROUP_CO, 3 },
-
-    // XOR #imm, R0
-    { "11001010iiiiiiii", &sh4_inst_binary_xor_imm_r0, false,
-      SH4_GROUP_EX, 1 },
-
-    // XOR.B #imm, @(R0, GBR)
-    { "11001110iiiiiiii", &sh4_inst_binary_xorb_imm_r0_gbr, false,
-      SH4_GROUP_CO, 4 },
-
-    // BF label
-    { "10001011dddddddd", &sh4_inst_unary_bf_disp, true,
-      SH4_GROUP_BR, 1 },
-
-    // BF/S label
-    { "10001111dddddddd", &sh4_inst_unary_bfs_disp, true,
-      SH4_GROUP_BR, 1 },
-
-    // BT label
-    { "10001001dddddddd", &sh4_inst_unary_bt_disp, true,
-      SH4_GROUP_BR, 1 },
-
-    // BT/S label
-    { "10001101dddddddd", &sh4_inst_unary_bts_disp, true,
-      SH4_GROUP_BR, 1 },
-
-    // BRA label
-    { "1010dddddddddddd", &sh4_inst_unary_bra_disp, true,
-      SH4_GROUP_BR, 1 },
-
-    // BSR label
-    { "1011dddddddddddd", &sh4_inst_unary_bsr_disp, true,
-      SH4_GROUP_BR, 1 },
-
-    // TRAPA #immed
-    { "11000011iiiiiiii", &sh4_inst_unary_trapa_disp, false,
-      SH4_GROUP_CO, 7 },
-
-    // TAS.B @Rn
-    { "0100nnnn00011011", &sh4_inst_unary_tasb_gen, false,
-      SH4_GROUP_CO, 5 },
-
-    // OCBI @Rn
-    { "0000nnnn10010011", &sh4_inst_unary_ocbi_indgen, false,
-      SH4_GROUP_LS, 1 },
-
-    // OCBP @Rn
-    { "0000nnnn10100011", &sh4_inst_unary_ocbp_indgen, false,
-      SH4_GROUP_LS, 1 },
-
-    // OCBWB @Rn
-    { "0000nnnn10110011", &sh4_inst_unary_ocbwb_indgen, false,
-      SH4_GROUP_LS, 1 },
-
-    // PREF @Rn
-    { "0000nnnn10000011", &sh4_inst_unary_pref_indgen, false,
-      SH4_GROUP_LS, 1 },
-
-    // JMP @Rn
-    { "0100nnnn00101011", &sh4_inst_unary_jmp_indgen, true,
-      SH4_GROUP_CO, 2 },
-
-    // JSR @Rn
-    { "0100nnnn00001011", &sh4_inst_unary_jsr_indgen, true,
-      SH4_GROUP_CO, 2 },
-
-    // LDC Rm, SR
-    { "0100mmmm00001110", &sh4_inst_binary_ldc_gen_sr, false,
-      SH4_GROUP_CO, 4 },
-
-    // LDC Rm, GBR
-    { "0100mmmm00011110", &sh4_inst_binary_ldc_gen_gbr, false,
-      SH4_GROUP_CO, 3 },
-
-    // LDC Rm, VBR
-    { "0100mmmm00101110", &sh4_inst_binary_ldc_gen_vbr, false,
-      SH4_GROUP_CO, 1 },
-
-    // LDC Rm, SSR
-    { "0100mmmm00111110", &sh4_inst_binary_ldc_gen_ssr, false,
-      SH4_GROUP_CO, 1 },
-
-    // LDC Rm, SPC
-    { "0100mmmm01001110", &sh4_inst_binary_ldc_gen_spc, false,
-      SH4_GROUP_CO, 1 },
-
-    // LDC Rm, DBR
-    { "0100mmmm11111010", &sh4_inst_binary_ldc_gen_dbr, false,
-      SH4_GROUP_CO, 1 },
-
-    // STC SR, Rn
-    { "0000nnnn00000010", &sh4_inst_binary_stc_sr_gen, false,
-      SH4_GROUP_CO, 2 },
-
-    // STC GBR, Rn
-    { "0000nnnn00010010", &sh4_inst_binary_stc_gbr_gen, false,
-      SH4_GROUP_CO, 2 },
-
-    // STC VBR, Rn
-    { "0000nnnn00100010", &sh4_inst_binary_stc_vbr_gen, false,
-      SH4_GROUP_CO, 2 },
-
-    // STC SSR, Rn
-    { "0000nnnn00110010", &sh4_inst_binary_stc_ssr_gen, false,
-      SH4_GROUP_CO, 2 },
-
-    // STC SPC, Rn
-    { "0000nnnn01000010", &sh4_inst_binary_stc_spc_gen, false,
-      SH4_GROUP_CO, 2 },
-
-    // STC SGR, Rn
-    { "0000nnnn00111010", &sh4_inst_binary_stc_sgr_gen, false,
-      SH4_GROUP_CO, 3 },
-
-    // STC DBR, Rn
-    { "0000nnnn11111010", &sh4_inst_binary_stc_dbr_gen, false,
-      SH4_GROUP_CO, 2 },
-
-    // LDC.L @Rm+, SR
-    { "0100mmmm00000111", &sh4_inst_binary_ldcl_indgeninc_sr, false,
-      SH4_GROUP_CO, 4 },
-
-    // LDC.L @Rm+, GBR
-    { "0100mmmm00010111", &sh4_inst_binary_ldcl_indgeninc_gbr, false,
-      SH4_GROUP_CO, 3 },
-
-    // LDC.L @Rm+, VBR
-    { "0100mmmm00100111", &sh4_inst_binary_ldcl_indgeninc_vbr, false,
-      SH4_GROUP_CO, 1 },
-
-    // LDC.L @Rm+, SSR
-    { "0100mmmm00110111", &sh4_inst_binary_ldcl_indgenic_ssr, false,
-      SH4_GROUP_CO, 1 },
-
-    // LDC.L @Rm+, SPC
-    { "0100mmmm01000111", &sh4_inst_binary_ldcl_indgeninc_spc, false,
-      SH4_GROUP_CO, 1 },
-
-    // LDC.L @Rm+, DBR
-    { "0100mmmm11110110", &sh4_inst_binary_ldcl_indgeninc_dbr, false,
-      SH4_GROUP_CO, 1 },
-
-    // STC.L SR, @-Rn
-    { "0100nnnn00000011", &sh4_inst_binary_stcl_sr_inddecgen, false,
-      SH4_GROUP_CO, 2 },
-
-    // STC.L GBR, @-Rn
-    { "0100nnnn00010011", &sh4_inst_binary_stcl_gbr_inddecgen, false,
-      SH4_GROUP_CO, 2 },
-
-    // STC.L VBR, @-Rn
-    { "0100nnnn00100011", &sh4_inst_binary_stcl_vbr_inddecgen, false,
-      SH4_GROUP_CO, 2 },
-
-    // STC.L SSR, @-Rn
-    { "0100nnnn00110011", &sh4_inst_binary_stcl_ssr_inddecgen, false,
-      SH4_GROUP_CO, 2 },
-
-    // STC.L SPC, @-Rn
-    { "0100nnnn01000011", &sh4_inst_binary_stcl_spc_inddecgen, false,
-      SH4_GROUP_CO, 2 },
-
-    // STC.L SGR, @-Rn
-    { "0100nnnn00110010", &sh4_inst_binary_stcl_sgr_inddecgen, false,
-      SH4_GROUP_CO, 3 },
-
-    // STC.L DBR, @-Rn
-    { "0100nnnn11110010", &sh4_inst_binary_stcl_dbr_inddecgen, false,
-      SH4_GROUP_CO, 2 },
-
-    // MOV #imm, Rn
-    { "1110nnnniiiiiiii", &sh4_inst_binary_mov_imm_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // ADD #imm, Rn
-    { "0111nnnniiiiiiii", &sh4_inst_binary_add_imm_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // MOV.W @(disp, PC), Rn
-    { "1001nnnndddddddd", &sh4_inst_binary_movw_binind_disp_pc_gen,
-      false, SH4_GROUP_LS, 1 },
-
-    // MOV.L @(disp, PC), Rn
-    { "1101nnnndddddddd", &sh4_inst_binary_movl_binind_disp_pc_gen,
-      false, SH4_GROUP_LS, 1 },
-
-    // MOV Rm, Rn
-    { "0110nnnnmmmm0011", &sh4_inst_binary_movw_gen_gen, false,
-      SH4_GROUP_MT, 1 },
-
-    // SWAP.B Rm, Rn
-    { "0110nnnnmmmm1000", &sh4_inst_binary_swapb_gen_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // SWAP.W Rm, Rn
-    { "0110nnnnmmmm1001", &sh4_inst_binary_swapw_gen_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // XTRCT Rm, Rn
-    { "0010nnnnmmmm1101", &sh4_inst_binary_xtrct_gen_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // ADD Rm, Rn
-    { "0011nnnnmmmm1100", &sh4_inst_binary_add_gen_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // ADDC Rm, Rn
-    { "0011nnnnmmmm1110", &sh4_inst_binary_addc_gen_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // ADDV Rm, Rn
-    { "0011nnnnmmmm1111", &sh4_inst_binary_addv_gen_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // CMP/EQ Rm, Rn
-    { "0011nnnnmmmm0000", &sh4_inst_binary_cmpeq_gen_gen, false,
-      SH4_GROUP_MT, 1 },
-
-    // CMP/HS Rm, Rn
-    { "0011nnnnmmmm0010", &sh4_inst_binary_cmphs_gen_gen, false,
-      SH4_GROUP_MT, 1 },
-
-    // CMP/GE Rm, Rn
-    { "0011nnnnmmmm0011", &sh4_inst_binary_cmpge_gen_gen, false,
-      SH4_GROUP_MT, 1 },
-
-    // CMP/HI Rm, Rn
-    { "0011nnnnmmmm0110", &sh4_inst_binary_cmphi_gen_gen, false,
-      SH4_GROUP_MT, 1 },
-
-    // CMP/GT Rm, Rn
-    { "0011nnnnmmmm0111", &sh4_inst_binary_cmpgt_gen_gen, false,
-      SH4_GROUP_MT, 1 },
-
-    // CMP/STR Rm, Rn
-    { "0010nnnnmmmm1100", &sh4_inst_binary_cmpstr_gen_gen, false,
-      SH4_GROUP_MT, 1 },
-
-    // DIV1 Rm, Rn
-    { "0011nnnnmmmm0100", &sh4_inst_binary_div1_gen_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // DIV0S Rm, Rn
-    { "0010nnnnmmmm0111", &sh4_inst_binary_div0s_gen_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // DIV0U
-    { "0000000000011001", &sh4_inst_noarg_div0u, false, SH4_GROUP_EX, 1 },
-
-    // DMULS.L Rm, Rn
-    { "0011nnnnmmmm1101", &sh4_inst_binary_dmulsl_gen_gen, false,
-      SH4_GROUP_CO, 2 },
-
-    // DMULU.L Rm, Rn
-    { "0011nnnnmmmm0101", &sh4_inst_binary_dmulul_gen_gen, false,
-      SH4_GROUP_CO, 2 },
-
-    // EXTS.B Rm, Rn
-    { "0110nnnnmmmm1110", &sh4_inst_binary_extsb_gen_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // EXTS.W Rm, Rn
-    { "0110nnnnmmmm1111", &sh4_inst_binary_extsw_gen_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // EXTU.B Rm, Rn
-    { "0110nnnnmmmm1100", &sh4_inst_binary_extub_gen_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // EXTU.W Rm, Rn
-    { "0110nnnnmmmm1101", &sh4_inst_binary_extuw_gen_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // MUL.L Rm, Rn
-    { "0000nnnnmmmm0111", &sh4_inst_binary_mull_gen_gen, false,
-      SH4_GROUP_CO, 2 },
-
-    // MULS.W Rm, Rn
-    { "0010nnnnmmmm1111", &sh4_inst_binary_mulsw_gen_gen, false,
-      SH4_GROUP_CO, 2 },
-
-    // MULU.W Rm, Rn
-    { "0010nnnnmmmm1110", &sh4_inst_binary_muluw_gen_gen, false,
-      SH4_GROUP_CO, 2 },
-
-    // NEG Rm, Rn
-    { "0110nnnnmmmm1011", &sh4_inst_binary_neg_gen_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // NEGC Rm, Rn
-    { "0110nnnnmmmm1010", &sh4_inst_binary_negc_gen_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // SUB Rm, Rn
-    { "0011nnnnmmmm1000", &sh4_inst_binary_sub_gen_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // SUBC Rm, Rn
-    { "0011nnnnmmmm1010", &sh4_inst_binary_subc_gen_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // SUBV Rm, Rn
-    { "0011nnnnmmmm1011", &sh4_inst_binary_subv_gen_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // AND Rm, Rn
-    { "0010nnnnmmmm1001", &sh4_inst_binary_and_gen_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // NOT Rm, Rn
-    { "0110nnnnmmmm0111", &sh4_inst_binary_not_gen_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // OR Rm, Rn
-    { "0010nnnnmmmm1011", &sh4_inst_binary_or_gen_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // TST Rm, Rn
-    { "0010nnnnmmmm1000", &sh4_inst_binary_tst_gen_gen, false,
-      SH4_GROUP_MT, 1 },
-
-    // XOR Rm, Rn
-    { "0010nnnnmmmm1010", &sh4_inst_binary_xor_gen_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // SHAD Rm, Rn
-    { "0100nnnnmmmm1100", &sh4_inst_binary_shad_gen_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // SHLD Rm, Rn
-    { "0100nnnnmmmm1101", &sh4_inst_binary_shld_gen_gen, false,
-      SH4_GROUP_EX, 1 },
-
-    // LDC Rm, Rn_BANK
-    { "0100mmmm1nnn1110", &sh4_inst_binary_ldc_gen_bank, false,
-      SH4_GROUP_CO, 1 },
-
-    // LDC.L @Rm+, Rn_BANK
-    { "0100mmmm1nnn0111", &sh4_inst_binary_ldcl_indgeninc_bank, false,
-      SH4_GROUP_CO, 1 },
-
-    // STC Rm_BANK, Rn
-    { "0000nnnn1mmm0010", &sh4_inst_binary_stc_bank_gen, false,
-      SH4_GROUP_CO, 2 },
-
-    // STC.L Rm_BANK, @-Rn
-    { "0100nnnn1mmm0011", &sh4_inst_binary_stcl_bank_inddecgen, false,
-      SH4_GROUP_CO, 2 },
-
-    // LDS Rm, MACH
-    { "0100mmmm00001010", &sh4_inst_binary_lds_gen_mach, false,
-      SH4_GROUP_CO, 1 },
-
-    // LDS Rm, MACL
-    { "0100mmmm00011010", &sh4_inst_binary_lds_gen_macl, false,
-      SH4_GROUP_CO, 1 },
-
-    // STS MACH, Rn
-    { "0000nnnn00001010", &sh4_inst_binary_sts_mach_gen, false,
-      SH4_GROUP_CO, 1 },
-
-    // STS MACL, Rn
-    { "0000nnnn00011010", &sh4_inst_binary_sts_macl_gen, false,
-      SH4_GROUP_CO, 1 },
-
-    // LDS Rm, PR
-    { "0100mmmm00101010", &sh4_inst_binary_lds_gen_pr, false,
-      SH4_GROUP_CO, 2 },
-
-    // STS PR, Rn
-    { "0000nnnn00101010", &sh4_inst_binary_sts_pr_gen, false,
-      SH4_GROUP_CO, 2 },
-
-    // LDS.L @Rm+, MACH
-    { "0100mmmm00000110", &sh4_inst_binary_ldsl_indgeninc_mach, false,
-      SH4_GROUP_CO, 1 },
-
-    // LDS.L @Rm+, MACL
-    { "0100mmmm00010110", &sh4_inst_binary_ldsl_indgeninc_macl, false,
-      SH4_GROUP_CO, 1 },
-
-    // STS.L MACH, @-Rn
-    { "0100mmmm00000010", &sh4_inst_binary_stsl_mach_inddecgen, false,
-      SH4_GROUP_CO, 1 },
-
-    // STS.L MACL, @-Rn
-    { "0100mmmm00010010", &sh4_inst_binary_stsl_macl_inddecgen, false,
-      SH4_GROUP_CO, 1 },
-
-    // LDS.L @Rm+, PR
-    { "0100mmmm00100110", &sh4_inst_binary_ldsl_indgeninc_pr, false,
-      SH4_GROUP_CO, 2 },
-
-    // STS.L PR, @-Rn
-    { "0100nnnn00100010", &sh4_inst_binary_stsl_pr_inddecgen, false,
-      SH4_GROUP_CO, 2 },
-
-    // MOV.B Rm, @Rn
-    { "0010nnnnmmmm0000", &sh4_inst_binary_movb_gen_indgen, false,
-      SH4_GROUP_LS, 1 },
-
-    // MOV.W Rm, @Rn
-    { "0010nnnnmmmm0001", &sh4_inst_binary_movw_gen_indgen, false,
-      SH4_GROUP_LS, 1 },
-
-    // MOV.L Rm, @Rn
-    { "0010nnnnmmmm0010", &sh4_inst_binary_movl_gen_indgen, false,
-      SH4_GROUP_LS, 1 },
-
-    // MOV.B @Rm, Rn
-    { "0110nnnnmmmm0000", &sh4_inst_binary_movb_indgen_gen, false,
-      SH4_GROUP_LS, 1 },
-
-    // MOV.W @Rm, Rn
-    { "0110nnnnmmmm0001", &sh4_inst_binary_movw_indgen_gen, false,
-      SH4_GROUP_LS, 1 },
-
-    // MOV.L @Rm, Rn
-    { "0110nnnnmmmm0010", &sh4_inst_binary_movl_indgen_gen, false,
-      SH4_GROUP_LS, 1 },
-
-    // MOV.B Rm, @-Rn
-    { "0010nnnnmmmm0100", &sh4_inst_binary_movb_gen_inddecgen, false,
-      SH4_GROUP_LS, 1 },
-
-    // MOV.W Rm, @-Rn
-    { "0010nnnnmmmm0101", &sh4_inst_binary_movw_gen_inddecgen, false,
-      SH4_GROUP_LS, 1 },
-
-    // MOV.L Rm, @-Rn
-    { "0010nnnnmmmm0110", &sh4_inst_binary_movl_gen_inddecgen, false,
-      SH4_GROUP_LS, 1 },
-
-    // MOV.B @Rm+, Rn
-    { "0110nnnnmmmm0100", &sh4_inst_binary_movb_indgeninc_gen, false,
-      SH4_GROUP_LS, 1 },
-
-    // MOV.W @Rm+, Rn
-    { "0110nnnnmmmm0101", &sh4_inst_binary_movw_indgeninc_gen, false,
-      SH4_GROUP_LS, 1 },
-
-    // MOV.L @Rm+, Rn
-    { "0110nnnnmmmm0110", &sh4_inst_binary_movl_indgeninc_gen, false,
-      SH4_GROUP_LS, 1 },
-
-    // MAC.L @Rm+, @Rn+
-    { "0000nnnnmmmm1111", &sh4_inst_binary_macl_indgeninc_indgeninc,
-      false, SH4_GROUP_CO, 2 },
-
-    // MAC.W @Rm+, @Rn+
-    { "0100nnnnmmmm1111", &sh4_inst_binary_macw_indgeninc_indgeninc,
-      false, SH4_GROUP_CO, 2 },
-
-    // MOV.B R0, @(disp, Rn)
-    { "10000000nnnndddd", &sh4_inst_binary_movb_r0_binind_disp_gen,
-      false, SH4_GROUP_LS, 1 },
-
-    // MOV.W R0, @(disp, Rn)
-    { "10000001nnnndddd", &sh4_inst_binary_movw_r0_binind_disp_gen,
-      false, SH4_GROUP_LS, 1 },
-
-    // MOV.L Rm, @(disp, Rn)
-    { "0001nnnnmmmmdddd", &sh4_inst_binary_movl_gen_binind_disp_gen,
-      false, SH4_GROUP_LS, 1 },
-
-    // MOV.B @(disp, Rm), R0
-    { "10000100mmmmdddd", &sh4_inst_binary_movb_binind_disp_gen_r0,
-      false, SH4_GROUP_LS, 1 },
-
-    // MOV.W @(disp, Rm), R0
-    { "10000101mmmmdddd", &sh4_inst_binary_movw_binind_disp_gen_r0,
-      false, SH4_GROUP_LS, 1 },
-
-    // MOV.L @(disp, Rm), Rn
-    { "0101nnnnmmmmdddd", &sh4_inst_binary_movl_binind_disp_gen_gen,
-      false, SH4_GROUP_LS, 1 },
-
-    // MOV.B Rm, @(R0, Rn)
-    { "0000nnnnmmmm0100", &sh4_inst_binary_movb_gen_binind_r0_gen,
-      false, SH4_GROUP_LS, 1 },
-
-    // MOV.W Rm, @(R0, Rn)
-    { "0000nnnnmmmm0101", &sh4_inst_binary_movw_gen_binind_r0_gen,
-      false, SH4_GROUP_LS, 1 },
-
-    // MOV.L Rm, @(R0, Rn)
-    { "0000nnnnmmmm0110", &sh4_inst_binary_movl_gen_binind_r0_gen,
-      false, SH4_GROUP_LS, 1 },
-
-    // MOV.B @(R0, Rm), Rn
-    { "0000nnnnmmmm1100", &sh4_inst_binary_movb_binind_r0_gen_gen,
-      false, SH4_GROUP_LS, 1 },
-
-    // MOV.W @(R0, Rm), Rn
-    { "0000nnnnmmmm1101", &sh4_inst_binary_movw_binind_r0_gen_gen,
-      false, SH4_GROUP_LS, 1 },
-
-    // MOV.L @(R0, Rm), Rn
-    { "0000nnnnmmmm1110", &sh4_inst_binary_movl_binind_r0_gen_gen,
-      false, SH4_GROUP_LS, 1 },
-
-    // MOV.B R0, @(disp, GBR)
-    { "11000000dddddddd", &sh4_inst_binary_movb_r0_binind_disp_gbr,
-      false, SH4_GROUP_LS, 1 },
-
-    // MOV.W R0, @(disp, GBR)
-    { "11000001dddddddd", &sh4_inst_binary_movw_r0_binind_disp_gbr,
-      false, SH4_GROUP_LS, 1 },
-
-    // MOV.L R0, @(disp, GBR)
-    { "11000010dddddddd", &sh4_inst_binary_movl_r0_binind_disp_gbr,
-      false, SH4_GROUP_LS, 1 },
-
-    // MOV.B @(disp, GBR), R0
-    { "11000100dddddddd", &sh4_inst_binary_movb_binind_disp_gbr_r0,
-      false, SH4_GROUP_LS, 1 },
-
-    // MOV.W @(disp, GBR), R0
-    { "11000101dddddddd", &sh4_inst_binary_movw_binind_disp_gbr_r0,
-      false, SH4_GROUP_LS, 1 },
-
-    // MOV.L @(disp, GBR), R0
-    { "11000110dddddddd", &sh4_inst_binary_movl_binind_disp_gbr_r0,
-      false, SH4_GROUP_LS, 1 },
-
-    // MOVA @(disp, PC), R0
-    { "11000111dddddddd", &sh4_inst_binary_mova_binind_disp_pc_r0,
-      false, SH4_GROUP_EX, 1 },
-
-    // MOVCA.L R0, @Rn
-    { "0000nnnn11000011", &sh4_inst_binary_movcal_r0_indgen,
-      false, SH4_GROUP_LS, 1 },
-
-    // FLDI0 FRn
-    { "1111nnnn10001101", FPU_HANDLER(fldi0),
-      false, SH4_GROUP_LS, 1 },
-
-    // FLDI1 Frn
-    { "1111nnnn10011101", FPU_HANDLER(fldi1),
-      false, SH4_GROUP_LS, 1 },
-
-    // FMOV FRm, FRn
-    // 1111nnnnmmmm1100
-    // FMOV DRm, DRn
-    // 1111nnn0mmm01100
-    // FMOV XDm, DRn
-    // 1111nnn0mmm11100
-    // FMOV DRm, XDn
-    // 1111nnn1mmm01100
-    // FMOV XDm, XDn
-    // 1111nnn1mmm11100
-    { "1111nnnnmmmm1100", FPU_HANDLER(fmov_gen),
-      false, SH4_GROUP_LS, 1 },
-
-    // FMOV.S @Rm, FRn
-    // 1111nnnnmmmm1000
-    // FMOV @Rm, DRn
-    // 1111nnn0mmmm1000
-    // FMOV @Rm, XDn
-    // 1111nnn1mmmm1000
-    { "1111nnnnmmmm1000", FPU_HANDLER(fmovs_ind_gen),
-      false, SH4_GROUP_LS, 1 },
-
-    // FMOV.S @(R0, Rm), FRn
-    // 1111nnnnmmmm0110
-    // FMOV @(R0, Rm), DRn
-    // 1111nnn0mmmm0110
-    // FMOV @(R0, Rm), XDn
-    // 1111nnn1mmmm0110
-    { "1111nnnnmmmm0110", FPU_HANDLER(fmov_binind_r0_gen_fpu),
-      false, SH4_GROUP_LS, 1 },
-
-    // FMOV.S @Rm+, FRn
-    // 1111nnnnmmmm1001
-    // FMOV @Rm+, DRn
-    // 1111nnn0mmmm1001
-    // FMOV @Rm+, XDn
-    // 1111nnn1mmmm1001
-    { "1111nnnnmmmm1001", FPU_HANDLER(fmov_indgeninc_fpu),
-      false, SH4_GROUP_LS, 1 },
-
-    // FMOV.S FRm, @Rn
-    // 1111nnnnmmmm1010
-    // FMOV DRm, @Rn
-    // 1111nnnnmmm01010
-    // FMOV XDm, @Rn
-    // 1111nnnnmmm11010
-    { "1111nnnnmmmm1010", FPU_HANDLER(fmov_fpu_indgen),
-      false, SH4_GROUP_LS, 1 },
-
-    // FMOV.S FRm, @-Rn
-    // 1111nnnnmmmm1011
-    // FMOV DRm, @-Rn
-    // 1111nnnnmmm01011
-    // FMOV XDm, @-Rn
-    // 1111nnnnmmm11011
-    { "1111nnnnmmmm1011", FPU_HANDLER(fmov_fpu_inddecgen),
-      false, SH4_GROUP_LS, 1 },
-
-    // FMOV.S FRm, @(R0, Rn)
-    // 1111nnnnmmmm0111
-    // FMOV DRm, @(R0, Rn)
-    // 1111nnnnmmm00111
-    // FMOV XDm, @(R0, Rn)
-    // 1111nnnnmmm10111
-    { "1111nnnnmmmm0111", FPU_HANDLER(fmov_fpu_binind_r0_gen),
-      false, SH4_GROUP_LS, 1 },
-
-    // FLDS FRm, FPUL
-    // XXX Should this check the SZ or PR bits of FPSCR ?
-    { "1111mmmm00011101", &sh4_inst_binary_flds_fr_fpul, false,
-      SH4_GROUP_LS, 1 },
-
-    // FSTS FPUL, FRn
-    // XXX Should this check the SZ or PR bits of FPSCR ?
-    { "1111nnnn00001101", &sh4_inst_binary_fsts_fpul_fr, false,
-      SH4_GROUP_LS, 1 },
-
-    // FABS FRn
-    // 1111nnnn01011101
-    // FABS DRn
-    // 1111nnn001011101
-    { "1111nnnn01011101", FPU_HANDLER(fabs_fpu), false,
-      SH4_GROUP_LS, 1 },
-
-    // FADD FRm, FRn
-    // 1111nnnnmmmm0000
-    // FADD DRm, DRn
-    // 1111nnn0mmm00000
-    { "1111nnnnmmmm0000", FPU_HANDLER(fadd_fpu),
-      false, SH4_GROUP_FE, 1 },
-
-    // FCMP/EQ FRm, FRn
-    // 1111nnnnmmmm0100
-    // FCMP/EQ DRm, DRn
-    // 1111nnn0mmm00100
-    { "1111nnnnmmmm0100", FPU_HANDLER(fcmpeq_fpu), false, SH4_GROUP_FE, 1 },
-
-    // FCMP/GT FRm, FRn
-    // 1111nnnnmmmm0101
-    // FCMP/GT DRm, DRn
-    // 1111nnn0mmm00101
-    { "1111nnnnmmmm0101", FPU_HANDLER(fcmpgt_fpu), false, SH4_GROUP_FE, 1 },
-
-    // FDIV FRm, FRn
-    // 1111nnnnmmmm0011
-    // FDIV DRm, DRn
-    // 1111nnn0mmm00011
-    { "1111nnnnmmmm0011", FPU_HANDLER(fdiv_fpu), false, SH4_GROUP_FE, 1 },
-
-    // FLOAT FPUL, FRn
-    // 1111nnnn00101101
-    // FLOAT FPUL, DRn
-    // 1111nnn000101101
-    { "1111nnnn00101101", FPU_HANDLER(float_fpu), false, SH4_GROUP_FE, 1 },
-
-    // FMAC FR0, FRm, FRn
-    // 1111nnnnmmmm1110
-    { "1111nnnnmmmm1110", FPU_HANDLER(fmac_fpu), false, SH4_GROUP_FE, 1 },
-
-    // FMUL FRm, FRn
-    // 1111nnnnmmmm0010
-    // FMUL DRm, DRn
-    // 1111nnn0mmm00010
-    { "1111nnnnmmmm0010", FPU_HANDLER(fmul_fpu), false, SH4_GROUP_FE, 1 },
-
-    // FNEG FRn
-    // 1111nnnn01001101
-    // FNEG DRn
-    // 1111nnn001001101
-    { "1111nnnn01001101", FPU_HANDLER(fneg_fpu), false, SH4_GROUP_LS, 1 },
-
-    // FSQRT FRn
-    // 1111nnnn01101101
-    // FSQRT DRn
-    // 1111nnn001101101
-    { "1111nnnn01101101", FPU_HANDLER(fsqrt_fpu), false, SH4_GROUP_FE, 1 },
-
-    // FSUB FRm, FRn
-    // 1111nnnnmmmm0001
-    // FSUB DRm, DRn
-    // 1111nnn0mmm00001
-    { "1111nnnnmmmm0001", FPU_HANDLER(fsub_fpu), false, SH4_GROUP_FE, 1 },
-
-    // FTRC FRm, FPUL
-    // 1111mmmm00111101
-    // FTRC DRm, FPUL
-    // 1111mmm000111101
-    { "1111mmmm00111101", FPU_HANDLER(ftrc_fpu), false, SH4_GROUP_FE, 1 },
-
-    // FCNVDS DRm, FPUL
-    // 1111mmm010111101
-    { "1111mmm010111101", FPU_HANDLER(fcnvds_fpu), false, SH4_GROUP_FE, 1 },
-
-    // FCNVSD FPUL, DRn
-    // 1111nnn010101101
-    { "1111nnn010101101", FPU_HANDLER(fcnvsd_fpu), false, SH4_GROUP_FE, 1 },
-
-    // LDS Rm, FPSCR
-    { "0100mmmm01101010", &sh4_inst_binary_lds_gen_fpscr, false,
-      SH4_GROUP_CO, 1 },
-
-    // LDS Rm, FPUL
-    { "0100mmmm01011010", &sh4_inst_binary_gen_fpul, false,
-      SH4_GROUP_LS, 1 },
-
-    // LDS.L @Rm+, FPSCR
-    { "0100mmmm01100110", &sh4_inst_binary_ldsl_indgeninc_fpscr, false,
-      SH4_GROUP_CO, 1 },
-
-    // LDS.L @Rm+, FPUL
-    { "0100mmmm01010110", &sh4_inst_binary_ldsl_indgeninc_fpul, false,
-      SH4_GROUP_CO, 1 },
-
-    // STS FPSCR, Rn
-    { "0000nnnn01101010", &sh4_inst_binary_sts_fpscr_gen, false,
-      SH4_GROUP_CO, 1 },
-
-    // STS FPUL, Rn
-    { "0000nnnn01011010", &sh4_inst_binary_sts_fpul_gen, false,
-      SH4_GROUP_LS, 1 },
-
-    // STS.L FPSCR, @-Rn
-    { "0100nnnn01100010", &sh4_inst_binary_stsl_fpscr_inddecgen, false,
-      SH4_GROUP_CO, 1 },
-
-    // STS.L FPUL, @-Rn
-    { "0100nnnn01010010", &sh4_inst_binary_stsl_fpul_inddecgen, false,
-      SH4_GROUP_CO, 1 },
-
-    // FIPR FVm, FVn - vector dot product
-    { "1111nnmm11101101", &sh4_inst_binary_fipr_fv_fv, false,
-      SH4_GROUP_FE, 1 },
-
-    // FTRV XMTRX, FVn - multiple vector by matrix
-    { "1111nn0111111101", &sh4_inst_binary_fitrv_mxtrx_fv, false,
-      SH4_GROUP_FE, 1 },
-
-    // FSCA FPUL, DRn - sine/cosine table lookup
-    // TODO: the issue cycle count here might be wrong, I couldn't find that
-    //       value for this instruction
-    { "1111nnn011111101", FPU_HANDLER(fsca_fpu), false, SH4_GROUP_FE, 1 },
-
-    // FSRRA FRn
-    // 1111nnnn01111101
-    // TODO: the issue cycle for this opcode might be wrong as well
-    { "1111nnnn01111101", FPU_HANDLER(fsrra_fpu), false, SH4_GROUP_FE, 1 },
-
+#define SH4_INST(fmt, func, is_branch, group, issue) \
+    { fmt, &func, is_branch, group, issue },
+#include "sh4_inst_list.h"
+#undef SH4_INST
     { NULL }
 };
 
@@ -1011,11 +156,23 @@ static InstOpcode invalid_opcode = {
     } while (0)
 
 InstOpcode const *sh4_inst_lut[1 << 16];
+InstOpcode const *sh4_inst_fpu_mode_lut[SH4_INST_N_FPU_MODES][1 << 16];
 
 void sh4_init_inst_lut() {
     unsigned inst;
     for (inst = 0; inst < (1 << 16); inst++)
         sh4_inst_lut[inst] = sh4_decode_inst_slow((inst_t)inst);
+
+#ifdef ENABLE_SH4_SPECIALIZED_HANDLERS
+    sh4_inst_install_specializations();
+#endif
+
+    // this has to go last so that it picks up everything above
+    sh4_inst_init_fpu_mode_luts();
+
+#ifdef SH4_INST_SSE
+    sh4_inst_have_sse = __builtin_cpu_supports("sse");
+#endif
 }
 
 void sh4_exec_inst(Sh4 *sh4) {
@@ -1028,7 +185,7 @@ void sh4_exec_inst(Sh4 *sh4) {
         SH4_INST_RAISE_ERROR(sh4, ERROR_UNIMPLEMENTED);
     }
 
-    sh4_do_exec_inst(sh4, inst, sh4_inst_lut[inst]);
+    sh4_do_exec_inst(sh4, inst, sh4->inst_lut[inst]);
 }
 
 // used to initialize the sh4_inst_lut
@@ -1045,6 +202,8 @@ static InstOpcode const* sh4_decode_inst_slow(inst_t inst) {
     return &invalid_opcode;
 }
 
+#ifndef ENABLE_SH4_THREADED_DISPATCH
+
 void sh4_do_exec_inst(Sh4 *sh4, inst_t inst, InstOpcode const *op) {
     Sh4OpArgs oa;
     oa.inst = inst;
@@ -1077,13 +236,234 @@ void sh4_do_exec_inst(Sh4 *sh4, inst_t inst, InstOpcode const *op) {
     }
 }
 
+#else // ENABLE_SH4_THREADED_DISPATCH
+
+/*
+ * Threaded dispatch.  Instead of calling through InstOpcode's func pointer,
+ * each opcode gets its own label in the dispatching function, and that label
+ * makes a direct call to the handler (which gcc is free to inline, since
+ * they're all in this file).  After the handler returns, the label jumps to
+ * wherever cont points, which is how the delay-slot bookkeeping gets
+ * skipped entirely for instructions that aren't in a delay slot.
+ *
+ * This relies on gcc's labels-as-values extension.
+ */
+
+#define SH4_INST_LABEL(func) SH4_INST_LABEL_(func)
+#define SH4_INST_LABEL_(func) inst_label_ ## func
+
+// table of labels, indexed by InstOpcode.dispatch_idx
+#define SH4_INST_DISPATCH_ENTRY(fmt, func, is_branch, group, issue) \
+    &&SH4_INST_LABEL(func),
+
+// one label for each opcode
+#define SH4_INST_DISPATCH_LABEL(fmt, func, is_branch, group, issue) \
+    SH4_INST_LABEL(func):                                           \
+        func(sh4, oa);                                              \
+        goto *cont;
+
+void sh4_do_exec_inst(Sh4 *sh4, inst_t inst, InstOpcode const *op) {
+    static void const *const dispatch_tbl[] = {
+#define SH4_INST SH4_INST_DISPATCH_ENTRY
+#include "sh4_inst_list.h"
+#undef SH4_INST
+        &&SH4_INST_LABEL(sh4_inst_invalid),
+        &&inst_label_indirect
+    };
+
+    Sh4OpArgs oa;
+    void const *cont;
+    addr32_t delayed_branch_addr;
+
+    oa.inst = inst;
+
+    if (sh4->delayed_branch) {
+        if (op->is_branch) {
+            // raise exception for illegal slot instruction
+            sh4_set_exception(sh4, SH4_EXCP_SLOT_ILLEGAL_INST);
+            return;
+        }
+        delayed_branch_addr = sh4->delayed_branch_addr;
+        cont = &&on_slot_done;
+    } else {
+        cont = &&on_inst_done;
+    }
+
+    goto *dispatch_tbl[op->dispatch_idx];
+
+#define SH4_INST SH4_INST_DISPATCH_LABEL
+#include "sh4_inst_list.h"
+#undef SH4_INST
+    SH4_INST_DISPATCH_LABEL(NULL, sh4_inst_invalid, false, 0, 0)
+inst_label_indirect:
+    op->func(sh4, oa);
+    goto *cont;
+
+on_slot_done:
+#ifdef ENABLE_DEBUGGER
+    if (sh4->aborted_operation) {
+        sh4->aborted_operation = false;
+        return;
+    }
+#endif
+    sh4->reg[SH4_REG_PC] = delayed_branch_addr;
+    sh4->delayed_branch = false;
+    return;
+
+on_inst_done:
+#ifdef ENABLE_DEBUGGER
+    sh4->aborted_operation = false;
+#endif
+    return;
+}
+
+/*
+ * This is the same as the sh4_run_cycles in sh4.c (which gets compiled out
+ * when this is enabled), except that the instructions get dispatched inline
+ * instead of going through sh4_do_exec_inst.  The cycle accounting and
+ * dual-issue rules are exactly the same; see the comments over there.
+ */
+void sh4_run_cycles(Sh4 *sh4, unsigned n_cycles) {
+    static void const *const dispatch_tbl[] = {
+#define SH4_INST SH4_INST_DISPATCH_ENTRY
+#include "sh4_inst_list.h"
+#undef SH4_INST
+        &&SH4_INST_LABEL(sh4_inst_invalid),
+        &&inst_label_indirect
+    };
+
+    inst_t inst;
+    int exc_pending;
+    InstOpcode const *op, *first_op;
+    Sh4OpArgs oa;
+    void const *cont;
+    addr32_t delayed_branch_addr;
+
+    /*
+     * true while the second instruction of a dual-issued pair is being
+     * executed
+     */
+    bool paired;
+
+mulligan:
+    sh4_check_interrupts(sh4);
+    if ((exc_pending = sh4_read_inst(sh4, &inst, sh4->reg[SH4_REG_PC]))) {
+        if (exc_pending == MEM_ACCESS_EXC) {
+            // TODO: some sort of logic to detect infinite loops here
+            goto mulligan;
+        } else {
+            RAISE_ERROR(get_error_pending());
+        }
+    }
+
+    op = sh4->inst_lut[inst];
+
+    if (op->issue > (n_cycles + sh4->cycles_accum)) {
+        dc_cycle_advance(n_cycles);
+        sh4->cycles_accum += n_cycles;
+        return;
+    }
+
+    if (op->issue > sh4->cycles_accum) {
+        unsigned adv_cycles = op->issue - sh4->cycles_accum;
+        dc_cycle_advance(adv_cycles);
+        n_cycles -= adv_cycles;
+        sh4->cycles_accum = 0;
+    } else {
+        sh4->cycles_accum -= op->issue;
+    }
+
+    first_op = op;
+    paired = false;
+
+exec_inst:
+    oa.inst = inst;
+
+    if (sh4->delayed_branch) {
+        if (op->is_branch) {
+            // raise exception for illegal slot instruction
+            sh4_set_exception(sh4, SH4_EXCP_SLOT_ILLEGAL_INST);
+            goto next_inst;
+        }
+        delayed_branch_addr = sh4->delayed_branch_addr;
+        cont = &&on_slot_done;
+    } else {
+        cont = &&on_inst_done;
+    }
+
+    goto *dispatch_tbl[op->dispatch_idx];
+
+#define SH4_INST SH4_INST_DISPATCH_LABEL
+#include "sh4_inst_list.h"
+#undef SH4_INST
+    SH4_INST_DISPATCH_LABEL(NULL, sh4_inst_invalid, false, 0, 0)
+inst_label_indirect:
+    op->func(sh4, oa);
+    goto *cont;
+
+on_slot_done:
+#ifdef ENABLE_DEBUGGER
+    if (sh4->aborted_operation) {
+        sh4->aborted_operation = false;
+        goto next_inst;
+    }
+#endif
+    sh4->reg[SH4_REG_PC] = delayed_branch_addr;
+    sh4->delayed_branch = false;
+    goto next_inst;
+
+on_inst_done:
+#ifdef ENABLE_DEBUGGER
+    sh4->aborted_operation = false;
+#endif
+
+next_inst:
+    if (!paired && first_op->group != SH4_GROUP_CO) {
+        /*
+         * if there's an exception we'll deal with it next time this
+         * function gets called
+         */
+        if ((exc_pending = sh4_read_inst(sh4, &inst, sh4->reg[SH4_REG_PC]))) {
+            if (exc_pending == MEM_ACCESS_EXC)
+                goto mulligan; // TODO: might be better to return here instead
+            else
+                RAISE_ERROR(get_error_pending());
+        }
+
+        op = sh4->inst_lut[inst];
+
+        if (op->group != SH4_GROUP_CO &&
+            ((first_op->group != op->group) ||
+             (first_op->group == SH4_GROUP_MT))) {
+            paired = true;
+            goto exec_inst;
+        }
+    }
+
+    n_cycles = dc_sched_clamp_slice(n_cycles);
+
+    if (sh4->idle)
+        sh4_idle_skip(sh4, n_cycles);
+    else if (n_cycles)
+        goto mulligan;
+}
+
+#endif // ENABLE_SH4_THREADED_DISPATCH
+
 void sh4_compile_instructions(Sh4 *sh4) {
     InstOpcode *op = opcode_list;
 
     while (op->fmt) {
         sh4_compile_instruction(sh4, op);
+#ifdef ENABLE_SH4_THREADED_DISPATCH
+        op->dispatch_idx = op - opcode_list;
+#endif
         op++;
     }
+
+#ifdef ENABLE_SH4_THREADED_DISPATCH
+    invalid_opcode.dispatch_idx = op - opcode_list;
+#endif
 }
 
 void sh4_compile_instruction(Sh4 *sh4, struct InstOpcode *op) {
@@ -1320,6 +700,12 @@ void sh4_inst_sleep(Sh4 *sh4, Sh4OpArgs inst) {
         else
             sh4->exec_state = SH4_EXEC_STATE_SLEEP;
     }
+
+    /*
+     * the PC doesn't move, so this keeps getting executed until an interrupt
+     * comes along.  Interrupts only come from scheduled events.
+     */
+    sh4->idle = true;
 }
 
 #define INST_MASK_1111101111111101 0xffff
@@ -1338,6 +724,10 @@ void sh4_inst_frchg(Sh4 *sh4, Sh4OpArgs inst) {
      * just let the operation go through so I can avoid branching.
      */
 
+    /*
+     * this doesn't need to go through sh4_set_fpscr because the FR bit isn't
+     * one of the bits that sh4->inst_lut depends on.
+     */
     sh4->reg[SH4_REG_FPSCR] ^= SH4_FPSCR_FR_MASK;
     sh4_fpu_bank_switch(sh4);
 
@@ -1360,7 +750,14 @@ void sh4_inst_fschg(Sh4 *sh4, Sh4OpArgs inst) {
      * just let the operation go through so I can avoid branching.
      */
 
+    /*
+     * this is the same thing sh4_set_fpscr would do, minus the rounding-mode
+     * and bank-switching stuff which FSCHG can't affect.
+     */
     sh4->reg[SH4_REG_FPSCR] ^= SH4_FPSCR_SZ_MASK;
+    sh4->inst_lut =
+        sh4_inst_fpu_mode_lut[sh4_inst_fpu_mode(sh4->reg[SH4_REG_FPSCR])];
+
     sh4_next_inst(sh4);
 }
 
@@ -1418,6 +815,7 @@ void sh4_inst_unary_cmppl_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
 // DT Rn
 // 0100nnnn00010000
+SH4_INST_HOT
 void sh4_inst_unary_dt_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
     CHECK_INST(inst, INST_MASK_0100nnnn00010000, INST_CONS_0100nnnn00010000);
@@ -1563,6 +961,7 @@ void sh4_inst_unary_shar_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
 // SHLL Rn
 // 0100nnnn00000000
+SH4_INST_HOT
 void sh4_inst_unary_shll_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
     CHECK_INST(inst, INST_MASK_0100nnnn00000000, INST_CONS_0100nnnn00000000);
@@ -1584,6 +983,7 @@ void sh4_inst_unary_shll_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
 // SHLR Rn
 // 0100nnnn00000001
+SH4_INST_HOT
 void sh4_inst_unary_shlr_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
     CHECK_INST(inst, INST_MASK_0100nnnn00000001, INST_CONS_0100nnnn00000001);
@@ -1605,6 +1005,7 @@ void sh4_inst_unary_shlr_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
 // SHLL2 Rn
 // 0100nnnn00001000
+SH4_INST_HOT
 void sh4_inst_unary_shll2_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
     CHECK_INST(inst, INST_MASK_0100nnnn00001000, INST_CONS_0100nnnn00001000);
@@ -1623,6 +1024,7 @@ void sh4_inst_unary_shll2_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
 // SHLR2 Rn
 // 0100nnnn00001001
+SH4_INST_HOT
 void sh4_inst_unary_shlr2_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
     CHECK_INST(inst, INST_MASK_0100nnnn00001001, INST_CONS_0100nnnn00001001);
@@ -1641,6 +1043,7 @@ void sh4_inst_unary_shlr2_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
 // SHLL8 Rn
 // 0100nnnn00011000
+SH4_INST_HOT
 void sh4_inst_unary_shll8_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
     CHECK_INST(inst, INST_MASK_0100nnnn00011000, INST_CONS_0100nnnn00011000);
@@ -1659,6 +1062,7 @@ void sh4_inst_unary_shll8_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
 // SHLR8 Rn
 // 0100nnnn00011001
+SH4_INST_HOT
 void sh4_inst_unary_shlr8_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
     CHECK_INST(inst, INST_MASK_0100nnnn00011001, INST_CONS_0100nnnn00011001);
@@ -1677,6 +1081,7 @@ void sh4_inst_unary_shlr8_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
 // SHLL16 Rn
 // 0100nnnn00101000
+SH4_INST_HOT
 void sh4_inst_unary_shll16_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
     CHECK_INST(inst, INST_MASK_0100nnnn00101000, INST_CONS_0100nnnn00101000);
@@ -1695,6 +1100,7 @@ void sh4_inst_unary_shll16_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
 // SHLR16 Rn
 // 0100nnnn00101001
+SH4_INST_HOT
 void sh4_inst_unary_shlr16_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
     CHECK_INST(inst, INST_MASK_0100nnnn00101001, INST_CONS_0100nnnn00101001);
@@ -1915,10 +1321,15 @@ void sh4_inst_unary_bf_disp(Sh4 *sh4, Sh4OpArgs inst) {
 
     CHECK_INST(inst, INST_MASK_10001011dddddddd, INST_CONS_10001011dddddddd);
 
-    if (!(sh4->reg[SH4_REG_SR] & SH4_SR_FLAG_T_MASK))
+    if (!(sh4->reg[SH4_REG_SR] & SH4_SR_FLAG_T_MASK)) {
+        addr32_t branch_pc = sh4->reg[SH4_REG_PC];
         sh4->reg[SH4_REG_PC] += (((int32_t)inst.simm8) << 1) + 4;
-    else
+        if (inst.simm8 < 0 &&
+            sh4_idle_loop_check(sh4->reg[SH4_REG_PC], branch_pc))
+            sh4->idle = true;
+    } else {
         sh4_next_inst(sh4);
+    }
 }
 
 #define INST_MASK_10001111dddddddd 0xff00
@@ -1933,6 +1344,10 @@ void sh4_inst_unary_bfs_disp(Sh4 *sh4, Sh4OpArgs inst) {
     if (!(sh4->reg[SH4_REG_SR] & SH4_SR_FLAG_T_MASK)) {
         sh4->delayed_branch_addr = sh4->reg[SH4_REG_PC] + (((int32_t)inst.simm8) << 1) + 4;
         sh4->delayed_branch = true;
+        if (inst.simm8 < 0 &&
+            sh4_idle_loop_check(sh4->delayed_branch_addr,
+                                sh4->reg[SH4_REG_PC]))
+            sh4->idle = true;
     }
 
     sh4_next_inst(sh4);
@@ -1947,10 +1362,15 @@ void sh4_inst_unary_bt_disp(Sh4 *sh4, Sh4OpArgs inst) {
 
     CHECK_INST(inst, INST_MASK_10001001dddddddd, INST_CONS_10001001dddddddd);
 
-    if (sh4->reg[SH4_REG_SR] & SH4_SR_FLAG_T_MASK)
+    if (sh4->reg[SH4_REG_SR] & SH4_SR_FLAG_T_MASK) {
+        addr32_t branch_pc = sh4->reg[SH4_REG_PC];
         sh4->reg[SH4_REG_PC] += (((int32_t)inst.simm8) << 1) + 4;
-    else
+        if (inst.simm8 < 0 &&
+            sh4_idle_loop_check(sh4->reg[SH4_REG_PC], branch_pc))
+            sh4->idle = true;
+    } else {
         sh4_next_inst(sh4);
+    }
 }
 
 #define INST_MASK_10001101dddddddd 0xff00
@@ -1965,6 +1385,10 @@ void sh4_inst_unary_bts_disp(Sh4 *sh4, Sh4OpArgs inst) {
     if (sh4->reg[SH4_REG_SR] & SH4_SR_FLAG_T_MASK) {
         sh4->delayed_branch_addr = sh4->reg[SH4_REG_PC] + (((int32_t)inst.simm8) << 1) + 4;
         sh4->delayed_branch = true;
+        if (inst.simm8 < 0 &&
+            sh4_idle_loop_check(sh4->delayed_branch_addr,
+                                sh4->reg[SH4_REG_PC]))
+            sh4->idle = true;
     }
 
     sh4_next_inst(sh4);
@@ -1981,6 +1405,9 @@ void sh4_inst_unary_bra_disp(Sh4 *sh4, Sh4OpArgs inst) {
 
     sh4->delayed_branch = true;
     sh4->delayed_branch_addr = sh4->reg[SH4_REG_PC] + (((int32_t)inst.simm12) << 1) + 4;
+    if (inst.simm12 < 0 &&
+        sh4_idle_loop_check(sh4->delayed_branch_addr, sh4->reg[SH4_REG_PC]))
+        sh4->idle = true;
 
     sh4_next_inst(sh4);
 }
@@ -2881,6 +2308,7 @@ void sh4_inst_binary_movl_binind_disp_pc_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
 // MOV Rm, Rn
 // 0110nnnnmmmm0011
+SH4_INST_HOT
 void sh4_inst_binary_movw_gen_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
     CHECK_INST(inst, INST_MASK_0110nnnnmmmm0011, INST_CONS_0110nnnnmmmm0011);
@@ -2958,6 +2386,7 @@ void sh4_inst_binary_xtrct_gen_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
 // ADD Rm, Rn
 // 0011nnnnmmmm1100
+SH4_INST_HOT
 void sh4_inst_binary_add_gen_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
     CHECK_INST(inst, INST_MASK_0011nnnnmmmm1100, INST_CONS_0011nnnnmmmm1100);
@@ -3038,6 +2467,7 @@ void sh4_inst_binary_addv_gen_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
 // CMP/EQ Rm, Rn
 // 0011nnnnmmmm0000
+SH4_INST_HOT
 void sh4_inst_binary_cmpeq_gen_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
     CHECK_INST(inst, INST_MASK_0011nnnnmmmm0000, INST_CONS_0011nnnnmmmm0000);
@@ -3054,6 +2484,7 @@ void sh4_inst_binary_cmpeq_gen_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
 // CMP/HS Rm, Rn
 // 0011nnnnmmmm0010
+SH4_INST_HOT
 void sh4_inst_binary_cmphs_gen_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
     CHECK_INST(inst, INST_MASK_0011nnnnmmmm0010, INST_CONS_0011nnnnmmmm0010);
@@ -3105,6 +2536,7 @@ void sh4_inst_binary_cmphi_gen_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
 // CMP/GT Rm, Rn
 // 0011nnnnmmmm0111
+SH4_INST_HOT
 void sh4_inst_binary_cmpgt_gen_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
     CHECK_INST(inst, INST_MASK_0011nnnnmmmm0111, INST_CONS_0011nnnnmmmm0111);
@@ -3352,6 +2784,7 @@ void sh4_inst_binary_extsw_gen_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
 // EXTU.B Rm, Rn
 // 0110nnnnmmmm1100
+SH4_INST_HOT
 void sh4_inst_binary_extub_gen_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
     CHECK_INST(inst, INST_MASK_0110nnnnmmmm1100, INST_CONS_0110nnnnmmmm1100);
@@ -3367,6 +2800,7 @@ void sh4_inst_binary_extub_gen_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
 // EXTU.W Rm, Rn
 // 0110nnnnmmmm1101
+SH4_INST_HOT
 void sh4_inst_binary_extuw_gen_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
     CHECK_INST(inst, INST_MASK_0110nnnnmmmm1101, INST_CONS_0110nnnnmmmm1101);
@@ -3466,6 +2900,7 @@ void sh4_inst_binary_negc_gen_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
 // SUB Rm, Rn
 // 0011nnnnmmmm1000
+SH4_INST_HOT
 void sh4_inst_binary_sub_gen_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
     CHECK_INST(inst, INST_MASK_0011nnnnmmmm1000, INST_CONS_0011nnnnmmmm1000);
@@ -3545,6 +2980,7 @@ void sh4_inst_binary_subv_gen_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
 // AND Rm, Rn
 // 0010nnnnmmmm1001
+SH4_INST_HOT
 void sh4_inst_binary_and_gen_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
     CHECK_INST(inst, INST_MASK_0010nnnnmmmm1001, INST_CONS_0010nnnnmmmm1001);
@@ -3573,6 +3009,7 @@ void sh4_inst_binary_not_gen_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
 // OR Rm, Rn
 // 0010nnnnmmmm1011
+SH4_INST_HOT
 void sh4_inst_binary_or_gen_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
     CHECK_INST(inst, INST_MASK_0010nnnnmmmm1011, INST_CONS_0010nnnnmmmm1011);
@@ -3587,6 +3024,7 @@ void sh4_inst_binary_or_gen_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
 // TST Rm, Rn
 // 0010nnnnmmmm1000
+SH4_INST_HOT
 void sh4_inst_binary_tst_gen_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
     CHECK_INST(inst, INST_MASK_0010nnnnmmmm1000, INST_CONS_0010nnnnmmmm1000);
@@ -3604,6 +3042,7 @@ void sh4_inst_binary_tst_gen_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
 // XOR Rm, Rn
 // 0010nnnnmmmm1010
+SH4_INST_HOT
 void sh4_inst_binary_xor_gen_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
     CHECK_INST(inst, INST_MASK_0010nnnnmmmm1010, INST_CONS_0010nnnnmmmm1010);
@@ -4022,6 +3461,7 @@ void sh4_inst_binary_movw_gen_indgen(Sh4 *sh4, Sh4OpArgs inst) {
 
 // MOV.L Rm, @Rn
 // 0010nnnnmmmm0010
+SH4_INST_HOT
 void sh4_inst_binary_movl_gen_indgen(Sh4 *sh4, Sh4OpArgs inst) {
 
     CHECK_INST(inst, INST_MASK_0010nnnnmmmm0010, INST_CONS_0010nnnnmmmm0010);
@@ -4080,6 +3520,7 @@ void sh4_inst_binary_movw_indgen_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
 // MOV.L @Rm, Rn
 // 0110nnnnmmmm0010
+SH4_INST_HOT
 void sh4_inst_binary_movl_indgen_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
     CHECK_INST(inst, INST_MASK_0110nnnnmmmm0010, INST_CONS_0110nnnnmmmm0010);
@@ -4149,6 +3590,7 @@ void sh4_inst_binary_movw_gen_inddecgen(Sh4 *sh4, Sh4OpArgs inst) {
 
 // MOV.L Rm, @-Rn
 // 0010nnnnmmmm0110
+SH4_INST_HOT
 void sh4_inst_binary_movl_gen_inddecgen(Sh4 *sh4, Sh4OpArgs inst) {
 
     CHECK_INST(inst, INST_MASK_0010nnnnmmmm0110, INST_CONS_0010nnnnmmmm0110);
@@ -4220,6 +3662,7 @@ void sh4_inst_binary_movw_indgeninc_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
 // MOV.L @Rm+, Rn
 // 0110nnnnmmmm0110
+SH4_INST_HOT
 void sh4_inst_binary_movl_indgeninc_gen(Sh4 *sh4, Sh4OpArgs inst) {
 
     CHECK_INST(inst, INST_MASK_0110nnnnmmmm0110, INST_CONS_0110nnnnmmmm0110);
@@ -5902,10 +5345,9 @@ void sh4_inst_binary_fmov_xd_xd(Sh4 *sh4, Sh4OpArgs inst) {
     CHECK_INST(inst, INST_MASK_1111nnn1mmm11100, INST_CONS_1111nnn1mmm11100);
     CHECK_FPSCR(sh4->reg[SH4_REG_FPSCR], SH4_FPSCR_SZ_MASK, SH4_FPSCR_SZ_MASK);
 
-    error_set_feature("opcode implementation");
-    error_set_opcode_format("1111nnn1mmm11100");
-    error_set_opcode_name("FMOV XDm, XDn");
-    SH4_INST_RAISE_ERROR(sh4, ERROR_UNIMPLEMENTED);
+    *sh4_fpu_xd(sh4, inst.dr_dst) = *sh4_fpu_xd(sh4, inst.dr_src);
+
+    sh4_next_inst(sh4);
 }
 
 #define INST_MASK_1111nnn1mmmm1000 0xf10f
@@ -5918,10 +5360,13 @@ void sh4_inst_binary_fmov_indgen_xd(Sh4 *sh4, Sh4OpArgs inst) {
     CHECK_INST(inst, INST_MASK_1111nnn1mmmm1000, INST_CONS_1111nnn1mmmm1000);
     CHECK_FPSCR(sh4->reg[SH4_REG_FPSCR], SH4_FPSCR_SZ_MASK, SH4_FPSCR_SZ_MASK);
 
-    error_set_feature("opcode implementation");
-    error_set_opcode_format("1111nnn1mmmm1000");
-    error_set_opcode_name("FMOV @Rm, XDn");
-    SH4_INST_RAISE_ERROR(sh4, ERROR_UNIMPLEMENTED);
+    reg32_t addr = *sh4_gen_reg(sh4, inst.src_reg);
+    double *dst_ptr = sh4_fpu_xd(sh4, inst.dr_dst);
+
+    if (sh4_read_mem(sh4, dst_ptr, addr, sizeof(*dst_ptr)) != 0)
+        return;
+
+    sh4_next_inst(sh4);
 }
 
 #define INST_MASK_1111nnn1mmmm1001 0xf10f
@@ -5954,10 +5399,13 @@ void sh4_inst_binary_fmov_binind_r0_gen_xd(Sh4 *sh4, Sh4OpArgs inst) {
     CHECK_INST(inst, INST_MASK_1111nnn1mmmm0110, INST_CONS_1111nnn1mmmm0110);
     CHECK_FPSCR(sh4->reg[SH4_REG_FPSCR], SH4_FPSCR_SZ_MASK, SH4_FPSCR_SZ_MASK);
 
-    error_set_feature("opcode implementation");
-    error_set_opcode_format("1111nnn1mmmm0110");
-    error_set_opcode_name("FMOV @(R0, Rn), XDn");
-    SH4_INST_RAISE_ERROR(sh4, ERROR_UNIMPLEMENTED);
+    reg32_t addr = *sh4_gen_reg(sh4, 0) + *sh4_gen_reg(sh4, inst.src_reg);
+    double *dst_ptr = sh4_fpu_xd(sh4, inst.dr_dst);
+
+    if (sh4_read_mem(sh4, dst_ptr, addr, sizeof(*dst_ptr)) != 0)
+        return;
+
+    sh4_next_inst(sh4);
 }
 
 #define INST_MASK_1111nnnnmmm11010 0xf01f
@@ -5970,10 +5418,13 @@ void sh4_inst_binary_fmov_xd_indgen(Sh4 *sh4, Sh4OpArgs inst) {
     CHECK_INST(inst, INST_MASK_1111nnnnmmm11010, INST_CONS_1111nnnnmmm11010);
     CHECK_FPSCR(sh4->reg[SH4_REG_FPSCR], SH4_FPSCR_SZ_MASK, SH4_FPSCR_SZ_MASK);
 
-    error_set_feature("opcode implementation");
-    error_set_opcode_format("1111nnnnmmm11010");
-    error_set_opcode_name("FMOV XDm, @Rn");
-    SH4_INST_RAISE_ERROR(sh4, ERROR_UNIMPLEMENTED);
+    reg32_t addr = *sh4_gen_reg(sh4, inst.dst_reg);
+    double *src_p = sh4_fpu_xd(sh4, inst.dr_src);
+
+    if (sh4_write_mem(sh4, src_p, addr, sizeof(*src_p)) != 0)
+        return;
+
+    sh4_next_inst(sh4);
 }
 
 #define INST_MASK_1111nnnnmmm11011 0xf01f
@@ -6007,11 +5458,63 @@ void sh4_inst_binary_fmov_xs_binind_r0_gen(Sh4 *sh4, Sh4OpArgs inst) {
     CHECK_INST(inst, INST_MASK_1111nnnnmmm10111, INST_CONS_1111nnnnmmm10111);
     CHECK_FPSCR(sh4->reg[SH4_REG_FPSCR], SH4_FPSCR_SZ_MASK, SH4_FPSCR_SZ_MASK);
 
-    error_set_feature("opcode implementation");
-    error_set_opcode_format("1111nnnnmmm10111");
-    error_set_opcode_name("FMOV XDm, @(R0, Rn)");
-    SH4_INST_RAISE_ERROR(sh4, ERROR_UNIMPLEMENTED);
+    addr32_t addr = *sh4_gen_reg(sh4, 0) + *sh4_gen_reg(sh4, inst.dst_reg);
+    double *src_p = sh4_fpu_xd(sh4, inst.dr_src);
+
+    if (sh4_write_mem(sh4, src_p, addr, sizeof(*src_p)) != 0)
+        return;
+
+    sh4_next_inst(sh4);
+}
+
+#ifdef SH4_INST_SSE
+/*
+ * The SSE versions of FIPR and FTRV have to give the exact same results as the
+ * scalar versions, so there's no FMA and no DPPS here.  Both of those round
+ * differently from the scalar code, which adds the products up one at a time
+ * from left to right.  Everything else about rounding comes from MXCSR, which
+ * fesetround (and therefore sh4_set_fpscr) takes care of.
+ *
+ * The one thing that can differ is which payload a NaN result ends up with,
+ * since that depends on operand order and gcc is free to swap the operands
+ * of the scalar code's multiplies.  The real SH4 doesn't propagate NaN
+ * payloads the way x86 does anyways.
+ */
+
+// fv2[3] = fv1 dot fv2
+__attribute__((target("sse")))
+static inline void sh4_inst_fipr_sse(float const *fv1, float *fv2) {
+    __m128 prod = _mm_mul_ps(_mm_loadu_ps(fv1), _mm_loadu_ps(fv2));
+
+    __m128 sum = _mm_add_ss(prod, _mm_shuffle_ps(prod, prod, 1));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(prod, prod, 2));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(prod, prod, 3));
+
+    _mm_store_ss(fv2 + 3, sum);
+}
+
+/*
+ * fv = xmtrx * fv
+ *
+ * XMTRX is stored column-major (XF0-XF3 is the first column), so each column
+ * gets scaled by one element of fv and then the columns get added up.
+ */
+__attribute__((target("sse")))
+static inline void sh4_inst_ftrv_sse(float const *xmtrx, float *fv) {
+    __m128 vec = _mm_loadu_ps(fv);
+
+    __m128 res = _mm_mul_ps(_mm_shuffle_ps(vec, vec, 0x00),
+                            _mm_loadu_ps(xmtrx));
+    res = _mm_add_ps(res, _mm_mul_ps(_mm_shuffle_ps(vec, vec, 0x55),
+                                     _mm_loadu_ps(xmtrx + 4)));
+    res = _mm_add_ps(res, _mm_mul_ps(_mm_shuffle_ps(vec, vec, 0xaa),
+                                     _mm_loadu_ps(xmtrx + 8)));
+    res = _mm_add_ps(res, _mm_mul_ps(_mm_shuffle_ps(vec, vec, 0xff),
+                                     _mm_loadu_ps(xmtrx + 12)));
+
+    _mm_storeu_ps(fv, res);
 }
+#endif
 
 #define INST_MASK_1111nnmm11101101 0xf0ff
 #define INST_CONS_1111nnmm11101101 0xf0ed
@@ -6044,6 +5547,14 @@ void sh4_inst_binary_fipr_fv_fv(Sh4 *sh4, Sh4OpArgs inst) {
     unsigned reg_src_idx = inst.fv_src * 4;
     unsigned reg_dst_idx = inst.fv_dst * 4;
 
+#ifdef SH4_INST_SSE
+    if (sh4_inst_have_sse) {
+        sh4_inst_fipr_sse((float*)(sh4->reg + SH4_REG_FR0 + reg_src_idx),
+                          (float*)(sh4->reg + SH4_REG_FR0 + reg_dst_idx));
+        return;
+    }
+#endif
+
     reg32_t *src1_ptr = sh4->reg + SH4_REG_FR0 + reg_src_idx;
     reg32_t *src2_ptr = sh4->reg + SH4_REG_FR0 + reg_dst_idx;
 
@@ -6085,6 +5596,15 @@ void sh4_inst_binary_fitrv_mxtrx_fv(Sh4 *sh4, Sh4OpArgs inst) {
 #endif
 
     unsigned reg_idx = inst.fv_reg * 4 + SH4_REG_FR0;
+
+#ifdef SH4_INST_SSE
+    if (sh4_inst_have_sse) {
+        sh4_inst_ftrv_sse((float*)(sh4->reg + SH4_REG_XMTRX),
+                          (float*)(sh4->reg + reg_idx));
+        return;
+    }
+#endif
+
     float tmp[4];
     memcpy(tmp, sh4->reg + reg_idx, sizeof(tmp));
 
@@ -6222,7 +5742,7 @@ DEF_FPU_HANDLER(fldi1, SH4_FPSCR_PR_MASK,
 // FMOV XDm, XDn
 // 1111nnn1mmm11100
 DEF_FPU_HANDLER_CUSTOM(fmov_gen) {
-    if (sh4->reg[SH4_REG_FPSCR] & SH4_FPSCR_SZ_MASK) {
+    if (fpscr & SH4_FPSCR_SZ_MASK) {
 
         /*
          * TODO: I ought to be able to merge all four of these into a single
@@ -6230,24 +5750,20 @@ DEF_FPU_HANDLER_CUSTOM(fmov_gen) {
          * which register banks get used for the source and destination
          * operands.
          */
-        switch (inst.inst & ((1 << 8) | (1 << 4))) {
+        switch (inst & ((1 << 8) | (1 << 4))) {
         case 0:
-            sh4_inst_binary_fmov_dr_dr(sh4, inst);
-            break;
+            return sh4_inst_binary_fmov_dr_dr;
         case (1 << 4):
-            sh4_inst_binary_fmov_xd_dr(sh4, inst);
-            break;
+            return sh4_inst_binary_fmov_xd_dr;
         case (1 << 8):
-            sh4_inst_binary_fmov_dr_xd(sh4, inst);
-            break;
+            return sh4_inst_binary_fmov_dr_xd;
         case (1 << 8) | (1 << 4):
-            sh4_inst_binary_fmov_xd_xd(sh4, inst);
-            break;
+            return sh4_inst_binary_fmov_xd_xd;
         default:
             RAISE_ERROR(ERROR_INTEGRITY); // should never happen
         }
     } else {
-        sh4_inst_binary_fmov_fr_fr(sh4, inst);
+        return sh4_inst_binary_fmov_fr_fr;
     }
 }
 
@@ -6258,7 +5774,7 @@ DEF_FPU_HANDLER_CUSTOM(fmov_gen) {
 // FMOV @Rm, XDn
 // 1111nnn1mmmm1000
 DEF_FPU_HANDLER_CUSTOM(fmovs_ind_gen) {
-    if (sh4->reg[SH4_REG_FPSCR] & SH4_FPSCR_SZ_MASK) {
+    if (fpscr & SH4_FPSCR_SZ_MASK) {
 
         /*
          * TODO: I ought to be able to merge both of these into a single
@@ -6266,18 +5782,16 @@ DEF_FPU_HANDLER_CUSTOM(fmovs_ind_gen) {
          * which register banks get used for the source and destination
          * operands.
          */
-        switch (inst.inst & (1 << 8)) {
+        switch (inst & (1 << 8)) {
         case 0:
-            sh4_inst_binary_fmov_indgen_dr(sh4, inst);
-            break;
+            return sh4_inst_binary_fmov_indgen_dr;
         case (1 << 8):
-            sh4_inst_binary_fmov_indgen_xd(sh4, inst);
-            break;
+            return sh4_inst_binary_fmov_indgen_xd;
         default:
             RAISE_ERROR(ERROR_INTEGRITY); // should never happen
         }
     } else {
-        sh4_inst_binary_fmovs_indgen_fr(sh4, inst);
+        return sh4_inst_binary_fmovs_indgen_fr;
     }
 }
 
@@ -6288,7 +5802,7 @@ DEF_FPU_HANDLER_CUSTOM(fmovs_ind_gen) {
 // FMOV @(R0, Rm), XDn
 // 1111nnn1mmmm0110
 DEF_FPU_HANDLER_CUSTOM(fmov_binind_r0_gen_fpu) {
-    if (sh4->reg[SH4_REG_FPSCR] & SH4_FPSCR_SZ_MASK) {
+    if (fpscr & SH4_FPSCR_SZ_MASK) {
 
         /*
          * TODO: I ought to be able to merge both of these into a single
@@ -6296,18 +5810,16 @@ DEF_FPU_HANDLER_CUSTOM(fmov_binind_r0_gen_fpu) {
          * which register banks get used for the source and destination
          * operands.
          */
-        switch (inst.inst & (1 << 8)) {
+        switch (inst & (1 << 8)) {
         case 0:
-            sh4_inst_binary_fmov_binind_r0_gen_dr(sh4, inst);
-            break;
+            return sh4_inst_binary_fmov_binind_r0_gen_dr;
         case (1 << 8):
-            sh4_inst_binary_fmov_binind_r0_gen_xd(sh4, inst);
-            break;
+            return sh4_inst_binary_fmov_binind_r0_gen_xd;
         default:
             RAISE_ERROR(ERROR_INTEGRITY); // should never happen
         }
     } else {
-        sh4_inst_binary_fmovs_binind_r0_gen_fr(sh4, inst);
+        return sh4_inst_binary_fmovs_binind_r0_gen_fr;
     }
 }
 
@@ -6318,7 +5830,7 @@ DEF_FPU_HANDLER_CUSTOM(fmov_binind_r0_gen_fpu) {
 // FMOV @Rm+, XDn
 // 1111nnn1mmmm1001
 DEF_FPU_HANDLER_CUSTOM(fmov_indgeninc_fpu) {
-    if (sh4->reg[SH4_REG_FPSCR] & SH4_FPSCR_SZ_MASK) {
+    if (fpscr & SH4_FPSCR_SZ_MASK) {
 
         /*
          * TODO: I ought to be able to merge both of these into a single
@@ -6326,18 +5838,16 @@ DEF_FPU_HANDLER_CUSTOM(fmov_indgeninc_fpu) {
          * which register banks get used for the source and destination
          * operands.
          */
-        switch (inst.inst & (1 << 8)) {
+        switch (inst & (1 << 8)) {
         case 0:
-            sh4_inst_binary_fmov_indgeninc_dr(sh4, inst);
-            break;
+            return sh4_inst_binary_fmov_indgeninc_dr;
         case (1 << 8):
-            sh4_inst_binary_fmov_indgeninc_xd(sh4, inst);
-            break;
+            return sh4_inst_binary_fmov_indgeninc_xd;
         default:
             RAISE_ERROR(ERROR_INTEGRITY); // should never happen
         }
     } else {
-        sh4_inst_binary_fmovs_indgeninc_fr(sh4, inst);
+        return sh4_inst_binary_fmovs_indgeninc_fr;
     }
 }
 
@@ -6348,7 +5858,7 @@ DEF_FPU_HANDLER_CUSTOM(fmov_indgeninc_fpu) {
 // FMOV XDm, @Rn
 // 1111nnnnmmm11010
 DEF_FPU_HANDLER_CUSTOM(fmov_fpu_indgen) {
-    if (sh4->reg[SH4_REG_FPSCR] & SH4_FPSCR_SZ_MASK) {
+    if (fpscr & SH4_FPSCR_SZ_MASK) {
 
         /*
          * TODO: I ought to be able to merge both of these into a single
@@ -6356,18 +5866,16 @@ DEF_FPU_HANDLER_CUSTOM(fmov_fpu_indgen) {
          * which register banks get used for the source and destination
          * operands.
          */
-        switch (inst.inst & (1 << 4)) {
+        switch (inst & (1 << 4)) {
         case 0:
-            sh4_inst_binary_fmov_dr_indgen(sh4, inst);
-            break;
+            return sh4_inst_binary_fmov_dr_indgen;
         case (1 << 4):
-            sh4_inst_binary_fmov_xd_indgen(sh4, inst);
-            break;
+            return sh4_inst_binary_fmov_xd_indgen;
         default:
             RAISE_ERROR(ERROR_INTEGRITY); // should never happen
         }
     } else {
-        sh4_inst_binary_fmovs_fr_indgen(sh4, inst);
+        return sh4_inst_binary_fmovs_fr_indgen;
     }
 }
 
@@ -6378,7 +5886,7 @@ DEF_FPU_HANDLER_CUSTOM(fmov_fpu_indgen) {
 // FMOV XDm, @-Rn
 // 1111nnnnmmm11011
 DEF_FPU_HANDLER_CUSTOM(fmov_fpu_inddecgen) {
-    if (sh4->reg[SH4_REG_FPSCR] & SH4_FPSCR_SZ_MASK) {
+    if (fpscr & SH4_FPSCR_SZ_MASK) {
 
         /*
          * TODO: I ought to be able to merge both of these into a single
@@ -6386,18 +5894,16 @@ DEF_FPU_HANDLER_CUSTOM(fmov_fpu_inddecgen) {
          * which register banks get used for the source and destination
          * operands.
          */
-        switch (inst.inst & (1 << 4)) {
+        switch (inst & (1 << 4)) {
         case 0:
-            sh4_inst_binary_fmov_dr_inddecgen(sh4, inst);
-            break;
+            return sh4_inst_binary_fmov_dr_inddecgen;
         case (1 << 4):
-            sh4_inst_binary_fmov_xd_inddecgen(sh4, inst);
-            break;
+            return sh4_inst_binary_fmov_xd_inddecgen;
         default:
             RAISE_ERROR(ERROR_INTEGRITY); // should never happen
         }
     } else {
-        sh4_inst_binary_fmovs_fr_inddecgen(sh4, inst);
+        return sh4_inst_binary_fmovs_fr_inddecgen;
     }
 }
 
@@ -6409,7 +5915,7 @@ DEF_FPU_HANDLER_CUSTOM(fmov_fpu_inddecgen) {
 // FMOV XDm, @(R0, Rn)
 // 1111nnnnmmm10111
 DEF_FPU_HANDLER_CUSTOM(fmov_fpu_binind_r0_gen) {
-    if (sh4->reg[SH4_REG_FPSCR] & SH4_FPSCR_SZ_MASK) {
+    if (fpscr & SH4_FPSCR_SZ_MASK) {
 
         /*
          * TODO: I ought to be able to merge both of these into a single
@@ -6417,18 +5923,16 @@ DEF_FPU_HANDLER_CUSTOM(fmov_fpu_binind_r0_gen) {
          * which register banks get used for the source and destination
          * operands.
          */
-        switch (inst.inst & (1 << 4)) {
+        switch (inst & (1 << 4)) {
         case 0:
-            sh4_inst_binary_fmov_dr_binind_r0_gen(sh4, inst);
-            break;
+            return sh4_inst_binary_fmov_dr_binind_r0_gen;
         case (1 << 4):
-            sh4_inst_binary_fmov_xs_binind_r0_gen(sh4, inst);
-            break;
+            return sh4_inst_binary_fmov_xs_binind_r0_gen;
         default:
             RAISE_ERROR(ERROR_INTEGRITY); // should never happen
         }
     } else {
-        sh4_inst_binary_fmovs_fr_binind_r0_gen(sh4, inst);
+        return sh4_inst_binary_fmovs_fr_binind_r0_gen;
     }
 }
 
@@ -6548,3 +6052,151 @@ DEF_FPU_HANDLER(fsca_fpu, SH4_FPSCR_PR_MASK,
 // 1111nnnn01111101
 DEF_FPU_HANDLER(fsrra_fpu, SH4_FPSCR_PR_MASK,
                 sh4_inst_unary_fsrra_frn, sh4_inst_invalid);
+
+/*
+ * FPU-mode-specific opcodes.  Every InstOpcode whose handler is one of the
+ * FPU handlers above gets a copy for each handler its resolver can return,
+ * and those copies are what sh4_inst_fpu_mode_lut points at.
+ */
+
+typedef opcode_func_t (*sh4_fpu_resolver_fn)(reg32_t fpscr, inst_t inst);
+
+struct sh4_fpu_resolver {
+    opcode_func_t handler;
+    sh4_fpu_resolver_fn resolve;
+};
+
+#define FPU_RESOLVER_ENTRY(name) { FPU_HANDLER(name), FPU_RESOLVER(name) }
+
+static struct sh4_fpu_resolver const fpu_resolvers[] = {
+    FPU_RESOLVER_ENTRY(fldi0),
+    FPU_RESOLVER_ENTRY(fldi1),
+    FPU_RESOLVER_ENTRY(fmov_gen),
+    FPU_RESOLVER_ENTRY(fmovs_ind_gen),
+    FPU_RESOLVER_ENTRY(fmov_binind_r0_gen_fpu),
+    FPU_RESOLVER_ENTRY(fmov_indgeninc_fpu),
+    FPU_RESOLVER_ENTRY(fmov_fpu_indgen),
+    FPU_RESOLVER_ENTRY(fmov_fpu_inddecgen),
+    FPU_RESOLVER_ENTRY(fmov_fpu_binind_r0_gen),
+    FPU_RESOLVER_ENTRY(fabs_fpu),
+    FPU_RESOLVER_ENTRY(fadd_fpu),
+    FPU_RESOLVER_ENTRY(fcmpeq_fpu),
+    FPU_RESOLVER_ENTRY(fcmpgt_fpu),
+    FPU_RESOLVER_ENTRY(fdiv_fpu),
+    FPU_RESOLVER_ENTRY(float_fpu),
+    FPU_RESOLVER_ENTRY(fmac_fpu),
+    FPU_RESOLVER_ENTRY(fmul_fpu),
+    FPU_RESOLVER_ENTRY(fneg_fpu),
+    FPU_RESOLVER_ENTRY(fsqrt_fpu),
+    FPU_RESOLVER_ENTRY(fsub_fpu),
+    FPU_RESOLVER_ENTRY(ftrc_fpu),
+    FPU_RESOLVER_ENTRY(fcnvds_fpu),
+    FPU_RESOLVER_ENTRY(fcnvsd_fpu),
+    FPU_RESOLVER_ENTRY(fsca_fpu),
+    FPU_RESOLVER_ENTRY(fsrra_fpu),
+
+    { NULL, NULL }
+};
+
+/*
+ * this only has to be big enough to hold every distinct (opcode, handler)
+ * pair.  At the time of writing there are about 60 of those.
+ */
+#define SH4_INST_MAX_FPU_MODE_OPS 128
+
+static InstOpcode fpu_mode_ops[SH4_INST_MAX_FPU_MODE_OPS];
+static InstOpcode const *fpu_mode_op_bases[SH4_INST_MAX_FPU_MODE_OPS];
+static unsigned n_fpu_mode_ops;
+
+// returns the copy of base that uses func as its handler
+static InstOpcode const *
+sh4_inst_fpu_mode_op(InstOpcode const *base, opcode_func_t func) {
+    unsigned idx;
+
+    for (idx = 0; idx < n_fpu_mode_ops; idx++) {
+        if (fpu_mode_op_bases[idx] == base && fpu_mode_ops[idx].func == func)
+            return fpu_mode_ops + idx;
+    }
+
+    if (n_fpu_mode_ops >= SH4_INST_MAX_FPU_MODE_OPS)
+        RAISE_ERROR(ERROR_INTEGRITY);
+
+    fpu_mode_ops[idx] = *base;
+    fpu_mode_ops[idx].func = func;
+#ifdef ENABLE_SH4_THREADED_DISPATCH
+    fpu_mode_ops[idx].dispatch_idx = invalid_opcode.dispatch_idx + 1;
+#endif
+    fpu_mode_op_bases[idx] = base;
+    n_fpu_mode_ops++;
+
+    return fpu_mode_ops + idx;
+}
+
+static void sh4_inst_init_fpu_mode_luts(void) {
+    unsigned inst, mode;
+
+    n_fpu_mode_ops = 0;
+
+    for (inst = 0; inst < (1 << 16); inst++) {
+        InstOpcode const *op = sh4_inst_lut[inst];
+        struct sh4_fpu_resolver const *res = fpu_resolvers;
+
+        while (res->handler && res->handler != op->func)
+            res++;
+
+        for (mode = 0; mode < SH4_INST_N_FPU_MODES; mode++) {
+            if (res->handler) {
+                // this is the inverse of sh4_inst_fpu_mode
+                reg32_t fpscr = ((mode & 2) ? SH4_FPSCR_PR_MASK : 0) |
+                    ((mode & 1) ? SH4_FPSCR_SZ_MASK : 0);
+                sh4_inst_fpu_mode_lut[mode][inst] =
+                    sh4_inst_fpu_mode_op(op, res->resolve(fpscr, inst));
+            } else {
+                sh4_inst_fpu_mode_lut[mode][inst] = op;
+            }
+        }
+    }
+}
+
+#ifdef ENABLE_SH4_SPECIALIZED_HANDLERS
+
+/*
+ * Operand-specialized handlers.  sh4_inst_specialized.h gets generated at
+ * build time by tool/sh4_inst_gen, and it contains a wrapper for every
+ * register combination of a handful of hot opcodes.  Each wrapper calls the
+ * real handler with a constant instruction, so after inlining there's no
+ * Sh4OpArgs decoding left in them.
+ */
+
+struct sh4_inst_specialization {
+    inst_t inst;
+    opcode_func_t func;
+};
+
+#include "sh4_inst_specialized.h"
+
+static InstOpcode specialized_ops[SH4_INST_N_SPECIALIZATIONS];
+
+static void sh4_inst_install_specializations(void) {
+    unsigned idx;
+
+    for (idx = 0; idx < SH4_INST_N_SPECIALIZATIONS; idx++) {
+        struct sh4_inst_specialization const *spec =
+            sh4_inst_specializations + idx;
+
+        // everything except for the handler is the same as the generic opcode
+        specialized_ops[idx] = *sh4_inst_lut[spec->inst];
+        specialized_ops[idx].func = spec->func;
+#ifdef ENABLE_SH4_THREADED_DISPATCH
+        /*
+         * the threaded dispatcher only has labels for the generic handlers,
+         * so the specialized ones go through a label that calls func.
+         */
+        specialized_ops[idx].dispatch_idx = invalid_opcode.dispatch_idx + 1;
+#endif
+
+        sh4_inst_lut[spec->inst] = specialized_ops + idx;
+    }
+}
+
+#endif
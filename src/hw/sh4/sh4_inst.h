@@ -28,6 +28,7 @@
 #include <stdbool.h>
 
 #include "types.h"
+#include "sh4_reg_flags.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -244,6 +245,18 @@ struct InstOpcode {
     // by anding with mask and checking for equality with val
     inst_t mask;
     inst_t val;
+
+#ifdef ENABLE_SH4_THREADED_DISPATCH
+    /*
+     * index into the threaded interpreter's table of labels.  This is just
+     * the opcode's position in sh4_inst_list.h; the invalid opcode goes at
+     * the end, followed by one label that just calls through func.  That last
+     * one is for the copies of InstOpcodes that point at some other handler:
+     * the operand-specialized handlers (see ENABLE_SH4_SPECIALIZED_HANDLERS)
+     * and the entries in sh4_inst_fpu_mode_lut.
+     */
+    unsigned dispatch_idx;
+#endif
 };
 
 typedef struct InstOpcode InstOpcode;
@@ -254,6 +267,49 @@ typedef struct InstOpcode InstOpcode;
  */
 extern InstOpcode const *sh4_inst_lut[1 << 16];
 
+/*
+ * FPU-mode-specific copies of sh4_inst_lut, one for each combination of
+ * FPSCR.PR and FPSCR.SZ.  In these, the FPU opcodes whose behavior depends on
+ * those two bits point straight at the handler for that mode instead of at a
+ * DEF_FPU_HANDLER that has to check FPSCR every time it runs.
+ *
+ * sh4_set_fpscr keeps sh4->inst_lut pointed at the one that matches the
+ * current FPSCR, and that's what the interpreter decodes with.  Anything that
+ * holds onto decoded instructions (the JIT, the IR and the cached
+ * interpreter) has to keep using sh4_inst_lut instead, since the FPU mode can
+ * change out from under a block that's already been translated.
+ */
+#define SH4_INST_N_FPU_MODES 4
+
+extern InstOpcode const *sh4_inst_fpu_mode_lut[SH4_INST_N_FPU_MODES][1 << 16];
+
+static inline unsigned sh4_inst_fpu_mode(reg32_t fpscr) {
+    return ((fpscr & SH4_FPSCR_PR_MASK) ? 2 : 0) |
+        ((fpscr & SH4_FPSCR_SZ_MASK) ? 1 : 0);
+}
+
+/*
+ * cycle accounting for one instruction when instructions are being counted
+ * ahead of time (ie by anything that translates whole blocks at once).  This
+ * is the same dual-issue rule that sh4_run_cycles uses: an instruction is
+ * free if the one before it was not free and the two can go down separate
+ * pipelines.  *prev_group should start out as SH4_GROUP_NONE.
+ */
+static inline unsigned
+sh4_inst_dual_issue_cycles(InstOpcode const *op, sh4_inst_group_t *prev_group) {
+    sh4_inst_group_t prev = *prev_group;
+
+    if (prev != SH4_GROUP_NONE && prev != SH4_GROUP_CO &&
+        op->group != SH4_GROUP_CO &&
+        (prev != op->group || prev == SH4_GROUP_MT)) {
+        *prev_group = SH4_GROUP_NONE;
+        return 0;
+    }
+
+    *prev_group = op->group;
+    return op->issue;
+}
+
 void sh4_do_exec_inst(Sh4 *sh4, inst_t inst, InstOpcode const *op);
 
 void sh4_compile_instructions(Sh4 *sh4);
@@ -1221,7 +1277,21 @@ void sh4_inst_invalid(Sh4 *sh4, Sh4OpArgs inst);
 
 #define DECL_FPU_HANDLER(name) void FPU_HANDLER(name) (Sh4 *sh4, Sh4OpArgs inst)
 
+/*
+ * Every FPU handler also gets a resolver, which returns the handler that the
+ * FPU handler would end up calling for a given FPSCR and instruction.
+ * sh4_init_inst_lut uses these to fill in sh4_inst_fpu_mode_lut.
+ */
+#define FPU_RESOLVER(name) sh4_fpu_resolve_ ## name
+
+#define DECL_FPU_RESOLVER(name)                                         \
+    static opcode_func_t FPU_RESOLVER(name)(reg32_t fpscr, inst_t inst)
+
 #define DEF_FPU_HANDLER(name, mask, on_false, on_true) \
+    DECL_FPU_RESOLVER(name) {                          \
+        (void)inst;                                    \
+        return (fpscr & (mask)) ? on_true : on_false;  \
+    }                                                  \
     DECL_FPU_HANDLER(name) {                           \
         if (sh4->reg[SH4_REG_FPSCR] & (mask)) {        \
             on_true(sh4, inst);                        \
@@ -1230,8 +1300,16 @@ void sh4_inst_invalid(Sh4 *sh4, Sh4OpArgs inst);
         }                                              \
     }
 
-#define DEF_FPU_HANDLER_CUSTOM(name)            \
-    DECL_FPU_HANDLER(name)
+/*
+ * for DEF_FPU_HANDLER_CUSTOM, the body that follows is the resolver, and the
+ * handler just calls whatever it returns.
+ */
+#define DEF_FPU_HANDLER_CUSTOM(name)                                    \
+    DECL_FPU_RESOLVER(name);                                            \
+    DECL_FPU_HANDLER(name) {                                            \
+        FPU_RESOLVER(name)(sh4->reg[SH4_REG_FPSCR], inst.inst)(sh4, inst); \
+    }                                                                   \
+    DECL_FPU_RESOLVER(name)
 
 // these handlers have no specified behavior for when the PR bit is set
 
@@ -0,0 +1,1295 @@
+/*******************************************************************************
+ *
+ *
+ *    WashingtonDC Dreamcast Emulator
+ *    Copyright (C) 2017 snickerbockers
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sh4.h"
+#include "sh4_mem.h"
+#include "error.h"
+#include "mem_code.h"
+#include "mem_areas.h"
+#include "MemoryMap.h"
+#include "dreamcast.h"
+
+#include "sh4_ir.h"
+
+/*******************************************************************************
+ *
+ * lowering
+ *
+ ******************************************************************************/
+
+struct ir_builder {
+    struct sh4_ir_op ops[SH4_IR_MAX_OPS];
+    unsigned n_ops;
+};
+
+static struct sh4_ir_op *ir_emit(struct ir_builder *bld, enum sh4_ir_opcode opcode,
+                                 addr32_t pc, unsigned cycles) {
+    struct sh4_ir_op *op = bld->ops + bld->n_ops++;
+
+    memset(op, 0, sizeof(*op));
+    op->opcode = opcode;
+    op->dst = op->src[0] = op->src[1] = SH4_IR_NO_REG;
+    op->pc = pc;
+    op->cycles = cycles;
+
+    return op;
+}
+
+static void ir_emit_alu(struct ir_builder *bld, enum sh4_ir_opcode opcode,
+                        addr32_t pc, unsigned cycles, unsigned dst,
+                        unsigned src0, unsigned src1, uint32_t imm) {
+    struct sh4_ir_op *op = ir_emit(bld, opcode, pc, cycles);
+    op->dst = dst;
+    op->src[0] = src0;
+    op->src[1] = src1;
+    op->imm = imm;
+}
+
+/*
+ * try to lower the given instruction into IR.  Only instructions that touch
+ * nothing but the general-purpose registers, the T flag and 32-bit memory
+ * are candidates for this.
+ *
+ * returns false if the instruction needs to go through SH4_IR_FALLBACK.
+ */
+static bool ir_lower_inst(struct ir_builder *bld, inst_t inst,
+                          addr32_t pc, unsigned cycles) {
+    unsigned rn = (inst >> 8) & 0xf;
+    unsigned rm = (inst >> 4) & 0xf;
+    uint32_t simm8 = (uint32_t)(int32_t)(int8_t)(inst & 0xff);
+    uint32_t uimm8 = inst & 0xff;
+    struct sh4_ir_op *op;
+
+    switch (inst) {
+    case 0x0009:
+        // NOP
+        return true;
+    case 0x0008:
+        // CLRT
+        ir_emit(bld, SH4_IR_SETT, pc, cycles)->imm = 0;
+        return true;
+    case 0x0018:
+        // SETT
+        ir_emit(bld, SH4_IR_SETT, pc, cycles)->imm = 1;
+        return true;
+    }
+
+    switch (inst & 0xf000) {
+    case 0xe000:
+        // MOV #imm, Rn
+        op = ir_emit(bld, SH4_IR_MOV_IMM, pc, cycles);
+        op->dst = rn;
+        op->imm = simm8;
+        return true;
+    case 0x7000:
+        // ADD #imm, Rn
+        ir_emit_alu(bld, SH4_IR_ADD, pc, cycles, rn, rn, SH4_IR_NO_REG, simm8);
+        return true;
+    case 0xd000:
+        // MOV.L @(disp, PC), Rn
+        op = ir_emit(bld, SH4_IR_LOAD32, pc, cycles);
+        op->dst = rn;
+        op->imm = (uimm8 << 2) + (pc & ~3) + 4;
+        return true;
+    case 0x5000:
+        // MOV.L @(disp, Rm), Rn
+        op = ir_emit(bld, SH4_IR_LOAD32, pc, cycles);
+        op->dst = rn;
+        op->src[0] = rm;
+        op->imm = (inst & 0xf) << 2;
+        return true;
+    case 0x1000:
+        // MOV.L Rm, @(disp, Rn)
+        op = ir_emit(bld, SH4_IR_STORE32, pc, cycles);
+        op->src[0] = rn;
+        op->src[1] = rm;
+        op->imm = (inst & 0xf) << 2;
+        return true;
+    }
+
+    switch (inst & 0xff00) {
+    case 0x8800:
+        // CMP/EQ #imm, R0
+        op = ir_emit(bld, SH4_IR_CMP, pc, cycles);
+        op->cond = SH4_IR_COND_EQ;
+        op->src[0] = 0;
+        op->imm = simm8;
+        return true;
+    case 0xc800:
+        // TST #imm, R0
+        op = ir_emit(bld, SH4_IR_TST, pc, cycles);
+        op->src[0] = 0;
+        op->imm = uimm8;
+        return true;
+    case 0xc900:
+        // AND #imm, R0
+        ir_emit_alu(bld, SH4_IR_AND, pc, cycles, 0, 0, SH4_IR_NO_REG, uimm8);
+        return true;
+    case 0xca00:
+        // XOR #imm, R0
+        ir_emit_alu(bld, SH4_IR_XOR, pc, cycles, 0, 0, SH4_IR_NO_REG, uimm8);
+        return true;
+    case 0xcb00:
+        // OR #imm, R0
+        ir_emit_alu(bld, SH4_IR_OR, pc, cycles, 0, 0, SH4_IR_NO_REG, uimm8);
+        return true;
+    }
+
+    switch (inst & 0xf00f) {
+    case 0x6003:
+        // MOV Rm, Rn
+        op = ir_emit(bld, SH4_IR_MOV, pc, cycles);
+        op->dst = rn;
+        op->src[0] = rm;
+        return true;
+    case 0x6007:
+    case 0x600c:
+    case 0x600d:
+    case 0x600e:
+    case 0x600f:
+        // NOT, EXTU.B, EXTU.W, EXTS.B, EXTS.W Rm, Rn
+        op = ir_emit(bld, SH4_IR_NOT, pc, cycles);
+        switch (inst & 0xf) {
+        case 0xc:
+            op->opcode = SH4_IR_EXTU_B;
+            break;
+        case 0xd:
+            op->opcode = SH4_IR_EXTU_W;
+            break;
+        case 0xe:
+            op->opcode = SH4_IR_EXTS_B;
+            break;
+        case 0xf:
+            op->opcode = SH4_IR_EXTS_W;
+            break;
+        }
+        op->dst = rn;
+        op->src[0] = rm;
+        return true;
+    case 0x6002:
+        // MOV.L @Rm, Rn
+        op = ir_emit(bld, SH4_IR_LOAD32, pc, cycles);
+        op->dst = rn;
+        op->src[0] = rm;
+        return true;
+    case 0x2002:
+        // MOV.L Rm, @Rn
+        op = ir_emit(bld, SH4_IR_STORE32, pc, cycles);
+        op->src[0] = rn;
+        op->src[1] = rm;
+        return true;
+    case 0x300c:
+        // ADD Rm, Rn
+        ir_emit_alu(bld, SH4_IR_ADD, pc, cycles, rn, rn, rm, 0);
+        return true;
+    case 0x2009:
+        // AND Rm, Rn
+        ir_emit_alu(bld, SH4_IR_AND, pc, cycles, rn, rn, rm, 0);
+        return true;
+    case 0x200b:
+        // OR Rm, Rn
+        ir_emit_alu(bld, SH4_IR_OR, pc, cycles, rn, rn, rm, 0);
+        return true;
+    case 0x200a:
+        // XOR Rm, Rn
+        ir_emit_alu(bld, SH4_IR_XOR, pc, cycles, rn, rn, rm, 0);
+        return true;
+    case 0x2008:
+        // TST Rm, Rn
+        op = ir_emit(bld, SH4_IR_TST, pc, cycles);
+        op->src[0] = rn;
+        op->src[1] = rm;
+        return true;
+    case 0x3000:
+    case 0x3002:
+    case 0x3003:
+    case 0x3006:
+    case 0x3007:
+        // CMP/EQ, CMP/HS, CMP/GE, CMP/HI, CMP/GT Rm, Rn
+        op = ir_emit(bld, SH4_IR_CMP, pc, cycles);
+        switch (inst & 0xf) {
+        case 0x0:
+            op->cond = SH4_IR_COND_EQ;
+            break;
+        case 0x2:
+            op->cond = SH4_IR_COND_HS;
+            break;
+        case 0x3:
+            op->cond = SH4_IR_COND_GE;
+            break;
+        case 0x6:
+            op->cond = SH4_IR_COND_HI;
+            break;
+        case 0x7:
+            op->cond = SH4_IR_COND_GT;
+            break;
+        }
+        op->src[0] = rn;
+        op->src[1] = rm;
+        return true;
+    }
+
+    switch (inst & 0xf0ff) {
+    case 0x4000:
+        // SHLL Rn
+        op = ir_emit(bld, SH4_IR_SHLL, pc, cycles);
+        op->dst = op->src[0] = rn;
+        return true;
+    case 0x4001:
+        // SHLR Rn
+        op = ir_emit(bld, SH4_IR_SHLR, pc, cycles);
+        op->dst = op->src[0] = rn;
+        return true;
+    case 0x4010:
+        // DT Rn
+        op = ir_emit(bld, SH4_IR_DT, pc, cycles);
+        op->dst = op->src[0] = rn;
+        return true;
+    }
+
+    unsigned shift_amount;
+    bool shift_right;
+    if (sh4_code_decode_shift(inst, &rn, &shift_amount, &shift_right)) {
+        ir_emit_alu(bld, shift_right ? SH4_IR_SHR : SH4_IR_SHL, pc, cycles,
+                    rn, rn, SH4_IR_NO_REG, shift_amount);
+        return true;
+    }
+
+    return false;
+}
+
+struct sh4_ir_block *sh4_ir_lower_block(addr32_t pc) {
+    struct ir_builder bld;
+    struct sh4_code_walk walk;
+    unsigned inst_no;
+
+    if (!sh4_code_walk_block(&walk, pc))
+        return NULL;
+
+    bld.n_ops = 0;
+
+    for (inst_no = 0; inst_no < walk.n_insts; inst_no++) {
+        struct sh4_code_inst const *ent = walk.insts + inst_no;
+        addr32_t cur_pc = pc + 2 * inst_no;
+
+        // the instruction that ends the block sets the PC on its own
+        if ((walk.ends_on_branch && inst_no == walk.n_insts - 1) ||
+            !ir_lower_inst(&bld, ent->inst, cur_pc, ent->cycles)) {
+            struct sh4_ir_op *fallback =
+                ir_emit(&bld, SH4_IR_FALLBACK, cur_pc, ent->cycles);
+            fallback->inst = ent->inst;
+            fallback->inst_op = ent->op;
+        }
+    }
+
+    // if the block ends in a delayed branch, the slot comes along for the ride
+    if (walk.has_slot) {
+        struct sh4_ir_op *slot = ir_emit(&bld, SH4_IR_SLOT,
+                                         pc + 2 * walk.n_insts,
+                                         walk.slot.cycles);
+        slot->inst = walk.slot.inst;
+        slot->inst_op = walk.slot.op;
+    }
+
+    struct sh4_ir_block *blk = (struct sh4_ir_block*)
+        malloc(sizeof(struct sh4_ir_block) +
+               bld.n_ops * sizeof(struct sh4_ir_op));
+    if (!blk)
+        RAISE_ERROR(ERROR_FAILED_ALLOC);
+
+    memset(blk, 0, sizeof(*blk));
+    blk->hdr.pc = pc;
+    blk->hdr.cycle_count = sh4_code_walk_cycles(&walk);
+    blk->cycle_count_no_slot = walk.insts[walk.n_insts - 1].cycles;
+    blk->end_pc = pc + 2 * walk.n_insts;
+    blk->end_pc_valid = !walk.ends_on_branch;
+    blk->n_insts = walk.n_insts + (walk.has_slot ? 1 : 0);
+    blk->n_ops = bld.n_ops;
+    memcpy(blk->ops, bld.ops, bld.n_ops * sizeof(struct sh4_ir_op));
+
+    return blk;
+}
+
+/*******************************************************************************
+ *
+ * optimization passes
+ *
+ ******************************************************************************/
+
+// returns true if op might end the block early
+static bool ir_op_can_exit(struct sh4_ir_op const *op) {
+    switch (op->opcode) {
+    case SH4_IR_LOAD32:
+    case SH4_IR_LOAD32_FWD:
+    case SH4_IR_STORE32:
+    case SH4_IR_FALLBACK:
+    case SH4_IR_SLOT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// returns true if the only thing op does is write to op->dst
+static bool ir_op_is_pure(struct sh4_ir_op const *op) {
+    switch (op->opcode) {
+    case SH4_IR_MOV_IMM:
+    case SH4_IR_MOV:
+    case SH4_IR_ADD:
+    case SH4_IR_AND:
+    case SH4_IR_OR:
+    case SH4_IR_XOR:
+    case SH4_IR_SHL:
+    case SH4_IR_SHR:
+    case SH4_IR_NOT:
+    case SH4_IR_EXTU_B:
+    case SH4_IR_EXTU_W:
+    case SH4_IR_EXTS_B:
+    case SH4_IR_EXTS_W:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static uint32_t ir_eval_alu(enum sh4_ir_opcode opcode,
+                            uint32_t lhs, uint32_t rhs) {
+    switch (opcode) {
+    case SH4_IR_ADD:
+        return lhs + rhs;
+    case SH4_IR_AND:
+        return lhs & rhs;
+    case SH4_IR_OR:
+        return lhs | rhs;
+    case SH4_IR_XOR:
+        return lhs ^ rhs;
+    case SH4_IR_SHL:
+        return lhs << rhs;
+    case SH4_IR_SHR:
+        return lhs >> rhs;
+    case SH4_IR_NOT:
+        return ~lhs;
+    case SH4_IR_EXTU_B:
+        return lhs & 0xff;
+    case SH4_IR_EXTU_W:
+        return lhs & 0xffff;
+    case SH4_IR_EXTS_B:
+        return (uint32_t)(int32_t)(int8_t)lhs;
+    case SH4_IR_EXTS_W:
+        return (uint32_t)(int32_t)(int16_t)lhs;
+    default:
+        RAISE_ERROR(ERROR_INTEGRITY);
+    }
+}
+
+static bool ir_eval_cmp(enum sh4_ir_cond cond, uint32_t lhs, uint32_t rhs) {
+    switch (cond) {
+    case SH4_IR_COND_EQ:
+        return lhs == rhs;
+    case SH4_IR_COND_HS:
+        return lhs >= rhs;
+    case SH4_IR_COND_GE:
+        return (int32_t)lhs >= (int32_t)rhs;
+    case SH4_IR_COND_HI:
+        return lhs > rhs;
+    case SH4_IR_COND_GT:
+        return (int32_t)lhs > (int32_t)rhs;
+    default:
+        RAISE_ERROR(ERROR_INTEGRITY);
+    }
+}
+
+/*
+ * returns true if addr is somewhere in system RAM, and accessing it won't go
+ * through the MMU or anything else that could have side-effects.
+ */
+static inline bool ir_addr_is_ram(addr32_t addr, unsigned len) {
+    addr32_t paddr = addr & 0x1fffffff;
+    return addr < SH4_AREA_P4_FIRST && paddr >= ADDR_AREA3_FIRST &&
+        paddr <= ADDR_AREA3_LAST - (len - 1);
+}
+
+/*
+ * Turn 32-bit loads from constant addresses into constants when we know the
+ * value can't change before the load happens.  That's true for the boot ROM,
+ * which can't be written to at all, and it's true for the system RAM pages
+ * that the block was read from, since writing to those would invalidate the
+ * block.  The latter only holds up until the block's first store or fallback
+ * though, since those could write to the block's own pages.
+ *
+ * This is mostly useful for MOV.L @(disp, PC), Rn, which is how the SH4 loads
+ * 32-bit constants.
+ */
+void sh4_ir_pass_fold_literals(struct sh4_ir_block *blk) {
+    addr32_t pc_first = blk->hdr.pc & 0x1fffffff;
+    addr32_t pc_last = (blk->hdr.pc + 2 * blk->n_insts - 1) & 0x1fffffff;
+    bool may_have_written = false;
+    unsigned op_no;
+    int page_first = -1, page_last = -1;
+
+    if (ir_addr_is_ram(blk->hdr.pc, 2)) {
+        page_first = (pc_first & ADDR_AREA3_MASK) >> SH4_CODE_PAGE_SHIFT;
+        page_last = (pc_last & ADDR_AREA3_MASK) >> SH4_CODE_PAGE_SHIFT;
+    }
+
+    for (op_no = 0; op_no < blk->n_ops; op_no++) {
+        struct sh4_ir_op *op = blk->ops + op_no;
+
+        if (op->opcode == SH4_IR_STORE32 || op->opcode == SH4_IR_FALLBACK ||
+            op->opcode == SH4_IR_SLOT) {
+            may_have_written = true;
+            continue;
+        }
+
+        if (op->opcode != SH4_IR_LOAD32 || op->src[0] != SH4_IR_NO_REG ||
+            (op->imm & 3) || op->imm >= SH4_AREA_P4_FIRST)
+            continue;
+
+        addr32_t paddr = op->imm & 0x1fffffff;
+        bool foldable = false;
+
+        if (paddr >= ADDR_BIOS_FIRST && paddr <= ADDR_BIOS_LAST - 3) {
+            foldable = true;
+        } else if (!may_have_written && page_first >= 0 &&
+                   ir_addr_is_ram(op->imm, 4)) {
+            int page = (paddr & ADDR_AREA3_MASK) >> SH4_CODE_PAGE_SHIFT;
+            foldable = (page == page_first || page == page_last);
+        }
+
+        uint32_t val;
+        if (foldable &&
+            memory_map_read(&val, paddr, sizeof(val)) == MEM_ACCESS_SUCCESS) {
+            op->opcode = SH4_IR_MOV_IMM;
+            op->src[0] = SH4_IR_NO_REG;
+            op->imm = val;
+        }
+    }
+}
+
+/*
+ * Remove T flag writes that get overwritten before anything can read them.
+ * T is live at the end of the block and at every op that can exit (since the
+ * CPU state has to be exact when an exception happens), and fallbacks can
+ * read it.  T-writing ops that also write a register get turned into their
+ * flag-less equivalents.
+ */
+void sh4_ir_pass_dead_t(struct sh4_ir_block *blk) {
+    bool t_live = true;
+    unsigned op_no;
+
+    for (op_no = blk->n_ops; op_no > 0; op_no--) {
+        struct sh4_ir_op *op = blk->ops + op_no - 1;
+
+        if (ir_op_can_exit(op)) {
+            t_live = true;
+            continue;
+        }
+
+        switch (op->opcode) {
+        case SH4_IR_CMP:
+        case SH4_IR_TST:
+        case SH4_IR_SETT:
+            if (!t_live)
+                op->opcode = SH4_IR_NOP;
+            t_live = false;
+            break;
+        case SH4_IR_SHLL:
+        case SH4_IR_SHLR:
+            if (!t_live) {
+                op->opcode = (op->opcode == SH4_IR_SHLL) ?
+                    SH4_IR_SHL : SH4_IR_SHR;
+                op->src[1] = SH4_IR_NO_REG;
+                op->imm = 1;
+            }
+            t_live = false;
+            break;
+        case SH4_IR_DT:
+            if (!t_live) {
+                op->opcode = SH4_IR_ADD;
+                op->src[1] = SH4_IR_NO_REG;
+                op->imm = (uint32_t)-1;
+            }
+            t_live = false;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+/*
+ * Track which registers hold known constants and fold them into the ops that
+ * use them.  Fallbacks are barriers since they can write to anything.  This is
+ * also what turns chains like MOV #1, R0 ; SHLL8 R0 ; SHLL2 R0 into a single
+ * constant (the dead intermediate values get cleaned up by
+ * sh4_ir_pass_dead_regs).
+ */
+void sh4_ir_pass_const_prop(struct sh4_ir_block *blk) {
+    bool known[16] = { false };
+    uint32_t val[16];
+    unsigned op_no, reg_no;
+
+    for (op_no = 0; op_no < blk->n_ops; op_no++) {
+        struct sh4_ir_op *op = blk->ops + op_no;
+        unsigned src0 = op->src[0], src1 = op->src[1];
+
+        switch (op->opcode) {
+        case SH4_IR_MOV_IMM:
+            known[op->dst] = true;
+            val[op->dst] = op->imm;
+            break;
+        case SH4_IR_ADD:
+        case SH4_IR_AND:
+        case SH4_IR_OR:
+        case SH4_IR_XOR:
+            /*
+             * these are all commutative, so if the only known operand is on
+             * the left then swap it over to the right where it can be an
+             * immediate.
+             */
+            if (src1 != SH4_IR_NO_REG && !known[src1] && known[src0]) {
+                op->src[0] = src1;
+                op->src[1] = src0;
+                src0 = op->src[0];
+                src1 = op->src[1];
+            }
+            // fall-through
+        case SH4_IR_SHL:
+        case SH4_IR_SHR:
+            if (src1 != SH4_IR_NO_REG && known[src1]) {
+                op->imm = val[src1];
+                op->src[1] = src1 = SH4_IR_NO_REG;
+            }
+            // fall-through
+        case SH4_IR_MOV:
+        case SH4_IR_NOT:
+        case SH4_IR_EXTU_B:
+        case SH4_IR_EXTU_W:
+        case SH4_IR_EXTS_B:
+        case SH4_IR_EXTS_W:
+            if (known[src0] && src1 == SH4_IR_NO_REG) {
+                op->imm = (op->opcode == SH4_IR_MOV) ? val[src0] :
+                    ir_eval_alu(op->opcode, val[src0], op->imm);
+                op->opcode = SH4_IR_MOV_IMM;
+                op->src[0] = SH4_IR_NO_REG;
+                known[op->dst] = true;
+                val[op->dst] = op->imm;
+            } else {
+                known[op->dst] = false;
+            }
+            break;
+        case SH4_IR_CMP:
+        case SH4_IR_TST:
+            if (src1 != SH4_IR_NO_REG && known[src1]) {
+                op->imm = val[src1];
+                op->src[1] = src1 = SH4_IR_NO_REG;
+            }
+            if (known[src0] && src1 == SH4_IR_NO_REG) {
+                if (op->opcode == SH4_IR_CMP)
+                    op->imm = ir_eval_cmp(op->cond, val[src0], op->imm);
+                else
+                    op->imm = !(val[src0] & op->imm);
+                op->opcode = SH4_IR_SETT;
+                op->src[0] = SH4_IR_NO_REG;
+            }
+            break;
+        case SH4_IR_SHLL:
+        case SH4_IR_SHLR:
+        case SH4_IR_DT:
+            /*
+             * these have to stay around for the sake of the T flag, but the
+             * register they write is still known.
+             */
+            if (known[src0]) {
+                if (op->opcode == SH4_IR_SHLL)
+                    val[op->dst] = val[src0] << 1;
+                else if (op->opcode == SH4_IR_SHLR)
+                    val[op->dst] = val[src0] >> 1;
+                else
+                    val[op->dst] = val[src0] - 1;
+                known[op->dst] = true;
+            } else {
+                known[op->dst] = false;
+            }
+            break;
+        case SH4_IR_LOAD32:
+        case SH4_IR_LOAD32_FWD:
+            if (src0 != SH4_IR_NO_REG && known[src0]) {
+                op->imm += val[src0];
+                op->src[0] = SH4_IR_NO_REG;
+            }
+            known[op->dst] = false;
+            break;
+        case SH4_IR_STORE32:
+            if (src0 != SH4_IR_NO_REG && known[src0]) {
+                op->imm += val[src0];
+                op->src[0] = SH4_IR_NO_REG;
+            }
+            break;
+        case SH4_IR_FALLBACK:
+        case SH4_IR_SLOT:
+            for (reg_no = 0; reg_no < 16; reg_no++)
+                known[reg_no] = false;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+struct ir_mem_fwd {
+    unsigned base;  // SH4_IR_NO_REG for absolute addresses
+    uint32_t disp;
+    unsigned val_reg;
+};
+
+static void ir_fwd_kill_reg(struct ir_mem_fwd *fwd, unsigned *n_fwd,
+                            unsigned reg_no) {
+    unsigned idx = 0;
+
+    while (idx < *n_fwd) {
+        if (fwd[idx].base == reg_no || fwd[idx].val_reg == reg_no)
+            fwd[idx] = fwd[--*n_fwd];
+        else
+            idx++;
+    }
+}
+
+/*
+ * Forward values from stores (and earlier loads) to later loads from the same
+ * address.  Any store kills everything we know about memory since it might
+ * alias, and fallbacks kill everything because they can do whatever they
+ * want.  The loads become SH4_IR_LOAD32_FWD, which still checks at runtime
+ * that the address is in RAM.
+ */
+void sh4_ir_pass_forward_mem(struct sh4_ir_block *blk) {
+    struct ir_mem_fwd fwd[16];
+    unsigned n_fwd = 0;
+    unsigned op_no, idx, base;
+    uint32_t disp;
+
+    for (op_no = 0; op_no < blk->n_ops; op_no++) {
+        struct sh4_ir_op *op = blk->ops + op_no;
+
+        switch (op->opcode) {
+        case SH4_IR_STORE32:
+            n_fwd = 0;
+            fwd[n_fwd].base = op->src[0];
+            fwd[n_fwd].disp = op->imm;
+            fwd[n_fwd].val_reg = op->src[1];
+            n_fwd++;
+            break;
+        case SH4_IR_LOAD32:
+            base = op->src[0];
+            disp = op->imm;
+
+            for (idx = 0; idx < n_fwd; idx++) {
+                if (fwd[idx].base == base && fwd[idx].disp == disp) {
+                    if (base == SH4_IR_NO_REG && ir_addr_is_ram(disp, 4)) {
+                        // no need for the runtime check
+                        op->opcode = SH4_IR_MOV;
+                        op->src[0] = fwd[idx].val_reg;
+                    } else {
+                        op->opcode = SH4_IR_LOAD32_FWD;
+                        op->src[1] = fwd[idx].val_reg;
+                    }
+                    break;
+                }
+            }
+
+            ir_fwd_kill_reg(fwd, &n_fwd, op->dst);
+
+            if (op->dst != base && n_fwd < sizeof(fwd) / sizeof(fwd[0])) {
+                fwd[n_fwd].base = base;
+                fwd[n_fwd].disp = disp;
+                fwd[n_fwd].val_reg = op->dst;
+                n_fwd++;
+            }
+            break;
+        case SH4_IR_FALLBACK:
+        case SH4_IR_SLOT:
+            n_fwd = 0;
+            break;
+        default:
+            if (op->dst != SH4_IR_NO_REG)
+                ir_fwd_kill_reg(fwd, &n_fwd, op->dst);
+            break;
+        }
+    }
+}
+
+/*
+ * Remove register writes that get overwritten before anything can read them.
+ * Every register is live at the end of the block and at every op that can
+ * exit.
+ */
+void sh4_ir_pass_dead_regs(struct sh4_ir_block *blk) {
+    unsigned live = 0xffff;
+    unsigned op_no;
+
+    for (op_no = blk->n_ops; op_no > 0; op_no--) {
+        struct sh4_ir_op *op = blk->ops + op_no - 1;
+        unsigned uses = 0;
+
+        if (op->opcode == SH4_IR_NOP)
+            continue;
+
+        if (op->src[0] != SH4_IR_NO_REG)
+            uses |= 1 << op->src[0];
+        if (op->src[1] != SH4_IR_NO_REG)
+            uses |= 1 << op->src[1];
+
+        if (ir_op_can_exit(op)) {
+            live = 0xffff;
+            continue;
+        }
+
+        if (op->dst != SH4_IR_NO_REG) {
+            if (ir_op_is_pure(op) && !(live & (1 << op->dst))) {
+                op->opcode = SH4_IR_NOP;
+                continue;
+            }
+            live &= ~(1 << op->dst);
+        }
+
+        live |= uses;
+    }
+}
+
+void sh4_ir_compact(struct sh4_ir_block *blk) {
+    unsigned src_idx, dst_idx = 0;
+
+    for (src_idx = 0; src_idx < blk->n_ops; src_idx++) {
+        struct sh4_ir_op *op = blk->ops + src_idx;
+
+        // MOV Rn, Rn doesn't do anything either
+        if (op->opcode == SH4_IR_NOP ||
+            (op->opcode == SH4_IR_MOV && op->dst == op->src[0]))
+            continue;
+
+        if (dst_idx != src_idx)
+            blk->ops[dst_idx] = *op;
+        dst_idx++;
+    }
+
+    blk->n_ops = dst_idx;
+}
+
+void sh4_ir_optimize(struct sh4_ir_block *blk) {
+    sh4_ir_pass_fold_literals(blk);
+    sh4_ir_pass_dead_t(blk);
+    sh4_ir_pass_const_prop(blk);
+
+    /*
+     * constant propagation can make more load addresses constant, and
+     * folding those loads can give constant propagation more to work with.
+     */
+    sh4_ir_pass_fold_literals(blk);
+    sh4_ir_pass_const_prop(blk);
+
+    sh4_ir_pass_forward_mem(blk);
+    sh4_ir_pass_dead_regs(blk);
+    sh4_ir_compact(blk);
+}
+
+/*******************************************************************************
+ *
+ * execution
+ *
+ ******************************************************************************/
+
+static inline void ir_set_t(Sh4 *sh4, bool t) {
+    sh4->reg[SH4_REG_SR] = (sh4->reg[SH4_REG_SR] & ~SH4_SR_FLAG_T_MASK) |
+        ((reg32_t)t << SH4_SR_FLAG_T_SHIFT);
+}
+
+unsigned sh4_ir_exec(Sh4 *sh4, struct sh4_ir_block const *blk) {
+    reg32_t *gen = sh4->reg + SH4_REG_R0;
+    struct sh4_ir_op const *op = blk->ops;
+    struct sh4_ir_op const *end = blk->ops + blk->n_ops;
+    uint32_t rhs, addr, mem_val;
+    Sh4OpArgs oa;
+
+    for (; op < end; op++) {
+        rhs = (op->src[1] == SH4_IR_NO_REG) ? op->imm : gen[op->src[1]];
+
+        switch (op->opcode) {
+        case SH4_IR_NOP:
+            break;
+        case SH4_IR_MOV_IMM:
+            gen[op->dst] = op->imm;
+            break;
+        case SH4_IR_MOV:
+            gen[op->dst] = gen[op->src[0]];
+            break;
+        case SH4_IR_ADD:
+            gen[op->dst] = gen[op->src[0]] + rhs;
+            break;
+        case SH4_IR_AND:
+            gen[op->dst] = gen[op->src[0]] & rhs;
+            break;
+        case SH4_IR_OR:
+            gen[op->dst] = gen[op->src[0]] | rhs;
+            break;
+        case SH4_IR_XOR:
+            gen[op->dst] = gen[op->src[0]] ^ rhs;
+            break;
+        case SH4_IR_SHL:
+            gen[op->dst] = gen[op->src[0]] << rhs;
+            break;
+        case SH4_IR_SHR:
+            gen[op->dst] = gen[op->src[0]] >> rhs;
+            break;
+        case SH4_IR_NOT:
+        case SH4_IR_EXTU_B:
+        case SH4_IR_EXTU_W:
+        case SH4_IR_EXTS_B:
+        case SH4_IR_EXTS_W:
+            gen[op->dst] = ir_eval_alu(op->opcode, gen[op->src[0]], 0);
+            break;
+        case SH4_IR_CMP:
+            ir_set_t(sh4, ir_eval_cmp(op->cond, gen[op->src[0]], rhs));
+            break;
+        case SH4_IR_TST:
+            ir_set_t(sh4, !(gen[op->src[0]] & rhs));
+            break;
+        case SH4_IR_SETT:
+            ir_set_t(sh4, op->imm);
+            break;
+        case SH4_IR_SHLL:
+            mem_val = gen[op->src[0]];
+            gen[op->dst] = mem_val << 1;
+            ir_set_t(sh4, mem_val >> 31);
+            break;
+        case SH4_IR_SHLR:
+            mem_val = gen[op->src[0]];
+            gen[op->dst] = mem_val >> 1;
+            ir_set_t(sh4, mem_val & 1);
+            break;
+        case SH4_IR_DT:
+            gen[op->dst] = gen[op->src[0]] - 1;
+            ir_set_t(sh4, !gen[op->dst]);
+            break;
+        case SH4_IR_LOAD32_FWD:
+            addr = op->imm;
+            if (op->src[0] != SH4_IR_NO_REG)
+                addr += gen[op->src[0]];
+            if (ir_addr_is_ram(addr, 4)) {
+                gen[op->dst] = gen[op->src[1]];
+                break;
+            }
+            // fall-through
+        case SH4_IR_LOAD32:
+            addr = op->imm;
+            if (op->src[0] != SH4_IR_NO_REG)
+                addr += gen[op->src[0]];
+            sh4->reg[SH4_REG_PC] = op->pc;
+            if (sh4_read_mem(sh4, &mem_val, addr, sizeof(mem_val)) != 0)
+                return op->cycles;
+            gen[op->dst] = mem_val;
+            break;
+        case SH4_IR_STORE32:
+            addr = op->imm;
+            if (op->src[0] != SH4_IR_NO_REG)
+                addr += gen[op->src[0]];
+            mem_val = gen[op->src[1]];
+            sh4->reg[SH4_REG_PC] = op->pc;
+            if (sh4_write_mem(sh4, &mem_val, addr, sizeof(mem_val)) != 0)
+                return op->cycles;
+            break;
+        case SH4_IR_FALLBACK:
+            sh4->reg[SH4_REG_PC] = op->pc;
+            oa.inst = op->inst;
+            op->inst_op->func(sh4, oa);
+
+            /*
+             * if the handler didn't leave the PC where we expected it, then
+             * either it was the branch at the end of the block or it raised
+             * an exception.  Either way, we're done.
+             */
+            if (sh4->reg[SH4_REG_PC] != op->pc + 2)
+                return op->cycles;
+            break;
+        case SH4_IR_SLOT:
+            /*
+             * sh4_do_exec_inst takes care of the branch itself, as well as
+             * illegal slot instructions.
+             */
+            if (sh4->delayed_branch) {
+                sh4_do_exec_inst(sh4, op->inst, op->inst_op);
+                return blk->hdr.cycle_count;
+            }
+            return blk->cycle_count_no_slot;
+        default:
+            RAISE_ERROR(ERROR_INTEGRITY);
+        }
+    }
+
+    if (blk->end_pc_valid)
+        sh4->reg[SH4_REG_PC] = blk->end_pc;
+
+    return blk->cycle_count_no_slot;
+}
+
+/*******************************************************************************
+ *
+ * dumping
+ *
+ ******************************************************************************/
+
+static char const *ir_opcode_names[SH4_IR_OPCODE_COUNT] = {
+    [SH4_IR_NOP]         = "nop",
+    [SH4_IR_MOV_IMM]     = "mov_imm",
+    [SH4_IR_MOV]         = "mov",
+    [SH4_IR_ADD]         = "add",
+    [SH4_IR_AND]         = "and",
+    [SH4_IR_OR]          = "or",
+    [SH4_IR_XOR]         = "xor",
+    [SH4_IR_SHL]         = "shl",
+    [SH4_IR_SHR]         = "shr",
+    [SH4_IR_NOT]         = "not",
+    [SH4_IR_EXTU_B]      = "extu.b",
+    [SH4_IR_EXTU_W]      = "extu.w",
+    [SH4_IR_EXTS_B]      = "exts.b",
+    [SH4_IR_EXTS_W]      = "exts.w",
+    [SH4_IR_CMP]         = "cmp",
+    [SH4_IR_TST]         = "tst",
+    [SH4_IR_SETT]        = "sett",
+    [SH4_IR_SHLL]        = "shll",
+    [SH4_IR_SHLR]        = "shlr",
+    [SH4_IR_DT]          = "dt",
+    [SH4_IR_LOAD32]      = "load32",
+    [SH4_IR_STORE32]     = "store32",
+    [SH4_IR_LOAD32_FWD]  = "load32_fwd",
+    [SH4_IR_FALLBACK]    = "fallback",
+    [SH4_IR_SLOT]        = "slot"
+};
+
+static char const *ir_cond_names[SH4_IR_COND_COUNT] = {
+    [SH4_IR_COND_EQ] = "eq",
+    [SH4_IR_COND_HS] = "hs",
+    [SH4_IR_COND_GE] = "ge",
+    [SH4_IR_COND_HI] = "hi",
+    [SH4_IR_COND_GT] = "gt"
+};
+
+static void ir_dump_src(FILE *stream, unsigned reg_no, uint32_t imm) {
+    if (reg_no == SH4_IR_NO_REG)
+        fprintf(stream, "#0x%08x", (unsigned)imm);
+    else
+        fprintf(stream, "r%u", reg_no);
+}
+
+static void ir_dump_op(FILE *stream, struct sh4_ir_op const *op) {
+    fprintf(stream, "    %08x [%3u] %-10s ", (unsigned)op->pc, op->cycles,
+            ir_opcode_names[op->opcode]);
+
+    switch (op->opcode) {
+    case SH4_IR_MOV_IMM:
+        fprintf(stream, "r%u, #0x%08x", op->dst, (unsigned)op->imm);
+        break;
+    case SH4_IR_MOV:
+    case SH4_IR_NOT:
+    case SH4_IR_EXTU_B:
+    case SH4_IR_EXTU_W:
+    case SH4_IR_EXTS_B:
+    case SH4_IR_EXTS_W:
+    case SH4_IR_SHLL:
+    case SH4_IR_SHLR:
+    case SH4_IR_DT:
+        fprintf(stream, "r%u, r%u", op->dst, op->src[0]);
+        break;
+    case SH4_IR_ADD:
+    case SH4_IR_AND:
+    case SH4_IR_OR:
+    case SH4_IR_XOR:
+    case SH4_IR_SHL:
+    case SH4_IR_SHR:
+        fprintf(stream, "r%u, r%u, ", op->dst, op->src[0]);
+        ir_dump_src(stream, op->src[1], op->imm);
+        break;
+    case SH4_IR_CMP:
+        fprintf(stream, "%s r%u, ", ir_cond_names[op->cond], op->src[0]);
+        ir_dump_src(stream, op->src[1], op->imm);
+        break;
+    case SH4_IR_TST:
+        fprintf(stream, "r%u, ", op->src[0]);
+        ir_dump_src(stream, op->src[1], op->imm);
+        break;
+    case SH4_IR_SETT:
+        fprintf(stream, "%u", (unsigned)op->imm);
+        break;
+    case SH4_IR_LOAD32:
+    case SH4_IR_LOAD32_FWD:
+        fprintf(stream, "r%u, [", op->dst);
+        if (op->src[0] != SH4_IR_NO_REG)
+            fprintf(stream, "r%u + ", op->src[0]);
+        fprintf(stream, "0x%08x]", (unsigned)op->imm);
+        if (op->opcode == SH4_IR_LOAD32_FWD)
+            fprintf(stream, " (r%u)", op->src[1]);
+        break;
+    case SH4_IR_STORE32:
+        fprintf(stream, "[");
+        if (op->src[0] != SH4_IR_NO_REG)
+            fprintf(stream, "r%u + ", op->src[0]);
+        fprintf(stream, "0x%08x], r%u", (unsigned)op->imm, op->src[1]);
+        break;
+    case SH4_IR_FALLBACK:
+    case SH4_IR_SLOT:
+        fprintf(stream, "0x%04x (%s)", (unsigned)op->inst, op->inst_op->fmt);
+        break;
+    default:
+        break;
+    }
+
+    fputc('\n', stream);
+}
+
+void sh4_ir_dump_ops(FILE *stream, struct sh4_ir_op const *ops,
+                     unsigned n_ops) {
+    unsigned op_no;
+    for (op_no = 0; op_no < n_ops; op_no++)
+        ir_dump_op(stream, ops + op_no);
+}
+
+void sh4_ir_dump_block(FILE *stream, struct sh4_ir_block const *blk) {
+    fprintf(stream, "block 0x%08x: %u instructions, %u cycles, "
+            "executed %lu times\n", (unsigned)blk->hdr.pc, blk->n_insts,
+            blk->hdr.cycle_count, blk->exec_count);
+
+    if (blk->unopt_ops) {
+        fprintf(stream, "  before optimization (%u ops):\n", blk->n_unopt_ops);
+        sh4_ir_dump_ops(stream, blk->unopt_ops, blk->n_unopt_ops);
+        fprintf(stream, "  after optimization (%u ops):\n", blk->n_ops);
+    }
+    sh4_ir_dump_ops(stream, blk->ops, blk->n_ops);
+
+    if (blk->end_pc_valid)
+        fprintf(stream, "    -> 0x%08x\n", (unsigned)blk->end_pc);
+}
+
+/*******************************************************************************
+ *
+ * IR interpreter
+ *
+ ******************************************************************************/
+
+/*
+ * when there are this many blocks, every block gets thrown away and we start
+ * over.
+ */
+#define SH4_IR_BLOCK_LIMIT (1 << 16)
+
+static struct sh4_code_cache ir_cache;
+
+// every valid block, so they can be freed
+static struct sh4_ir_block *all_blocks;
+static unsigned n_blocks;
+
+/*
+ * blocks that have been invalidated.  These can't be freed right away because
+ * the block that's executing could have been the one that got invalidated.
+ */
+static struct sh4_ir_block *dead_blocks;
+
+static bool dump_enabled;
+
+static struct sh4_ir_stats stats;
+
+static void ir_on_invalidate(struct sh4_code_cache *cache,
+                             struct sh4_code_block *hdr);
+static void ir_free_block(struct sh4_ir_block *blk);
+static void ir_free_dead_blocks(void);
+static void ir_flush(void);
+static struct sh4_code_block *ir_find(addr32_t pc);
+static struct sh4_code_block *ir_compile(addr32_t pc);
+static unsigned ir_exec(Sh4 *sh4, struct sh4_code_block *hdr);
+
+static struct sh4_code_runner const ir_runner = {
+    .find = ir_find,
+    .compile = ir_compile,
+    .exec = ir_exec
+};
+
+void sh4_ir_init(void) {
+    memset(&stats, 0, sizeof(stats));
+    all_blocks = dead_blocks = NULL;
+    n_blocks = 0;
+    sh4_code_cache_init(&ir_cache, ir_on_invalidate);
+}
+
+void sh4_ir_cleanup(void) {
+    ir_flush();
+    sh4_code_cache_cleanup(&ir_cache);
+}
+
+void sh4_ir_set_dump_enabled(bool enable) {
+    dump_enabled = enable;
+}
+
+void sh4_ir_get_stats(struct sh4_ir_stats *stats_out) {
+    memcpy(stats_out, &stats, sizeof(*stats_out));
+    stats_out->blocks_invalidated = ir_cache.n_invalidated;
+}
+
+void sh4_ir_run_cycles(Sh4 *sh4, unsigned n_cycles) {
+    if (dead_blocks)
+        ir_free_dead_blocks();
+
+    sh4_code_cache_run_cycles(sh4, n_cycles, &ir_runner);
+}
+
+static struct sh4_code_block *ir_find(addr32_t pc) {
+    return sh4_code_cache_find(&ir_cache, pc);
+}
+
+static unsigned ir_exec(Sh4 *sh4, struct sh4_code_block *hdr) {
+    struct sh4_ir_block *blk = (struct sh4_ir_block*)hdr;
+
+    blk->exec_count++;
+    return sh4_ir_exec(sh4, blk);
+}
+
+static struct sh4_code_block *ir_compile(addr32_t pc) {
+    if (n_blocks >= SH4_IR_BLOCK_LIMIT)
+        ir_flush();
+
+    struct sh4_ir_block *blk = sh4_ir_lower_block(pc);
+    if (!blk)
+        return NULL;
+
+    if (dump_enabled) {
+        size_t n_bytes = blk->n_ops * sizeof(struct sh4_ir_op);
+        blk->unopt_ops = (struct sh4_ir_op*)malloc(n_bytes);
+        if (!blk->unopt_ops)
+            RAISE_ERROR(ERROR_FAILED_ALLOC);
+        memcpy(blk->unopt_ops, blk->ops, n_bytes);
+        blk->n_unopt_ops = blk->n_ops;
+    }
+
+    stats.ops_before_opt += blk->n_ops;
+    sh4_ir_optimize(blk);
+    stats.ops_after_opt += blk->n_ops;
+
+    unsigned op_no;
+    for (op_no = 0; op_no < blk->n_ops; op_no++)
+        if (blk->ops[op_no].opcode == SH4_IR_FALLBACK)
+            stats.fallback_ops++;
+
+    sh4_code_cache_insert(&ir_cache, &blk->hdr, pc,
+                          pc + 2 * (blk->n_insts - 1));
+
+    blk->prev_all = NULL;
+    blk->next_all = all_blocks;
+    if (all_blocks)
+        all_blocks->prev_all = blk;
+    all_blocks = blk;
+    n_blocks++;
+
+    stats.blocks_compiled++;
+
+    return &blk->hdr;
+}
+
+static void ir_on_invalidate(struct sh4_code_cache *cache,
+                             struct sh4_code_block *hdr) {
+    struct sh4_ir_block *blk = (struct sh4_ir_block*)hdr;
+
+    if (blk->prev_all)
+        blk->prev_all->next_all = blk->next_all;
+    else
+        all_blocks = blk->next_all;
+    if (blk->next_all)
+        blk->next_all->prev_all = blk->prev_all;
+    n_blocks--;
+
+    blk->next_dead = dead_blocks;
+    dead_blocks = blk;
+}
+
+static void ir_free_block(struct sh4_ir_block *blk) {
+    free(blk->unopt_ops);
+    free(blk);
+}
+
+static void ir_free_dead_blocks(void) {
+    while (dead_blocks) {
+        struct sh4_ir_block *next = dead_blocks->next_dead;
+        ir_free_block(dead_blocks);
+        dead_blocks = next;
+    }
+}
+
+static void ir_flush(void) {
+    ir_free_dead_blocks();
+
+    sh4_code_cache_clear(&ir_cache);
+    while (all_blocks) {
+        struct sh4_ir_block *next = all_blocks->next_all;
+        ir_free_block(all_blocks);
+        all_blocks = next;
+    }
+    n_blocks = 0;
+
+    stats.flushes++;
+}
+
+static int ir_cmp_exec_count(void const *lhs, void const *rhs) {
+    struct sh4_ir_block const *blk_lhs = *(struct sh4_ir_block const**)lhs;
+    struct sh4_ir_block const *blk_rhs = *(struct sh4_ir_block const**)rhs;
+
+    if (blk_lhs->exec_count > blk_rhs->exec_count)
+        return -1;
+    else if (blk_lhs->exec_count < blk_rhs->exec_count)
+        return 1;
+    return 0;
+}
+
+void sh4_ir_dump_hot_blocks(FILE *stream, unsigned n_hot) {
+    struct sh4_ir_block **sorted;
+    struct sh4_ir_block *blk;
+    unsigned idx = 0;
+
+    if (!n_blocks)
+        return;
+
+    sorted = (struct sh4_ir_block**)malloc(n_blocks * sizeof(*sorted));
+    if (!sorted)
+        RAISE_ERROR(ERROR_FAILED_ALLOC);
+
+    for (blk = all_blocks; blk; blk = blk->next_all)
+        sorted[idx++] = blk;
+
+    qsort(sorted, n_blocks, sizeof(*sorted), ir_cmp_exec_count);
+
+    if (n_hot > n_blocks)
+        n_hot = n_blocks;
+
+    fprintf(stream, "The %u most frequently executed IR blocks:\n", n_hot);
+    for (idx = 0; idx < n_hot; idx++)
+        sh4_ir_dump_block(stream, sorted[idx]);
+
+    free(sorted);
+}
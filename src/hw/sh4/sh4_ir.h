@@ -0,0 +1,282 @@
+/*******************************************************************************
+ *
+ *
+ *    WashingtonDC Dreamcast Emulator
+ *    Copyright (C) 2017 snickerbockers
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ******************************************************************************/
+
+#ifndef SH4_IR_H_
+#define SH4_IR_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "types.h"
+#include "sh4_inst.h"
+#include "sh4_code_cache.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Intermediate representation for SH4 basic blocks.
+ *
+ * Each instruction in a block gets lowered into a simple three-address op
+ * that works directly on the general-purpose registers (R0-R15) and the T
+ * flag.  Instructions that don't have an IR equivalent become SH4_IR_FALLBACK
+ * ops, which just call the interpreter's handler for that instruction; the
+ * optimizer treats those as barriers, so the IR never needs to know about an
+ * instruction in order to be correct.
+ *
+ * Blocks are split up by sh4_code_walk_block, the same as the JIT.  If a
+ * block ends in a delayed branch, the delay slot gets tacked on as an
+ * SH4_IR_SLOT op.
+ *
+ * Nothing in here is specific to the IR interpreter (sh4_ir_run_cycles);
+ * lowering and optimization are exposed separately so that a native backend
+ * can translate optimized blocks instead of executing them directly.
+ */
+
+// slot for the delay-slot op
+#define SH4_IR_MAX_OPS (SH4_CODE_MAX_BLOCK_LEN + 1)
+
+// register number for "no register" (ie, use the immediate instead)
+#define SH4_IR_NO_REG 0xff
+
+enum sh4_ir_opcode {
+    // removed by the optimizer
+    SH4_IR_NOP,
+
+    // dst = imm
+    SH4_IR_MOV_IMM,
+
+    // dst = src[0]
+    SH4_IR_MOV,
+
+    /*
+     * dst = src[0] <op> src[1].  If src[1] is SH4_IR_NO_REG, then imm is used
+     * in its place.  Shift amounts are always immediates.
+     */
+    SH4_IR_ADD,
+    SH4_IR_AND,
+    SH4_IR_OR,
+    SH4_IR_XOR,
+    SH4_IR_SHL,
+    SH4_IR_SHR,
+
+    // dst = <op> src[0]
+    SH4_IR_NOT,
+    SH4_IR_EXTU_B,
+    SH4_IR_EXTU_W,
+    SH4_IR_EXTS_B,
+    SH4_IR_EXTS_W,
+
+    /*
+     * T = src[0] <cmp> src[1] (or imm).  cond holds an enum sh4_ir_cond.
+     * dst is unused.
+     */
+    SH4_IR_CMP,
+
+    // T = !(src[0] & src[1]), or !(src[0] & imm).  dst is unused.
+    SH4_IR_TST,
+
+    // T = imm.  This is CLRT/SETT.
+    SH4_IR_SETT,
+
+    // dst = src[0] << 1, T = the bit that got shifted out
+    SH4_IR_SHLL,
+
+    // dst = src[0] >> 1, T = the bit that got shifted out
+    SH4_IR_SHLR,
+
+    // dst = src[0] - 1, T = (dst == 0)
+    SH4_IR_DT,
+
+    /*
+     * dst = *(uint32_t*)(src[0] + imm).  If src[0] is SH4_IR_NO_REG, then
+     * imm is an absolute address.  This can raise a CPU exception, in which
+     * case the block ends early.
+     */
+    SH4_IR_LOAD32,
+
+    // *(uint32_t*)(src[0] + imm) = src[1].  Same caveats as SH4_IR_LOAD32
+    SH4_IR_STORE32,
+
+    /*
+     * this is a load whose value is already sitting in src[1] because of a
+     * store to (or a load from) the same address earlier in the block.  If
+     * src[0] + imm turns out to be in system RAM at runtime then dst = src[1]
+     * and memory doesn't get touched; otherwise it's just an SH4_IR_LOAD32.
+     * The fallback is needed because the address could be in a memory-mapped
+     * register, where reading back what you just wrote doesn't always work.
+     */
+    SH4_IR_LOAD32_FWD,
+
+    // run inst through the interpreter
+    SH4_IR_FALLBACK,
+
+    /*
+     * run inst as a delay slot, if the previous op set up a delayed branch.
+     * This is only ever the last op in a block.
+     */
+    SH4_IR_SLOT,
+
+    SH4_IR_OPCODE_COUNT
+};
+
+enum sh4_ir_cond {
+    SH4_IR_COND_EQ,
+    SH4_IR_COND_HS,     // unsigned >=
+    SH4_IR_COND_GE,     // signed >=
+    SH4_IR_COND_HI,     // unsigned >
+    SH4_IR_COND_GT,     // signed >
+
+    SH4_IR_COND_COUNT
+};
+
+struct sh4_ir_op {
+    uint8_t opcode;
+    uint8_t cond;
+    uint8_t dst;
+    uint8_t src[2];
+
+    uint32_t imm;
+
+    // only used by SH4_IR_FALLBACK and SH4_IR_SLOT
+    inst_t inst;
+    InstOpcode const *inst_op;
+
+    // guest address of the instruction this op came from
+    addr32_t pc;
+
+    /*
+     * cycles charged to the block up to and including the instruction this
+     * op came from.  This is what the block returns if it exits early at this
+     * op.
+     */
+    unsigned cycles;
+};
+
+struct sh4_ir_block {
+    // this must be the first member
+    struct sh4_code_block hdr;
+
+    // same as hdr.cycle_count, except for when the delayed branch isn't taken
+    unsigned cycle_count_no_slot;
+
+    /*
+     * address of the instruction after the block.  If the block ends with
+     * something that sets the PC on its own (a branch or a CO instruction)
+     * then this isn't used.
+     */
+    addr32_t end_pc;
+    bool end_pc_valid;
+
+    unsigned n_insts;
+
+    // these are only used by sh4_ir_run_cycles
+    unsigned long exec_count;
+    struct sh4_ir_block *prev_all, *next_all, *next_dead;
+
+    /*
+     * the ops as they were before optimization.  This is only kept around
+     * when dumping is enabled, otherwise it's NULL.
+     */
+    struct sh4_ir_op *unopt_ops;
+    unsigned n_unopt_ops;
+
+    unsigned n_ops;
+    struct sh4_ir_op ops[];
+};
+
+struct Sh4;
+
+/*
+ * translate the block at pc into IR.  This returns a malloc'd block, or NULL
+ * if the first instruction can't be read without side-effects (see
+ * sh4_code_cache_fetch).  The block is not optimized and it is not added to
+ * any caches.
+ */
+struct sh4_ir_block *sh4_ir_lower_block(addr32_t pc);
+
+void sh4_ir_optimize(struct sh4_ir_block *blk);
+
+/*
+ * the individual passes, in the order that sh4_ir_optimize runs them.  These
+ * all work in-place and leave SH4_IR_NOPs behind instead of removing ops;
+ * sh4_ir_compact cleans those up.
+ */
+void sh4_ir_pass_fold_literals(struct sh4_ir_block *blk);
+void sh4_ir_pass_dead_t(struct sh4_ir_block *blk);
+void sh4_ir_pass_const_prop(struct sh4_ir_block *blk);
+void sh4_ir_pass_forward_mem(struct sh4_ir_block *blk);
+void sh4_ir_pass_dead_regs(struct sh4_ir_block *blk);
+void sh4_ir_compact(struct sh4_ir_block *blk);
+
+/*
+ * execute the block.  This returns the number of cycles used, which is only
+ * less than blk->hdr.cycle_count if the block exited early because of an
+ * exception.
+ */
+unsigned sh4_ir_exec(struct Sh4 *sh4, struct sh4_ir_block const *blk);
+
+void sh4_ir_dump_block(FILE *stream, struct sh4_ir_block const *blk);
+void sh4_ir_dump_ops(FILE *stream, struct sh4_ir_op const *ops,
+                     unsigned n_ops);
+
+/*******************************************************************************
+ *
+ * IR interpreter
+ *
+ ******************************************************************************/
+
+void sh4_ir_init(void);
+void sh4_ir_cleanup(void);
+
+// drop-in replacement for sh4_run_cycles; see sh4_code_cache_run_cycles
+void sh4_ir_run_cycles(struct Sh4 *sh4, unsigned n_cycles);
+
+/*
+ * if this is enabled, the unoptimized IR is kept around for every block so
+ * that sh4_ir_dump_hot_blocks can show what the optimizer did.  It needs to
+ * be set before any blocks get translated.
+ */
+void sh4_ir_set_dump_enabled(bool enable);
+
+// print the n_blocks most frequently executed blocks, before and after
+void sh4_ir_dump_hot_blocks(FILE *stream, unsigned n_blocks);
+
+struct sh4_ir_stats {
+    unsigned long blocks_compiled;
+    unsigned long blocks_invalidated;
+    unsigned long flushes;
+
+    // these are counted when blocks are translated, not when they run
+    unsigned long ops_before_opt, ops_after_opt;
+    unsigned long fallback_ops;
+};
+
+void sh4_ir_get_stats(struct sh4_ir_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,475 @@
+/*******************************************************************************
+ *
+ *
+ *    WashingtonDC Dreamcast Emulator
+ *    Copyright (C) 2017 snickerbockers
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ******************************************************************************/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "sh4.h"
+#include "sh4_inst.h"
+#include "sh4_excp.h"
+#include "error.h"
+#include "mem_code.h"
+#include "mem_areas.h"
+#include "MemoryMap.h"
+#include "dreamcast.h"
+#include "sh4_code_cache.h"
+
+#include "sh4_jit.h"
+
+#if !defined(__x86_64__)
+#error the SH4 JIT can only generate x86-64 code
+#endif
+
+/*
+ * when the code buffer or the block pool runs out, the entire cache gets
+ * thrown away and we start over.  This is a lot simpler than trying to
+ * garbage-collect individual blocks, and it doesn't happen very often.
+ */
+#define SH4_JIT_CODE_BUF_SIZE (32 * 1024 * 1024)
+#define SH4_JIT_BLOCK_COUNT (1 << 16)
+
+/*
+ * upper bound on the amount of host code that can be emitted for a single
+ * block.  The fallback path is the largest thing we emit (about 40 bytes per
+ * instruction counting its exit stub), so this leaves plenty of headroom.
+ */
+#define SH4_JIT_MAX_BLOCK_BYTES (SH4_CODE_MAX_BLOCK_LEN * 64 + 256)
+
+typedef unsigned(*sh4_jit_native_fn)(Sh4*);
+
+struct jit_block {
+    // this must be the first member
+    struct sh4_code_block hdr;
+
+    sh4_jit_native_fn native;
+};
+
+static struct sh4_code_cache jit_cache;
+
+static struct jit_block *block_pool;
+static unsigned n_blocks;
+
+static uint8_t *code_buf, *code_cur;
+
+static struct sh4_jit_stats stats;
+
+static struct sh4_code_block *jit_find(addr32_t pc);
+static struct sh4_code_block *jit_compile(addr32_t pc);
+static unsigned jit_exec(Sh4 *sh4, struct sh4_code_block *blk);
+
+static struct sh4_code_runner const jit_runner = {
+    .find = jit_find,
+    .compile = jit_compile,
+    .exec = jit_exec
+};
+
+void sh4_jit_init(void) {
+    code_buf = (uint8_t*)mmap(NULL, SH4_JIT_CODE_BUF_SIZE,
+                              PROT_READ | PROT_WRITE | PROT_EXEC,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code_buf == MAP_FAILED) {
+        code_buf = NULL;
+        RAISE_ERROR(ERROR_FAILED_ALLOC);
+    }
+
+    block_pool = (struct jit_block*)malloc(sizeof(struct jit_block) *
+                                           SH4_JIT_BLOCK_COUNT);
+    if (!block_pool)
+        RAISE_ERROR(ERROR_FAILED_ALLOC);
+
+    memset(&stats, 0, sizeof(stats));
+
+    /*
+     * blocks live in block_pool until the next flush, so there's nothing to
+     * do when one gets invalidated.
+     */
+    sh4_code_cache_init(&jit_cache, NULL);
+
+    sh4_jit_flush();
+}
+
+void sh4_jit_cleanup(void) {
+    sh4_code_cache_cleanup(&jit_cache);
+
+    free(block_pool);
+    block_pool = NULL;
+
+    if (code_buf)
+        munmap(code_buf, SH4_JIT_CODE_BUF_SIZE);
+    code_buf = code_cur = NULL;
+}
+
+void sh4_jit_flush(void) {
+    sh4_code_cache_clear(&jit_cache);
+    n_blocks = 0;
+    code_cur = code_buf;
+    stats.flushes++;
+}
+
+void sh4_jit_get_stats(struct sh4_jit_stats *stats_out) {
+    memcpy(stats_out, &stats, sizeof(*stats_out));
+    stats_out->blocks_invalidated = jit_cache.n_invalidated;
+}
+
+void sh4_jit_run_cycles(Sh4 *sh4, unsigned n_cycles) {
+    sh4_code_cache_run_cycles(sh4, n_cycles, &jit_runner);
+}
+
+static struct sh4_code_block *jit_find(addr32_t pc) {
+    return sh4_code_cache_find(&jit_cache, pc);
+}
+
+static unsigned jit_exec(Sh4 *sh4, struct sh4_code_block *blk) {
+    return ((struct jit_block*)blk)->native(sh4);
+}
+
+/*******************************************************************************
+ *
+ * x86-64 code emission
+ *
+ * Generated blocks are functions of the form unsigned blk(Sh4 *sh4) which
+ * return the number of cycles they used.  rbx holds the Sh4 pointer for the
+ * whole block since it's callee-saved; pushing it on entry also conveniently
+ * puts the stack on a 16-byte boundary for the calls into the handlers.
+ *
+ ******************************************************************************/
+
+#define REG_OFFS(reg_no) \
+    ((uint32_t)(offsetof(struct Sh4, reg) + (reg_no) * sizeof(reg32_t)))
+#define GEN_REG_OFFS(idx) REG_OFFS(SH4_REG_R0 + (idx))
+
+static inline void emit_u8(uint8_t val) {
+    *code_cur++ = val;
+}
+
+static inline void emit_u32(uint32_t val) {
+    memcpy(code_cur, &val, sizeof(val));
+    code_cur += sizeof(val);
+}
+
+static inline void emit_u64(uint64_t val) {
+    memcpy(code_cur, &val, sizeof(val));
+    code_cur += sizeof(val);
+}
+
+// <opcode> modrm(mod=10, reg, rm=rbx) disp32
+static inline void emit_rbx_disp32(uint8_t reg_field, uint32_t disp) {
+    emit_u8(0x80 | (reg_field << 3) | 3);
+    emit_u32(disp);
+}
+
+// mov eax, [rbx + disp]
+static void emit_load_eax(uint32_t disp) {
+    emit_u8(0x8b);
+    emit_rbx_disp32(0, disp);
+}
+
+// mov [rbx + disp], eax
+static void emit_store_eax(uint32_t disp) {
+    emit_u8(0x89);
+    emit_rbx_disp32(0, disp);
+}
+
+// mov dword [rbx + disp], imm32
+static void emit_store_imm(uint32_t disp, uint32_t imm) {
+    emit_u8(0xc7);
+    emit_rbx_disp32(0, disp);
+    emit_u32(imm);
+}
+
+static void emit_call(void const *fn) {
+    // mov rax, imm64
+    emit_u8(0x48);
+    emit_u8(0xb8);
+    emit_u64((uint64_t)(uintptr_t)fn);
+
+    // call rax
+    emit_u8(0xff);
+    emit_u8(0xd0);
+}
+
+// mov eax, cycles ; pop rbx ; ret
+static void emit_epilogue(unsigned cycles) {
+    emit_u8(0xb8);
+    emit_u32(cycles);
+    emit_u8(0x5b);
+    emit_u8(0xc3);
+}
+
+// emit a jne rel32 with a placeholder target and return the address to patch
+static uint8_t *emit_jne(void) {
+    emit_u8(0x0f);
+    emit_u8(0x85);
+    uint8_t *patch = code_cur;
+    emit_u32(0);
+    return patch;
+}
+
+static void patch_rel32(uint8_t *patch, uint8_t const *target) {
+    int32_t rel = (int32_t)(target - (patch + sizeof(int32_t)));
+    memcpy(patch, &rel, sizeof(rel));
+}
+
+// call the interpreter's handler for the instruction
+static void emit_fallback(inst_t inst, InstOpcode const *op) {
+    // mov rdi, rbx
+    emit_u8(0x48);
+    emit_u8(0x89);
+    emit_u8(0xdf);
+
+    // mov esi, inst
+    emit_u8(0xbe);
+    emit_u32(inst);
+
+    emit_call((void const*)op->func);
+}
+
+/*
+ * try to emit native code for the given instruction.  Only instructions that
+ * touch nothing but the general-purpose registers are candidates for this,
+ * which means they can never raise an exception.  The registers are always
+ * physically bank-swapped in the Sh4 struct, so the offsets are constant.
+ *
+ * returns false if the instruction needs to go through the fallback path.
+ */
+static bool emit_native(inst_t inst) {
+    unsigned rn = (inst >> 8) & 0xf;
+    unsigned rm = (inst >> 4) & 0xf;
+    int32_t simm8 = (int8_t)(inst & 0xff);
+
+    if (inst == 0x0009) {
+        // NOP
+        return true;
+    }
+
+    switch (inst & 0xf000) {
+    case 0xe000:
+        // MOV #imm, Rn
+        emit_store_imm(GEN_REG_OFFS(rn), (uint32_t)simm8);
+        return true;
+    case 0x7000:
+        // ADD #imm, Rn - add dword [rbx + disp], imm32
+        emit_u8(0x81);
+        emit_rbx_disp32(0, GEN_REG_OFFS(rn));
+        emit_u32((uint32_t)simm8);
+        return true;
+    }
+
+    switch (inst & 0xf00f) {
+    case 0x6003:
+        // MOV Rm, Rn
+        emit_load_eax(GEN_REG_OFFS(rm));
+        emit_store_eax(GEN_REG_OFFS(rn));
+        return true;
+    case 0x6007:
+        // NOT Rm, Rn
+        emit_load_eax(GEN_REG_OFFS(rm));
+        emit_u8(0xf7);
+        emit_u8(0xd0);
+        emit_store_eax(GEN_REG_OFFS(rn));
+        return true;
+    case 0x600c:
+        // EXTU.B Rm, Rn - movzx eax, byte [rbx + disp]
+        emit_u8(0x0f);
+        emit_u8(0xb6);
+        emit_rbx_disp32(0, GEN_REG_OFFS(rm));
+        emit_store_eax(GEN_REG_OFFS(rn));
+        return true;
+    case 0x600d:
+        // EXTU.W Rm, Rn - movzx eax, word [rbx + disp]
+        emit_u8(0x0f);
+        emit_u8(0xb7);
+        emit_rbx_disp32(0, GEN_REG_OFFS(rm));
+        emit_store_eax(GEN_REG_OFFS(rn));
+        return true;
+    case 0x300c:
+        // ADD Rm, Rn
+        emit_load_eax(GEN_REG_OFFS(rm));
+        emit_u8(0x01);
+        emit_rbx_disp32(0, GEN_REG_OFFS(rn));
+        return true;
+    case 0x2009:
+        // AND Rm, Rn
+        emit_load_eax(GEN_REG_OFFS(rm));
+        emit_u8(0x21);
+        emit_rbx_disp32(0, GEN_REG_OFFS(rn));
+        return true;
+    case 0x200b:
+        // OR Rm, Rn
+        emit_load_eax(GEN_REG_OFFS(rm));
+        emit_u8(0x09);
+        emit_rbx_disp32(0, GEN_REG_OFFS(rn));
+        return true;
+    case 0x200a:
+        // XOR Rm, Rn
+        emit_load_eax(GEN_REG_OFFS(rm));
+        emit_u8(0x31);
+        emit_rbx_disp32(0, GEN_REG_OFFS(rn));
+        return true;
+    }
+
+    unsigned shift_amount;
+    bool shift_right;
+    if (sh4_code_decode_shift(inst, &rn, &shift_amount, &shift_right)) {
+        // shl/shr dword [rbx + disp], imm8
+        emit_u8(0xc1);
+        emit_rbx_disp32(shift_right ? 5 : 4, GEN_REG_OFFS(rn));
+        emit_u8(shift_amount);
+        return true;
+    }
+
+    return false;
+}
+
+struct jit_exit_fixup {
+    uint8_t *patch;
+    unsigned cycles;
+};
+
+static struct sh4_code_block *jit_compile(addr32_t pc) {
+    struct jit_exit_fixup exits[SH4_CODE_MAX_BLOCK_LEN];
+    struct sh4_code_walk walk;
+    unsigned n_exits = 0, inst_no;
+
+    if (!sh4_code_walk_block(&walk, pc))
+        return NULL;
+
+    if (n_blocks >= SH4_JIT_BLOCK_COUNT ||
+        (size_t)(code_buf + SH4_JIT_CODE_BUF_SIZE - code_cur) <
+        SH4_JIT_MAX_BLOCK_BYTES) {
+        sh4_jit_flush();
+    }
+
+    struct jit_block *blk = block_pool + n_blocks++;
+    uint8_t *code_start = code_cur;
+
+    // push rbx ; mov rbx, rdi
+    emit_u8(0x53);
+    emit_u8(0x48);
+    emit_u8(0x89);
+    emit_u8(0xfb);
+
+    addr32_t cur_pc = pc;
+    struct sh4_code_inst const *last = walk.insts + walk.n_insts - 1;
+
+    /*
+     * when this is true, sh4->reg[SH4_REG_PC] is behind cur_pc because of
+     * natively-emitted instructions.  It needs to be written back before
+     * calling into a handler or leaving the block.
+     */
+    bool pc_dirty = false;
+
+    for (inst_no = 0; inst_no < walk.n_insts; inst_no++) {
+        struct sh4_code_inst const *ent = walk.insts + inst_no;
+
+        if (emit_native(ent->inst)) {
+            stats.native_insts++;
+            cur_pc += 2;
+            pc_dirty = true;
+            continue;
+        }
+
+        stats.fallback_insts++;
+        if (pc_dirty) {
+            emit_store_imm(REG_OFFS(SH4_REG_PC), cur_pc);
+            pc_dirty = false;
+        }
+
+        emit_fallback(ent->inst, ent->op);
+        cur_pc += 2;
+
+        if (ent == last && walk.ends_on_branch)
+            break;
+
+        /*
+         * if the handler didn't leave the PC where we expected it, then
+         * it raised an exception so get out of here.
+         */
+        // cmp dword [rbx + pc], cur_pc
+        emit_u8(0x81);
+        emit_rbx_disp32(7, REG_OFFS(SH4_REG_PC));
+        emit_u32(cur_pc);
+        exits[n_exits].patch = emit_jne();
+        exits[n_exits].cycles = ent->cycles;
+        n_exits++;
+    }
+
+    if (walk.ends_on_branch && walk.has_slot) {
+        /*
+         * If the last instruction set up a delayed branch then run the delay
+         * slot through sh4_do_exec_inst so it takes care of the branch (and
+         * of illegal slot instructions).  If it didn't, the handler already
+         * left the PC where it needs to be.
+         */
+        // cmp byte [rbx + delayed_branch], 0
+        emit_u8(0x80);
+        emit_rbx_disp32(7, offsetof(struct Sh4, delayed_branch));
+        emit_u8(0);
+        uint8_t *slot_patch = emit_jne();
+
+        emit_epilogue(last->cycles);
+
+        patch_rel32(slot_patch, code_cur);
+
+        // mov rdi, rbx ; mov esi, inst ; mov rdx, op
+        emit_u8(0x48);
+        emit_u8(0x89);
+        emit_u8(0xdf);
+        emit_u8(0xbe);
+        emit_u32(walk.slot.inst);
+        emit_u8(0x48);
+        emit_u8(0xba);
+        emit_u64((uint64_t)(uintptr_t)walk.slot.op);
+        emit_call((void const*)sh4_do_exec_inst);
+
+        emit_epilogue(walk.slot.cycles);
+    } else {
+        if (pc_dirty)
+            emit_store_imm(REG_OFFS(SH4_REG_PC), cur_pc);
+        emit_epilogue(last->cycles);
+    }
+
+    unsigned exit_no;
+    for (exit_no = 0; exit_no < n_exits; exit_no++) {
+        patch_rel32(exits[exit_no].patch, code_cur);
+        emit_epilogue(exits[exit_no].cycles);
+    }
+
+#ifdef INVARIANTS
+    if (code_cur - code_start > SH4_JIT_MAX_BLOCK_BYTES)
+        RAISE_ERROR(ERROR_INTEGRITY);
+#endif
+
+    blk->native = (sh4_jit_native_fn)(void*)code_start;
+    blk->hdr.cycle_count = sh4_code_walk_cycles(&walk);
+
+    sh4_code_cache_insert(&jit_cache, &blk->hdr, pc,
+                          sh4_code_walk_pc_last(&walk, pc));
+
+    stats.blocks_compiled++;
+
+    return &blk->hdr;
+}
@@ -0,0 +1,71 @@
+/*******************************************************************************
+ *
+ *
+ *    WashingtonDC Dreamcast Emulator
+ *    Copyright (C) 2017 snickerbockers
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ******************************************************************************/
+
+#ifndef SH4_JIT_H_
+#define SH4_JIT_H_
+
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * x86-64 dynamic recompiler for the SH4.
+ *
+ * Guest code is translated one basic block at a time, split up the way
+ * sh4_code_walk_block does it.  A handful of simple integer instructions are
+ * emitted natively; everything else is emitted as a call to the same
+ * opcode_list handler the interpreter would have used, so the JIT never needs
+ * to know about an instruction to be correct.
+ *
+ * Translated blocks are kept in an sh4_code_cache, so writes to system RAM
+ * pages that hold translated code throw away every block on that page.
+ */
+
+struct Sh4;
+
+void sh4_jit_init(void);
+void sh4_jit_cleanup(void);
+
+// drop-in replacement for sh4_run_cycles; see sh4_code_cache_run_cycles
+void sh4_jit_run_cycles(struct Sh4 *sh4, unsigned n_cycles);
+
+// throw away every translated block
+void sh4_jit_flush(void);
+
+struct sh4_jit_stats {
+    unsigned long blocks_compiled;
+    unsigned long blocks_invalidated;
+    unsigned long flushes;
+
+    // these are counted when instructions are translated, not when they run
+    unsigned long native_insts, fallback_insts;
+};
+
+void sh4_jit_get_stats(struct sh4_jit_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
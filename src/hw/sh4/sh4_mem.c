@@ -35,7 +35,10 @@
 #include "debugger.h"
 #endif
 
-static inline enum VirtMemArea sh4_get_mem_area(addr32_t addr);
+#ifdef ENABLE_FASTMEM
+#include "fastmem.h"
+#include "hw/sh4/sh4_code_cache.h"
+#endif
 
 /*
  * TODO: need to adequately return control to the debugger when there's a memory
@@ -43,15 +46,175 @@ static inline enum VirtMemArea sh4_get_mem_area(addr32_t addr);
  * solution, but until all the codebase is out of C++ I don't want to risk that.
  */
 
-int sh4_write_mem(Sh4 *sh4, void const *data, addr32_t addr, unsigned len) {
-#ifdef ENABLE_DEBUGGER
-    struct debugger *dbg = dreamcast_get_debugger();
-    if (dbg && debug_is_w_watch(dbg, addr, len)) {
-        sh4->aborted_operation = true;
-        return MEM_ACCESS_EXC;
+void sh4_mem_refresh_pages(Sh4 *sh4) {
+    unsigned page_no;
+    bool ora = (sh4->reg[SH4_REG_CCR] & SH4_CCR_OCE_MASK) &&
+        (sh4->reg[SH4_REG_CCR] & SH4_CCR_ORA_MASK);
+    bool at = sh4->reg[SH4_REG_MMUCR] & SH4_MMUCR_AT_MASK;
+
+    /*
+     * TODO: user-mode processes should only be able to get at U0 and the
+     * store queues.  Right now that doesn't matter because you can't leave
+     * privileged mode without raising an ERROR_UNIMPLEMENTED (see
+     * sh4_on_sr_change in sh4.c), but if that ever changes then there will
+     * need to be a second set of pages for user mode.
+     */
+    for (page_no = 0; page_no < SH4_MEM_N_PAGES; page_no++) {
+        addr32_t addr = ((addr32_t)page_no) << SH4_MEM_PAGE_SHIFT;
+        enum sh4_mem_page_type tp;
+
+        if (addr >= SH4_AREA_P4_FIRST)
+            tp = SH4_MEM_PAGE_P4;
+        else if (at && (addr <= SH4_AREA_P0_LAST || addr >= SH4_AREA_P3_FIRST))
+            tp = SH4_MEM_PAGE_TLB;
+        else if (ora && sh4_ocache_in_ram_area(addr))
+            tp = SH4_MEM_PAGE_ORA;
+        else
+            tp = SH4_MEM_PAGE_PHYS;
+
+        sh4->mem_pages[page_no] = tp;
     }
+
+#ifdef ENABLE_FASTMEM
+    // P0 is four of fastmem's areas, P3 is one
+    for (page_no = 0; page_no < 4; page_no++)
+        fastmem_set_area_mapped(page_no, !at);
+    fastmem_set_area_mapped(SH4_AREA_P3_FIRST >> 29, !at);
+#endif
+}
+
+static inline enum sh4_mem_page_type sh4_mem_page(Sh4 *sh4, addr32_t addr) {
+    return (enum sh4_mem_page_type)sh4->mem_pages[addr >> SH4_MEM_PAGE_SHIFT];
+}
+
+static int sh4_mem_tlb_unimplemented(addr32_t addr, unsigned len) {
+    error_set_address(addr);
+    error_set_length(len);
+    error_set_feature("SH4 MMU support");
+    PENDING_ERROR(ERROR_UNIMPLEMENTED);
+    return MEM_ACCESS_FAILURE;
+}
+
+#ifdef ENABLE_DEBUGGER
+#define SH4_MEM_CHECK_R_WATCH(addr, len)                                \
+    do {                                                                \
+        struct debugger *dbg = dreamcast_get_debugger();                \
+        if (dbg && debug_is_r_watch(dbg, (addr), (len))) {              \
+            sh4->aborted_operation = true;                              \
+            return MEM_ACCESS_EXC;                                      \
+        }                                                               \
+    } while (0)
+#define SH4_MEM_CHECK_W_WATCH(addr, len)                                \
+    do {                                                                \
+        struct debugger *dbg = dreamcast_get_debugger();                \
+        if (dbg && debug_is_w_watch(dbg, (addr), (len))) {              \
+            sh4->aborted_operation = true;                              \
+            return MEM_ACCESS_EXC;                                      \
+        }                                                               \
+    } while (0)
+#else
+#define SH4_MEM_CHECK_R_WATCH(addr, len) do { } while (0)
+#define SH4_MEM_CHECK_W_WATCH(addr, len) do { } while (0)
 #endif
 
+/*
+ * With fastmem, RAM doesn't need to go through the page tables at all.  Only
+ * RAM is mapped into the fastmem window, so a successful write is always a
+ * write to RAM.
+ *
+ * Anything that isn't area 3 would just fault, and a fault costs a trip
+ * through the kernel every time since there's nothing here that can be
+ * patched to skip it next time.  So only area 3 addresses (in P0-P3) even try
+ * the window.
+ */
+#ifdef ENABLE_FASTMEM
+#define SH4_MEM_IS_AREA3(addr)                                          \
+    ((addr) < SH4_AREA_P4_FIRST && ((addr) & 0x1c000000) == 0x0c000000)
+#define SH4_MEM_FASTMEM_READ(bits, valp, addr)                          \
+    do {                                                                \
+        if (SH4_MEM_IS_AREA3(addr) &&                                   \
+            likely(fastmem_read_##bits((valp), (addr))))                \
+            return MEM_ACCESS_SUCCESS;                                  \
+    } while (0)
+#define SH4_MEM_FASTMEM_WRITE(bits, val, addr)                          \
+    do {                                                                \
+        if (SH4_MEM_IS_AREA3(addr) &&                                   \
+            likely(fastmem_write_##bits((val), (addr)))) {              \
+            sh4_code_cache_notify_write((addr) & ADDR_AREA3_MASK,       \
+                                        sizeof(val));                   \
+            return MEM_ACCESS_SUCCESS;                                  \
+        }                                                               \
+    } while (0)
+#else
+#define SH4_MEM_FASTMEM_READ(bits, valp, addr) do { } while (0)
+#define SH4_MEM_FASTMEM_WRITE(bits, val, addr) do { } while (0)
+#endif
+
+#define SH4_MEM_DEF_READ(bits)                                          \
+    int sh4_read_mem_##bits(Sh4 *sh4, uint##bits##_t *valp, addr32_t addr) { \
+        int ret;                                                        \
+                                                                        \
+        SH4_MEM_CHECK_R_WATCH(addr, sizeof(*valp));                     \
+        SH4_MEM_FASTMEM_READ(bits, valp, addr);                         \
+                                                                        \
+        switch (sh4_mem_page(sh4, addr)) {                              \
+        case SH4_MEM_PAGE_PHYS:                                         \
+            ret = memory_map_read_##bits(valp, addr & MEMORY_MAP_ADDR_MASK); \
+            break;                                                      \
+        case SH4_MEM_PAGE_ORA:                                          \
+            sh4_ocache_do_read_ora(sh4, valp, addr, sizeof(*valp));     \
+            return MEM_ACCESS_SUCCESS;                                  \
+        case SH4_MEM_PAGE_P4:                                           \
+            ret = sh4_do_read_p4(sh4, valp, addr, sizeof(*valp));       \
+            break;                                                      \
+        default:                                                        \
+            ret = sh4_mem_tlb_unimplemented(addr, sizeof(*valp));       \
+        }                                                               \
+                                                                        \
+        if (ret == MEM_ACCESS_FAILURE)                                  \
+            RAISE_ERROR(get_error_pending());                           \
+        return ret;                                                     \
+    }
+
+#define SH4_MEM_DEF_WRITE(bits)                                         \
+    int sh4_write_mem_##bits(Sh4 *sh4, uint##bits##_t val, addr32_t addr) { \
+        int ret;                                                        \
+                                                                        \
+        SH4_MEM_CHECK_W_WATCH(addr, sizeof(val));                       \
+        SH4_MEM_FASTMEM_WRITE(bits, val, addr);                         \
+                                                                        \
+        switch (sh4_mem_page(sh4, addr)) {                              \
+        case SH4_MEM_PAGE_PHYS:                                         \
+            ret = memory_map_write_##bits(val, addr & MEMORY_MAP_ADDR_MASK); \
+            break;                                                      \
+        case SH4_MEM_PAGE_ORA:                                          \
+            sh4_ocache_do_write_ora(sh4, &val, addr, sizeof(val));      \
+            return MEM_ACCESS_SUCCESS;                                  \
+        case SH4_MEM_PAGE_P4:                                           \
+            ret = sh4_do_write_p4(sh4, &val, addr, sizeof(val));        \
+            break;                                                      \
+        default:                                                        \
+            ret = sh4_mem_tlb_unimplemented(addr, sizeof(val));         \
+        }                                                               \
+                                                                        \
+        if (ret == MEM_ACCESS_FAILURE)                                  \
+            RAISE_ERROR(get_error_pending());                           \
+        return ret;                                                     \
+    }
+
+SH4_MEM_DEF_READ(8)
+SH4_MEM_DEF_READ(16)
+SH4_MEM_DEF_READ(32)
+SH4_MEM_DEF_READ(64)
+
+SH4_MEM_DEF_WRITE(8)
+SH4_MEM_DEF_WRITE(16)
+SH4_MEM_DEF_WRITE(32)
+SH4_MEM_DEF_WRITE(64)
+
+int sh4_write_mem_buf(Sh4 *sh4, void const *data, addr32_t addr, unsigned len) {
+    SH4_MEM_CHECK_W_WATCH(addr, len);
+
     int ret;
 
     if ((ret = sh4_do_write_mem(sh4, data, addr, len)) == MEM_ACCESS_FAILURE)
@@ -60,61 +223,16 @@ int sh4_write_mem(Sh4 *sh4, void const *data, addr32_t addr, unsigned len) {
 }
 
 int sh4_do_write_mem(Sh4 *sh4, void const *data, addr32_t addr, unsigned len) {
-
-    enum VirtMemArea virt_area = sh4_get_mem_area(addr);
-
-#if 0
-    /*
-     * this is commented out because you can't leave privileged mode without
-     * raising an EROR_UNIMPLEMENTED (see sh4_on_sr_change in sh4.c)
-     */
-    bool privileged = sh4->reg[SH4_REG_SR] & SH4_SR_MD_MASK ? true : false;
-
-    if (virt_area != SH4_AREA_P0 && !privileged) {
-        // TODO: allow user-mode access to the store queue area
-
-        /*
-         * The spec says user-mode processes can only write to the U0 area
-         * (which overlaps with P0) and the store queue area but I can't find
-         * the part where it describes what needs to be done.  Raising the
-         * SH4_EXCP_DATA_TLB_WRITE_PROT_VIOL exception seems incorrect since that
-         * looks like it's for instances where the page can be looked up in the
-         * TLB.
-         */
-        error_set_feature("CPU exception for unprivileged "
-                          "access to high memory areas");
-        PENDING_ERROR(ERROR_UNIMPLEMENTED);
-        return MEM_ACCESS_FAILURE;
-    }
-#endif
-
-    switch (virt_area) {
-    case SH4_AREA_P0:
-    case SH4_AREA_P3:
-        /*
-         * TODO: Check for MMUCR_AT_MASK in the MMUCR register and raise an
-         * error or do TLB lookups accordingly.
-         *
-         * currently it is impossible for this to be set because of the
-         * ERROR_UNIMPLEMENTED that gets raised if you set this bit in sh4_reg.c
-         */
-
-        // handle the case where OCE is enabled and ORA is
-        // enabled but we don't have Ocache available
-        if ((sh4->reg[SH4_REG_CCR] & SH4_CCR_OCE_MASK) &&
-            (sh4->reg[SH4_REG_CCR] & SH4_CCR_ORA_MASK) &&
-            sh4_ocache_in_ram_area(addr)) {
-            sh4_ocache_do_write_ora(sh4, data, addr, len);
-            return MEM_ACCESS_SUCCESS;
-        }
-
-        // don't use the cache
-        // INTENTIONAL FALLTHROUGH
-    case SH4_AREA_P1:
-    case SH4_AREA_P2:
-        return memory_map_write(data, addr & 0x1fffffff, len);
-    case SH4_AREA_P4:
+    switch (sh4_mem_page(sh4, addr)) {
+    case SH4_MEM_PAGE_PHYS:
+        return memory_map_write(data, addr & MEMORY_MAP_ADDR_MASK, len);
+    case SH4_MEM_PAGE_ORA:
+        sh4_ocache_do_write_ora(sh4, data, addr, len);
+        return MEM_ACCESS_SUCCESS;
+    case SH4_MEM_PAGE_P4:
         return sh4_do_write_p4(sh4, data, addr, len);
+    case SH4_MEM_PAGE_TLB:
+        return sh4_mem_tlb_unimplemented(addr, len);
     default:
         break;
     }
@@ -124,14 +242,9 @@ int sh4_do_write_mem(Sh4 *sh4, void const *data, addr32_t addr, unsigned len) {
     exit(1); // never happens
 }
 
-int sh4_read_mem(Sh4 *sh4, void *data, addr32_t addr, unsigned len) {
-#ifdef ENABLE_DEBUGGER
-    struct debugger *dbg = dreamcast_get_debugger();
-    if (dbg && debug_is_r_watch(dbg, addr, len)) {
-        sh4->aborted_operation = true;
-        return MEM_ACCESS_EXC;
-    }
-#endif
+int sh4_read_mem_buf(Sh4 *sh4, void *data, addr32_t addr, unsigned len) {
+    SH4_MEM_CHECK_R_WATCH(addr, len);
+
     int ret;
 
     if ((ret = sh4_do_read_mem(sh4, data, addr, len)) == MEM_ACCESS_FAILURE)
@@ -140,61 +253,16 @@ int sh4_read_mem(Sh4 *sh4, void *data, addr32_t addr, unsigned len) {
 }
 
 int sh4_do_read_mem(Sh4 *sh4, void *data, addr32_t addr, unsigned len) {
-
-    enum VirtMemArea virt_area = sh4_get_mem_area(addr);
-
-#if 0
-    /*
-     * this is commented out because you can't leave privileged mode without
-     * raising an EROR_UNIMPLEMENTED (see sh4_on_sr_change in sh4.c)
-     */
-    bool privileged = sh4->reg[SH4_REG_SR] & SH4_SR_MD_MASK ? true : false;
-
-    if (virt_area != SH4_AREA_P0 && !privileged) {
-        // TODO: allow user-mode access to the store queue area
-
-        /*
-         * The spec says user-mode processes can only write to the U0 area
-         * (which overlaps with P0) and the store queue area but I can't find
-         * the part where it describes what needs to be done.  Raising the
-         * SH4_EXCP_DATA_TLB_WRITE_PROT_VIOL exception seems incorrect since that
-         * looks like it's for instances where the page can be looked up in the
-         * TLB.
-         */
-        error_set_feature("CPU exception for unprivileged "
-                          "access to high memory areas");
-        PENDING_ERROR(ERROR_UNIMPLEMENTED);
-        return MEM_ACCESS_FAILURE;
-    }
-#endif
-
-    switch (virt_area) {
-    case SH4_AREA_P0:
-    case SH4_AREA_P3:
-        /*
-         * TODO: Check for MMUCR_AT_MASK in the MMUCR register and raise an
-         * error or do TLB lookups accordingly.
-         *
-         * currently it is impossible for this to be set because of the
-         * ERROR_UNIMPLEMENTED that gets raised if you set this bit in sh4_reg.c
-         */
-
-        // handle the case where OCE is enabled and ORA is
-        // enabled but we don't have Ocache available
-        if ((sh4->reg[SH4_REG_CCR] & SH4_CCR_OCE_MASK) &&
-            (sh4->reg[SH4_REG_CCR] & SH4_CCR_ORA_MASK) &&
-            sh4_ocache_in_ram_area(addr)) {
-            sh4_ocache_do_read_ora(sh4, data, addr, len);
-            return MEM_ACCESS_SUCCESS;
-        }
-
-        // don't use the cache
-        // INTENTIONAL FALLTHROUGH
-    case SH4_AREA_P1:
-    case SH4_AREA_P2:
-        return memory_map_read(data, addr & 0x1fffffff, len);
-    case SH4_AREA_P4:
+    switch (sh4_mem_page(sh4, addr)) {
+    case SH4_MEM_PAGE_PHYS:
+        return memory_map_read(data, addr & MEMORY_MAP_ADDR_MASK, len);
+    case SH4_MEM_PAGE_ORA:
+        sh4_ocache_do_read_ora(sh4, data, addr, len);
+        return MEM_ACCESS_SUCCESS;
+    case SH4_MEM_PAGE_P4:
         return sh4_do_read_p4(sh4, data, addr, len);
+    case SH4_MEM_PAGE_TLB:
+        return sh4_mem_tlb_unimplemented(addr, len);
     default:
         break;
     }
@@ -242,74 +310,21 @@ int sh4_do_write_p4(Sh4 *sh4, void const *dat, addr32_t addr, unsigned len) {
 
 
 int sh4_read_inst(Sh4 *sh4, inst_t *out, addr32_t addr) {
-    enum VirtMemArea virt_area = sh4_get_mem_area(addr);
-
-#if 0
-    /*
-     * this is commented out because you can't leave privileged mode without
-     * raising an EROR_UNIMPLEMENTED (see sh4_on_sr_change in sh4.c)
-     */
-    bool privileged = sh4->reg[SH4_REG_SR] & SH4_SR_MD_MASK ? true : false;
-
-    if (virt_area != SH4_AREA_P0 && !privileged) {
-        /*
-         * The spec says user-mode processes can only access the U0 area
-         * (which overlaps with P0) and the store queue area but I can't find
-         * the part where it describes what needs to be done.  Raising the
-         * SH4_EXCP_DATA_TLB_WRITE_PROT_VIOL exception seems incorrect since that
-         * looks like it's for instances where the page can be looked up in the
-         * TLB.
-         */
-        error_set_feature("CPU exception for unprivileged "
-                          "access to high memory areas");
-        PENDING_ERROR(ERROR_UNIMPLEMENTED);
-        return MEM_ACCESS_FAILURE;
-    }
-#endif
-
-    switch (virt_area) {
-    case SH4_AREA_P0:
-    case SH4_AREA_P3:
-        /*
-         * TODO: Check for MMUCR_AT_MASK in the MMUCR register and raise an
-         * error or do TLB lookups accordingly.
-         *
-         * currently it is impossible for this to be set because of the
-         * ERROR_UNIMPLEMENTED that gets raised if you set this bit in sh4_reg.c
-         */
-    case SH4_AREA_P1:
-    case SH4_AREA_P2:
-        return memory_map_read(out, addr & 0x1fffffff, sizeof(*out));
-    case SH4_AREA_P4:
+    switch (sh4_mem_page(sh4, addr)) {
+    case SH4_MEM_PAGE_PHYS:
+    case SH4_MEM_PAGE_ORA:
+        // the operand cache doesn't have anything to do with instructions
+        return memory_map_read_16(out, addr & MEMORY_MAP_ADDR_MASK);
+    case SH4_MEM_PAGE_P4:
         error_set_feature("CPU exception for reading instructions from the P4 "
                           "memory area");
         PENDING_ERROR(ERROR_UNIMPLEMENTED);
         return MEM_ACCESS_FAILURE;
+    case SH4_MEM_PAGE_TLB:
+        return sh4_mem_tlb_unimplemented(addr, sizeof(*out));
     default:
         break;
     }
 
     return MEM_ACCESS_EXC;
 }
-
-static inline enum VirtMemArea sh4_get_mem_area(addr32_t addr) {
-    /*
-     * XXX I tried replacing this block of if statements with a lookup table,
-     * but somehow it turned out to be slower that way.  This is possibly
-     * because the lookup-table was not in the cache and had to be fetched from
-     * memory.
-     *
-     * If you ever want to look into this again, the trick is to use the upper
-     * four bits as the index into the lookup table (P0 will be 0-7,
-     * P1 will be 8-9, etc.)
-     */
-    if (addr <= SH4_AREA_P0_LAST)
-        return SH4_AREA_P0;
-    if (addr >= SH4_AREA_P1_FIRST && addr <= SH4_AREA_P1_LAST)
-        return SH4_AREA_P1;
-    if (addr >= SH4_AREA_P2_FIRST && addr <= SH4_AREA_P2_LAST)
-        return SH4_AREA_P2;
-    if (addr >= SH4_AREA_P3_FIRST && addr <= SH4_AREA_P3_LAST)
-        return SH4_AREA_P3;
-    return SH4_AREA_P4;
-}
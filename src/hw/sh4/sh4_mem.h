@@ -24,20 +24,18 @@
 #define SH4_MEM_H_
 
 #include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "types.h"
+#include "mem_code.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 struct Sh4;
-
-enum VirtMemArea {
-    SH4_AREA_P0 = 0,
-    SH4_AREA_P1,
-    SH4_AREA_P2,
-    SH4_AREA_P3,
-    SH4_AREA_P4
-};
+typedef struct Sh4 Sh4;
 
 // Physical memory aread boundaries
 #define SH4_AREA_P0_FIRST  0x00000000
@@ -74,16 +72,106 @@ static_assert((SH4_P4_REGEND - SH4_P4_REGSTART) ==
 #define SH4_OP_CACHE_LINE_SIZE (SH4_LONGS_PER_OP_CACHE_LINE * 4)
 #define SH4_OC_RAM_AREA_SIZE (8 * 1024)
 
+/*
+ * Each 16MB page of the CPU's virtual address space gets one of these, which
+ * says what a memory access to that page has to do.  This is what
+ * sh4_get_mem_area used to figure out with a chain of if-statements, except
+ * it also takes CCR and MMUCR into account so that the common case (plain old
+ * physical memory) doesn't need to look at either of those registers.
+ *
+ * sh4_mem_refresh_pages has to be called whenever CCR or MMUCR changes.
+ */
+#define SH4_MEM_PAGE_SHIFT 24
+#define SH4_MEM_N_PAGES (1 << (32 - SH4_MEM_PAGE_SHIFT))
+
+enum sh4_mem_page_type {
+    // the lower 29 bits go straight to the memory map
+    SH4_MEM_PAGE_PHYS,
+
+    // operand-cache RAM (CCR.ORA).  Instruction fetches treat this as PHYS.
+    SH4_MEM_PAGE_ORA,
+
+    // P4 area: store queues, memory-mapped registers, cache arrays.
+    SH4_MEM_PAGE_P4,
+
+    // address translation is enabled (MMUCR.AT).  This is not implemented.
+    SH4_MEM_PAGE_TLB
+};
+
+void sh4_mem_refresh_pages(Sh4 *sh4);
+
 /*
  * From within the CPU, these functions should be called instead of
  * the memory's read/write functions because these implement the MMU
  * functionality.  In the event of a CPU exception, these functions will set the
  * appropriate CPU flags for an exception and return non-zero.  On success
  * they will return zero.
+ *
+ * The sized versions are what pretty much every instruction ends up calling;
+ * sh4_read_mem/sh4_write_mem just pick one of those based on len (which is
+ * almost always a compile-time constant) and only fall back to the
+ * _buf versions for odd sizes.
  */
-int sh4_write_mem(Sh4 *sh4, void const *dat, addr32_t addr, unsigned len);
-int sh4_read_mem(Sh4 *sh4, void *dat, addr32_t addr, unsigned len);
+int sh4_read_mem_8(Sh4 *sh4, uint8_t *valp, addr32_t addr);
+int sh4_read_mem_16(Sh4 *sh4, uint16_t *valp, addr32_t addr);
+int sh4_read_mem_32(Sh4 *sh4, uint32_t *valp, addr32_t addr);
+int sh4_read_mem_64(Sh4 *sh4, uint64_t *valp, addr32_t addr);
+
+int sh4_write_mem_8(Sh4 *sh4, uint8_t val, addr32_t addr);
+int sh4_write_mem_16(Sh4 *sh4, uint16_t val, addr32_t addr);
+int sh4_write_mem_32(Sh4 *sh4, uint32_t val, addr32_t addr);
+int sh4_write_mem_64(Sh4 *sh4, uint64_t val, addr32_t addr);
+
+int sh4_write_mem_buf(Sh4 *sh4, void const *dat, addr32_t addr, unsigned len);
+int sh4_read_mem_buf(Sh4 *sh4, void *dat, addr32_t addr, unsigned len);
 
+#define SH4_MEM_READ_SIZED(bits)                                        \
+    do {                                                                \
+        uint##bits##_t val;                                             \
+        int ret = sh4_read_mem_##bits(sh4, &val, addr);                 \
+        if (ret == MEM_ACCESS_SUCCESS)                                  \
+            memcpy(dat, &val, sizeof(val));                             \
+        return ret;                                                     \
+    } while (0)
+
+#define SH4_MEM_WRITE_SIZED(bits)                                       \
+    do {                                                                \
+        uint##bits##_t val;                                             \
+        memcpy(&val, dat, sizeof(val));                                 \
+        return sh4_write_mem_##bits(sh4, val, addr);                    \
+    } while (0)
+
+static inline int
+sh4_read_mem(Sh4 *sh4, void *dat, addr32_t addr, unsigned len) {
+    switch (len) {
+    case 1:
+        SH4_MEM_READ_SIZED(8);
+    case 2:
+        SH4_MEM_READ_SIZED(16);
+    case 4:
+        SH4_MEM_READ_SIZED(32);
+    case 8:
+        SH4_MEM_READ_SIZED(64);
+    default:
+        return sh4_read_mem_buf(sh4, dat, addr, len);
+    }
+}
+
+static inline int
+sh4_write_mem(Sh4 *sh4, void const *dat, addr32_t addr, unsigned len) {
+    switch (len) {
+    case 1:
+        SH4_MEM_WRITE_SIZED(8);
+    case 2:
+        SH4_MEM_WRITE_SIZED(16);
+    case 4:
+        SH4_MEM_WRITE_SIZED(32);
+    case 8:
+        SH4_MEM_WRITE_SIZED(64);
+    default:
+        return sh4_write_mem_buf(sh4, dat, addr, len);
+    }
+}
 
 /*
  * same as sh4_write_mem/sh4_read_mem, except they don't automatically raise
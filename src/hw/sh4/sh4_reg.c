@@ -29,6 +29,7 @@
 #include "sh4_tmu.h"
 #include "sh4_dmac.h"
 #include "sh4.h"
+#include "mmio.h"
 
 static struct Sh4MemMappedReg *find_reg_by_addr(addr32_t addr);
 
@@ -42,6 +43,8 @@ static int sh4_id_reg_read_handler(Sh4 *sh4, void *buf,
 
 static int sh4_mmucr_reg_write_handler(Sh4 *sh4, void const *buf,
                                        struct Sh4MemMappedReg const *reg_info);
+static int sh4_ccr_reg_write_handler(Sh4 *sh4, void const *buf,
+                                     struct Sh4MemMappedReg const *reg_info);
 
 static struct Sh4MemMappedReg mem_mapped_regs[] = {
     { "EXPEVT", 0xff000024, ~((addr32_t)0), 4, SH4_REG_EXPEVT, false,
@@ -51,7 +54,7 @@ static struct Sh4MemMappedReg mem_mapped_regs[] = {
     { "MMUCR", 0xff000010, ~((addr32_t)0), 4, SH4_REG_MMUCR, false,
       Sh4WarnRegReadHandler, sh4_mmucr_reg_write_handler, 0, 0 },
     { "CCR", 0xff00001c, ~((addr32_t)0), 4, SH4_REG_CCR, false,
-      Sh4DefaultRegReadHandler, Sh4DefaultRegWriteHandler, 0, 0 },
+      Sh4DefaultRegReadHandler, sh4_ccr_reg_write_handler, 0, 0 },
     { "QACR0", 0xff000038, ~((addr32_t)0), 4, SH4_REG_QACR0, false,
       Sh4DefaultRegReadHandler, Sh4DefaultRegWriteHandler, 0, 0 },
     { "QACR1", 0xff00003c, ~((addr32_t)0), 4, SH4_REG_QACR1, false,
@@ -254,6 +257,14 @@ static struct Sh4MemMappedReg mem_mapped_regs[] = {
       Sh4DefaultRegReadHandler, Sh4DefaultRegWriteHandler, 0, 0 },
 
     /* DMA Controller (DMAC) */
+    { "SAR0", 0xffa00000, ~((addr32_t)0), 4, (sh4_reg_idx_t)-1, true,
+      sh4_dmac_sar_reg_read_handler, sh4_dmac_sar_reg_write_handler, 0, 0 },
+    { "DAR0", 0xffa00004, ~((addr32_t)0), 4, (sh4_reg_idx_t)-1, true,
+      sh4_dmac_dar_reg_read_handler, sh4_dmac_dar_reg_write_handler, 0, 0 },
+    { "DMATCR0", 0xffa00008, ~((addr32_t)0), 4, (sh4_reg_idx_t)-1, true,
+      sh4_dmac_dmatcr_reg_read_handler, sh4_dmac_dmatcr_reg_write_handler, 0, 0 },
+    { "CHCR0", 0xffa0000c, ~((addr32_t)0), 4, (sh4_reg_idx_t)-1, true,
+      sh4_dmac_chcr_reg_read_handler, sh4_dmac_chcr_reg_write_handler, 0, 0 },
     { "SAR1", 0xffa00010, ~((addr32_t)0), 4, SH4_REG_SAR1, true,
       sh4_dmac_sar_reg_read_handler, sh4_dmac_sar_reg_write_handler, 0, 0 },
     { "DAR1", 0xffa00014, ~((addr32_t)0), 4, SH4_REG_DAR1, true,
@@ -279,7 +290,8 @@ static struct Sh4MemMappedReg mem_mapped_regs[] = {
     { "CHCR3", 0xffa0003c, ~((addr32_t)0), 4, SH4_REG_CHCR3, true,
       sh4_dmac_chcr_reg_read_handler, sh4_dmac_chcr_reg_write_handler, 0, 0 },
     { "DMAOR", 0xffa00040, ~((addr32_t)0), 4, SH4_REG_DMAOR, true,
-      Sh4WarnRegReadHandler, Sh4WarnRegWriteHandler, 0, 0 },
+      sh4_dmac_dmaor_reg_read_handler, sh4_dmac_dmaor_reg_write_handler,
+      0, 0 },
 
     /* Serial port */
     { "SCSMR2", 0xffe80000, ~((addr32_t)0), 2, SH4_REG_SCSMR2, false,
@@ -393,9 +405,38 @@ void sh4_poweron_reset_regs(Sh4 *sh4) {
     *sh4_gen_reg(sh4, 15) = 0x8c00f400;
 }
 
+/*
+ * Registers that are decoded by their exact address go into the map by
+ * address, and registers that are decoded with an address mask (the SDMR
+ * registers) get the whole page.  find_reg_by_addr still does the mask check
+ * on whatever it gets back from the map, so anything weird just falls through
+ * to the linear search.
+ */
+static struct mmio_map sh4_reg_map;
+
+void sh4_init_reg_map(void) {
+    struct Sh4MemMappedReg *reg;
+
+    mmio_map_init(&sh4_reg_map, SH4_P4_REGSTART, SH4_P4_REGEND - 1);
+    for (reg = mem_mapped_regs; reg->reg_name; reg++) {
+        if (reg->addr_mask == ~((addr32_t)0))
+            mmio_map_add(&sh4_reg_map, reg->addr, reg->len, reg);
+        else
+            mmio_map_add_page(&sh4_reg_map, reg->addr, reg);
+    }
+}
+
+void sh4_cleanup_reg_map(void) {
+    mmio_map_cleanup(&sh4_reg_map);
+}
+
 static struct Sh4MemMappedReg *find_reg_by_addr(addr32_t addr) {
-    struct Sh4MemMappedReg *curs = mem_mapped_regs;
+    struct Sh4MemMappedReg *curs = mmio_map_find(&sh4_reg_map, addr);
 
+    if (curs && curs->addr == (addr & curs->addr_mask))
+        return curs;
+
+    curs = mem_mapped_regs;
     while (curs->reg_name) {
         if (curs->addr == (addr & curs->addr_mask))
             return curs;
@@ -686,6 +727,7 @@ static int sh4_mmucr_reg_write_handler(Sh4 *sh4, void const *buf,
     memcpy(&new_val, buf, sizeof(new_val));
 
     sh4->reg[SH4_REG_MMUCR] = new_val;
+    sh4_mem_refresh_pages(sh4);
 
     if (new_val & SH4_MMUCR_AT_MASK) {
         error_set_feature("SH4 MMU support");
@@ -694,3 +736,16 @@ static int sh4_mmucr_reg_write_handler(Sh4 *sh4, void const *buf,
 
     return 0;
 }
+
+static int sh4_ccr_reg_write_handler(Sh4 *sh4, void const *buf,
+                                     struct Sh4MemMappedReg const *reg_info) {
+    uint32_t new_val;
+    memcpy(&new_val, buf, sizeof(new_val));
+
+    sh4->reg[SH4_REG_CCR] = new_val;
+
+    // OCE and ORA decide whether operand-cache RAM is mapped in
+    sh4_mem_refresh_pages(sh4);
+
+    return 0;
+}
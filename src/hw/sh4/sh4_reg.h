@@ -386,6 +386,10 @@ typedef struct Sh4MemMappedReg Sh4MemMappedReg;
  */
 void sh4_init_regs(Sh4 *sh4);
 
+// sets up/tears down the lookup table for the memory-mapped registers
+void sh4_init_reg_map(void);
+void sh4_cleanup_reg_map(void);
+
 // set up the memory-mapped registers for a reset;
 void sh4_poweron_reset_regs(Sh4 *sh4);
 
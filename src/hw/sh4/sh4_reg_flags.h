@@ -513,9 +513,46 @@ extern "C" {
  *
  ******************************************************************************/
 
+// DMAC Enable
+#define SH4_DMAC_CHCR_DE_SHIFT 0
+#define SH4_DMAC_CHCR_DE_MASK (1 << SH4_DMAC_CHCR_DE_SHIFT)
+
+// Transfer End
 #define SH4_DMAC_CHCR_TE_SHIFT 1
 #define SH4_DMAC_CHCR_TE_MASK (1 << SH4_DMAC_CHCR_TE_SHIFT)
 
+// Interrupt Enable
+#define SH4_DMAC_CHCR_IE_SHIFT 2
+#define SH4_DMAC_CHCR_IE_MASK (1 << SH4_DMAC_CHCR_IE_SHIFT)
+
+// Transmit Size
+#define SH4_DMAC_CHCR_TS_SHIFT 4
+#define SH4_DMAC_CHCR_TS_MASK (7 << SH4_DMAC_CHCR_TS_SHIFT)
+
+// Resource Select
+#define SH4_DMAC_CHCR_RS_SHIFT 8
+#define SH4_DMAC_CHCR_RS_MASK (0xf << SH4_DMAC_CHCR_RS_SHIFT)
+
+// Source Address Mode
+#define SH4_DMAC_CHCR_SM_SHIFT 12
+#define SH4_DMAC_CHCR_SM_MASK (3 << SH4_DMAC_CHCR_SM_SHIFT)
+
+// Destination Address Mode
+#define SH4_DMAC_CHCR_DM_SHIFT 14
+#define SH4_DMAC_CHCR_DM_MASK (3 << SH4_DMAC_CHCR_DM_SHIFT)
+
+// DMAC Master Enable
+#define SH4_DMAC_DMAOR_DME_SHIFT 0
+#define SH4_DMAC_DMAOR_DME_MASK (1 << SH4_DMAC_DMAOR_DME_SHIFT)
+
+// NMI Flag
+#define SH4_DMAC_DMAOR_NMIF_SHIFT 1
+#define SH4_DMAC_DMAOR_NMIF_MASK (1 << SH4_DMAC_DMAOR_NMIF_SHIFT)
+
+// Address Error Flag
+#define SH4_DMAC_DMAOR_AE_SHIFT 2
+#define SH4_DMAC_DMAOR_AE_MASK (1 << SH4_DMAC_DMAOR_AE_SHIFT)
+
 #ifdef __cplusplus
 }
 #endif
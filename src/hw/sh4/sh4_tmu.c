@@ -426,6 +426,7 @@ int sh4_tmu_tcnt_read_handler(Sh4 *sh4, void *buf,
     }
 
     tmu_chan_sync(sh4, chan);
+    sh4_idle_clock_read();
     return Sh4DefaultRegReadHandler(sh4, buf, reg_info);
 }
 
@@ -29,6 +29,7 @@
 #include "dreamcast.h"
 #include "hw/sh4/sh4.h"
 #include "hw/sh4/sh4_dmac.h"
+#include "mmio.h"
 
 #include "sys_block.h"
 
@@ -266,8 +267,20 @@ static int warn_sys_reg_write_handler(struct sys_mapped_reg const *reg_info,
     return default_sys_reg_write_handler(reg_info, buf, addr, len);
 }
 
+static struct mmio_map sys_block_map;
+
+void sys_block_init(void) {
+    MMIO_MAP_INIT_TABLE(&sys_block_map, ADDR_SYS_FIRST, ADDR_SYS_LAST,
+                        struct sys_mapped_reg, sys_reg_info, ent->len);
+}
+
+void sys_block_cleanup(void) {
+    mmio_map_cleanup(&sys_block_map);
+}
+
 int sys_block_read(void *buf, size_t addr, size_t len) {
-    struct sys_mapped_reg *curs = sys_reg_info;
+    struct sys_mapped_reg *curs =
+        mmio_map_search_start(&sys_block_map, addr, sys_reg_info);
 
     while (curs->reg_name) {
         if (curs->addr == addr) {
@@ -293,7 +306,8 @@ int sys_block_read(void *buf, size_t addr, size_t len) {
 }
 
 int sys_block_write(void const *buf, size_t addr, size_t len) {
-    struct sys_mapped_reg *curs = sys_reg_info;
+    struct sys_mapped_reg *curs =
+        mmio_map_search_start(&sys_block_map, addr, sys_reg_info);
 
     while (curs->reg_name) {
         if (curs->addr == addr) {
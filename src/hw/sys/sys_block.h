@@ -34,6 +34,9 @@
 extern "C" {
 #endif
 
+void sys_block_init(void);
+void sys_block_cleanup(void);
+
 int sys_block_read(void *buf, size_t addr, size_t len);
 int sys_block_write(void const *buf, size_t addr, size_t len);
 
@@ -30,6 +30,8 @@
 #include "gfx/gfx_thread.h"
 #include "win/win_thread.h"
 #include "hw/pvr2/framebuffer.h"
+#include "hw/pvr2/geo_buf.h"
+#include "hw/pvr2/pvr2_tex_decode.h"
 #include "gfx/opengl/opengl_output.h"
 #include "mount.h"
 #include "gdi.h"
@@ -49,8 +51,21 @@ static void print_usage(char const *cmd) {
             "\t-s\t\tpath to dreamcast system call image (only needed for "
             "direct boot)\n"
             "\t-t\t\testablish serial server over TCP port 1998\n"
+            "\t-j\t\tenable the x86-64 dynamic recompiler\n"
+            "\t-i\t\trun the CPU through the optimizing IR interpreter\n"
+            "\t-I\t\tsame as -i, and print the hottest IR blocks before "
+            "and after optimization on exit\n"
+            "\t-c\t\trun the CPU through the cached (pre-decoded) "
+            "interpreter\n"
+            "\t-r <count>\tnumber of frames that can be queued up for the "
+            "renderer (default %u, minimum 2)\n"
+            "\t-F\t\twhen the renderer falls behind, drop the oldest "
+            "queued frame instead of waiting for it\n"
+            "\t-T <count>\tnumber of threads for decoding textures "
+            "(default %u, 0 decodes them on the CPU thread)\n"
             "\t-h\t\tdisplay this message and exit\n"
-            "\t-m\t\tmount the given image in the GD-ROM drive\n");
+            "\t-m\t\tmount the given image in the GD-ROM drive\n",
+            GEO_BUF_COUNT_DEFAULT, PVR2_TEX_DECODE_THREADS_DEFAULT);
 }
 
 int main(int argc, char **argv) {
@@ -63,8 +78,14 @@ int main(int argc, char **argv) {
     char const *path_syscalls_bin = NULL;
     char const *path_gdi = NULL;
     bool enable_serial = false;
+    bool enable_jit = false;
+    bool enable_ir = false, dump_ir = false;
+    bool enable_cached_interp = false;
+    unsigned n_geo_bufs = GEO_BUF_COUNT_DEFAULT;
+    enum geo_buf_policy geo_buf_policy = GEO_BUF_POLICY_BLOCK;
+    unsigned n_tex_threads = PVR2_TEX_DECODE_THREADS_DEFAULT;
 
-    while ((opt = getopt(argc, argv, "b:f:s:m:gduht")) != -1) {
+    while ((opt = getopt(argc, argv, "b:f:s:m:r:T:gduhtjiIcF")) != -1) {
         switch (opt) {
         case 'b':
             bios_path = optarg;
@@ -102,6 +123,35 @@ int main(int argc, char **argv) {
         case 'm':
             path_gdi = optarg;
             break;
+        case 'j':
+            enable_jit = true;
+            break;
+        case 'I':
+            dump_ir = true;
+            // fall-through
+        case 'i':
+            enable_ir = true;
+            break;
+        case 'c':
+            enable_cached_interp = true;
+            break;
+        case 'r':
+            if (atoi(optarg) < 2) {
+                fprintf(stderr, "Error: -r needs at least 2 frames\n");
+                exit(1);
+            }
+            n_geo_bufs = atoi(optarg);
+            break;
+        case 'F':
+            geo_buf_policy = GEO_BUF_POLICY_DROP_OLDEST;
+            break;
+        case 'T':
+            if (atoi(optarg) < 0) {
+                fprintf(stderr, "Error: -T can't be negative\n");
+                exit(1);
+            }
+            n_tex_threads = atoi(optarg);
+            break;
         case 'h':
             print_usage(cmd);
             exit(0);
@@ -119,6 +169,31 @@ int main(int argc, char **argv) {
         exit(1);
     }
 
+    if (enable_jit && enable_debugger) {
+        fprintf(stderr, "Error: the JIT (-j) cannot be used with the remote "
+                "GDB backend (-g)\n");
+        exit(1);
+    }
+
+    if (enable_ir && enable_debugger) {
+        fprintf(stderr, "Error: the IR interpreter (-i) cannot be used with "
+                "the remote GDB backend (-g)\n");
+        exit(1);
+    }
+
+    if (enable_cached_interp && enable_debugger) {
+        fprintf(stderr, "Error: the cached interpreter (-c) cannot be used "
+                "with the remote GDB backend (-g)\n");
+        exit(1);
+    }
+
+    if ((enable_jit + enable_ir + enable_cached_interp) > 1) {
+        fprintf(stderr, "Error: only one of the JIT (-j), the IR interpreter "
+                "(-i) and the cached interpreter (-c) can be used at a "
+                "time\n");
+        exit(1);
+    }
+
     if (path_syscalls_bin && !boot_direct)
         fprintf(stderr, "Warning: -s option is meaningless when not "
                 "performing a direct boot (-d option)\n");
@@ -177,16 +252,40 @@ int main(int argc, char **argv) {
 #endif
     }
 
+    if (enable_jit) {
+#ifdef ENABLE_JIT_X86_64
+        dreamcast_enable_jit();
+#else
+        fprintf(stderr, "ERROR: Unable to enable the JIT.\n"
+                "Please rebuild with -DENABLE_JIT_X86_64=On\n");
+        exit(1);
+#endif
+    }
+
+    if (enable_ir)
+        dreamcast_enable_ir(dump_ir);
+
+    if (enable_cached_interp)
+        dreamcast_enable_cached_interp();
+
     framebuffer_init(640, 480);
+    geo_buf_init(n_geo_bufs, geo_buf_policy);
+    pvr2_tex_decode_init(n_tex_threads);
     win_thread_launch(640, 480);
     gfx_thread_launch(640, 480);
 
     dreamcast_run();
 
+    // the CPU thread was the only one handing out decode jobs
+    pvr2_tex_decode_cleanup();
+
     printf("Waiting for gfx_thread to exit...\n");
     gfx_thread_join();
     printf("gfx_thread has exited.\n");
 
+    // this has to wait until the gfx_thread can't be rendering anymore
+    geo_buf_cleanup();
+
     printf("Waiting for win_thread to exit...\n");
     win_thread_join();
     printf("win_thread has exited.\n");
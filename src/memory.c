@@ -27,13 +27,28 @@
 
 #include "memory.h"
 
+#ifdef ENABLE_FASTMEM
+#include "fastmem.h"
+#endif
+
 void memory_init(struct Memory *mem) {
-    mem->mem = (uint8_t*)malloc(sizeof(uint8_t) * MEMORY_SIZE);
+#ifdef ENABLE_FASTMEM
+    /*
+     * fastmem needs RAM to come from a memfd so that it can map it into its
+     * window.  If that doesn't work out then it's just a regular malloc.
+     */
+    if (!(mem->mem = (uint8_t*)fastmem_ram_alloc(MEMORY_SIZE)))
+#endif
+        mem->mem = (uint8_t*)malloc(sizeof(uint8_t) * MEMORY_SIZE);
 
     memory_clear(mem);
 }
 
 void memory_cleanup(struct Memory *mem) {
+#ifdef ENABLE_FASTMEM
+    if (fastmem_ram_free(mem->mem))
+        return;
+#endif
     free(mem->mem);
 }
 
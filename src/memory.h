@@ -24,6 +24,7 @@
 #define MEMORY_HPP_
 
 #include <stdint.h>
+#include <string.h>
 
 #include "error.h"
 #include "types.h"
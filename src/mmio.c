@@ -0,0 +1,98 @@
+/*******************************************************************************
+ *
+ *
+ *    WashingtonDC Dreamcast Emulator
+ *    Copyright (C) 2017 snickerbockers
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ******************************************************************************/
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "error.h"
+
+#include "mmio.h"
+
+void mmio_map_init(struct mmio_map *map, addr32_t first, addr32_t last) {
+    map->first = first;
+    map->n_pages = ((last - first) >> MMIO_PAGE_SHIFT) + 1;
+    map->pages = (struct mmio_page*)calloc(map->n_pages,
+                                           sizeof(struct mmio_page));
+    if (!map->pages)
+        RAISE_ERROR(ERROR_FAILED_ALLOC);
+}
+
+void mmio_map_cleanup(struct mmio_map *map) {
+    unsigned page_no;
+
+    for (page_no = 0; page_no < map->n_pages; page_no++)
+        free(map->pages[page_no].slots);
+    free(map->pages);
+
+    memset(map, 0, sizeof(*map));
+}
+
+static struct mmio_page *mmio_map_get_page(struct mmio_map *map,
+                                           addr32_t addr) {
+    unsigned page_no = (addr - map->first) >> MMIO_PAGE_SHIFT;
+
+    if (addr < map->first || page_no >= map->n_pages) {
+        error_set_address(addr);
+        RAISE_ERROR(ERROR_INTEGRITY);
+    }
+
+    return map->pages + page_no;
+}
+
+void mmio_map_add(struct mmio_map *map, addr32_t addr, unsigned len,
+                  void *ent) {
+    addr32_t cur;
+
+    if (!len)
+        len = 1;
+
+    for (cur = addr & ~((1 << MMIO_SLOT_SHIFT) - 1); cur < addr + len;
+         cur += 1 << MMIO_SLOT_SHIFT) {
+        struct mmio_page *page = mmio_map_get_page(map, cur);
+        unsigned slot_no = ((cur - map->first) & MMIO_PAGE_MASK) >>
+            MMIO_SLOT_SHIFT;
+
+        if (slot_no >= page->n_slots) {
+            // grow the page just enough to hold the new slot
+            void **slots = (void**)realloc(page->slots,
+                                           (slot_no + 1) * sizeof(void*));
+            if (!slots)
+                RAISE_ERROR(ERROR_FAILED_ALLOC);
+            memset(slots + page->n_slots, 0,
+                   (slot_no + 1 - page->n_slots) * sizeof(void*));
+            page->slots = slots;
+            page->n_slots = slot_no + 1;
+        }
+
+        // first come, first served (see mmio.h)
+        if (!page->slots[slot_no])
+            page->slots[slot_no] = ent;
+    }
+}
+
+void mmio_map_add_page(struct mmio_map *map, addr32_t addr, void *ent) {
+    struct mmio_page *page = mmio_map_get_page(map, addr);
+
+    if (!page->fallback)
+        page->fallback = ent;
+}
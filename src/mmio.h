@@ -0,0 +1,144 @@
+/*******************************************************************************
+ *
+ *
+ *    WashingtonDC Dreamcast Emulator
+ *    Copyright (C) 2017 snickerbockers
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ******************************************************************************/
+
+
+#ifndef MMIO_H_
+#define MMIO_H_
+
+#include <stddef.h>
+
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * MMIO register lookup tables.
+ *
+ * Every device that has memory-mapped registers keeps them in a table of
+ * structs that start with a name, an address and a length.  Finding the right
+ * entry used to mean walking the table from the top on every single access,
+ * which adds up for registers that software polls in a loop (SB_ISTNRM,
+ * SPG_STATUS, the GD-ROM status register, etc).
+ *
+ * An mmio_map sits in front of one of those tables.  The device registers
+ * every entry in its table with mmio_map_add when it gets initialized, and
+ * after that mmio_map_find gets from an address to the table entry that
+ * covers it with two array lookups: one for the 64KB page the address is in
+ * and one for the 4-byte slot inside of that page.
+ *
+ * The map doesn't know anything about what the entries look like, so the
+ * device still walks its table to find the entry that actually matches the
+ * access (the exact address, the length, etc); the map just tells it where to
+ * start walking.  When more than one entry lands in the same slot, the first
+ * one added wins.  Every entry that could match an access covers the
+ * access's slot, so as long as the entries were added in table order
+ * (MMIO_MAP_INIT_TABLE does that) the entry the map returns is never past the
+ * one a linear search from the top would have found.
+ */
+
+#define MMIO_PAGE_SHIFT 16
+#define MMIO_PAGE_SIZE (1 << MMIO_PAGE_SHIFT)
+#define MMIO_PAGE_MASK (MMIO_PAGE_SIZE - 1)
+
+#define MMIO_SLOT_SHIFT 2
+
+struct mmio_page {
+    // slots[n] covers page offsets (n << MMIO_SLOT_SHIFT) and up
+    void **slots;
+    unsigned n_slots;
+
+    /*
+     * this gets returned for any address in the page that doesn't have a
+     * slot of its own.  It's for registers that are decoded with an address
+     * mask instead of by their exact address.
+     */
+    void *fallback;
+};
+
+struct mmio_map {
+    addr32_t first;
+    unsigned n_pages;
+    struct mmio_page *pages;
+};
+
+// first and last are the range of addresses the map covers
+void mmio_map_init(struct mmio_map *map, addr32_t first, addr32_t last);
+void mmio_map_cleanup(struct mmio_map *map);
+
+// map the len bytes starting at addr to ent
+void mmio_map_add(struct mmio_map *map, addr32_t addr, unsigned len,
+                  void *ent);
+
+// map every address in the page that addr is in to ent
+void mmio_map_add_page(struct mmio_map *map, addr32_t addr, void *ent);
+
+/*
+ * returns the entry that covers addr, or NULL if there isn't one (or if the
+ * map hasn't been initialized).
+ */
+static inline void *mmio_map_find(struct mmio_map const *map, addr32_t addr) {
+    addr32_t offs = addr - map->first;
+    unsigned page_no = offs >> MMIO_PAGE_SHIFT;
+
+    if (page_no >= map->n_pages)
+        return NULL;
+
+    struct mmio_page const *page = map->pages + page_no;
+    unsigned slot_no = (offs & MMIO_PAGE_MASK) >> MMIO_SLOT_SHIFT;
+
+    if (slot_no < page->n_slots && page->slots[slot_no])
+        return page->slots[slot_no];
+    return page->fallback;
+}
+
+/*
+ * Initializes map to cover first through last and adds every entry in table
+ * to it, in table order.  table is an array of ent_type that ends with an
+ * entry whose reg_name is NULL.  ent_len is the number of bytes each entry
+ * covers; it gets evaluated once per entry with ent pointing at that entry,
+ * so for most tables it's just ent->len.
+ */
+#define MMIO_MAP_INIT_TABLE(map, first, last, ent_type, table, ent_len) \
+    do {                                                                \
+        ent_type *ent;                                                  \
+        mmio_map_init((map), (first), (last));                          \
+        for (ent = (table); ent->reg_name; ent++)                       \
+            mmio_map_add((map), ent->addr, (ent_len), ent);             \
+    } while (0)
+
+/*
+ * returns the entry in table that a search for addr should start at: the one
+ * the map has for addr if there is one, or else the top of the table.
+ */
+static inline void *mmio_map_search_start(struct mmio_map const *map,
+                                          addr32_t addr, void *table) {
+    void *ent = mmio_map_find(map, addr);
+    return ent ? ent : table;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
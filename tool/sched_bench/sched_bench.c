@@ -0,0 +1,130 @@
+/*******************************************************************************
+ *
+ *
+ *    WashingtonDC Dreamcast Emulator
+ *    Copyright (C) 2017 snickerbockers
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ******************************************************************************/
+
+
+/*
+ * sched_bench: microbenchmark for the event scheduler in dc_sched.c
+ *
+ * usage: sched_bench [n_events] [n_iterations]
+ *
+ * This keeps n_events events scheduled at all times.  Every iteration pops
+ * the earliest event and schedules it again a random distance into the
+ * future, and every fourth iteration also cancels a random event and
+ * reschedules it, which is roughly what SPG and the TMU do whenever their
+ * registers get written.  It also checks that the events come out in the
+ * right order, so it doubles as a sanity test.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "dc_sched.h"
+
+#define DEFAULT_N_EVENTS 4096
+#define DEFAULT_N_ITERATIONS (16 * 1024 * 1024)
+
+// the furthest into the future any event gets scheduled
+#define MAX_DELTA 100000
+
+/*
+ * error.c wants to print this when the scheduler raises an error, but there's
+ * nothing to print here.
+ */
+void dc_print_perf_stats(void) {
+}
+
+static void bench_handler(struct SchedEvent *event) {
+}
+
+int main(int argc, char **argv) {
+    unsigned n_events = DEFAULT_N_EVENTS;
+    unsigned long n_iterations = DEFAULT_N_ITERATIONS;
+    unsigned long iteration;
+    unsigned idx;
+    dc_cycle_stamp_t now = 0;
+    struct timespec start_time, end_time;
+
+    if (argc > 1)
+        n_events = atoi(argv[1]);
+    if (argc > 2)
+        n_iterations = atol(argv[2]);
+
+    if (!n_events) {
+        fprintf(stderr, "usage: %s [n_events] [n_iterations]\n", argv[0]);
+        return 1;
+    }
+
+    struct SchedEvent *events =
+        (struct SchedEvent*)calloc(n_events, sizeof(struct SchedEvent));
+    if (!events) {
+        fprintf(stderr, "failed to allocate %u events\n", n_events);
+        return 1;
+    }
+
+    srand(0);
+
+    for (idx = 0; idx < n_events; idx++) {
+        events[idx].when = rand() % MAX_DELTA;
+        events[idx].handler = bench_handler;
+        sched_event(events + idx);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    for (iteration = 0; iteration < n_iterations; iteration++) {
+        struct SchedEvent *event = pop_event();
+
+        if (event->when < now) {
+            fprintf(stderr, "ERROR: event at %llu came out after %llu\n",
+                    (unsigned long long)event->when,
+                    (unsigned long long)now);
+            return 1;
+        }
+        now = event->when;
+        event->handler(event);
+
+        event->when = now + rand() % MAX_DELTA;
+        sched_event(event);
+
+        if (!(iteration % 4)) {
+            event = events + rand() % n_events;
+            cancel_event(event);
+            event->when = now + rand() % MAX_DELTA;
+            sched_event(event);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+    double seconds = (end_time.tv_sec - start_time.tv_sec) +
+        (end_time.tv_nsec - start_time.tv_nsec) / 1000000000.0;
+
+    printf("%lu iterations with %u events in %f seconds "
+           "(%f ns per iteration)\n", n_iterations, n_events, seconds,
+           seconds * 1000000000.0 / n_iterations);
+
+    dc_sched_cleanup();
+    free(events);
+
+    return 0;
+}
@@ -0,0 +1,283 @@
+/*******************************************************************************
+ *
+ *
+ *    WashingtonDC Dreamcast Emulator
+ *    Copyright (C) 2017 snickerbockers
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ******************************************************************************/
+
+/*
+ * sh4_inst_gen: generates operand-specialized versions of the hottest SH4
+ * instruction handlers.
+ *
+ * usage: sh4_inst_gen <sh4_inst_list.h> <sh4_inst.c> <output file>
+ *
+ * The handlers to specialize are the ones marked with SH4_INST_HOT in
+ * sh4_inst.c.  For each of them, this finds its format string in
+ * sh4_inst_list.h and writes out one tiny wrapper per possible value of the
+ * instruction's register fields (the n and m bits).  The wrapper overwrites
+ * the Sh4OpArgs it was given with the (constant) instruction it was
+ * generated for and calls the real handler, so once the real handler gets
+ * inlined every register index in it is a compile-time constant.
+ *
+ * The output is meant to be #included at the bottom of sh4_inst.c, which is
+ * what makes the inlining possible.  It also defines a table,
+ * sh4_inst_specializations, which sh4_init_inst_lut uses to point
+ * sh4_inst_lut at the wrappers.
+ *
+ * This only knows about the n and m fields because those are the only ones
+ * that are cheap to enumerate; specializing on an 8-bit immediate as well
+ * would be 4096 wrappers for a single opcode.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_HOT_HANDLERS 64
+#define MAX_HANDLER_LEN 128
+
+#define FMT_LEN 16
+
+static char *read_file(char const *path) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "unable to open %s\n", path);
+        exit(1);
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    char *buf = (char*)malloc(len + 1);
+    if (!buf || fread(buf, 1, len, fp) != (size_t)len) {
+        fprintf(stderr, "unable to read %s\n", path);
+        exit(1);
+    }
+    buf[len] = '\0';
+
+    fclose(fp);
+    return buf;
+}
+
+/*
+ * find the format string for the given handler in the contents of
+ * sh4_inst_list.h.  Entries look like this:
+ *
+ * SH4_INST("0011nnnnmmmm1100", sh4_inst_binary_add_gen_gen,
+ *          false, SH4_GROUP_EX, 1)
+ */
+static int find_fmt(char const *list, char const *handler,
+                    char fmt_out[FMT_LEN + 1]) {
+    static char const prefix[] = "SH4_INST(\"";
+    size_t handler_len = strlen(handler);
+    char const *cursor = list;
+
+    while ((cursor = strstr(cursor, prefix))) {
+        char const *fmt = cursor + strlen(prefix);
+        char const *name = fmt + FMT_LEN + 3; // skip past the ", "
+
+        cursor = fmt;
+
+        if (strlen(fmt) < FMT_LEN + 3 + handler_len ||
+            fmt[FMT_LEN] != '"' ||
+            strncmp(name, handler, handler_len) != 0 ||
+            name[handler_len] != ',')
+            continue;
+
+        memcpy(fmt_out, fmt, FMT_LEN);
+        fmt_out[FMT_LEN] = '\0';
+        return 0;
+    }
+
+    return -1;
+}
+
+struct hot_opcode {
+    char handler[MAX_HANDLER_LEN];
+
+    // the fixed bits of the instruction
+    unsigned val;
+
+    // lowest bit and width of the n and m fields (0 bits if it doesn't exist)
+    unsigned n_shift, n_bits;
+    unsigned m_shift, m_bits;
+};
+
+/*
+ * parse the fixed bits of fmt, and figure out where the n and m fields are.
+ * Returns nonzero if fmt has any fields other than n and m.
+ */
+static int parse_fmt(char const fmt[FMT_LEN + 1], struct hot_opcode *op) {
+    int idx;
+
+    op->val = 0;
+    op->n_shift = op->n_bits = op->m_shift = op->m_bits = 0;
+
+    for (idx = 0; idx < FMT_LEN; idx++) {
+        unsigned shift = FMT_LEN - 1 - idx;
+        switch (fmt[idx]) {
+        case '0':
+            break;
+        case '1':
+            op->val |= 1 << shift;
+            break;
+        case 'n':
+            // fields go from msb to lsb, so the last bit we see is the lowest
+            op->n_shift = shift;
+            op->n_bits++;
+            break;
+        case 'm':
+            op->m_shift = shift;
+            op->m_bits++;
+            break;
+        default:
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * find every handler that's marked hot in the contents of sh4_inst.c.  A hot
+ * handler's definition looks like this:
+ *
+ * SH4_INST_HOT
+ * void sh4_inst_binary_add_gen_gen(Sh4 *sh4, Sh4OpArgs inst) {
+ *
+ * returns the number of handlers found.
+ */
+static unsigned find_hot_handlers(char const *src, struct hot_opcode *ops) {
+    static char const marker[] = "\nSH4_INST_HOT\nvoid ";
+    char const *cursor = src;
+    unsigned n_ops = 0;
+
+    while ((cursor = strstr(cursor, marker))) {
+        char const *name = cursor + strlen(marker);
+        size_t len = strcspn(name, "(");
+
+        cursor = name;
+
+        if (!name[len] || len >= MAX_HANDLER_LEN) {
+            fprintf(stderr, "malformed SH4_INST_HOT definition\n");
+            exit(1);
+        }
+
+        if (n_ops >= MAX_HOT_HANDLERS) {
+            fprintf(stderr, "too many SH4_INST_HOT handlers\n");
+            exit(1);
+        }
+
+        memcpy(ops[n_ops].handler, name, len);
+        ops[n_ops].handler[len] = '\0';
+        n_ops++;
+    }
+
+    return n_ops;
+}
+
+static unsigned variant_count(struct hot_opcode const *op) {
+    return 1 << (op->n_bits + op->m_bits);
+}
+
+// returns the instruction for the given variant of op
+static unsigned variant_inst(struct hot_opcode const *op, unsigned variant) {
+    unsigned n = variant >> op->m_bits;
+    unsigned m = variant & ((1 << op->m_bits) - 1);
+
+    return op->val | (n << op->n_shift) | (m << op->m_shift);
+}
+
+int main(int argc, char **argv) {
+    static struct hot_opcode ops[MAX_HOT_HANDLERS];
+    unsigned n_ops, op_no, variant;
+    unsigned n_specializations = 0;
+
+    if (argc != 4) {
+        fprintf(stderr, "usage: %s <sh4_inst_list.h> <sh4_inst.c> <output>\n",
+                argv[0]);
+        return 1;
+    }
+
+    char *list = read_file(argv[1]);
+    char *src = read_file(argv[2]);
+
+    n_ops = find_hot_handlers(src, ops);
+
+    for (op_no = 0; op_no < n_ops; op_no++) {
+        char fmt[FMT_LEN + 1];
+        struct hot_opcode *op = ops + op_no;
+
+        if (find_fmt(list, op->handler, fmt) != 0) {
+            fprintf(stderr, "unable to find %s in %s\n", op->handler, argv[1]);
+            return 1;
+        }
+
+        if (parse_fmt(fmt, op) != 0) {
+            fprintf(stderr, "%s (%s) has operand fields other than n and m\n",
+                    op->handler, fmt);
+            return 1;
+        }
+    }
+
+    FILE *out = fopen(argv[3], "w");
+    if (!out) {
+        fprintf(stderr, "unable to open %s for writing\n", argv[3]);
+        return 1;
+    }
+
+    fprintf(out, "/*\n"
+            " * generated by sh4_inst_gen from %s and %s.\n"
+            " * DO NOT EDIT.  See tool/sh4_inst_gen/sh4_inst_gen.c.\n"
+            " */\n\n", argv[1], argv[2]);
+
+    for (op_no = 0; op_no < n_ops; op_no++) {
+        struct hot_opcode const *op = ops + op_no;
+        for (variant = 0; variant < variant_count(op); variant++) {
+            unsigned inst = variant_inst(op, variant);
+            fprintf(out,
+                    "static void %s_%04x(Sh4 *sh4, Sh4OpArgs inst) {\n"
+                    "    inst.inst = 0x%04x;\n"
+                    "    %s(sh4, inst);\n"
+                    "}\n\n", op->handler, inst, inst, op->handler);
+        }
+    }
+
+    fprintf(out, "static struct sh4_inst_specialization const "
+            "sh4_inst_specializations[] = {\n");
+
+    for (op_no = 0; op_no < n_ops; op_no++) {
+        struct hot_opcode const *op = ops + op_no;
+        for (variant = 0; variant < variant_count(op); variant++) {
+            unsigned inst = variant_inst(op, variant);
+            fprintf(out, "    { 0x%04x, %s_%04x },\n",
+                    inst, op->handler, inst);
+            n_specializations++;
+        }
+    }
+
+    fprintf(out, "};\n\n"
+            "#define SH4_INST_N_SPECIALIZATIONS %u\n", n_specializations);
+
+    fclose(out);
+    free(src);
+    free(list);
+
+    return 0;
+}
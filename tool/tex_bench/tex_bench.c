@@ -0,0 +1,220 @@
+/*******************************************************************************
+ *
+ *
+ *    WashingtonDC Dreamcast Emulator
+ *    Copyright (C) 2017 snickerbockers
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ ******************************************************************************/
+
+
+/*
+ * tex_bench: microbenchmark for the texture detwiddling kernels in
+ * pvr2_twiddle.c
+ *
+ * usage: tex_bench [megabytes]
+ *
+ * For every format and texture size, this converts textures over and over
+ * until it's written about the given number of megabytes (64 by default),
+ * and prints how many megabytes per second that came out to.  The same thing
+ * gets done with a straightforward texel-at-a-time loop for comparison.
+ * Every kernel's output gets checked against that loop first, so this
+ * doubles as a sanity test.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hw/pvr2/pvr2_twiddle.h"
+
+#define DEFAULT_MEGABYTES 64
+
+// largest texture is 1024x1024 at two bytes per texel
+#define MAX_TEX_BYTES (1024 * 1024 * 2)
+
+enum bench_fmt {
+    BENCH_FMT_16,
+    BENCH_FMT_ARGB_4444,
+    BENCH_FMT_8,
+    BENCH_FMT_ARGB_4444_LINEAR,
+
+    BENCH_FMT_COUNT
+};
+
+static char const *fmt_names[BENCH_FMT_COUNT] = {
+    [BENCH_FMT_16] = "16-bit",
+    [BENCH_FMT_ARGB_4444] = "ARGB4444",
+    [BENCH_FMT_8] = "8-bit",
+    [BENCH_FMT_ARGB_4444_LINEAR] = "ARGB4444 (not twiddled)"
+};
+
+static struct {
+    unsigned w_shift, h_shift;
+} const sizes[] = {
+    { 3, 3 }, { 5, 5 }, { 6, 6 }, { 7, 7 }, { 8, 8 }, { 9, 9 }, { 10, 10 },
+    { 8, 6 }, { 6, 8 }, { 10, 8 }, { 8, 10 }
+};
+
+#define N_SIZES (sizeof(sizes) / sizeof(sizes[0]))
+
+static uint8_t src[MAX_TEX_BYTES], dst[MAX_TEX_BYTES], ref[MAX_TEX_BYTES];
+
+/*
+ * the long way of doing it: interleave one bit at a time, then stack the
+ * leftover bits of the longer side on top.
+ */
+static unsigned ref_twiddle(unsigned x, unsigned y,
+                            unsigned w_shift, unsigned h_shift) {
+    unsigned min_shift = w_shift < h_shift ? w_shift : h_shift;
+    unsigned offs = 0, bit;
+
+    for (bit = 0; bit < min_shift; bit++) {
+        offs |= ((y >> bit) & 1) << (2 * bit);
+        offs |= ((x >> bit) & 1) << (2 * bit + 1);
+    }
+
+    return offs | (((x | y) >> min_shift) << (2 * min_shift));
+}
+
+static void ref_conv(enum bench_fmt fmt, unsigned w_shift, unsigned h_shift) {
+    unsigned w = 1 << w_shift, h = 1 << h_shift;
+    unsigned x, y;
+
+    for (y = 0; y < h; y++) {
+        for (x = 0; x < w; x++) {
+            unsigned dst_idx = y * w + x;
+            unsigned src_idx = ref_twiddle(x, y, w_shift, h_shift);
+            uint16_t pix;
+
+            switch (fmt) {
+            case BENCH_FMT_16:
+                memcpy(ref + 2 * dst_idx, src + 2 * src_idx, 2);
+                break;
+            case BENCH_FMT_ARGB_4444:
+            case BENCH_FMT_ARGB_4444_LINEAR:
+                if (fmt == BENCH_FMT_ARGB_4444_LINEAR)
+                    src_idx = dst_idx;
+                memcpy(&pix, src + 2 * src_idx, 2);
+                pix = ((pix & 0xf000) >> 12) | ((pix & 0x0f00) << 4) |
+                    ((pix & 0x00f0) << 4) | ((pix & 0x000f) << 4);
+                memcpy(ref + 2 * dst_idx, &pix, 2);
+                break;
+            case BENCH_FMT_8:
+                ref[dst_idx] = src[src_idx];
+                break;
+            default:
+                abort();
+            }
+        }
+    }
+}
+
+static void kernel_conv(enum bench_fmt fmt,
+                        unsigned w_shift, unsigned h_shift) {
+    switch (fmt) {
+    case BENCH_FMT_16:
+        pvr2_detwiddle_16((uint16_t*)dst, (uint16_t const*)src,
+                          w_shift, h_shift);
+        break;
+    case BENCH_FMT_ARGB_4444:
+        pvr2_detwiddle_argb_4444((uint16_t*)dst, (uint16_t const*)src,
+                                 w_shift, h_shift);
+        break;
+    case BENCH_FMT_8:
+        pvr2_detwiddle_8(dst, src, w_shift, h_shift);
+        break;
+    case BENCH_FMT_ARGB_4444_LINEAR:
+        pvr2_conv_argb_4444((uint16_t*)dst, (uint16_t const*)src,
+                            (size_t)1 << (w_shift + h_shift));
+        break;
+    default:
+        abort();
+    }
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+int main(int argc, char **argv) {
+    unsigned long megabytes = DEFAULT_MEGABYTES;
+    unsigned idx, fmt, size_no;
+
+    if (argc > 1)
+        megabytes = atol(argv[1]);
+
+    if (!megabytes) {
+        fprintf(stderr, "usage: %s [megabytes]\n", argv[0]);
+        return 1;
+    }
+
+    pvr2_twiddle_init();
+
+    srand(0);
+    for (idx = 0; idx < MAX_TEX_BYTES; idx++)
+        src[idx] = rand();
+
+    printf("%-24s %-10s %12s %12s\n", "format", "size",
+           "kernel MB/s", "simple MB/s");
+
+    for (fmt = 0; fmt < BENCH_FMT_COUNT; fmt++) {
+        for (size_no = 0; size_no < N_SIZES; size_no++) {
+            unsigned w_shift = sizes[size_no].w_shift;
+            unsigned h_shift = sizes[size_no].h_shift;
+            size_t n_bytes = ((size_t)1 << (w_shift + h_shift)) *
+                (fmt == BENCH_FMT_8 ? 1 : 2);
+            unsigned long n_iterations = megabytes * 1024 * 1024 / n_bytes;
+            unsigned long iteration;
+            double start_time, kernel_time, simple_time;
+
+            if (!n_iterations)
+                n_iterations = 1;
+
+            ref_conv(fmt, w_shift, h_shift);
+            memset(dst, 0, n_bytes);
+            kernel_conv(fmt, w_shift, h_shift);
+            if (memcmp(dst, ref, n_bytes) != 0) {
+                fprintf(stderr, "ERROR: %s %ux%u doesn't match\n",
+                        fmt_names[fmt], 1 << w_shift, 1 << h_shift);
+                return 1;
+            }
+
+            start_time = now();
+            for (iteration = 0; iteration < n_iterations; iteration++)
+                kernel_conv(fmt, w_shift, h_shift);
+            kernel_time = now() - start_time;
+
+            start_time = now();
+            for (iteration = 0; iteration < n_iterations; iteration++)
+                ref_conv(fmt, w_shift, h_shift);
+            simple_time = now() - start_time;
+
+            char size_str[16];
+            snprintf(size_str, sizeof(size_str), "%ux%u",
+                     1 << w_shift, 1 << h_shift);
+
+            double total_mb = (double)n_bytes * n_iterations / (1024 * 1024);
+            printf("%-24s %-10s %12.1f %12.1f\n", fmt_names[fmt], size_str,
+                   total_mb / kernel_time, total_mb / simple_time);
+        }
+    }
+
+    return 0;
+}